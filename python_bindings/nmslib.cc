@@ -18,7 +18,13 @@
 #include <pybind11/stl.h>
 
 #include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -34,6 +40,9 @@
 #include "spacefactory.h"
 #include "space/space_sparse_vector.h"
 #include "space/space_l2sqr_sift.h"
+#include "space/space_half_vector.h"
+#include "mmap_dataset.h"
+#include "object_arena.h"
 #include "thread_pool.h"
 
 #include "cpu_feature_guard.h"
@@ -63,6 +72,104 @@ AnyParams loadParams(py::object o);
 void exportLegacyAPI(py::module * m);
 void freeAndClearObjectVector(ObjectVector& data);
 
+// pybind11::gil_scoped_acquire can deadlock when acquiring the GIL on threads
+// created from python (https://github.com/nmslib/nmslib/issues/291)
+// This might be fixed in a future version of pybind11 (https://github.com/pybind/pybind11/pull/1211)
+// but until then, lets fall back to the python c-api to fix.
+struct AcquireGIL {
+  PyGILState_STATE state;
+  AcquireGIL()
+    : state(PyGILState_Ensure()) {
+  }
+  ~AcquireGIL() {
+    PyGILState_Release(state);
+  }
+};
+
+/*
+ * Lets asynchronous queries read the index and the data at the same time, while methods
+ * changing them wait for the running queries and hold off new ones
+ * (a shared mutex, which isn't available in C++11).
+ */
+class DataLock {
+ public:
+  void lock_shared() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this]() { return !writer; });
+    ++readers;
+  }
+  void unlock_shared() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--readers == 0) cond.notify_all();
+  }
+  // Must be called without holding the GIL: running queries may need it, e.g., to log
+  void lock() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this]() { return !writer; });
+    writer = true;
+    cond.wait(lock, [this]() { return readers == 0; });
+  }
+  void unlock() {
+    std::lock_guard<std::mutex> lock(mutex);
+    writer = false;
+    cond.notify_all();
+  }
+
+ private:
+  std::mutex mutex;
+  std::condition_variable cond;
+  size_t readers = 0;
+  bool writer = false;
+};
+
+/*
+ * The layout of buffers created by saveIndexToBuffer: this header is followed
+ * by data records (if the data was saved) and by the serialized index. Data records
+ * are laid out as ObjectArena records, so that a loaded index can use them in place.
+ */
+struct IndexBufferHeader {
+  uint64_t magic;
+  uint64_t hasData;
+  uint64_t dataQty;
+  uint64_t dataSize;
+  uint64_t indexSize;
+};
+const uint64_t INDEX_BUFFER_MAGIC = 0x314655424d534d4eULL; // "NMSMBUF1"
+
+// Keeps a python buffer (e.g., bytes or a shared-memory segment) exported while C++ code reads it
+struct PinnedBuffer {
+  explicit PinnedBuffer(py::object obj) {
+    if (PyObject_GetBuffer(obj.ptr(), &view, PyBUF_C_CONTIGUOUS) != 0) {
+      throw py::error_already_set();
+    }
+    // objects are read in place: unaligned memory is copied to a properly aligned block
+    if (reinterpret_cast<uintptr_t>(view.buf) % ObjectArena::RECORD_ALIGN) {
+      copy.reset(new char[view.len]);
+      memcpy(copy.get(), view.buf, view.len);
+    }
+  }
+  ~PinnedBuffer() {
+    AcquireGIL l;
+    PyBuffer_Release(&view);
+  }
+  const char* data() const { return copy ? copy.get() : static_cast<const char*>(view.buf); }
+  size_t size() const { return view.len; }
+
+  Py_buffer view;
+  std::unique_ptr<char[]> copy;
+
+ private:
+  DISABLE_COPY_AND_ASSIGN(PinnedBuffer);
+};
+
+// A read-only stream over a memory block, which, unlike istringstream, doesn't copy the block
+struct MemoryStreamBuf : public std::streambuf {
+  MemoryStreamBuf(const char* p, size_t size) {
+    char* b = const_cast<char*>(p);
+    setg(b, b, b + size);
+  }
+};
+
 // Wrap a space/objectvector/index together for ease of use
 template <typename dist_t>
 struct IndexWrapper {
@@ -73,7 +180,8 @@ struct IndexWrapper {
         DistType dist_type)
       : method(method), space_type(space_type), data_type(data_type), dist_type(dist_type),
         space(SpaceFactoryRegistry<dist_t>::Instance().CreateSpace(space_type,
-                                                                   loadParams(space_params))) {
+                                                                   loadParams(space_params))),
+        arena(new ObjectArena()) {
     auto vectSpacePtr = dynamic_cast<VectorSpace<dist_t>*>(space.get());
     if (data_type == DATATYPE_DENSE_VECTOR && vectSpacePtr == nullptr) {
       throw std::invalid_argument("The space type " + space_type +
@@ -90,6 +198,8 @@ struct IndexWrapper {
     AnyParams params = loadParams(index_params);
 
     py::gil_scoped_release l;
+    stopQueryPool();
+    std::unique_lock<DataLock> lock(dataLock);
     auto factory = MethodFactoryRegistry<dist_t>::Instance();
     index.reset(factory.CreateMethod(print_progress, method, space_type, *space, data));
     index->CreateIndex(params);
@@ -97,13 +207,27 @@ struct IndexWrapper {
 
   void loadIndex(const std::string & filename, bool load_data = false) {
     py::gil_scoped_release l;
+    stopQueryPool();
+    std::unique_lock<DataLock> lock(dataLock);
     auto factory = MethodFactoryRegistry<dist_t>::Instance();
     bool print_progress=false; // We are not going to creat the index anyways, only to load an existing one
     index.reset(factory.CreateMethod(print_progress, method, space_type, *space, data));
     if (load_data) {
       vector<string> dummy;
-      freeAndClearObjectVector(data);
-      space->ReadObjectVectorFromBinData(data, dummy, filename + data_suff);
+      ObjectVector loaded;
+      freeData();
+      try {
+        space->ReadObjectVectorFromBinData(loaded, dummy, filename + data_suff);
+      } catch (...) {
+        for (const Object* obj : loaded) delete obj;
+        throw;
+      }
+      // Each object is freed right after it is copied into the arena
+      ObjectArena::Region region(*arena);
+      for (const Object* obj : loaded) {
+        data.push_back(region.Copy(obj));
+        delete obj;
+      }
     }
     index->LoadIndex(filename);
 
@@ -124,6 +248,86 @@ struct IndexWrapper {
     index->SaveIndex(filename);
   }
 
+  // Serializes the index and, optionally, the data into a single bytes object
+  py::bytes saveIndexToBuffer(bool save_data = false) {
+    if (!index) {
+      throw std::invalid_argument("Must call createIndex or loadIndex before this method");
+    }
+    IndexBufferHeader header = {INDEX_BUFFER_MAGIC, save_data, 0, 0, 0};
+    std::string indexStr;
+    {
+      py::gil_scoped_release l;
+      std::ostringstream output(std::ios::binary);
+      output.exceptions(std::ios::badbit | std::ios::failbit);
+      index->SaveIndexToStream(output);
+      indexStr = output.str();
+      if (save_data) {
+        header.dataQty = data.size();
+        for (const Object* obj : data) {
+          header.dataSize += ObjectArena::RecordSize(obj->datalength());
+        }
+      }
+      header.indexSize = indexStr.size();
+    }
+
+    size_t totalSize = sizeof(header) + header.dataSize + header.indexSize;
+    auto ret = py::reinterpret_steal<py::bytes>(PyBytes_FromStringAndSize(nullptr, totalSize));
+    if (!ret) throw py::error_already_set();
+    char* p = PyBytes_AS_STRING(ret.ptr());
+    {
+      py::gil_scoped_release l;
+      memcpy(p, &header, sizeof(header));
+      p += sizeof(header);
+      for (size_t i = 0; i < header.dataQty; ++i) {
+        size_t recSize = ObjectArena::RecordSize(data[i]->datalength());
+        memcpy(p, data[i]->buffer(), data[i]->bufferlength());
+        memset(p + data[i]->bufferlength(), 0, recSize - data[i]->bufferlength());
+        p += recSize;
+      }
+      memcpy(p, indexStr.data(), indexStr.size());
+    }
+    return ret;
+  }
+
+  // Loads the index from a buffer created by saveIndexToBuffer. The loaded data isn't copied:
+  // objects point into the buffer, which is kept alive as long as the data is used.
+  void loadIndexFromBuffer(py::object buffer, bool load_data = false) {
+    std::shared_ptr<PinnedBuffer> pinned(new PinnedBuffer(buffer));
+    IndexBufferHeader header;
+    if (pinned->size() < sizeof(header)) {
+      throw std::invalid_argument("The buffer is too small to contain an index");
+    }
+    memcpy(&header, pinned->data(), sizeof(header));
+    if (header.magic != INDEX_BUFFER_MAGIC) {
+      throw std::invalid_argument("The buffer wasn't created by saveIndexToBuffer");
+    }
+    if (sizeof(header) + header.dataSize + header.indexSize > pinned->size()) {
+      throw std::invalid_argument("The buffer is truncated");
+    }
+    if (load_data && !header.hasData) {
+      throw std::invalid_argument("The buffer doesn't contain data, it was saved with save_data=False");
+    }
+
+    const char* pData = pinned->data() + sizeof(header);
+    py::gil_scoped_release l;
+    stopQueryPool();
+    std::unique_lock<DataLock> lock(dataLock);
+    auto factory = MethodFactoryRegistry<dist_t>::Instance();
+    index.reset(factory.CreateMethod(false, method, space_type, *space, data));
+    if (load_data) {
+      freeData();
+      // The arena keeps the buffer
+      if (arena->AttachRecords(pinned, pData, header.dataSize, header.dataQty, data) != header.dataQty) {
+        throw std::runtime_error("Corrupted data records");
+      }
+    }
+    MemoryStreamBuf streamBuf(pData + header.dataSize, header.indexSize);
+    std::istream input(&streamBuf);
+    input.exceptions(std::ios::badbit | std::ios::failbit);
+    index->LoadIndexFromStream(input);
+    index->ResetQueryTimeParams();
+  }
+
   py::object knnQuery(py::object input, size_t k) {
     if (!index) {
       throw std::invalid_argument("Must call createIndex or loadIndex before this method");
@@ -139,13 +343,73 @@ struct IndexWrapper {
     return convertResult(res.get());
   }
 
+  // Enqueues the query to the worker pool of the index and returns a concurrent.futures.Future.
+  // The search runs without the GIL, which is re-acquired only to set the result of the future.
+  py::object knnQueryAsync(py::object input, size_t k) {
+    if (!index) {
+      throw std::invalid_argument("Must call createIndex or loadIndex before this method");
+    }
+
+    std::shared_ptr<const Object> query(readObject(input));
+    py::object future = py::module::import("concurrent.futures").attr("Future")();
+    // The reference is stolen back by the job, which releases it while holding the GIL
+    PyObject * pFuture = future.inc_ref().ptr();
+    if (!queryPool) {
+      queryPool.reset(new ThreadPool(0));
+    }
+    queryPool->Submit([this, query, k, pFuture]() {
+      std::unique_ptr<KNNQueue<dist_t>> res;
+      std::string error;
+      // methods changing the index or the data wait until the search is over
+      dataLock.lock_shared();
+      try {
+        KNNQuery<dist_t> knn(*space, query.get(), k);
+        index->Search(&knn, -1);
+        res.reset(knn.Result()->Clone());
+      } catch (const std::exception & e) {
+        error = e.what();
+      } catch (...) {
+        error = "Unknown error";
+      }
+      dataLock.unlock_shared();
+
+      AcquireGIL l;
+      py::object future = py::reinterpret_steal<py::object>(pFuture);
+      try {
+        // the future is not set, if it was cancelled in the meantime
+        if (future.attr("set_running_or_notify_cancel")().cast<bool>()) {
+          if (res) {
+            future.attr("set_result")(convertResult(res.get()));
+          } else {
+            future.attr("set_exception")(py::module::import("builtins").attr("RuntimeError")(error));
+          }
+        }
+      } catch (const py::error_already_set &) {
+        // there is nobody to report the error to
+      }
+    });
+    return future;
+  }
+
+  // Waits for the pending asynchronous queries: must be called without holding the GIL
+  void stopQueryPool() {
+    queryPool.reset();
+  }
+
+  // Waits for the running asynchronous queries and keeps new ones from reading
+  // the index and the data until the lock is released: must be called holding the GIL
+  std::unique_lock<DataLock> lockData() {
+    py::gil_scoped_release l;
+    return std::unique_lock<DataLock>(dataLock);
+  }
+
   py::object knnQueryBatch(py::object input, size_t k, int num_threads) {
     if (!index) {
       throw std::invalid_argument("Must call createIndex or loadIndex before this method");
     }
 
     ObjectVector queries;
-    readObjectVector(input, &queries);
+    readObjectVector(input, &queries, py::none(), num_threads);
     std::vector<std::unique_ptr<KNNQueue<dist_t>>> results(queries.size());
     {
       py::gil_scoped_release l;
@@ -167,6 +431,86 @@ struct IndexWrapper {
     return ret;
   }
 
+  // Writes results directly into (nq, k) numpy arrays: no per-query python objects are created
+  // and the GIL is released for the whole search & fill. Short results are padded with
+  // the id -1 and the largest possible distance (infinity for floating point distances)
+  py::object knnQueryBatchArrays(py::object input, size_t k, int num_threads,
+                                 py::object ids_out, py::object distances_out) {
+    if (!index) {
+      throw std::invalid_argument("Must call createIndex or loadIndex before this method");
+    }
+
+    ObjectVector queries;
+    readObjectVector(input, &queries, py::none(), num_threads);
+    size_t nq = queries.size();
+
+    py::array_t<int32_t, py::array::c_style> ids;
+    py::array_t<dist_t, py::array::c_style> distances;
+    try {
+      ids = getOutputArray<int32_t>(ids_out, nq, k, "ids");
+      distances = getOutputArray<dist_t>(distances_out, nq, k, "distances");
+    } catch (...) {
+      freeAndClearObjectVector(queries);
+      throw;
+    }
+
+    int32_t* pIds = ids.mutable_data();
+    dist_t*  pDists = distances.mutable_data();
+    const dist_t padDist = std::numeric_limits<dist_t>::has_infinity ?
+                           std::numeric_limits<dist_t>::infinity() :
+                           std::numeric_limits<dist_t>::max();
+    {
+      py::gil_scoped_release l;
+
+      ParallelFor(0, nq, num_threads, [&](size_t query_index, size_t threadId) {
+        KNNQuery<dist_t> knn(*space, queries[query_index], k);
+        index->Search(&knn, -1);
+        std::unique_ptr<KNNQueue<dist_t>> res(knn.Result()->Clone());
+
+        int32_t* rowIds = pIds + query_index * k;
+        dist_t*  rowDists = pDists + query_index * k;
+        size_t   size = std::min(res->Size(), k);
+        std::fill(rowIds + size, rowIds + k, -1);
+        std::fill(rowDists + size, rowDists + k, padDist);
+        // the queue returns the farthest neighbour first
+        while (!res->Empty() && size > 0) {
+          size -= 1;
+          rowIds[size] = res->TopObject()->id();
+          rowDists[size] = res->TopDistance();
+          res->Pop();
+        }
+      });
+
+      freeAndClearObjectVector(queries);
+    }
+
+    return py::make_tuple(ids, distances);
+  }
+
+  // Allocates a new (rows, cols) array or checks that a caller-provided one can be written to directly
+  template <typename T>
+  py::array_t<T, py::array::c_style> getOutputArray(py::object out, size_t rows, size_t cols,
+                                                    const std::string & name) {
+    if (out.is_none()) {
+      return py::array_t<T, py::array::c_style>({rows, cols});
+    }
+    if (!py::isinstance<py::array_t<T, py::array::c_style>>(out)) {
+      throw std::invalid_argument("The output array '" + name +
+                                  "' must be a C-contiguous numpy array of the type " +
+                                  py::str(py::dtype::of<T>()).cast<std::string>());
+    }
+    auto ret = py::reinterpret_borrow<py::array_t<T, py::array::c_style>>(out);
+    if (ret.ndim() != 2 || size_t(ret.shape(0)) != rows || size_t(ret.shape(1)) != cols) {
+      std::stringstream err;
+      err << "The output array '" << name << "' must have the shape (" << rows << ", " << cols << ")";
+      throw std::invalid_argument(err.str());
+    }
+    if (!ret.writeable()) {
+      throw std::invalid_argument("The output array '" + name + "' is read-only");
+    }
+    return ret;
+  }
+
   py::object convertResult(KNNQueue<dist_t> * res) {
     // Create numpy arrays for the output
     size_t size = res->Size();
@@ -183,21 +527,29 @@ struct IndexWrapper {
     return py::make_tuple(ids, distances);
   }
 
+  // Returns the fp16 space if the input is a float16 numpy array: its data is used as is (without conversion)
+  const VectorSpaceHalf<kHalfFloatFP16>* getFP16Space(py::object input) const {
+    if (!py::isinstance<py::array>(input)) return nullptr;
+    py::dtype dt = py::reinterpret_borrow<py::array>(input).dtype();
+    if (dt.kind() != 'f' || dt.itemsize() != sizeof(uint16_t)) return nullptr;
+    return dynamic_cast<const VectorSpaceHalf<kHalfFloatFP16>*>(space.get());
+  }
+
   const Object * readObject(py::object input, int id = 0) {
     switch (data_type) {
       case DATATYPE_DENSE_VECTOR: {
+        if (auto fp16Space = getFP16Space(input)) {
+          py::array temp = py::array::ensure(input, py::array::c_style);
+          return fp16Space->CreateObjFromHalfArray(id, -1, static_cast<const uint16_t*>(temp.data()), temp.size());
+        }
         py::array_t<dist_t, py::array::c_style | py::array::forcecast> temp(input);
-        std::vector<dist_t> tempVect(temp.data(0), temp.data(0) + temp.size());
         auto vectSpacePtr = reinterpret_cast<VectorSpace<dist_t>*>(space.get());
-        return vectSpacePtr->CreateObjFromVect(id, -1, tempVect);
-        // This way it will not always work properly
-        //return new Object(id, -1, temp.size() * sizeof(dist_t), temp.data(0));
+        return vectSpacePtr->CreateObjFromArray(id, -1, temp.data(), temp.size());
       }
       case DATATYPE_DENSE_UINT8_VECTOR: {
-        py::array_t<uint8_t> temp(input);
-        std::vector<uint8_t> tempVect(temp.data(0), temp.data(0) + temp.size());
+        py::array_t<uint8_t, py::array::c_style | py::array::forcecast> temp(input);
         auto vectSiftPtr = reinterpret_cast<SpaceL2SqrSift*>(space.get());
-        return vectSiftPtr->CreateObjFromUint8Vect(id, -1, tempVect);
+        return vectSiftPtr->CreateObjFromUint8Array(id, -1, temp.data(), temp.size());
       }
       case DATATYPE_OBJECT_AS_STRING: {
         std::string temp = py::cast<std::string>(input);
@@ -222,21 +574,40 @@ struct IndexWrapper {
   }
 
   // reads multiple items from a python object and inserts onto a similarity::ObjectVector
-  // returns the number of elements inserted
+  // returns the number of elements inserted. Numpy matrices and CSR matrices are converted
+  // directly from their buffers in parallel (with the GIL released). If the arena isn't
+  // nullptr, objects are created in the arena
   size_t readObjectVector(py::object input, ObjectVector * output,
-                          py::object ids_ = py::none()) {
-    std::vector<int> ids;
-    if (!ids_.is_none()) {
-      ids = py::cast<std::vector<int>>(ids_);
-    }
+                          py::object ids_ = py::none(), int num_threads = 0,
+                          ObjectArena * arena = nullptr) {
+    std::vector<int> ids = readIds(ids_);
 
     if (py::isinstance<py::list>(input)) {
       py::list items(input);
+      checkIdQty(ids, items.size());
+      std::unique_ptr<ObjectArena::Region> region(arena ? new ObjectArena::Region(*arena) : nullptr);
       for (size_t i = 0; i < items.size(); ++i) {
-        output->push_back(readObject(items[i], ids.size() ? ids.at(i) : i));
+        std::unique_ptr<const Object> obj(readObject(items[i], ids.size() ? ids[i] : i));
+        output->push_back(region ? region->Copy(obj.get()) : obj.release());
       }
       return items.size();
 
+    } else if (data_type == DATATYPE_DENSE_VECTOR && getFP16Space(input) != nullptr) {
+      auto fp16Space = getFP16Space(input);
+      py::array items = py::array::ensure(input, py::array::c_style);
+      if (items.ndim() != 2) throw std::runtime_error("data must be a 2d array");
+
+      size_t rows = items.shape(0), features = items.shape(1);
+      checkIdQty(ids, rows);
+      const uint16_t* pItems = static_cast<const uint16_t*>(items.data());
+      {
+        py::gil_scoped_release l;
+        createObjectsParallel(arena, rows, num_threads, output, [&](size_t row) {
+          return fp16Space->CreateObjFromHalfArray(ids.size() ? ids[row] : row, -1,
+                                                   pItems + row * features, features);
+        });
+      }
+      return rows;
     } else if (data_type == DATATYPE_DENSE_VECTOR) {
       // allow numpy arrays to be returned here too
       py::array_t<dist_t, py::array::c_style | py::array::forcecast> items(input);
@@ -244,15 +615,15 @@ struct IndexWrapper {
       if (buffer.ndim != 2) throw std::runtime_error("data must be a 2d array");
 
       size_t rows = buffer.shape[0], features = buffer.shape[1];
-      std::vector<dist_t> tempVect(features);
+      checkIdQty(ids, rows);
+      const dist_t* pItems = items.data();
       auto vectSpacePtr = reinterpret_cast<VectorSpace<dist_t>*>(space.get());
-      for (size_t row = 0; row < rows; ++row) {
-        int id = ids.size() ? ids.at(row) : row;
-        const dist_t* elemVecStart = items.data(row);
-        std::copy(elemVecStart, elemVecStart + features, tempVect.begin());
-        output->push_back(vectSpacePtr->CreateObjFromVect(id, -1, tempVect));
-        //this way it won't always work properly
-        //output->push_back(new Object(id, -1, features * sizeof(dist_t), items.data(row)));
+      {
+        py::gil_scoped_release l;
+        createObjectsParallel(arena, rows, num_threads, output, [&](size_t row) {
+          return vectSpacePtr->CreateObjFromArray(ids.size() ? ids[row] : row, -1,
+                                                  pItems + row * features, features);
+        });
       }
       return rows;
     } else if (data_type == DATATYPE_DENSE_UINT8_VECTOR) {
@@ -262,13 +633,15 @@ struct IndexWrapper {
       if (buffer.ndim != 2) throw std::runtime_error("data must be a 2d array");
 
       size_t rows = buffer.shape[0], features = buffer.shape[1];
-      std::vector<uint8_t> tempVect(features);
+      checkIdQty(ids, rows);
+      const uint8_t* pItems = items.data();
       auto vectSiftPtr = reinterpret_cast<SpaceL2SqrSift*>(space.get());
-      for (size_t row = 0; row < rows; ++row) {
-        int id = ids.size() ? ids.at(row) : row;
-        const uint8_t* elemVecStart = items.data(row);
-        std::copy(elemVecStart, elemVecStart + features, tempVect.begin());
-        output->push_back(vectSiftPtr->CreateObjFromUint8Vect(id, -1, tempVect));
+      {
+        py::gil_scoped_release l;
+        createObjectsParallel(arena, rows, num_threads, output, [&](size_t row) {
+          return vectSiftPtr->CreateObjFromUint8Array(ids.size() ? ids[row] : row, -1,
+                                                      pItems + row * features, features);
+        });
       }
       return rows;
 
@@ -280,38 +653,90 @@ struct IndexWrapper {
       }
 
       // try to intrepret input data as a CSR matrix
-      py::array_t<int> indptr(input.attr("indptr"));
-      py::array_t<int> indices(input.attr("indices"));
-      py::array_t<dist_t> sparse_data(input.attr("data"));
+      py::array_t<int, py::array::c_style | py::array::forcecast> indptr(input.attr("indptr"));
+      py::array_t<int, py::array::c_style | py::array::forcecast> indices(input.attr("indices"));
+      py::array_t<dist_t, py::array::c_style | py::array::forcecast> sparse_data(input.attr("data"));
+
+      size_t rows = indptr.size() ? indptr.size() - 1 : 0;
+      checkIdQty(ids, rows);
+      const int*    pIndptr = indptr.data();
+      const int*    pIndices = indices.data();
+      const dist_t* pValues = sparse_data.data();
+      const size_t  elemQty = std::min<size_t>(indices.size(), sparse_data.size());
 
       // read each row from the sparse matrix, and insert
       auto sparse_space = reinterpret_cast<const SpaceSparseVector<dist_t>*>(space.get());
-      std::vector<SparseVectElem<dist_t>> sparse_items;
-      for (int rowid = 0; rowid < indptr.size() - 1; ++rowid) {
-        sparse_items.clear();
-
-        for (int i = indptr.at(rowid); i < indptr.at(rowid + 1); ++i) {
-          sparse_items.push_back(SparseVectElem<dist_t>(indices.at(i),
-                                 sparse_data.at(i)));
-        }
-        std::sort(sparse_items.begin(), sparse_items.end());
-
-        int id = ids.size() ? ids.at(rowid) : rowid;
-        output->push_back(sparse_space->CreateObjFromVect(id, -1, sparse_items));
+      {
+        py::gil_scoped_release l;
+        createObjectsParallel(arena, rows, num_threads, output, [&](size_t row) {
+          int rowStart = pIndptr[row], rowEnd = pIndptr[row + 1];
+          if (rowStart < 0 || rowStart > rowEnd || size_t(rowEnd) > elemQty) {
+            throw std::invalid_argument("Invalid CSR matrix: wrong indptr values in the row " +
+                                        std::to_string(row));
+          }
+          std::vector<SparseVectElem<dist_t>> sparse_items;
+          sparse_items.reserve(rowEnd - rowStart);
+          for (int i = rowStart; i < rowEnd; ++i) {
+            sparse_items.push_back(SparseVectElem<dist_t>(pIndices[i], pValues[i]));
+          }
+          std::sort(sparse_items.begin(), sparse_items.end());
+
+          return sparse_space->CreateObjFromVect(ids.size() ? ids[row] : row, -1, sparse_items);
+        });
       }
-      return indptr.size() - 1;
+      return rows;
     }
 
     throw std::invalid_argument("Unknown data type");
   }
 
+  static std::vector<int> readIds(py::object ids_) {
+    std::vector<int> ids;
+    if (!ids_.is_none()) {
+      py::array_t<int, py::array::c_style | py::array::forcecast> idArr(ids_);
+      ids.assign(idArr.data(), idArr.data() + idArr.size());
+    }
+    return ids;
+  }
+
+  static void checkIdQty(const std::vector<int> & ids, size_t rows) {
+    if (!ids.empty() && ids.size() < rows) {
+      std::stringstream err;
+      err << "The number of ids (" << ids.size() << ") is smaller than the number of objects (" << rows << ")";
+      throw std::invalid_argument(err.str());
+    }
+  }
+
+  // Appends rows objects created by createObj(row) using several threads. Objects are created
+  // in place, so the order is preserved. If any of the calls fails, nothing is appended.
+  template <class CreateFunc>
+  static void createObjectsParallel(ObjectArena * arena, size_t rows, int num_threads, ObjectVector * output,
+                                    CreateFunc createObj) {
+    CreateObjectsParallel(arena, rows, ingestThreadQty(rows, num_threads), *output, createObj);
+  }
+
+  static size_t ingestThreadQty(size_t rows, int num_threads) {
+    // Starting a thread costs about as much as creating a thousand of small objects
+    const size_t minRowsPerThread = 1024;
+    size_t threadQty = num_threads > 0 ? num_threads : std::thread::hardware_concurrency();
+    return std::max<size_t>(1, std::min(threadQty, rows / minRowsPerThread));
+  }
+
+  // Data objects are stored in the arena, which frees them all at once
+  void freeData() {
+    data.clear();
+    arena.reset(new ObjectArena());
+  }
+
   py::object writeObject(const Object * obj) {
     switch (data_type) {
       case DATATYPE_DENSE_VECTOR: {
         auto vectSpacePtr = reinterpret_cast<VectorSpace<dist_t>*>(space.get());
         py::list ret;
-        const dist_t * values = reinterpret_cast<const dist_t *>(obj->data());
+        // The space may store vectors differently, e.g., using 16-bit numbers
         size_t elemQty = vectSpacePtr->GetElemQty(obj);
+        std::vector<dist_t> values(elemQty);
+        vectSpacePtr->CreateDenseVectFromObj(obj, values.data(), elemQty);
         for (size_t i = 0; i < elemQty; ++i) {
           ret.append(py::cast(values[i]));
         }
@@ -335,12 +760,25 @@ struct IndexWrapper {
   }
 
   size_t addDataPoint(int id, py::object input) {
-    data.push_back(readObject(input, id));
+    auto lock = lockData();
+    std::unique_ptr<const Object> obj(readObject(input, id));
+    data.push_back(arena->Copy(obj.get()));
     return data.size() - 1;
   }
 
-  size_t addDataPointBatch(py::object input, py::object ids = py::none()) {
-    return readObjectVector(input, &data, ids);
+  // Objects are created directly in the arena, which stores them contiguously
+  size_t addDataPointBatch(py::object input, py::object ids = py::none(), int num_threads = 0) {
+    auto lock = lockData();
+    return readObjectVector(input, &data, ids, num_threads, arena.get());
+  }
+
+  size_t loadDataFile(const std::string & filename, int num_threads = 0) {
+    std::vector<std::string> externIds;
+    py::gil_scoped_release l;
+    std::unique_lock<DataLock> lock(dataLock);
+    size_t start = data.size();
+    ReadMmapDataset(*space, filename, *arena, data, externIds, MAX_DATASET_QTY, num_threads);
+    return data.size() - start;
   }
 
   inline size_t size() const { return data.size(); }
@@ -363,7 +801,12 @@ struct IndexWrapper {
     // In cases when the interpreter was shutting down, attempting to log in python
     // could throw an exception (https://github.com/nmslib/nmslib/issues/327).
     //LOG(LIB_DEBUG) << "Destroying Index";
-    freeAndClearObjectVector(data);
+    if (queryPool) {
+      // pending asynchronous queries need the GIL to complete
+      py::gil_scoped_release l;
+      stopQueryPool();
+    }
+    freeData();
   }
 
   std::string method;
@@ -373,20 +816,13 @@ struct IndexWrapper {
   std::unique_ptr<Space<dist_t>> space;
   std::unique_ptr<Index<dist_t>> index;
   ObjectVector data;
-};
-
-// pybind11::gil_scoped_acquire can deadlock when acquiring the GIL on threads
-// created from python (https://github.com/nmslib/nmslib/issues/291)
-// This might be fixed in a future version of pybind11 (https://github.com/pybind/pybind11/pull/1211)
-// but until then, lets fall back to the python c-api to fix.
-struct AcquireGIL {
-  PyGILState_STATE state;
-  AcquireGIL()
-    : state(PyGILState_Ensure()) {
-  }
-  ~AcquireGIL() {
-    PyGILState_Release(state);
-  }
+  // data objects added by addDataPoint(Batch) and loaded by loadDataFile or loadIndex(FromBuffer);
+  // the arena also keeps memory-mapped files and buffers data objects point into
+  std::unique_ptr<ObjectArena> arena;
+  // workers of knnQueryAsync, created on the first call
+  std::unique_ptr<ThreadPool> queryPool;
+  // held by knnQueryAsync workers for reading and by methods changing the index or the data
+  DataLock dataLock;
 };
 
 class PythonLogger
@@ -556,6 +992,27 @@ void exportIndex(py::module * m) {
       "distances: array_like.\n"
       "    A 1D vector of the distance to each nearest neigbhour.\n")
 
+    .def("knnQueryAsync", &IndexWrapper<dist_t>::knnQueryAsync,
+      py::arg("vector"), py::arg("k") = 10,
+      "Submits a query to the pool of worker threads owned by the index and \n"
+      "returns immediately. Unlike knnQuery, the calling thread is not blocked, \n"
+      "so that many small concurrent queries can keep all the cores busy. \n"
+      "Methods that change the index or the data, e.g., addDataPointBatch or \n"
+      "createIndex, wait for the running queries to finish\n\n"
+      "Parameters\n"
+      "----------\n"
+      "vector: array_like\n"
+      "    A 1D vector to query for.\n"
+      "k: int optional\n"
+      "    The number of neighbours to return\n"
+      "\n"
+      "Returns\n"
+      "----------\n"
+      "future: concurrent.futures.Future\n"
+      "    A future with the tuple (ids, distances) as in knnQuery. This is not \n"
+      "    an asyncio future and it can't be awaited directly: in asyncio code, \n"
+      "    use ``await asyncio.wrap_future(future)``\n")
+
     .def("knnQueryBatch", &IndexWrapper<dist_t>::knnQueryBatch,
       py::arg("queries"), py::arg("k") = 10, py::arg("num_threads") = 0,
       "Performs multiple queries on the index, distributing the work over \n"
@@ -574,6 +1031,35 @@ void exportIndex(py::module * m) {
       "list:\n"
       "   A list of tuples of (ids, distances)\n ")
 
+    .def("knnQueryBatchArrays", &IndexWrapper<dist_t>::knnQueryBatchArrays,
+      py::arg("queries"), py::arg("k") = 10, py::arg("num_threads") = 0,
+      py::arg("ids") = py::none(), py::arg("distances") = py::none(),
+      "Performs multiple queries on the index, distributing the work over \n"
+      "a thread pool, and returns results as two dense matrices. This is \n"
+      "faster than knnQueryBatch for large batches\n\n"
+      "Parameters\n"
+      "----------\n"
+      "input: list\n"
+      "    A list of queries to query for\n"
+      "k: int optional\n"
+      "    The number of neighbours to return\n"
+      "num_threads: int optional\n"
+      "    The number of threads to use\n"
+      "ids: array_like optional\n"
+      "    A C-contiguous int32 array of the shape (number of queries, k) to write ids to\n"
+      "distances: array_like optional\n"
+      "    A C-contiguous array of the shape (number of queries, k) and of the distance type \n"
+      "    (float32 or int32) to write distances to\n"
+      "\n"
+      "Returns\n"
+      "----------\n"
+      "ids: array_like.\n"
+      "    A (number of queries, k) matrix of ids of nearest neighbours, the rows of queries \n"
+      "    with fewer than k neighbours are padded with -1\n"
+      "distances: array_like.\n"
+      "    A (number of queries, k) matrix of distances, padded with the largest possible \n"
+      "    distance value (inf for float distances)\n")
+
     .def("loadIndex", &IndexWrapper<dist_t>::loadIndex,
       py::arg("filename"),
       py::arg("load_data") = false,
@@ -596,9 +1082,45 @@ void exportIndex(py::module * m) {
       "save_data: bool optional\n"
       "    Whether or not to save data\n")
 
+    .def("saveIndexToBuffer", &IndexWrapper<dist_t>::saveIndexToBuffer,
+      py::arg("save_data") = false,
+      "Saves the index (and, optionally, the data) to an in-memory buffer \n"
+      "instead of a file. Only methods that save the index in a single file \n"
+      "(e.g., hnsw and vptree) support it\n\n"
+      "Parameters\n"
+      "----------\n"
+      "save_data: bool optional\n"
+      "    When set to True, the data is saved as well\n"
+      "\n"
+      "Returns\n"
+      "----------\n"
+      "bytes:\n"
+      "    The serialized index\n")
+
+    .def("loadIndexFromBuffer", &IndexWrapper<dist_t>::loadIndexFromBuffer,
+      py::arg("buffer"),
+      py::arg("load_data") = false,
+      "Loads the index from a buffer created by saveIndexToBuffer: bytes, bytearray, \n"
+      "mmap or, e.g., the buf attribute of multiprocessing.shared_memory.SharedMemory. \n"
+      "The loaded data is not copied: data points are used in place, so that processes \n"
+      "attached to the same shared-memory segment share a single copy of the data. \n"
+      "The buffer must not be modified while the index is used\n\n"
+      "Parameters\n"
+      "----------\n"
+      "buffer: buffer\n"
+      "    The buffer to load the index from\n"
+      "load_data: bool optional\n"
+      "    When set to True, the data is loaded as well\n")
+
     .def("setQueryTimeParams",
       [](IndexWrapper<dist_t> * self, py::object params) {
-        self->index->SetQueryTimeParams(loadParams(params));
+        if (!self->index) {
+          throw std::invalid_argument("Must call createIndex or loadIndex before this method");
+        }
+        AnyParams queryParams = loadParams(params);
+        // Asynchronous queries read query-time parameters without the GIL
+        auto lock = self->lockData();
+        self->index->SetQueryTimeParams(queryParams);
       }, py::arg("params") = py::none(),
       "Sets parameters used in knnQuery.\n\n"
       "Parameters\n"
@@ -624,6 +1146,7 @@ void exportIndex(py::module * m) {
     .def("addDataPointBatch", &IndexWrapper<dist_t>::addDataPointBatch,
       py::arg("data"),
       py::arg("ids") = py::none(),
+      py::arg("num_threads") = 0,
       "Adds multiple datapoints to the index\n\n"
       "Parameters\n"
       "----------\n"
@@ -632,6 +1155,29 @@ void exportIndex(py::module * m) {
       "ids: array_like optional\n"
       "    The ids of the object being inserted. If not set will default to the \n"
       "    row id of each object in the dataset\n"
+      "num_threads: int optional\n"
+      "    The number of threads used to convert numpy matrices and CSR matrices \n"
+      "    (by default all the cores are used)\n"
+      "Returns\n"
+      "----------\n"
+      "int\n"
+      "    The number of items added\n")
+
+    .def("loadDataFile", &IndexWrapper<dist_t>::loadDataFile,
+      py::arg("filename"),
+      py::arg("num_threads") = 0,
+      "Memory-maps a binary data file and adds its objects to the index\n\n"
+      "Parameters\n"
+      "----------\n"
+      "filename: str\n"
+      "    The file to load. The format is determined by the extension: .fvecs, .ivecs and .bvecs\n"
+      "    (each vector is preceded by its dimensionality), .fbin and .u8bin (a header with the\n"
+      "    number of vectors and the dimensionality followed by a float32 or uint8 matrix).\n"
+      "    Vectors of these formats are copied to the index once. Only .objs files (object records\n"
+      "    saved by NMSLIB) are used in place without copying.\n"
+      "    Ids are positions of objects in the file (.objs records keep their stored ids)\n"
+      "num_threads: int optional\n"
+      "    The number of threads used to convert vectors (by default all the cores are used)\n"
       "Returns\n"
       "----------\n"
       "int\n"
@@ -1,3 +1,4 @@
+import asyncio
 import itertools
 import tempfile
 import unittest
@@ -165,6 +166,83 @@ class DenseIndexTestMixin(object):
             ids = np.sqrt(ids).astype(int)
             self.assertTrue(get_hitrate(get_exact_cosine(query, data), ids) >= 5)
 
+    def testKnnQueryAsync(self):
+        np.random.seed(23)
+        data = np.random.randn(1000, 10).astype(np.float32)
+
+        index = self._get_index()
+        index.addDataPointBatch(data)
+        index.createIndex()
+
+        queries = data[:20]
+        futures = [index.knnQueryAsync(query, k=10) for query in queries]
+        for query, future in zip(queries, futures):
+            self.assert_allclose(index.knnQuery(query, k=10), future.result(timeout=60))
+
+        # futures can be awaited in asyncio code
+        loop = asyncio.new_event_loop()
+        try:
+            results = loop.run_until_complete(asyncio.gather(
+                *[asyncio.wrap_future(index.knnQueryAsync(query, k=10), loop=loop) for query in queries]))
+        finally:
+            loop.close()
+        for query, result in zip(queries, results):
+            self.assert_allclose(index.knnQuery(query, k=10), result)
+
+        # adding data waits for the pending queries, which still see the old index
+        expected = [index.knnQuery(query, k=10) for query in queries]
+        futures = [index.knnQueryAsync(query, k=10) for query in queries]
+        index.addDataPointBatch(np.random.randn(5000, 10).astype(np.float32))
+        for exp, future in zip(expected, futures):
+            self.assert_allclose(exp, future.result(timeout=60))
+
+        # query-time parameters can be changed while queries are pending
+        futures = [index.knnQueryAsync(query, k=10) for query in queries]
+        index.setQueryTimeParams()
+        for future in futures:
+            self.assertEqual(len(future.result(timeout=60)[0]), 10)
+
+        with self.assertRaises(ValueError):
+            self._get_index().setQueryTimeParams()
+
+    def testKnnQueryBatchArrays(self):
+        np.random.seed(23)
+        data = np.random.randn(1000, 10).astype(np.float32)
+
+        index = self._get_index()
+        index.addDataPointBatch(data)
+        index.createIndex()
+
+        queries = data[:10]
+        ids, distances = index.knnQueryBatchArrays(queries, k=10)
+        self.assertEqual(ids.shape, (10, 10))
+        self.assertEqual(ids.dtype, np.int32)
+        self.assertEqual(distances.shape, (10, 10))
+        for query_ids, query_dists, result in zip(ids, distances, index.knnQueryBatch(queries, k=10)):
+            self.assert_allclose(result, (query_ids, query_dists))
+
+        # results can be written into caller-provided buffers
+        out_ids = np.zeros((10, 10), dtype=np.int32)
+        out_dists = np.zeros((10, 10), dtype=np.float32)
+        ret_ids, ret_dists = index.knnQueryBatchArrays(queries, k=10, ids=out_ids, distances=out_dists)
+        self.assertTrue(ret_ids is out_ids)
+        npt.assert_array_equal(out_ids, ids)
+        npt.assert_allclose(out_dists, distances, rtol=RTOL, atol=ATOL)
+
+        with self.assertRaises(ValueError):
+            index.knnQueryBatchArrays(queries, k=10, ids=np.zeros((5, 10), dtype=np.int32))
+        with self.assertRaises(ValueError):
+            index.knnQueryBatchArrays(queries, k=10, ids=np.zeros((10, 10), dtype=np.int64))
+
+        # short results are padded
+        small = self._get_index()
+        small.addDataPointBatch(data[:5])
+        small.createIndex()
+        ids, distances = small.knnQueryBatchArrays(queries, k=10)
+        npt.assert_array_equal(ids[:, 5:], -1)
+        self.assertTrue(np.all(np.isinf(distances[:, 5:])))
+        self.assertTrue(np.all(ids[:, :5] >= 0))
+
     def testReloadIndex(self):
         np.random.seed(23)
         data = np.random.randn(1000, 10).astype(np.float32)
@@ -260,6 +338,40 @@ class HNSWTestCase(TestCaseBase, DenseIndexTestMixin):
     def _get_index(self, space='cosinesimil'):
         return nmslib.init(method='hnsw', space=space)
 
+    def testReloadIndexFromBuffer(self):
+        np.random.seed(23)
+        data = np.random.randn(1000, 10).astype(np.float32)
+        queries = data[:10]
+
+        for index_params in [{}, {'skip_optimized_index': 1}]:
+            original = self._get_index()
+            original.addDataPointBatch(data)
+            original.createIndex(index_params)
+            original_results = original.knnQueryBatch(queries, k=10)
+
+            buf = original.saveIndexToBuffer(save_data=True)
+            self.assertTrue(isinstance(buf, bytes))
+
+            for reloaded_buf in [buf, bytearray(buf), memoryview(buf)]:
+                reloaded = self._get_index()
+                reloaded.loadIndexFromBuffer(reloaded_buf, load_data=True)
+                self.assertEqual(len(reloaded), len(original))
+                npt.assert_allclose(reloaded[10], data[10], rtol=RTOL, atol=ATOL)
+                for orig, res in zip(original_results, reloaded.knnQueryBatch(queries, k=10)):
+                    self.assert_allclose(orig, res)
+                del reloaded
+
+        # the buffer doesn't need to be kept by the caller
+        reloaded = self._get_index()
+        reloaded.loadIndexFromBuffer(original.saveIndexToBuffer(save_data=True), load_data=True)
+        gc.collect()
+        self.assertEqual(reloaded.getDistance(0, 1), original.getDistance(0, 1))
+
+        with self.assertRaises(ValueError):
+            self._get_index().loadIndexFromBuffer(original.saveIndexToBuffer(), load_data=True)
+        with self.assertRaises(ValueError):
+            self._get_index().loadIndexFromBuffer(b'not an index')
+
 
 class BitJaccardTestCase(TestCaseBase, BitVectorIndexTestMixin):
     def _get_index(self, space='bit_jaccard'):
@@ -361,6 +473,124 @@ class SparseTestCase(TestCaseBase):
         self.assertEqual(len(index), 4)
         self.assertEqual(index[3], [(3, 1.0)])
 
+class BatchIngestionTestCase(TestCaseBase):
+    def testDenseParallel(self):
+        np.random.seed(23)
+        data = np.random.randn(5000, 8).astype(np.float32)
+
+        for num_threads in [1, 4]:
+            index = nmslib.init(method='hnsw', space='l2')
+            self.assertEqual(index.addDataPointBatch(data, ids=np.arange(data.shape[0]) * 2,
+                                                     num_threads=num_threads), data.shape[0])
+            self.assertEqual(len(index), data.shape[0])
+            for i in [0, 1, 2500, 4999]:
+                npt.assert_allclose(index[i], data[i], rtol=RTOL, atol=ATOL)
+
+        index = nmslib.init(method='hnsw', space='l2')
+        with self.assertRaises(ValueError):
+            index.addDataPointBatch(data, ids=np.arange(10))
+        self.assertEqual(len(index), 0)
+
+    def testDenseMixedWithSingleAdds(self):
+        np.random.seed(23)
+        data = np.random.randn(300, 8).astype(np.float32)
+
+        # objects added one by one and objects stored in contiguous blocks can be mixed
+        index = nmslib.init(method='hnsw', space='l2')
+        index.addDataPoint(0, data[0])
+        index.addDataPointBatch(data[1:150], ids=np.arange(1, 150))
+        index.addDataPoint(150, data[150])
+        index.addDataPointBatch(data[151:], ids=np.arange(151, data.shape[0]))
+        self.assertEqual(len(index), data.shape[0])
+        for i in [0, 1, 149, 150, 151, 299]:
+            npt.assert_allclose(index[i], data[i], rtol=RTOL, atol=ATOL)
+
+        index.createIndex()
+        ids, distances = index.knnQuery(data[151], k=1)
+        self.assertEqual(ids[0], 151)
+
+        temp_dir = tempfile.mkdtemp()
+        try:
+            temp_file_pref = os.path.join(temp_dir, 'index')
+            index.saveIndex(temp_file_pref, save_data=True)
+            reloaded = nmslib.init(method='hnsw', space='l2')
+            reloaded.addDataPointBatch(data[:10])
+            reloaded.loadIndex(temp_file_pref, load_data=True)
+            self.assertEqual(len(reloaded), data.shape[0])
+            npt.assert_allclose(reloaded[299], data[299], rtol=RTOL, atol=ATOL)
+        finally:
+            shutil.rmtree(temp_dir)
+
+    def testDenseHalfFloat(self):
+        np.random.seed(23)
+        data = np.random.randn(500, 16).astype(np.float16)
+
+        for space in ['l2_fp16', 'cosinesimil_fp16', 'negdotprod_bf16']:
+            index = nmslib.init(method='hnsw', space=space)
+            # float16 arrays are used as is by fp16 spaces and converted otherwise
+            index.addDataPointBatch(data[:250])
+            index.addDataPointBatch(data[250:].astype(np.float32), ids=np.arange(250, data.shape[0]))
+            index.addDataPoint(data.shape[0], data[0])
+            self.assertEqual(len(index), data.shape[0] + 1)
+            for i in [0, 249, 250, 499, 500]:
+                npt.assert_allclose(index[i], data[i % data.shape[0]], rtol=1e-2, atol=1e-2)
+
+            index.createIndex()
+            ids, distances = index.knnQuery(data[10], k=1)
+            if space != 'negdotprod_bf16':
+                self.assertEqual(ids[0], 10)
+
+    def testSparseCSR(self):
+        class CSR(object):
+            def __init__(self, indptr, indices, data):
+                self.indptr = np.array(indptr, dtype=np.int32)
+                self.indices = np.array(indices, dtype=np.int32)
+                self.data = np.array(data, dtype=np.float32)
+
+        index = nmslib.init(method='hnsw', space='cosinesimil_sparse',
+                            data_type=nmslib.DataType.SPARSE_VECTOR)
+        # rows are [(2, 1.), (0, 2.)], [], [(1, 3.)]: elements of the first row are sorted
+        self.assertEqual(index.addDataPointBatch(CSR([0, 2, 2, 3], [2, 0, 1], [1., 2., 3.])), 3)
+        self.assertEqual(index[0], [(0, 2.0), (2, 1.0)])
+        self.assertEqual(index[1], [])
+        self.assertEqual(index[2], [(1, 3.0)])
+
+        with self.assertRaises(ValueError):
+            index.addDataPointBatch(CSR([0, 2, 5], [2, 0, 1], [1., 2., 3.]))
+        self.assertEqual(len(index), 3)
+
+    def testLoadDataFile(self):
+        np.random.seed(23)
+        data = np.random.randint(0, 256, size=(500, 16)).astype(np.uint8)
+
+        temp_dir = tempfile.mkdtemp()
+        try:
+            fvecs = os.path.join(temp_dir, 'data.fvecs')
+            with open(fvecs, 'wb') as f:
+                dims = np.full((data.shape[0], 1), data.shape[1], dtype=np.int32)
+                f.write(np.hstack([dims.view(np.float32), data.astype(np.float32)]).tobytes())
+            u8bin = os.path.join(temp_dir, 'data.u8bin')
+            with open(u8bin, 'wb') as f:
+                f.write(np.array(data.shape, dtype=np.uint32).tobytes())
+                f.write(data.tobytes())
+
+            for filename in [fvecs, u8bin]:
+                index = nmslib.init(method='hnsw', space='l2')
+                self.assertEqual(index.loadDataFile(filename, num_threads=2), data.shape[0])
+                self.assertEqual(len(index), data.shape[0])
+                for i in [0, 1, 499]:
+                    npt.assert_allclose(index[i], data[i], rtol=RTOL, atol=ATOL)
+                index.createIndex()
+                ids, distances = index.knnQuery(data[10].astype(np.float32), k=1)
+                self.assertEqual(ids[0], 10)
+
+            index = nmslib.init(method='hnsw', space='l2')
+            with self.assertRaises(RuntimeError):
+                index.loadDataFile(os.path.join(temp_dir, 'data.txt'))
+        finally:
+            shutil.rmtree(temp_dir)
+
+
 class MemoryLeak1TestCase(TestCaseBase):
     def testMemoryLeak1(self):
         process = psutil.Process(os.getpid())
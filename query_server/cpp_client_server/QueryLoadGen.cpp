@@ -0,0 +1,420 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+
+/*
+ * A load generator for the query server. It reads queries using
+ * the regular Space readers (so any data format supported by the space
+ * can be used), sends k-NN queries over several concurrent connections,
+ * and reports the throughput, latency quantiles, and recall.
+ *
+ * There are two modes:
+ * 1) Closed loop (--qps 0): each connection sends the next query as soon
+ *    as it gets a reply. This measures the maximum throughput.
+ * 2) Open loop (--qps > 0): requests are scheduled at fixed intervals
+ *    independently of replies. The latency is measured from the scheduled
+ *    time rather than from the actual send time. Thus, if the server
+ *    (or the number of connections) can't keep up, the queueing delay is
+ *    included in the latency instead of being silently hidden
+ *    (i.e., the coordinated omission is avoided).
+ */
+#include <memory>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <unordered_set>
+
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/transport/TSocket.h>
+#include <thrift/transport/TTransportUtils.h>
+
+#include "QueryService.h"
+
+#include "params.h"
+#include "params_def.h"
+#include "utils.h"
+#include "space.h"
+#include "spacefactory.h"
+#include "knnquery.h"
+#include "knnqueue.h"
+#include "init.h"
+#include "logging.h"
+#include "thread_pool.h"
+#include "latency_histogram.h"
+
+#include <boost/program_options.hpp>
+
+using std::string;
+using std::vector;
+using std::exception;
+using std::stringstream;
+using std::ifstream;
+using std::ofstream;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::unique_ptr;
+using std::shared_ptr;
+
+using namespace  ::similarity;
+
+using namespace apache::thrift;
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::transport;
+
+namespace po = boost::program_options;
+
+typedef std::chrono::steady_clock LoadGenClock;
+
+struct LoadGenConfig {
+  string      host;
+  int         port = 0;
+  string      distType;
+  string      spaceType;
+  shared_ptr<AnyParams>  spaceParams;
+  string      queryFile;
+  unsigned    maxNumQuery = 0;
+  string      dataFile;
+  unsigned    maxNumData = 0;
+  string      goldFile;
+  int         k = 0;
+  string      queryTimeParams;
+  unsigned    connQty = 0;
+  double      targetQPS = 0;
+  size_t      requestQty = 0;
+  size_t      warmUpQty = 0;
+};
+
+static void Usage(const char *prog,
+                  const po::options_description& desc) {
+    std::cout << prog << std::endl
+              << desc << std::endl;
+}
+
+void ParseCommandLineForLoadGen(int argc, char*argv[], LoadGenConfig& conf) {
+  string spaceParamStr;
+
+  po::options_description ProgOptDesc("Allowed options");
+  ProgOptDesc.add_options()
+    (HELP_PARAM_OPT.c_str(),          HELP_PARAM_MSG.c_str())
+    (PORT_PARAM_OPT.c_str(),          po::value<int>(&conf.port)->required(), PORT_PARAM_MSG.c_str())
+    (ADDR_PARAM_OPT.c_str(),          po::value<string>(&conf.host)->default_value("localhost"), ADDR_PARAM_MSG.c_str())
+    (SPACE_TYPE_PARAM_OPT.c_str(),    po::value<string>(&spaceParamStr)->required(), SPACE_TYPE_PARAM_MSG.c_str())
+    (DIST_TYPE_PARAM_OPT.c_str(),     po::value<string>(&conf.distType)->default_value(DIST_TYPE_FLOAT), DIST_TYPE_PARAM_MSG.c_str())
+    (QUERY_FILE_PARAM_OPT.c_str(),    po::value<string>(&conf.queryFile)->required(), QUERY_FILE_PARAM_MSG.c_str())
+    (MAX_NUM_QUERY_PARAM_OPT.c_str(), po::value<unsigned>(&conf.maxNumQuery)->default_value(MAX_NUM_QUERY_PARAM_DEFAULT), MAX_NUM_QUERY_PARAM_MSG.c_str())
+    (DATA_FILE_PARAM_OPT.c_str(),     po::value<string>(&conf.dataFile)->default_value(""), DATA_FILE_PARAM_MSG.c_str())
+    (MAX_NUM_DATA_PARAM_OPT.c_str(),  po::value<unsigned>(&conf.maxNumData)->default_value(MAX_NUM_DATA_PARAM_DEFAULT), MAX_NUM_DATA_PARAM_MSG.c_str())
+    (GOLD_FILE_PARAM_OPT.c_str(),     po::value<string>(&conf.goldFile)->default_value(GOLD_FILE_PARAM_DEFAULT), GOLD_FILE_PARAM_MSG.c_str())
+    (KNN_PARAM_OPT.c_str(),           po::value<int>(&conf.k)->required(), "the number of neighbors K for the k-NN search")
+    (QUERY_TIME_PARAMS_PARAM_OPT.c_str(), po::value<string>(&conf.queryTimeParams)->default_value(""), QUERY_TIME_PARAMS_PARAM_MSG.c_str())
+    (CONN_QTY_PARAM_OPT.c_str(),      po::value<unsigned>(&conf.connQty)->default_value(CONN_QTY_PARAM_DEFAULT), CONN_QTY_PARAM_MSG.c_str())
+    (TARGET_QPS_PARAM_OPT.c_str(),    po::value<double>(&conf.targetQPS)->default_value(TARGET_QPS_PARAM_DEFAULT), TARGET_QPS_PARAM_MSG.c_str())
+    (REQUEST_QTY_PARAM_OPT.c_str(),   po::value<size_t>(&conf.requestQty)->default_value(REQUEST_QTY_PARAM_DEFAULT), REQUEST_QTY_PARAM_MSG.c_str())
+    (WARM_UP_QTY_PARAM_OPT.c_str(),   po::value<size_t>(&conf.warmUpQty)->default_value(WARM_UP_QTY_PARAM_DEFAULT), WARM_UP_QTY_PARAM_MSG.c_str())
+    ;
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, ProgOptDesc), vm);
+    if (vm.count("help")) {
+      Usage(argv[0], ProgOptDesc);
+      exit(0);
+    }
+    po::notify(vm);
+  } catch (const exception& e) {
+    Usage(argv[0], ProgOptDesc);
+    cerr << e.what() << endl;
+    exit(1);
+  }
+
+  if (conf.k <= 0 || conf.connQty == 0 || conf.targetQPS < 0) {
+    Usage(argv[0], ProgOptDesc);
+    cerr << "K and the number of connections should be positive, QPS should be non-negative!" << endl;
+    exit(1);
+  }
+
+  ToLower(conf.distType);
+  ToLower(spaceParamStr);
+
+  vector<string>     desc;
+  ParseSpaceArg(spaceParamStr, conf.spaceType, desc);
+  conf.spaceParams = shared_ptr<AnyParams>(new AnyParams(desc));
+}
+
+typedef vector<vector<IdType>> GoldStandardIds;
+
+static void ReadGoldStandard(const string& fileName, size_t queryQty, GoldStandardIds& gold) {
+  ifstream inp(fileName);
+  CHECK_MSG(inp, "Cannot open the gold standard file: '" + fileName + "' for reading");
+  gold.clear();
+  string line;
+  while (gold.size() < queryQty && getline(inp, line)) {
+    stringstream  str(line);
+    IdType        id;
+    gold.push_back(vector<IdType>());
+    while (str >> id) gold.back().push_back(id);
+  }
+  CHECK_MSG(gold.size() == queryQty,
+            "The gold standard file '" + fileName + "' has fewer lines than the number of queries: " +
+            ConvertToString(queryQty));
+}
+
+static void WriteGoldStandard(const string& fileName, const GoldStandardIds& gold) {
+  ofstream out(fileName);
+  CHECK_MSG(out, "Cannot open the gold standard file: '" + fileName + "' for writing");
+  for (const auto& ids : gold) {
+    for (size_t i = 0; i < ids.size(); ++i) {
+      out << (i ? " " : "") << ids[i];
+    }
+    out << endl;
+  }
+}
+
+// The brute-force search, ids are positions in the data file (as in the query server)
+template <typename dist_t>
+void ComputeGoldStandard(const Space<dist_t>& space, const ObjectVector& data,
+                         const ObjectVector& queries, unsigned k, GoldStandardIds& gold) {
+  gold.clear();
+  gold.resize(queries.size());
+  ParallelFor(0, queries.size(), 0, [&](size_t qid, size_t) {
+    KNNQuery<dist_t> query(space, queries[qid], k);
+    for (const Object* pObj : data) query.CheckAndAddToResult(pObj);
+    unique_ptr<KNNQueue<dist_t>> res(query.Result()->Clone());
+    vector<IdType>& ids = gold[qid];
+    while (!res->Empty()) {
+      ids.push_back(res->TopObject()->id());
+      res->Pop();
+    }
+    std::reverse(ids.begin(), ids.end());
+  });
+}
+
+struct ConnectionStats {
+  LogHistogram  latency_;
+  size_t        reqQty_ = 0;
+  size_t        errQty_ = 0;
+  double        recallSum_ = 0;
+};
+
+template <typename dist_t>
+class LoadGenerator {
+public:
+  LoadGenerator(const LoadGenConfig& conf) : conf_(conf),
+    space_(SpaceFactoryRegistry<dist_t>::Instance().CreateSpace(conf.spaceType, *conf.spaceParams)) {}
+
+  ~LoadGenerator() {
+    for (const Object* pObj : queries_) delete pObj;
+  }
+
+  void Run() {
+    loadQueries();
+    loadGoldStandard();
+
+    if (!conf_.queryTimeParams.empty()) {
+      ::apache::thrift::stdcxx::shared_ptr<TTransport>   socket(new TSocket(conf_.host, conf_.port));
+      ::apache::thrift::stdcxx::shared_ptr<TTransport>   transport(new TBufferedTransport(socket));
+      ::apache::thrift::stdcxx::shared_ptr<TProtocol>    protocol(new TBinaryProtocol(transport));
+      QueryServiceClient                                 client(protocol);
+      transport->open();
+      client.setQueryTimeParams(conf_.queryTimeParams);
+      transport->close();
+    }
+
+    if (conf_.warmUpQty) {
+      LOG(LIB_INFO) << "Sending " << conf_.warmUpQty << " warm-up requests";
+      runPhase(conf_.warmUpQty, 0 /* closed loop */);
+    }
+
+    size_t requestQty = conf_.requestQty ? conf_.requestQty : queryStrs_.size();
+    LOG(LIB_INFO) << "Sending " << requestQty << " requests over " << conf_.connQty << " connection(s), "
+                  << (conf_.targetQPS > 0 ? "open loop, target QPS: " + ConvertToString(conf_.targetQPS) :
+                                            string("closed loop"));
+
+    ConnectionStats total;
+    double elapsedSec = runPhase(requestQty, conf_.targetQPS, &total);
+
+    report(total, elapsedSec);
+  }
+
+private:
+  void loadQueries() {
+    vector<string> externIds;
+    unique_ptr<DataFileInputState> inpState(space_->ReadDataset(queries_, externIds, conf_.queryFile,
+                                                                conf_.maxNumQuery ? conf_.maxNumQuery : MAX_DATASET_QTY));
+    space_->UpdateParamsFromFile(*inpState);
+    CHECK_MSG(!queries_.empty(), "No queries were read from: '" + conf_.queryFile + "'");
+    for (const Object* pObj : queries_) {
+      queryStrs_.push_back(space_->CreateStrFromObj(pObj, ""));
+    }
+    LOG(LIB_INFO) << "Read " << queries_.size() << " queries from: " << conf_.queryFile;
+  }
+
+  void loadGoldStandard() {
+    if (conf_.goldFile.empty()) return;
+    if (DoesFileExist(conf_.goldFile)) {
+      ReadGoldStandard(conf_.goldFile, queries_.size(), gold_);
+      LOG(LIB_INFO) << "Read the gold standard from: " << conf_.goldFile;
+      return;
+    }
+    CHECK_MSG(!conf_.dataFile.empty(),
+              "The gold standard file '" + conf_.goldFile + "' doesn't exist, specify the data file to compute it");
+    ObjectVector   data;
+    vector<string> externIds;
+    space_->ReadDataset(data, externIds, conf_.dataFile,
+                        conf_.maxNumData ? conf_.maxNumData : MAX_DATASET_QTY);
+    LOG(LIB_INFO) << "Computing the gold standard for " << queries_.size() << " queries using "
+                  << data.size() << " data points";
+    ComputeGoldStandard(*space_, data, queries_, conf_.k, gold_);
+    for (const Object* pObj : data) delete pObj;
+    WriteGoldStandard(conf_.goldFile, gold_);
+    LOG(LIB_INFO) << "Saved the gold standard to: " << conf_.goldFile;
+  }
+
+  double computeRecall(size_t qid, const ReplyEntryList& res) const {
+    const vector<IdType>& goldIds = gold_[qid];
+    size_t goldQty = std::min(goldIds.size(), size_t(conf_.k));
+    if (!goldQty) return 1;
+    std::unordered_set<IdType> goldSet(goldIds.begin(), goldIds.begin() + goldQty);
+    size_t foundQty = 0;
+    for (const auto& e : res) foundQty += goldSet.count(e.id);
+    return double(foundQty) / goldQty;
+  }
+
+  /*
+   * Sends requestQty requests and returns the elapsed time in seconds.
+   * Request i is sent using the query i % (# of queries).
+   */
+  double runPhase(size_t requestQty, double targetQPS, ConnectionStats* pTotal = nullptr) {
+    vector<ConnectionStats>   connStats(conf_.connQty);
+    vector<std::thread>       threads;
+    std::atomic<size_t>       nextReq(0);
+    const auto                start = LoadGenClock::now();
+
+    for (unsigned connId = 0; connId < conf_.connQty; ++connId) {
+      threads.push_back(std::thread([&, connId]() {
+        ConnectionStats& stats = connStats[connId];
+        ::apache::thrift::stdcxx::shared_ptr<TTransport>   socket(new TSocket(conf_.host, conf_.port));
+        ::apache::thrift::stdcxx::shared_ptr<TTransport>   transport(new TBufferedTransport(socket));
+        ::apache::thrift::stdcxx::shared_ptr<TProtocol>    protocol(new TBinaryProtocol(transport));
+        QueryServiceClient                                 client(protocol);
+        try {
+          transport->open();
+        } catch (const TException& tx) {
+          LOG(LIB_ERROR) << "Connection error: " << tx.what();
+          return;
+        }
+
+        size_t reqId;
+        while ((reqId = nextReq.fetch_add(1)) < requestQty) {
+          auto sendTime = LoadGenClock::now();
+          if (targetQPS > 0) {
+            auto schedTime = start + std::chrono::duration_cast<LoadGenClock::duration>(
+                                       std::chrono::duration<double>(reqId / targetQPS));
+            std::this_thread::sleep_until(schedTime);
+            sendTime = schedTime;
+          }
+          size_t         qid = reqId % queryStrs_.size();
+          ReplyEntryList res;
+          try {
+            client.knnQuery(res, conf_.k, queryStrs_[qid], false, false);
+          } catch (const QueryException& e) {
+            LOG(LIB_ERROR) << "Query execution error: " << e.message;
+            stats.errQty_++;
+            continue;
+          } catch (const TException& tx) {
+            LOG(LIB_ERROR) << "Connection error: " << tx.what();
+            stats.errQty_++;
+            break;
+          }
+          stats.latency_.Add(std::chrono::duration_cast<std::chrono::microseconds>(
+                               LoadGenClock::now() - sendTime).count());
+          stats.reqQty_++;
+          if (!gold_.empty()) stats.recallSum_ += computeRecall(qid, res);
+        }
+        transport->close();
+      }));
+    }
+    for (auto& thread : threads) thread.join();
+
+    double elapsedSec = std::chrono::duration<double>(LoadGenClock::now() - start).count();
+
+    if (pTotal != nullptr) {
+      for (const auto& stats : connStats) {
+        pTotal->latency_.Merge(stats.latency_);
+        pTotal->reqQty_ += stats.reqQty_;
+        pTotal->errQty_ += stats.errQty_;
+        pTotal->recallSum_ += stats.recallSum_;
+      }
+    }
+    return elapsedSec;
+  }
+
+  void report(const ConnectionStats& total, double elapsedSec) const {
+    const LogHistogram& lat = total.latency_;
+    cout << "Requests:         " << total.reqQty_ << " (errors: " << total.errQty_ << ")" << endl;
+    cout << "Elapsed:          " << elapsedSec << " sec" << endl;
+    cout << "Throughput:       " << (elapsedSec > 0 ? total.reqQty_ / elapsedSec : 0) << " QPS";
+    if (conf_.targetQPS > 0) cout << " (target: " << conf_.targetQPS << ")";
+    cout << endl;
+    cout << "Latency (usec):   mean: " << lat.GetMean()
+         << " p50: "  << lat.GetQuantile(0.5)
+         << " p95: "  << lat.GetQuantile(0.95)
+         << " p99: "  << lat.GetQuantile(0.99)
+         << " p999: " << lat.GetQuantile(0.999)
+         << " max: "  << lat.GetMax() << endl;
+    if (!gold_.empty()) {
+      cout << "Recall@" << conf_.k << ":        "
+           << (total.reqQty_ ? total.recallSum_ / total.reqQty_ : 0) << endl;
+    }
+  }
+
+  const LoadGenConfig&      conf_;
+  unique_ptr<Space<dist_t>> space_;
+  ObjectVector              queries_;
+  vector<string>            queryStrs_;
+  GoldStandardIds           gold_;
+};
+
+int main(int argc, char *argv[]) {
+  LoadGenConfig conf;
+
+  ParseCommandLineForLoadGen(argc, argv, conf);
+
+  initLibrary(0, LIB_LOGSTDERR, NULL);
+
+  try {
+    if (DIST_TYPE_INT == conf.distType) {
+      LoadGenerator<int>(conf).Run();
+    } else if (DIST_TYPE_FLOAT == conf.distType) {
+      LoadGenerator<float>(conf).Run();
+    } else {
+      LOG(LIB_FATAL) << "Unknown distance value type: " << conf.distType;
+    }
+  } catch (const TException& tx) {
+    cerr << "Connection error: " << tx.what() << endl;
+    return 1;
+  } catch (const exception& e) {
+    cerr << "Exception: " << e.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
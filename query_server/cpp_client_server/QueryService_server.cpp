@@ -19,8 +19,16 @@
 #include <chrono>
 #include <iostream>
 #include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <map>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
 
 #include "QueryService.h"
+#include <thrift/TProcessor.h>
 #include <thrift/protocol/TBinaryProtocol.h>
 #include <thrift/server/TSimpleServer.h>
 #include <thrift/transport/TServerSocket.h>
@@ -33,6 +41,8 @@
 
 #include "params.h"
 #include "space.h"
+#include "mmap_dataset.h"
+#include "object_arena.h"
 #include "params_def.h"
 #include "utils.h"
 #include "space.h"
@@ -46,6 +56,9 @@
 #include "logging.h"
 #include "ztimer.h"
 #include "thread_pool.h"
+#include "method/sharded_index.h"
+#include "lru_cache.h"
+#include "latency_histogram.h"
 
 #define MAX_SPIN_LOCK_QTY 1000000
 #define SLEEP_DURATION    10
@@ -65,6 +78,7 @@ using std::unique_ptr;
 using std::exception;
 using std::mutex;
 using std::unique_lock;
+using std::map;
 
 using namespace  ::similarity;
 
@@ -86,6 +100,157 @@ private:
   mutex&   mtx_;
 };
 
+typedef std::chrono::steady_clock StatClock;
+
+static uint64_t UsecSince(const StatClock::time_point& start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(StatClock::now() - start).count();
+}
+
+/*
+ * Statistics of a single RPC function, all times are in microseconds.
+ * The queue wait is the time between the moment the processor starts
+ * reading a request and the moment the search starts. It includes reading
+ * of arguments and waiting for a concurrent update of query-time parameters.
+ * The serialization time includes building of the reply and writing it
+ * to the transport.
+ */
+struct RPCStats {
+  RPCStats() : reqQty_(0), truncQty_(0) {}
+
+  std::atomic<uint64_t>     reqQty_;
+  // The number of searches stopped by the timeout
+  std::atomic<uint64_t>     truncQty_;
+  ConcurrentLogHistogram    queueWait_;
+  ConcurrentLogHistogram    searchTime_;
+  ConcurrentLogHistogram    distComp_;
+  ConcurrentLogHistogram    serialTime_;
+};
+
+/*
+ * Information about a call processed by the current thread. It is filled
+ * out by StatsEventHandler, which thrift invokes in the same thread
+ * as the respective handler function.
+ */
+struct CallContext {
+  CallContext() : pStats_(nullptr), buildTime_(0) {}
+
+  RPCStats*               pStats_;
+  StatClock::time_point   start_;
+  StatClock::time_point   writeStart_;
+  uint64_t                buildTime_; // the time spent on building the reply
+};
+
+static CallContext& CurrentCall() {
+  static thread_local CallContext ctx;
+  return ctx;
+}
+
+class ServerStats {
+public:
+  ServerStats(const string& methName, const string& spaceType) :
+            methName_(methName), spaceType_(spaceType), start_(StatClock::now()) {
+    for (const char* rpcName : {"setQueryTimeParams", "knnQuery", "rangeQuery",
+                                "knnQueryBatch", "getDistance", "getStats"}) {
+      rpcStats_[rpcName].reset(new RPCStats());
+    }
+  }
+
+  // Returns NULL for unknown functions
+  RPCStats* Get(const string& rpcName) const {
+    auto it = rpcStats_.find(rpcName);
+    return it == rpcStats_.end() ? nullptr : it->second.get();
+  }
+
+  // Writes statistics using the Prometheus text exposition format
+  void Report(std::ostream& out) const {
+    out << "# TYPE nmslib_uptime_seconds gauge" << std::endl;
+    out << "nmslib_uptime_seconds " << UsecSince(start_) / 1e6 << std::endl;
+    out << "# TYPE nmslib_index_info gauge" << std::endl;
+    out << "nmslib_index_info{method=\"" << methName_ << "\",space=\"" << spaceType_ << "\"} 1" << std::endl;
+    out << "# TYPE nmslib_requests_total counter" << std::endl;
+    for (const auto& e : rpcStats_) {
+      out << "nmslib_requests_total{rpc=\"" << e.first << "\"} " << e.second->reqQty_ << std::endl;
+    }
+    out << "# TYPE nmslib_truncated_total counter" << std::endl;
+    for (const auto& e : rpcStats_) {
+      out << "nmslib_truncated_total{rpc=\"" << e.first << "\"} " << e.second->truncQty_ << std::endl;
+    }
+    reportHist(out, "nmslib_queue_wait_usec", &RPCStats::queueWait_);
+    reportHist(out, "nmslib_search_time_usec", &RPCStats::searchTime_);
+    reportHist(out, "nmslib_dist_comp", &RPCStats::distComp_);
+    reportHist(out, "nmslib_serialization_time_usec", &RPCStats::serialTime_);
+  }
+
+private:
+  void reportHist(std::ostream& out, const string& name, ConcurrentLogHistogram RPCStats::*field) const {
+    const double quantiles[] = {0.5, 0.9, 0.95, 0.99, 0.999};
+
+    map<string, LogHistogram> snapshots;
+    for (const auto& e : rpcStats_) {
+      LogHistogram& hist = snapshots[e.first];
+      (e.second.get()->*field).GetSnapshot(hist);
+      if (!hist.GetCount()) snapshots.erase(e.first);
+    }
+
+    out << "# TYPE " << name << " summary" << std::endl;
+    for (const auto& e : snapshots) {
+      const string label = "rpc=\"" + e.first + "\"";
+      for (double q : quantiles) {
+        out << name << "{" << label << ",quantile=\"" << q << "\"} " << e.second.GetQuantile(q) << std::endl;
+      }
+      out << name << "_sum{" << label << "} " << e.second.GetSum() << std::endl;
+      out << name << "_count{" << label << "} " << e.second.GetCount() << std::endl;
+    }
+    out << "# TYPE " << name << "_max gauge" << std::endl;
+    for (const auto& e : snapshots) {
+      out << name << "_max{rpc=\"" << e.first << "\"} " << e.second.GetMax() << std::endl;
+    }
+  }
+
+  string                              methName_;
+  string                              spaceType_;
+  StatClock::time_point               start_;
+  // This map is not modified after construction, so it can be read without locking
+  map<string, unique_ptr<RPCStats>>   rpcStats_;
+};
+
+/*
+ * Thrift calls this handler before and after reading a request
+ * and writing a reply. It records the start time of each call
+ * and measures the time to write the reply.
+ */
+class StatsEventHandler : public TProcessorEventHandler {
+public:
+  StatsEventHandler(ServerStats& stats) : stats_(stats) {}
+
+  void* getContext(const char* fnName, void*) override {
+    // Function names are prefixed with the service name, e.g., QueryService.knnQuery
+    const char* pName = strrchr(fnName, '.');
+    CallContext& ctx = CurrentCall();
+    ctx.pStats_ = stats_.Get(pName ? pName + 1 : fnName);
+    ctx.start_ = StatClock::now();
+    ctx.buildTime_ = 0;
+    if (ctx.pStats_) ++ctx.pStats_->reqQty_;
+    return &ctx;
+  }
+
+  void freeContext(void* ctx, const char*) override {
+    static_cast<CallContext*>(ctx)->pStats_ = nullptr;
+  }
+
+  void preWrite(void* ctx, const char*) override {
+    static_cast<CallContext*>(ctx)->writeStart_ = StatClock::now();
+  }
+
+  void postWrite(void* ctx, const char*, uint32_t) override {
+    CallContext& call = *static_cast<CallContext*>(ctx);
+    if (call.pStats_) call.pStats_->serialTime_.Add(call.buildTime_ + UsecSince(call.writeStart_));
+  }
+
+private:
+  ServerStats& stats_;
+};
+
 template <class dist_t>
 class QueryServiceHandler : virtual public QueryServiceIf {
  public:
@@ -100,10 +265,22 @@ class QueryServiceHandler : virtual public QueryServiceIf {
                       const string&                      SaveIndexLoc,
                       bool&                              CacheData,
                       const AnyParams&                   IndexParams,
-                      const AnyParams&                   QueryTimeParams) :
+                      const AnyParams&                   QueryTimeParams,
+                      size_t                             CacheSize,
+                      unsigned                           CacheTTL,
+                      unsigned                           TimeoutMsec,
+                      ServerStats&                       stats) :
     debugPrint_(debugPrint),
     methName_(MethodName),
     space_(SpaceFactoryRegistry<dist_t>::Instance().CreateSpace(SpaceType, SpaceParams)),
+    cache_(CacheSize, 1000 * uint64_t(CacheTTL)),
+    queryTimeParams_(QueryTimeParams.ToString()),
+    timeoutMsec_(TimeoutMsec),
+    stats_(stats),
+    knnStats_(stats.Get("knnQuery")),
+    rangeStats_(stats.Get("rangeQuery")),
+    batchStats_(stats.Get("knnQueryBatch")),
+    distStats_(stats.Get("getDistance")),
     counter_(0)
 
   {
@@ -111,10 +288,17 @@ class QueryServiceHandler : virtual public QueryServiceIf {
 
     if (!CacheData || !DoesFileExist(LoadIndexLoc + DATA_FILE_PREF)) {
       CHECK_MSG(!DataFile.empty(), "Specify the input data file!")
-      inpState = space_->ReadDataset(dataSet_,
-                                         externIds_,
-                                         DataFile,
-                                         MaxNumData);
+      if (IsMmapDatasetFile(DataFile)) {
+        ReadMmapDataset(*space_, DataFile, objArena_, dataSet_, externIds_, MaxNumData);
+        inpState.reset(new DataFileInputState());
+      } else {
+        inpState = space_->ReadDataset(dataSet_,
+                                           externIds_,
+                                           DataFile,
+                                           MaxNumData,
+                                           0,
+                                           &objArena_);
+      }
       if (CacheData && !SaveIndexLoc.empty()) {
         LOG(LIB_INFO) << "Saving data to location: " << SaveIndexLoc + DATA_FILE_PREF; 
 
@@ -123,10 +307,22 @@ class QueryServiceHandler : virtual public QueryServiceIf {
     } else {
       LOG(LIB_INFO) << "Loading cached data from location: " << LoadIndexLoc + DATA_FILE_PREF; 
 
-      inpState = space_->ReadObjectVectorFromBinData(dataSet_,
-                                                     externIds_,
-                                                     LoadIndexLoc + DATA_FILE_PREF,
-                                                     MaxNumData);
+      ObjectVector loaded;
+      try {
+        inpState = space_->ReadObjectVectorFromBinData(loaded,
+                                                       externIds_,
+                                                       LoadIndexLoc + DATA_FILE_PREF,
+                                                       MaxNumData);
+      } catch (...) {
+        for (auto e: loaded) delete e;
+        throw;
+      }
+      // Each object is freed right after it is copied into the arena
+      ObjectArena::Region region(objArena_);
+      for (auto e: loaded) {
+        dataSet_.push_back(region.Copy(e));
+        delete e;
+      }
     }
     space_->UpdateParamsFromFile(*inpState);
 
@@ -157,10 +353,13 @@ class QueryServiceHandler : virtual public QueryServiceIf {
 
     LOG(LIB_INFO) << "Setting query-time parameters";
     index_->SetQueryTimeParams(QueryTimeParams);
-  }
 
-  ~QueryServiceHandler() {
-    for (auto e: dataSet_) delete e;
+    if (cache_.IsEnabled()) {
+      LOG(LIB_INFO) << "Query result cache size: " << CacheSize << " TTL: " << CacheTTL << " sec.";
+    }
+    if (timeoutMsec_) {
+      LOG(LIB_INFO) << "Search timeout: " << timeoutMsec_ << " ms";
+    }
   }
 
   void setQueryTimeParams(const string& queryTimeParamStr) {
@@ -179,6 +378,8 @@ class QueryServiceHandler : virtual public QueryServiceIf {
               }
             }
             index_->SetQueryTimeParams(AnyParams(desc));
+            // Cache keys include query-time parameters, so old entries won't be reused
+            queryTimeParams_ = queryTimeParamStr;
             return;
           }
         } // the lock will be released in the end of the block
@@ -200,6 +401,7 @@ class QueryServiceHandler : virtual public QueryServiceIf {
                   const bool retExternId, const bool retObj) {
     // This will increase the counter and prevent modification of query time parameters.
     LockedCounterManager  mngr(counter_, mtx_);
+    recordQueueWait(rangeStats_);
 
     try {
       if (debugPrint_) {
@@ -211,9 +413,21 @@ class QueryServiceHandler : virtual public QueryServiceIf {
 
       unique_ptr<Object>  queryObj(space_->CreateObjFromStr(0, -1, queryObjStr, NULL));
 
+      string cacheKey;
+      if (cache_.IsEnabled()) {
+        cacheKey = CreateQueryCacheKey(queryObj.get(), cacheSearchParams("range", r, retExternId, retObj));
+        if (getCached(cacheKey, _return)) return;
+      }
+
+      WallClockTimer searchTm;
       RangeQuery<dist_t> range(*space_, queryObj.get(), r);
+      setTimeout(range);
       index_->Search(&range, -1);
+      rangeStats_->searchTime_.Add(searchTm.split());
+      rangeStats_->distComp_.Add(range.DistanceComputations());
+      checkTruncated(range, rangeStats_);
 
+      WallClockTimer buildTm;
       _return.clear();
 
       wtm.split();
@@ -267,6 +481,9 @@ class QueryServiceHandler : virtual public QueryServiceIf {
         }
         _return.insert(_return.begin(), e);
       }
+      addBuildTime(buildTm.split());
+      // Incomplete results are not cached
+      if (cache_.IsEnabled() && !range.IsTruncated()) cache_.Put(cacheKey, _return);
       if (debugPrint_) {
         for (size_t i = 0; i < ids.size(); ++i) {
           LOG(LIB_INFO) << "id=" << ids[i] << " dist=" << dists[i] << ( retExternId ? " " + externIds[i] : string(""));
@@ -285,6 +502,7 @@ class QueryServiceHandler : virtual public QueryServiceIf {
   }
 
   double getDistance(const std::string& objStr1, const std::string& objStr2) {
+    recordQueueWait(distStats_);
     try {
       if (debugPrint_) {
         LOG(LIB_INFO) << "Computing the distance between two objects";
@@ -297,7 +515,9 @@ class QueryServiceHandler : virtual public QueryServiceIf {
       unique_ptr<Object>  obj1(space_->CreateObjFromStr(0, -1, objStr1, NULL));
       unique_ptr<Object>  obj2(space_->CreateObjFromStr(0, -1, objStr2, NULL));
 
+      WallClockTimer searchTm;
       double res = space_->IndexTimeDistance(obj1.get(), obj2.get());
+      distStats_->searchTime_.Add(searchTm.split());
 
       wtm.split();
 
@@ -321,6 +541,7 @@ class QueryServiceHandler : virtual public QueryServiceIf {
                 const std::string& queryObjStr, const bool retExternId, const bool retObj) {
     // This will increase the counter and prevent modification of query time parameters.
     LockedCounterManager  mngr(counter_, mtx_);
+    recordQueueWait(knnStats_);
 
     try {
       if (debugPrint_) {
@@ -332,8 +553,21 @@ class QueryServiceHandler : virtual public QueryServiceIf {
 
       unique_ptr<Object>  queryObj(space_->CreateObjFromStr(0, -1, queryObjStr, NULL));
 
+      string cacheKey;
+      if (cache_.IsEnabled()) {
+        cacheKey = CreateQueryCacheKey(queryObj.get(), cacheSearchParams("knn", k, retExternId, retObj));
+        if (getCached(cacheKey, _return)) return;
+      }
+
+      WallClockTimer searchTm;
       KNNQuery<dist_t> knn(*space_, queryObj.get(), k);
+      setTimeout(knn);
       index_->Search(&knn, -1);
+      knnStats_->searchTime_.Add(searchTm.split());
+      knnStats_->distComp_.Add(knn.DistanceComputations());
+      checkTruncated(knn, knnStats_);
+
+      WallClockTimer buildTm;
       unique_ptr<KNNQueue<dist_t>> res(knn.Result()->Clone());
 
       _return.clear();
@@ -389,6 +623,8 @@ class QueryServiceHandler : virtual public QueryServiceIf {
         res->Pop();
       }
       std::reverse(_return.begin(), _return.end());
+      addBuildTime(buildTm.split());
+      if (cache_.IsEnabled() && !knn.IsTruncated()) cache_.Put(cacheKey, _return);
       if (debugPrint_) {
         for (size_t i = 0; i < ids.size(); ++i) {
           LOG(LIB_INFO) << "id=" << ids[i] << " dist=" << dists[i] << ( retExternId ? " " + externIds[i] : string(""));
@@ -413,15 +649,33 @@ class QueryServiceHandler : virtual public QueryServiceIf {
                      const bool retObj, const int32_t numThreads) {
     // This will increase the counter and prevent modification of query time parameters.
     LockedCounterManager  mngr(counter_, mtx_);
+    recordQueueWait(batchStats_);
 
     try {
       _return.clear();
       _return.resize(queryObjs.size());
 
+      // The total time spent on building replies in all threads
+      std::atomic<uint64_t> buildTime(0);
+
       ParallelFor(0, queryObjs.size(), numThreads, [&](size_t queryIndex, size_t threadId) {
         unique_ptr<Object>  queryObj(space_->CreateObjFromStr(0, -1, queryObjs[queryIndex], NULL));
+
+        string cacheKey;
+        if (cache_.IsEnabled()) {
+          cacheKey = CreateQueryCacheKey(queryObj.get(), cacheSearchParams("knn", k, retExternId, retObj));
+          if (cache_.Get(cacheKey, _return[queryIndex])) return;
+        }
+
+        WallClockTimer searchTm;
         KNNQuery<dist_t> knn(*space_, queryObj.get(), k);
+        setTimeout(knn);
         index_->Search(&knn, -1);
+        batchStats_->searchTime_.Add(searchTm.split());
+        batchStats_->distComp_.Add(knn.DistanceComputations());
+        checkTruncated(knn, batchStats_);
+
+        WallClockTimer buildTm;
         unique_ptr<KNNQueue<dist_t>> res(knn.Result()->Clone());
 
         _return[queryIndex].reserve(k);
@@ -450,7 +704,10 @@ class QueryServiceHandler : virtual public QueryServiceIf {
           res->Pop();
         }
         std::reverse(_return[queryIndex].begin(), _return[queryIndex].end());
+        buildTime += buildTm.split();
+        if (cache_.IsEnabled() && !knn.IsTruncated()) cache_.Put(cacheKey, _return[queryIndex]);
       });
+      addBuildTime(buildTime);
 
     } catch (const exception& e) {
       QueryException qe;
@@ -464,18 +721,159 @@ class QueryServiceHandler : virtual public QueryServiceIf {
 
   }
 
+  void getStats(string& _return) {
+    try {
+      std::stringstream out;
+      stats_.Report(out);
+      out << "# TYPE nmslib_cache_hits_total counter" << std::endl;
+      out << "nmslib_cache_hits_total " << cache_.GetHitQty() << std::endl;
+      out << "# TYPE nmslib_cache_misses_total counter" << std::endl;
+      out << "nmslib_cache_misses_total " << cache_.GetMissQty() << std::endl;
+      out << "# TYPE nmslib_cache_entries gauge" << std::endl;
+      out << "nmslib_cache_entries " << cache_.Size() << std::endl;
+      _return = out.str();
+    } catch (const exception& e) {
+        QueryException qe;
+        qe.__set_message(e.what());
+        throw qe;
+    } catch (...) {
+        QueryException qe;
+        qe.__set_message("Unknown exception");
+        throw qe;
+    }
+  }
+
  private:
+  /*
+   * The call context is set only when the function is invoked
+   * by the thrift processor (with the statistics event handler installed).
+   */
+  void recordQueueWait(RPCStats* pStats) {
+    const CallContext& ctx = CurrentCall();
+    if (ctx.pStats_ == pStats) pStats->queueWait_.Add(UsecSince(ctx.start_));
+  }
+
+  // Each query of a batch gets the full timeout
+  void setTimeout(Query<dist_t>& query) const {
+    if (timeoutMsec_) query.SetTimeout(1000 * uint64_t(timeoutMsec_));
+  }
+
+  void checkTruncated(const Query<dist_t>& query, RPCStats* pStats) const {
+    if (query.IsTruncated()) {
+      ++pStats->truncQty_;
+      if (debugPrint_) {
+        LOG(LIB_INFO) << "The search was stopped by the timeout, returning the best results found so far";
+      }
+    }
+  }
+
+  void addBuildTime(uint64_t buildTime) {
+    CallContext& ctx = CurrentCall();
+    if (ctx.pStats_) ctx.buildTime_ += buildTime;
+  }
+
+  /*
+   * Encodes all the search parameters that affect the result, except the query object.
+   * It should be called only when the query-time parameters cannot be modified,
+   * i.e., when the counter of active queries is positive.
+   */
+  string cacheSearchParams(const char* queryType, double param, bool retExternId, bool retObj) const {
+    std::stringstream str;
+    str.precision(17);
+    str << queryType << ":" << param << ":" << retExternId << ":" << retObj << ":" << queryTimeParams_;
+    return str.str();
+  }
+
+  bool getCached(const string& cacheKey, ReplyEntryList& _return) {
+    bool found = cache_.Get(cacheKey, _return);
+    if (debugPrint_) {
+      LOG(LIB_INFO) << "Cache " << (found ? "hit" : "miss") << ", hit rate: " << cache_.GetHitRate()
+                    << " (" << cache_.GetHitQty() << " hits " << cache_.GetMissQty() << " misses)";
+    }
+    return found;
+  }
+
   bool                        debugPrint_;
   string                      methName_;
   unique_ptr<Space<dist_t>>   space_;
   unique_ptr<Index<dist_t>>   index_;
   vector<string>              externIds_;
   ObjectVector                dataSet_; 
+  // Data objects are stored contiguously in the arena, which frees them and also keeps
+  // the memory-mapped data file these objects may point into
+  ObjectArena                 objArena_;
+
+  LRUCache<ReplyEntryList>    cache_;
+  string                      queryTimeParams_;
+  unsigned                    timeoutMsec_;
+
+  ServerStats&                stats_;
+  RPCStats*                   knnStats_;
+  RPCStats*                   rangeStats_;
+  RPCStats*                   batchStats_;
+  RPCStats*                   distStats_;
 
   int                         counter_; 
   mutex                       mtx_;
 };
 
+/*
+ * Periodically writes server statistics to a file, which can be picked up
+ * by a scraper (e.g., the textfile collector of the Prometheus node exporter).
+ * The file is replaced atomically, so readers never see a partial report.
+ */
+class StatsFileWriter {
+public:
+  StatsFileWriter(QueryServiceIf& handler, const string& fileName, unsigned intervalSec) :
+                  handler_(handler), fileName_(fileName), intervalSec_(std::max(intervalSec, 1u)),
+                  stop_(false) {
+    thread_ = std::thread([this]() { run(); });
+  }
+  ~StatsFileWriter() {
+    {
+      unique_lock<mutex> lock(mtx_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+  }
+
+private:
+  void run() {
+    unique_lock<mutex> lock(mtx_);
+    while (!cv_.wait_for(lock, std::chrono::seconds(intervalSec_), [this]() { return stop_; })) {
+      write();
+    }
+  }
+
+  void write() {
+    try {
+      string report;
+      handler_.getStats(report);
+      string tmpFileName = fileName_ + ".tmp";
+      {
+        std::ofstream out(tmpFileName);
+        CHECK_MSG(out, "Cannot open file '" + tmpFileName + "' for writing");
+        out << report;
+      }
+      CHECK_MSG(std::rename(tmpFileName.c_str(), fileName_.c_str()) == 0,
+                "Cannot rename '" + tmpFileName + "' to '" + fileName_ + "'");
+    } catch (const QueryException& e) {
+      LOG(LIB_ERROR) << "Failed to obtain statistics: " << e.message;
+    } catch (const exception& e) {
+      LOG(LIB_ERROR) << "Failed to write statistics: " << e.what();
+    }
+  }
+
+  QueryServiceIf&         handler_;
+  string                  fileName_;
+  unsigned                intervalSec_;
+  bool                    stop_;
+  mutex                   mtx_;
+  std::condition_variable cv_;
+  std::thread             thread_;
+};
+
 namespace po = boost::program_options;
 
 static void Usage(const char *prog,
@@ -497,6 +895,12 @@ void ParseCommandLineForServer(int argc, char*argv[],
                       std::shared_ptr<AnyParams>&  SpaceParams,
                       string&                 DataFile,
                       unsigned&               MaxNumData,
+                      unsigned&               ShardQty,
+                      size_t&                 CacheSize,
+                      unsigned&               CacheTTL,
+                      unsigned&               TimeoutMsec,
+                      string&                 StatsFile,
+                      unsigned&               StatsInterval,
                       string&                         MethodName,
                       std::shared_ptr<AnyParams>&     IndexTimeParams,
                       std::shared_ptr<AnyParams>&     QueryTimeParams) {
@@ -519,9 +923,15 @@ void ParseCommandLineForServer(int argc, char*argv[],
     (DATA_FILE_PARAM_OPT.c_str(),     po::value<string>(&DataFile)->default_value(""),              DATA_FILE_PARAM_MSG.c_str())
     (MAX_NUM_DATA_PARAM_OPT.c_str(),  po::value<unsigned>(&MaxNumData)->default_value(MAX_NUM_DATA_PARAM_DEFAULT), MAX_NUM_DATA_PARAM_MSG.c_str())
     (METHOD_PARAM_OPT.c_str(),        po::value<string>(&MethodName)->required(), METHOD_PARAM_MSG.c_str())
+    (SHARD_QTY_PARAM_OPT.c_str(),     po::value<unsigned>(&ShardQty)->default_value(SHARD_QTY_PARAM_DEFAULT), SHARD_QTY_PARAM_MSG.c_str())
     (LOAD_INDEX_PARAM_OPT.c_str(),    po::value<string>(&LoadIndexLoc)->default_value(LOAD_INDEX_PARAM_DEFAULT),   LOAD_INDEX_PARAM_MSG.c_str())
     (SAVE_INDEX_PARAM_OPT.c_str(),    po::value<string>(&SaveIndexLoc)->default_value(SAVE_INDEX_PARAM_DEFAULT),   SAVE_INDEX_PARAM_MSG.c_str())
     ("cacheData",                     po::bool_switch(&CacheData), "save/load data together with the index")
+    (CACHE_SIZE_PARAM_OPT.c_str(),    po::value<size_t>(&CacheSize)->default_value(CACHE_SIZE_PARAM_DEFAULT), CACHE_SIZE_PARAM_MSG.c_str())
+    (CACHE_TTL_PARAM_OPT.c_str(),     po::value<unsigned>(&CacheTTL)->default_value(CACHE_TTL_PARAM_DEFAULT), CACHE_TTL_PARAM_MSG.c_str())
+    (TIMEOUT_PARAM_OPT.c_str(),       po::value<unsigned>(&TimeoutMsec)->default_value(TIMEOUT_PARAM_DEFAULT), TIMEOUT_PARAM_MSG.c_str())
+    (STATS_FILE_PARAM_OPT.c_str(),    po::value<string>(&StatsFile)->default_value(STATS_FILE_PARAM_DEFAULT), STATS_FILE_PARAM_MSG.c_str())
+    (STATS_INTERVAL_PARAM_OPT.c_str(), po::value<unsigned>(&StatsInterval)->default_value(STATS_INTERVAL_PARAM_DEFAULT), STATS_INTERVAL_PARAM_MSG.c_str())
     (QUERY_TIME_PARAMS_PARAM_OPT.c_str(), po::value<string>(&queryTimeParamStr)->default_value(""), QUERY_TIME_PARAMS_PARAM_MSG.c_str())
     (INDEX_TIME_PARAMS_PARAM_OPT.c_str(), po::value<string>(&indexTimeParamStr)->default_value(""), INDEX_TIME_PARAMS_PARAM_MSG.c_str())
     ;
@@ -562,6 +972,13 @@ void ParseCommandLineForServer(int argc, char*argv[],
       IndexTimeParams = shared_ptr<AnyParams>(new AnyParams(desc));
     }
 
+    if (ShardQty > 1) {
+      // The sharded index passes all the other index-time parameters to shards
+      IndexTimeParams->AddChangeParam("shardMethod", MethodName);
+      IndexTimeParams->AddChangeParam("shardQty", ShardQty);
+      MethodName = METH_SHARDED;
+    }
+
     {
       vector<string>  desc;
 
@@ -591,6 +1008,12 @@ int main(int argc, char *argv[]) {
   std::shared_ptr<AnyParams>  SpaceParams;
   string      DataFile;
   unsigned    MaxNumData;
+  unsigned    ShardQty;
+  size_t      CacheSize;
+  unsigned    CacheTTL;
+  unsigned    TimeoutMsec;
+  string      StatsFile;
+  unsigned    StatsInterval;
   
   string                         MethodName;
   std::shared_ptr<AnyParams>     IndexParams;
@@ -613,6 +1036,12 @@ int main(int argc, char *argv[]) {
                       SpaceParams,
                       DataFile,
                       MaxNumData,
+                      ShardQty,
+                      CacheSize,
+                      CacheTTL,
+                      TimeoutMsec,
+                      StatsFile,
+                      StatsInterval,
                       MethodName,
                       IndexParams,
                       QueryTimeParams
@@ -622,6 +1051,7 @@ int main(int argc, char *argv[]) {
 
   ToLower(DistType);
 
+  ServerStats                  stats(MethodName, SpaceType);
   unique_ptr<QueryServiceIf>   queryHandler;
 
   if (DIST_TYPE_INT == DistType) {
@@ -635,7 +1065,11 @@ int main(int argc, char *argv[]) {
                                                     SaveIndexLoc,
                                                     CacheData,
                                                     *IndexParams,
-                                                    *QueryTimeParams));
+                                                    *QueryTimeParams,
+                                                    CacheSize,
+                                                    CacheTTL,
+                                                    TimeoutMsec,
+                                                    stats));
   } else if (DIST_TYPE_FLOAT == DistType) {
     queryHandler.reset(new QueryServiceHandler<float>(debugPrint,
                                                     SpaceType,
@@ -647,13 +1081,18 @@ int main(int argc, char *argv[]) {
                                                     SaveIndexLoc,
                                                     CacheData,
                                                     *IndexParams,
-                                                    *QueryTimeParams));
+                                                    *QueryTimeParams,
+                                                    CacheSize,
+                                                    CacheTTL,
+                                                    TimeoutMsec,
+                                                    stats));
   } else {
     LOG(LIB_FATAL) << "Unknown distance value type: " << DistType;
   }
 
   ::apache::thrift::stdcxx::shared_ptr<QueryServiceIf> handler(queryHandler.get());
   ::apache::thrift::stdcxx::shared_ptr<TProcessor> processor(new QueryServiceProcessor(handler));
+  processor->setEventHandler(::apache::thrift::stdcxx::shared_ptr<TProcessorEventHandler>(new StatsEventHandler(stats)));
   ::apache::thrift::stdcxx::shared_ptr<TServerTransport> serverTransport(new TServerSocket(port));
   ::apache::thrift::stdcxx::shared_ptr<TTransportFactory> transportFactory(new TBufferedTransportFactory());
   ::apache::thrift::stdcxx::shared_ptr<TProtocolFactory> protocolFactory(new TBinaryProtocolFactory());
@@ -673,6 +1112,11 @@ int main(int argc, char *argv[]) {
                            threadManager);
   LOG(LIB_INFO) << "Started a server with a " << threadQty << " thread-pool.";
 #endif
+  unique_ptr<StatsFileWriter>  statsWriter;
+  if (!StatsFile.empty()) {
+    LOG(LIB_INFO) << "Writing statistics to '" << StatsFile << "' every " << StatsInterval << " sec.";
+    statsWriter.reset(new StatsFileWriter(*queryHandler, StatsFile, StatsInterval));
+  }
   server.serve();
   return 0;
 }
@@ -26,6 +26,7 @@ class QueryServiceIf {
   virtual void rangeQuery(ReplyEntryList& _return, const double r, const std::string& queryObj, const bool retExternId, const bool retObj) = 0;
   virtual void knnQueryBatch(ReplyEntryListBatch& _return, const int32_t k, const std::vector<std::string> & queryObj, const bool retExternId, const bool retObj, const int32_t numThreads) = 0;
   virtual double getDistance(const std::string& obj1, const std::string& obj2) = 0;
+  virtual void getStats(std::string& _return) = 0;
 };
 
 class QueryServiceIfFactory {
@@ -71,6 +72,9 @@ class QueryServiceNull : virtual public QueryServiceIf {
     double _return = (double)0;
     return _return;
   }
+  void getStats(std::string& /* _return */) {
+    return;
+  }
 };
 
 
@@ -661,6 +665,106 @@ class QueryService_getDistance_presult {
 
 };
 
+
+class QueryService_getStats_args {
+ public:
+
+  QueryService_getStats_args(const QueryService_getStats_args&);
+  QueryService_getStats_args& operator=(const QueryService_getStats_args&);
+  QueryService_getStats_args() {
+  }
+
+  virtual ~QueryService_getStats_args() throw();
+
+  bool operator == (const QueryService_getStats_args & /* rhs */) const
+  {
+    return true;
+  }
+  bool operator != (const QueryService_getStats_args &rhs) const {
+    return !(*this == rhs);
+  }
+
+  bool operator < (const QueryService_getStats_args & ) const;
+
+  uint32_t read(::apache::thrift::protocol::TProtocol* iprot);
+  uint32_t write(::apache::thrift::protocol::TProtocol* oprot) const;
+
+};
+
+
+class QueryService_getStats_pargs {
+ public:
+
+
+  virtual ~QueryService_getStats_pargs() throw();
+
+  uint32_t write(::apache::thrift::protocol::TProtocol* oprot) const;
+
+};
+
+typedef struct _QueryService_getStats_result__isset {
+  _QueryService_getStats_result__isset() : success(false), err(false) {}
+  bool success :1;
+  bool err :1;
+} _QueryService_getStats_result__isset;
+
+class QueryService_getStats_result {
+ public:
+
+  QueryService_getStats_result(const QueryService_getStats_result&);
+  QueryService_getStats_result& operator=(const QueryService_getStats_result&);
+  QueryService_getStats_result() : success() {
+  }
+
+  virtual ~QueryService_getStats_result() throw();
+  std::string success;
+  QueryException err;
+
+  _QueryService_getStats_result__isset __isset;
+
+  void __set_success(const std::string& val);
+
+  void __set_err(const QueryException& val);
+
+  bool operator == (const QueryService_getStats_result & rhs) const
+  {
+    if (!(success == rhs.success))
+      return false;
+    if (!(err == rhs.err))
+      return false;
+    return true;
+  }
+  bool operator != (const QueryService_getStats_result &rhs) const {
+    return !(*this == rhs);
+  }
+
+  bool operator < (const QueryService_getStats_result & ) const;
+
+  uint32_t read(::apache::thrift::protocol::TProtocol* iprot);
+  uint32_t write(::apache::thrift::protocol::TProtocol* oprot) const;
+
+};
+
+typedef struct _QueryService_getStats_presult__isset {
+  _QueryService_getStats_presult__isset() : success(false), err(false) {}
+  bool success :1;
+  bool err :1;
+} _QueryService_getStats_presult__isset;
+
+class QueryService_getStats_presult {
+ public:
+
+
+  virtual ~QueryService_getStats_presult() throw();
+  std::string* success;
+  QueryException err;
+
+  _QueryService_getStats_presult__isset __isset;
+
+  uint32_t read(::apache::thrift::protocol::TProtocol* iprot);
+
+};
+
 class QueryServiceClient : virtual public QueryServiceIf {
  public:
   QueryServiceClient(apache::thrift::stdcxx::shared_ptr< ::apache::thrift::protocol::TProtocol> prot) {
@@ -701,6 +805,9 @@ class QueryServiceClient : virtual public QueryServiceIf {
   double getDistance(const std::string& obj1, const std::string& obj2);
   void send_getDistance(const std::string& obj1, const std::string& obj2);
   double recv_getDistance();
+  void getStats(std::string& _return);
+  void send_getStats();
+  void recv_getStats(std::string& _return);
  protected:
   apache::thrift::stdcxx::shared_ptr< ::apache::thrift::protocol::TProtocol> piprot_;
   apache::thrift::stdcxx::shared_ptr< ::apache::thrift::protocol::TProtocol> poprot_;
@@ -721,6 +828,7 @@ class QueryServiceProcessor : public ::apache::thrift::TDispatchProcessor {
   void process_rangeQuery(int32_t seqid, ::apache::thrift::protocol::TProtocol* iprot, ::apache::thrift::protocol::TProtocol* oprot, void* callContext);
   void process_knnQueryBatch(int32_t seqid, ::apache::thrift::protocol::TProtocol* iprot, ::apache::thrift::protocol::TProtocol* oprot, void* callContext);
   void process_getDistance(int32_t seqid, ::apache::thrift::protocol::TProtocol* iprot, ::apache::thrift::protocol::TProtocol* oprot, void* callContext);
+  void process_getStats(int32_t seqid, ::apache::thrift::protocol::TProtocol* iprot, ::apache::thrift::protocol::TProtocol* oprot, void* callContext);
  public:
   QueryServiceProcessor(::apache::thrift::stdcxx::shared_ptr<QueryServiceIf> iface) :
     iface_(iface) {
@@ -729,6 +837,7 @@ class QueryServiceProcessor : public ::apache::thrift::TDispatchProcessor {
     processMap_["rangeQuery"] = &QueryServiceProcessor::process_rangeQuery;
     processMap_["knnQueryBatch"] = &QueryServiceProcessor::process_knnQueryBatch;
     processMap_["getDistance"] = &QueryServiceProcessor::process_getDistance;
+    processMap_["getStats"] = &QueryServiceProcessor::process_getStats;
   }
 
   virtual ~QueryServiceProcessor() {}
@@ -805,6 +914,16 @@ class QueryServiceMultiface : virtual public QueryServiceIf {
     return ifaces_[i]->getDistance(obj1, obj2);
   }
 
+  void getStats(std::string& _return) {
+    size_t sz = ifaces_.size();
+    size_t i = 0;
+    for (; i < (sz - 1); ++i) {
+      ifaces_[i]->getStats(_return);
+    }
+    ifaces_[i]->getStats(_return);
+    return;
+  }
+
 };
 
 // The 'concurrent' client is a thread safe client that correctly handles
@@ -850,6 +969,9 @@ class QueryServiceConcurrentClient : virtual public QueryServiceIf {
   double getDistance(const std::string& obj1, const std::string& obj2);
   int32_t send_getDistance(const std::string& obj1, const std::string& obj2);
   double recv_getDistance(const int32_t seqid);
+  void getStats(std::string& _return);
+  int32_t send_getStats();
+  void recv_getStats(std::string& _return, const int32_t seqid);
  protected:
   apache::thrift::stdcxx::shared_ptr< ::apache::thrift::protocol::TProtocol> piprot_;
   apache::thrift::stdcxx::shared_ptr< ::apache::thrift::protocol::TProtocol> poprot_;
@@ -50,5 +50,13 @@ service QueryService {
    */
   double getDistance(1: required binary obj1,
                      2: required binary obj2)
+  throws (1: QueryException err),
+
+  /*
+   * Return server statistics (latency histograms, the number of distance
+   * computations, cache counters) as a plain-text report, which uses 
+   * the Prometheus text exposition format.
+   */
+  string getStats()
   throws (1: QueryException err)
 }
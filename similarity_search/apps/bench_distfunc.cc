@@ -37,6 +37,7 @@
 #include "permutation_utils.h"
 #include "ztimer.h"
 #include "pow.h"
+#include "simd_math.h"
 
 #include "../test/testdataset.h"
 
@@ -965,6 +966,55 @@ void TestJSPrecomp(size_t N, size_t dim, size_t Rep, float pZero) {
 
 }
 
+template <class T>
+void TestJSPrecompSIMD(size_t N, size_t dim, size_t Rep, float pZero) {
+    T* pArr = new T[N * dim * 2];
+
+    T *p = pArr;
+    for (size_t i = 0; i < N; ++i, p+= 2 * dim) {
+        GenRandVect(p, dim, T(0), T(1), true);
+        SetRandZeros(p, dim, pZero);
+        PrecompLogarithms(p, dim);
+    }
+
+    // The error with respect to the version that uses std::log
+    T Error = 0, Dist = 0;
+    for (size_t j = 1; j < N; ++j) {
+        T exact = JSPrecomp(pArr + 2*j*dim, pArr + 2*(j-1)*dim, dim);
+        Error += fabs(exact - JSPrecompSIMD(pArr + 2*j*dim, pArr + 2*(j-1)*dim, dim));
+        Dist += exact;
+    }
+
+    WallClockTimer  t;
+
+    t.reset();
+
+    T DiffSum = 0;
+
+    T fract = T(1)/N;
+
+    for (size_t i = 0; i < Rep; ++i) {
+        for (size_t j = 1; j < N; ++j) {
+            DiffSum += 0.01f * JSPrecompSIMD(pArr + 2*j*dim, pArr + 2*(j-1)*dim, dim) / N;
+        }
+        /* 
+         * Multiplying by 0.01 and dividing the sum by N is to prevent Intel from "cheating":
+         *
+         * http://searchivarius.org/blog/problem-previous-version-intels-library-benchmark
+         */
+        DiffSum *= fract;
+    }
+
+    uint64_t tDiff = t.split();
+
+    LOG(LIB_INFO) << "Ignore: " << DiffSum;
+    LOG(LIB_INFO) << typeid(T).name() << " " << "Elapsed: " << tDiff / 1e3 << " ms " << " # of JSs (precomp SIMD log) (sparsity:" << pZero << ")  per second: " << (1e6/tDiff) * N * Rep 
+                  << " average relative error: " << Error / max(Dist, T(1e-18));
+
+    delete [] pArr;
+
+}
+
 template <class T>
 void TestJSPrecompApproxLog(size_t N, size_t dim, size_t Rep, float pZero) {
     T* pArr = new T[N * dim * 2];
@@ -1290,7 +1340,26 @@ void TestLevenshtein(size_t N, size_t Rep) {
 
     LOG(LIB_INFO) << "Ignore: " << DiffSum;
     LOG(LIB_INFO) << " Elapsed: " << tDiff / 1e3 << " ms " << 
-            " # of unoptimized unweighted Levenshtein distances per second: " << (1e6/tDiff) * N * Rep ;
+            " # of bit-parallel unweighted Levenshtein distances per second: " << (1e6/tDiff) * N * Rep ;
+
+    // The classic DP for comparison
+    t.reset();
+
+    DiffSum = 0;
+
+    for (size_t i = 0; i < Rep; ++i) {
+        for (size_t j = 1; j < N; ++j) {
+            DiffSum += 0.01f * levenshtein(reinterpret_cast<const char*>(elems[j-1]->data()), elems[j-1]->datalength(),
+                                           reinterpret_cast<const char*>(elems[j]->data()), elems[j]->datalength()) / N;
+        }
+        DiffSum *= fract;
+    }
+
+    tDiff = t.split();
+
+    LOG(LIB_INFO) << "Ignore: " << DiffSum;
+    LOG(LIB_INFO) << " Elapsed: " << tDiff / 1e3 << " ms " << 
+            " # of DP-based unweighted Levenshtein distances per second: " << (1e6/tDiff) * N * Rep ;
 
 }
 
@@ -1895,35 +1964,96 @@ void TestBitHamming(size_t N, size_t dim, size_t Rep) {
         memcpy(p, &h[0], WordQty * sizeof(h[0]));
     }
 
-    WallClockTimer  t;
+    // Each implementation supported by the CPU is benchmarked
+    for (BitPopcountImpl impl : {kBitPopcountScalar, kBitPopcountAVX2, kBitPopcountAVX512}) {
+      if (!IsBitPopcountImplSupported(impl)) continue;
 
-    t.reset();
+      WallClockTimer  t;
 
-    float DiffSum = 0;
+      t.reset();
 
-    float fract = 1.0f/N;
+      float DiffSum = 0;
 
-    for (size_t i = 0; i < Rep; ++i) {
-        for (size_t j = 1; j < N; ++j) {
-            DiffSum += 0.01f * BitHamming(pArr + j*WordQty, pArr + (j-1)*WordQty, WordQty) / N;
-        }
-        /* 
-         * Multiplying by 0.01 and dividing the sum by N is to prevent Intel from "cheating":
-         *
-         * http://searchivarius.org/blog/problem-previous-version-intels-library-benchmark
-         */
-        DiffSum *= fract;
-    }
+      float fract = 1.0f/N;
 
-    uint64_t tDiff = t.split();
+      for (size_t i = 0; i < Rep; ++i) {
+          for (size_t j = 1; j < N; ++j) {
+              DiffSum += 0.01f * BitHamming(impl, pArr + j*WordQty, pArr + (j-1)*WordQty, WordQty) / N;
+          }
+          /* 
+           * Multiplying by 0.01 and dividing the sum by N is to prevent Intel from "cheating":
+           *
+           * http://searchivarius.org/blog/problem-previous-version-intels-library-benchmark
+           */
+          DiffSum *= fract;
+      }
 
-    LOG(LIB_INFO) << "Ignore: " << DiffSum;
-    LOG(LIB_INFO) << "Elapsed: " << tDiff / 1e3 << " ms " << " # of BitHamming per second: " << (1e6/tDiff) * N * Rep ;
+      uint64_t tDiff = t.split();
+
+      LOG(LIB_INFO) << "Ignore: " << DiffSum;
+      LOG(LIB_INFO) << "Elapsed: " << tDiff / 1e3 << " ms " << " # of BitHamming (" << GetBitPopcountImplName(impl)
+                    << ") per second: " << (1e6/tDiff) * N * Rep ;
+    }
 
     delete [] pArr;
 
 }
 
+/*
+ * The L2 distance and the scalar product for fp16/bf16 vectors (each implementation
+ * supported by the CPU) and for float vectors. The data set is large enough not to fit
+ * into the cache: 16-bit vectors need half of the memory bandwidth.
+ */
+template <HalfFloatType type>
+void TestHalfFloatDist(size_t N, size_t dim, size_t Rep) {
+    vector<float>    arr(N * dim);
+    vector<uint16_t> arrHalf(N * dim);
+
+    for (size_t i = 0; i < N; ++i) {
+        GenRandVect(&arr[i * dim], dim, -1.0f, 1.0f);
+    }
+    FloatToHalfArray<type>(&arr[0], &arrHalf[0], N * dim);
+
+    for (int bDot = 0; bDot < 2; ++bDot) {
+        // -1 denotes float vectors
+        for (int implId = -1; implId <= kHalfFloatAVX512BF16; ++implId) {
+            HalfFloatImpl impl = HalfFloatImpl(implId);
+            if (implId >= 0 && !IsHalfFloatImplSupported(impl)) continue;
+
+            WallClockTimer  t;
+
+            t.reset();
+
+            float DiffSum = 0;
+
+            float fract = 1.0f/N;
+
+            for (size_t i = 0; i < Rep; ++i) {
+                for (size_t j = 1; j < N; ++j) {
+                    float d;
+                    if (implId < 0) {
+                        d = bDot ? ScalarProductSIMD(&arr[j * dim], &arr[(j-1) * dim], dim) :
+                                   L2SqrSIMD(&arr[j * dim], &arr[(j-1) * dim], dim);
+                    } else {
+                        d = bDot ? ScalarProductHalf<type>(impl, &arrHalf[j * dim], &arrHalf[(j-1) * dim], dim) :
+                                   L2SqrHalf<type>(impl, &arrHalf[j * dim], &arrHalf[(j-1) * dim], dim);
+                    }
+                    DiffSum += 0.01f * d / N;
+                }
+                DiffSum *= fract;
+            }
+
+            uint64_t tDiff = t.split();
+
+            LOG(LIB_INFO) << "Ignore: " << DiffSum;
+            LOG(LIB_INFO) << "Elapsed: " << tDiff / 1e3 << " ms " << " # of " << (bDot ? "scalar products" : "L2Sqr")
+                          << " (" << (implId < 0 ? string("float") :
+                                      string(GetHalfFloatTypeName(type)) + " " + GetHalfFloatImplName(impl))
+                          << ") dim=" << dim << " per second: " << (1e6/tDiff) * N * Rep ;
+        }
+    }
+}
+
 void TestBitJaccard(size_t N, size_t dim, size_t Rep) {
     size_t WordQty = (dim + 31)/32; 
     uint32_t* pArr = new uint32_t[N * WordQty];
@@ -2058,6 +2188,13 @@ void TestRenyiDivFast(size_t N, size_t dim, size_t Rep, T alpha) {
         GenRandVect(p, dim, T(RANGE_SMALL), T(1.0), true /* norm. for regular KL */);
     }
 
+    T Error = 0, Dist = 0;
+    for (size_t j = 1; j < N; ++j) {
+        T exact = renyiDivergenceSlow(pArr + j*dim, pArr + (j-1)*dim, dim, alpha);
+        Error += fabs(exact - renyiDivergenceFast(pArr + j*dim, pArr + (j-1)*dim, dim, alpha));
+        Dist += fabs(exact);
+    }
+
     WallClockTimer  t;
 
     t.reset();
@@ -2081,12 +2218,129 @@ void TestRenyiDivFast(size_t N, size_t dim, size_t Rep, T alpha) {
     uint64_t tDiff = t.split();
 
     LOG(LIB_INFO) << "Ignore: " << DiffSum;
-    LOG(LIB_INFO) << typeid(T).name() << " " << "Elapsed: " << tDiff / 1e3 << " ms " << " # of fast Renyi-div. (alpha=" << alpha << ") per second: " << (1e6/tDiff) * N * Rep ;
+    LOG(LIB_INFO) << typeid(T).name() << " " << "Elapsed: " << tDiff / 1e3 << " ms " << " # of fast Renyi-div. (alpha=" << alpha << ") per second: " << (1e6/tDiff) * N * Rep
+                  << " average relative error: " << Error / max(Dist, T(1e-18));
 
     delete [] pArr;
 
 }
 
+template <class T>
+void TestAlphaBetaDiv(size_t N, size_t dim, size_t Rep, T alpha, T beta, bool bFast) {
+    T* pArr = new T[N * dim];
+
+    T *p = pArr;
+    for (size_t i = 0; i < N; ++i, p+= dim) {
+        GenRandVect(p, dim, T(RANGE_SMALL), T(1.0), true /* norm. for regular KL */);
+    }
+
+    T Error = 0, Dist = 0;
+    if (bFast) {
+        for (size_t j = 1; j < N; ++j) {
+            T exact = alphaBetaDivergenceSlow(pArr + j*dim, pArr + (j-1)*dim, dim, alpha, beta);
+            Error += fabs(exact - alphaBetaDivergenceFast(pArr + j*dim, pArr + (j-1)*dim, dim, alpha, beta));
+            Dist += fabs(exact);
+        }
+    }
+
+    WallClockTimer  t;
+
+    t.reset();
+
+    T DiffSum = 0;
+
+    T fract = T(1)/N;
+
+    for (size_t i = 0; i < Rep; ++i) {
+        for (size_t j = 1; j < N; ++j) {
+            DiffSum += 0.01f * (bFast ? alphaBetaDivergenceFast(pArr + j*dim, pArr + (j-1)*dim, dim, alpha, beta) :
+                                        alphaBetaDivergenceSlow(pArr + j*dim, pArr + (j-1)*dim, dim, alpha, beta)) / N;
+        }
+        DiffSum *= fract;
+    }
+
+    uint64_t tDiff = t.split();
+
+    LOG(LIB_INFO) << "Ignore: " << DiffSum;
+    LOG(LIB_INFO) << typeid(T).name() << " " << "Elapsed: " << tDiff / 1e3 << " ms " << " # of " << (bFast ? "fast" : "slow")
+                  << " alpha-beta div. (alpha=" << alpha << " beta=" << beta << ") per second: " << (1e6/tDiff) * N * Rep
+                  << (bFast ? " average relative error: " + ConvertToString(Error / max(Dist, T(1e-18))) : string(""));
+
+    delete [] pArr;
+
+}
+
+/*
+ * Throughput (numbers per second) and the maximum relative error
+ * of SIMD log, exp, and pow with respect to std functions.
+ */
+template <SIMDMathAccuracy acc>
+void TestSIMDMathFunc(size_t N, size_t Rep) {
+    vector<float> args(N), powArgs(N), res(N);
+    // Log and pow arguments are positive, exp arguments are their logarithms
+    for (size_t i = 0; i < N; ++i) {
+        args[i] = std::exp(40 * RandomReal<float>() - 20);
+        powArgs[i] = 4 * RandomReal<float>() - 2;
+    }
+    // The exponent of pow is the same for eight consecutive numbers
+    N -= N % 8;
+
+    for (int func = 0; func < 3; ++func) {
+        const char* funcName = func == 0 ? "log" : (func == 1 ? "exp" : "pow");
+        vector<float> inp(args);
+        if (func == 1) for (float& v : inp) v = std::log(v);
+
+        for (int bStd = 0; bStd < 2; ++bStd) {
+            WallClockTimer  t;
+            t.reset();
+
+            float DiffSum = 0;
+
+            for (size_t i = 0; i < Rep; ++i) {
+                if (bStd) {
+                    for (size_t j = 0; j < N; ++j) {
+                        res[j] = func == 0 ? std::log(inp[j]) :
+                                 (func == 1 ? std::exp(inp[j]) : std::pow(inp[j], powArgs[j & ~size_t(7)]));
+                    }
+                } else {
+#ifdef PORTABLE_SSE2
+                    typedef SIMDMathOps<SIMDMathWidest> Ops;
+                    for (size_t j = 0; j < N; j += Ops::kQty) {
+                        SIMDMathVect x = Ops::Load(&inp[j]);
+                        Ops::Store(&res[j], func == 0 ? LogSIMD<acc>(x) :
+                                            (func == 1 ? ExpSIMD<acc>(x) : PowSIMD<acc>(x, Ops::Set1(powArgs[j & ~size_t(7)]))));
+                    }
+#else
+                    for (size_t j = 0; j < N; ++j) {
+                        res[j] = func == 0 ? LogPoly<acc>(inp[j]) :
+                                 (func == 1 ? ExpPoly<acc>(inp[j]) : PowPoly<acc>(inp[j], powArgs[j & ~size_t(7)]));
+                    }
+#endif
+                }
+                DiffSum += 0.01f * res[i % N] / Rep;
+            }
+
+            uint64_t tDiff = t.split();
+
+            double maxRelErr = 0;
+            if (!bStd) {
+                for (size_t j = 0; j < N; ++j) {
+                    double exact = func == 0 ? std::log(double(inp[j])) :
+                                   (func == 1 ? std::exp(double(inp[j])) : std::pow(double(inp[j]), double(powArgs[j & ~size_t(7)])));
+                    // Logarithms are close to zero for arguments close to one
+                    maxRelErr = max(maxRelErr, fabs(res[j] - exact) / (func == 0 ? max(fabs(exact), 1.0) : fabs(exact)));
+                }
+            }
+
+            LOG(LIB_INFO) << "Ignore: " << DiffSum;
+            LOG(LIB_INFO) << "Elapsed: " << tDiff / 1e3 << " ms " << " # of "
+                          << (bStd ? "std::" : (acc == kSIMDMathAccurate ? "accurate SIMD " : "fast SIMD ")) << funcName
+                          << " per second: " << (1e6/tDiff) * N * Rep
+                          << (bStd ? string("") : " max. relative error: " + ConvertToString(maxRelErr));
+        }
+    }
+}
+
 }  // namespace similarity
 
 using namespace similarity;
@@ -2114,6 +2368,18 @@ int main(int argc, char* argv[]) {
       TestRenyiDivFast<float>(1024, dim, 100, alpha);
     }
 
+    nTest++;
+    TestSIMDMathFunc<kSIMDMathAccurate>(4096, 20000);
+    nTest++;
+    TestSIMDMathFunc<kSIMDMathFast>(4096, 20000);
+
+    for (float alpha = -1; alpha <= 1; alpha += 1) {
+      nTest++;
+      TestAlphaBetaDiv<float>(1024, dim, 100, alpha, 0.5f, false);
+      nTest++;
+      TestAlphaBetaDiv<float>(1024, dim, 100, alpha, 0.5f, true);
+    }
+
 #if defined(WITH_EXTRAS)
     nTest++;
     TestSQFDMinus<float>(2000, 50);
@@ -2139,6 +2405,15 @@ int main(int argc, char* argv[]) {
     nTest++;
     TestBitHamming(1000, 1024, 1500);
 
+    nTest++;
+    TestHalfFloatDist<kHalfFloatFP16>(20000, 768, 20);
+    nTest++;
+    TestHalfFloatDist<kHalfFloatBF16>(20000, 768, 20);
+    nTest++;
+    TestHalfFloatDist<kHalfFloatFP16>(1000, 128, 2000);
+    nTest++;
+    TestHalfFloatDist<kHalfFloatBF16>(1000, 128, 2000);
+
     nTest++;
     TestBitJaccard(1000, 32, 50000);
     nTest++;
@@ -2244,6 +2519,13 @@ int main(int argc, char* argv[]) {
     nTest++;
     TestJSPrecomp<float>(1024, dim, 500, pZero3);
 
+    nTest++;
+    TestJSPrecompSIMD<float>(1024, dim, 1000, pZero1);
+    nTest++;
+    TestJSPrecompSIMD<float>(1024, dim, 1000, pZero2);
+    nTest++;
+    TestJSPrecompSIMD<float>(1024, dim, 1000, pZero3);
+
     nTest++;
     TestJSPrecompApproxLog<float>(1024, dim, 1000, pZero1);
     nTest++;
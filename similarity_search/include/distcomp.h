@@ -25,6 +25,7 @@
 #include <portable_popcount.h>
 
 #include "permutation_type.h"
+#include "half_float.h"
 #include "idtype.h"
 
 namespace similarity {
@@ -59,6 +60,15 @@ template <class T> T L2NormSIMD(const T* pVect1, const T* pVect2, size_t qty);
 
 float L2SqrSIMD(const float* pVect1, const float* pVect2, size_t qty);
 
+/*
+ * One-to-many versions: pOut[i] = f(pVects[i], pQuery), all vectors have qty elements.
+ * They are faster than n calls of one-to-one functions, b/c several vectors are processed at once.
+ */
+void L2SqrSIMDBatch(const float* pQuery, const float* const* pVects, size_t n, size_t qty, float* pOut);
+void L1NormSIMDBatch(const float* pQuery, const float* const* pVects, size_t n, size_t qty, float* pOut);
+void ScalarProductSIMDBatch(const float* pQuery, const float* const* pVects, size_t n, size_t qty, float* pOut);
+void NormScalarProductSIMDBatch(const float* pQuery, const float* const* pVects, size_t n, size_t qty, float* pOut);
+
 /*
  * Scalar product related distances 
  */
@@ -171,6 +181,8 @@ template <class T> void PrecompLogarithms(T* pVect, size_t qty) {
 template <class T> T JSStandard(const T *pVect1, const T *pVect2, size_t qty);
 // Precomputed logs
 template <class T> T JSPrecomp(const T *pVect1, const T *pVect2, size_t qty);
+// Precomputed logs, the remaining log is computed using SIMD (see simd_math.h)
+template <class T> T JSPrecompSIMD(const T *pVect1, const T *pVect2, size_t qty);
 // Precomputed logs, one log is approximate
 template <class T> T JSPrecompApproxLog(const T *pVect1, const T *pVect2, size_t qty);
 
@@ -223,32 +235,87 @@ int SpearmanRho(const PivotIdType* x, const PivotIdType* y, size_t qty);
 int SpearmanFootruleSIMD(const PivotIdType* x, const PivotIdType* y, size_t qty);
 int SpearmanRhoSIMD(const PivotIdType* x, const PivotIdType* y, size_t qty);
 
-template <typename dist_t, typename dist_uint_t>
-dist_t inline BitJaccard(const dist_uint_t* a, const dist_uint_t* b, size_t qty) {
-  dist_uint_t num = 0, den = 0;
-
+/*
+ * Popcount-based distances for bit vectors stored as 32-bit words.
+ * There are several implementations, the best one supported
+ * by the CPU is chosen at run time (see distcomp_bit.cc).
+ */
+enum BitPopcountImpl {
+  kBitPopcountScalar = 0,
+  kBitPopcountAVX2   = 1,
+  kBitPopcountAVX512 = 2
+};
+
+bool IsBitPopcountImplSupported(BitPopcountImpl impl);
+BitPopcountImpl GetBitPopcountImpl();
+const char* GetBitPopcountImplName(BitPopcountImpl impl);
+
+unsigned BitHamming(const uint32_t* a, const uint32_t* b, size_t qty);
+// Computes popcount(a & b) and popcount(a | b)
+void BitAndOrCount(const uint32_t* a, const uint32_t* b, size_t qty, unsigned& andQty, unsigned& orQty);
+
+// These versions use a given implementation (which must be supported), e.g., for testing
+unsigned BitHamming(BitPopcountImpl impl, const uint32_t* a, const uint32_t* b, size_t qty);
+void BitAndOrCount(BitPopcountImpl impl, const uint32_t* a, const uint32_t* b, size_t qty,
+                   unsigned& andQty, unsigned& orQty);
+
+// One-to-many versions: pOut[i] is the distance between pVects[i] and pQuery
+void BitHammingBatch(const uint32_t* pQuery, const uint32_t* const* pVects, size_t n, size_t qty, unsigned* pOut);
+void BitHammingBatch(BitPopcountImpl impl, const uint32_t* pQuery, const uint32_t* const* pVects,
+                     size_t n, size_t qty, unsigned* pOut);
+void BitAndOrCountBatch(const uint32_t* pQuery, const uint32_t* const* pVects, size_t n, size_t qty,
+                        unsigned* pAndQty, unsigned* pOrQty);
+
+// A fallback for words other than 32-bit ones
+template <typename dist_uint_t>
+void inline BitAndOrCount(const dist_uint_t* a, const dist_uint_t* b, size_t qty, unsigned& andQty, unsigned& orQty) {
+  andQty = orQty = 0;
   for (size_t i=0; i < qty; ++i) {
-    //  __builtin_popcount quickly computes the number on 1s
-    num +=  __builtin_popcount(a[i] & b[i]);
-    den +=  __builtin_popcount(a[i] | b[i]);
+    andQty +=  __builtin_popcountll(a[i] & b[i]);
+    orQty  +=  __builtin_popcountll(a[i] | b[i]);
   }
-
-  return 1  - (dist_t(num) / dist_t(den));
 }
 
-//unsigned BitHamming(const uint32_t* a, const uint32_t* b, size_t qty);
-
-unsigned inline BitHamming(const uint32_t* a, const uint32_t* b, size_t qty) {
-  unsigned res = 0;
+template <typename dist_t, typename dist_uint_t>
+dist_t inline BitJaccard(const dist_uint_t* a, const dist_uint_t* b, size_t qty) {
+  unsigned num = 0, den = 0;
 
-  for (size_t i=0; i < qty; ++i) {
-    //  __builtin_popcount quickly computes the number on 1s
-    res +=  __builtin_popcount(a[i] ^ b[i]);
-  }
+  BitAndOrCount(a, b, qty, num, den);
 
-  return res;
+  return 1  - (dist_t(num) / dist_t(den));
 }
 
+/*
+ * Distances between vectors of 16-bit floating-point numbers (see half_float.h).
+ * Elements are converted to single precision inside the kernels and all
+ * arithmetic is carried out in single precision. As with popcount kernels,
+ * the best implementation supported by the CPU is chosen at run time
+ * (see distcomp_half.cc).
+ */
+enum HalfFloatImpl {
+  kHalfFloatScalar     = 0,
+  kHalfFloatAVX2       = 1,
+  kHalfFloatAVX512     = 2,
+  kHalfFloatAVX512BF16 = 3
+};
+
+bool IsHalfFloatImplSupported(HalfFloatImpl impl);
+HalfFloatImpl GetHalfFloatImpl();
+const char* GetHalfFloatImplName(HalfFloatImpl impl);
+
+template <HalfFloatType type> float L2SqrHalf(const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+template <HalfFloatType type> float ScalarProductHalf(const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+// The same as NormScalarProductSIMD: zero for (nearly) zero vectors, clamped to [-1, 1]
+template <HalfFloatType type> float NormScalarProductHalf(const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+
+// These versions use a given implementation (which must be supported), e.g., for testing
+template <HalfFloatType type>
+float L2SqrHalf(HalfFloatImpl impl, const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+template <HalfFloatType type>
+float ScalarProductHalf(HalfFloatImpl impl, const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+template <HalfFloatType type>
+float NormScalarProductHalf(HalfFloatImpl impl, const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+
 // Returns the size of the intersection
 unsigned IntersectSizeScalarFast(const IdType *pArr1, size_t qty1, const IdType *pArr2, size_t qty2);
 unsigned IntersectSizeScalarStand(const IdType *pArr1, size_t qty1, const IdType *pArr2, size_t qty2);
@@ -15,6 +15,10 @@
 #ifndef DISTCOMP_EDIST_HPP
 #define DISTCOMP_EDIST_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 namespace similarity {
 
 /* 
@@ -33,6 +37,49 @@ template<class T> int levenshtein(const T &s1, const T & s2) {
   return levenshtein(s1.c_str(), s1.size(), s2.c_str(), s2.size());
 }
 
+/*
+ * Bit-parallel computation of the Levenshtein distance:
+ *
+ * Gene Myers, "A fast bit-vector algorithm for approximate string matching based on dynamic programming", 1999
+ * Heikki Hyyro, "A bit-vector algorithm for computing Levenshtein and Damerau edit distances", 2003
+ *
+ * A column of the DP matrix is encoded by bit-vectors of vertical +1/-1 differences,
+ * one bit per character of the pattern. Longer patterns are split into 64-bit blocks.
+ * The cost is O(ceil(len(pattern)/64) * len(text)).
+ *
+ * The bounded version stops as soon as a lower bound for the distance exceeds maxDist.
+ * The lower bound is the value of the DP cell on the diagonal that ends in the
+ * bottom-right corner: any path to the corner either goes through this cell or it
+ * crosses the current column at a cell whose value plus the length difference
+ * of remaining suffixes is at least as large.
+ * The bounded version returns the exact distance if it doesn't exceed maxDist,
+ * otherwise, it returns a value that is larger than maxDist (but not necessarily the distance).
+ */
+#define LEVEN_BIT_PARALLEL_STACK_BLOCK_QTY  2
+
+int levenshteinBitParallel(const char* p1, size_t len1, const char* p2, size_t len2);
+int levenshteinBitParallelBounded(const char* p1, size_t len1, const char* p2, size_t len2, int maxDist);
+
+/*
+ * The same algorithm, but the pattern (e.g., a query) is preprocessed only once,
+ * which pays off when the pattern is compared against many strings.
+ */
+class LevenshteinBitParallel {
+ public:
+  LevenshteinBitParallel(const char* pattern, size_t len);
+
+  int Distance(const char* text, size_t len) const {
+    return DistanceBounded(text, len, INT32_MAX);
+  }
+  int DistanceBounded(const char* text, size_t len, int maxDist) const;
+  size_t PatternLen() const { return len_; }
+ private:
+  size_t                  len_;
+  size_t                  blockQty_;
+  // Match masks: a block of blockQty_ words for every possible character
+  std::vector<uint64_t>   peq_;
+};
+
 
 }
 
@@ -0,0 +1,125 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#ifndef DISTCOMP_FIXED_DIM_H
+#define DISTCOMP_FIXED_DIM_H
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include "portable_intrinsics.h"
+#include "distcomp.h"
+
+namespace similarity {
+
+/*
+ * Dense float kernels whose dimensionality is a compile-time constant.
+ * DIM must be a multiple of 16: the loop has a constant trip count,
+ * the compiler can unroll it completely, and there is no tail processing.
+ * DIM == 0 means that the dimensionality is known only at run time:
+ * in this case, the generic SIMD functions from distcomp.h are called.
+ *
+ * The summation order is the same as in the generic functions,
+ * so the results are the same as well.
+ */
+
+template <size_t DIM>
+inline float L2SqrFixedDim(const float* pVect1, const float* pVect2, size_t qty) {
+  static_assert(DIM % 16 == 0, "The dimensionality should be a multiple of 16");
+#ifdef PORTABLE_SSE2
+  if (DIM == 0) return L2SqrSIMD(pVect1, pVect2, qty);
+
+  __m128  diff, v1, v2;
+  __m128  sum = _mm_set1_ps(0);
+
+  for (size_t i = 0; i < DIM; i += 4) {
+    v1   = _mm_loadu_ps(pVect1 + i);
+    v2   = _mm_loadu_ps(pVect2 + i);
+    diff = _mm_sub_ps(v1, v2);
+    sum  = _mm_add_ps(sum, _mm_mul_ps(diff, diff));
+  }
+
+  float PORTABLE_ALIGN16 TmpRes[4];
+  _mm_store_ps(TmpRes, sum);
+  return TmpRes[0] + TmpRes[1] + TmpRes[2] + TmpRes[3];
+#else
+  return L2SqrSIMD(pVect1, pVect2, DIM ? DIM : qty);
+#endif
+}
+
+template <size_t DIM>
+inline float ScalarProductFixedDim(const float* pVect1, const float* pVect2, size_t qty) {
+  static_assert(DIM % 16 == 0, "The dimensionality should be a multiple of 16");
+#ifdef PORTABLE_SSE2
+  if (DIM == 0) return ScalarProductSIMD(pVect1, pVect2, qty);
+
+  __m128  sum = _mm_set1_ps(0);
+
+  for (size_t i = 0; i < DIM; i += 4) {
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pVect1 + i), _mm_loadu_ps(pVect2 + i)));
+  }
+
+  float PORTABLE_ALIGN16 TmpRes[4];
+  _mm_store_ps(TmpRes, sum);
+  return TmpRes[0] + TmpRes[1] + TmpRes[2] + TmpRes[3];
+#else
+  return ScalarProductSIMD(pVect1, pVect2, DIM ? DIM : qty);
+#endif
+}
+
+// The same as NormScalarProductSIMD: zero for (nearly) zero vectors, clamped to [-1, 1]
+template <size_t DIM>
+inline float NormScalarProductFixedDim(const float* pVect1, const float* pVect2, size_t qty) {
+  static_assert(DIM % 16 == 0, "The dimensionality should be a multiple of 16");
+#ifdef PORTABLE_SSE2
+  if (DIM == 0) return NormScalarProductSIMD(pVect1, pVect2, qty);
+
+  __m128  v1, v2;
+  __m128  sum_prod = _mm_set1_ps(0);
+  __m128  sum_square1 = sum_prod;
+  __m128  sum_square2 = sum_prod;
+
+  for (size_t i = 0; i < DIM; i += 4) {
+    v1   = _mm_loadu_ps(pVect1 + i);
+    v2   = _mm_loadu_ps(pVect2 + i);
+    sum_prod     = _mm_add_ps(sum_prod, _mm_mul_ps(v1, v2));
+    sum_square1  = _mm_add_ps(sum_square1, _mm_mul_ps(v1, v1));
+    sum_square2  = _mm_add_ps(sum_square2, _mm_mul_ps(v2, v2));
+  }
+
+  float PORTABLE_ALIGN16 TmpResProd[4];
+  float PORTABLE_ALIGN16 TmpResSquare1[4];
+  float PORTABLE_ALIGN16 TmpResSquare2[4];
+
+  _mm_store_ps(TmpResProd, sum_prod);
+  float sum = TmpResProd[0] + TmpResProd[1] + TmpResProd[2] + TmpResProd[3];
+  _mm_store_ps(TmpResSquare1, sum_square1);
+  float norm1 = TmpResSquare1[0] + TmpResSquare1[1] + TmpResSquare1[2] + TmpResSquare1[3];
+  _mm_store_ps(TmpResSquare2, sum_square2);
+  float norm2 = TmpResSquare2[0] + TmpResSquare2[1] + TmpResSquare2[2] + TmpResSquare2[3];
+
+  const float eps = std::numeric_limits<float>::min() * 2;
+
+  if (norm1 < eps || norm2 < eps) return 0;
+
+  return std::max(float(-1), std::min(float(1), sum / std::sqrt(norm1) / std::sqrt(norm2)));
+#else
+  return NormScalarProductSIMD(pVect1, pVect2, DIM ? DIM : qty);
+#endif
+}
+
+}  // namespace similarity
+
+#endif
@@ -24,6 +24,8 @@
 #include "object.h"
 #include "utils.h"
 #include "space.h"
+#include "mmap_dataset.h"
+#include "object_arena.h"
 
 namespace similarity {
 
@@ -103,15 +105,6 @@ public:
     }
   }
 
-  ~ExperimentConfig() {
-    for (auto it = origData_.begin(); it != origData_.end(); ++it) {
-      delete *it;
-    }
-    for (auto it = origQuery_.begin(); it != origQuery_.end(); ++it) {
-      delete *it;
-    }
-  }
-
   void PrintInfo() const;
   void SelectTestSet(int SetNum);
   int GetTestSetToRunQty() const {
@@ -169,6 +162,9 @@ private:
   unordered_map<size_t, size_t> cachedDataAssignment_;
   string            datafile_;
   string            queryfile_;
+  // All data and query objects are stored contiguously in the arena, which frees them
+  // and also keeps memory-mapped files these objects may point into
+  ObjectArena       objArena_;
   const ObjectVector* pExternalData_;  
   const ObjectVector* pExternalQuery_;  
   bool              noQueryData_;
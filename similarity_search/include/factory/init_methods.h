@@ -25,6 +25,7 @@
 #include "factory/method/hnsw.h"
 #include "factory/method/vptree.h"
 #include "factory/method/simple_inverted_index.h"
+#include "factory/method/sharded_index.h"
 
 namespace similarity {
 
@@ -62,6 +63,10 @@ inline void initMethods() {
 
   // Classic DAAT inverted index
   REGISTER_METHOD_CREATOR(float,  METH_SIMPLE_INV_INDEX, CreateSimplInvIndex)
+
+  // In-process scatter-gather search over several shards
+  REGISTER_METHOD_CREATOR(float,  METH_SHARDED, CreateShardedIndex)
+  REGISTER_METHOD_CREATOR(int,    METH_SHARDED, CreateShardedIndex)
 }
 
 
@@ -25,6 +25,7 @@
 #include "factory/space/space_js.h"
 #include "factory/space/space_lp.h"
 #include "factory/space/space_scalar.h"
+#include "factory/space/space_half_vector.h"
 #include "factory/space/space_sparse_lp.h"
 #include "factory/space/space_sparse_scalar.h"
 #include "factory/space/space_word_embed.h"
@@ -85,6 +86,14 @@ inline void initSpaces() {
   REGISTER_SPACE_CREATOR(float,  SPACE_ANGULAR_DISTANCE, CreateAngularDistance)
   REGISTER_SPACE_CREATOR(float,  SPACE_NEGATIVE_SCALAR, CreateNegativeScalarProduct)
 
+  // Dense vectors with 16-bit (fp16 and bf16) elements
+  REGISTER_SPACE_CREATOR(float,  SPACE_L2_FP16, CreateL2Half<kHalfFloatFP16>)
+  REGISTER_SPACE_CREATOR(float,  SPACE_L2_BF16, CreateL2Half<kHalfFloatBF16>)
+  REGISTER_SPACE_CREATOR(float,  SPACE_COSINE_SIMILARITY_FP16, CreateCosineSimilarityHalf<kHalfFloatFP16>)
+  REGISTER_SPACE_CREATOR(float,  SPACE_COSINE_SIMILARITY_BF16, CreateCosineSimilarityHalf<kHalfFloatBF16>)
+  REGISTER_SPACE_CREATOR(float,  SPACE_NEGATIVE_SCALAR_FP16, CreateNegativeScalarProductHalf<kHalfFloatFP16>)
+  REGISTER_SPACE_CREATOR(float,  SPACE_NEGATIVE_SCALAR_BF16, CreateNegativeScalarProductHalf<kHalfFloatBF16>)
+
   // Sparse
   REGISTER_SPACE_CREATOR(float,  SPACE_SPARSE_L, CreateSparseL)
   REGISTER_SPACE_CREATOR(float,  SPACE_SPARSE_LINF, CreateSparseLINF)
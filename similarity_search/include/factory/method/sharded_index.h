@@ -0,0 +1,40 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#ifndef _FACTORY_SHARDED_INDEX_H_
+#define _FACTORY_SHARDED_INDEX_H_
+
+#include <method/sharded_index.h>
+
+namespace similarity {
+
+/*
+ * Creating functions.
+ */
+
+template <typename dist_t>
+Index<dist_t>* CreateShardedIndex(bool PrintProgress,
+                                  const string& SpaceType,
+                                  Space<dist_t>& space,
+                                  const ObjectVector& DataObjects) {
+  return new ShardedIndex<dist_t>(PrintProgress, SpaceType, space, DataObjects);
+}
+
+/*
+ * End of creating functions.
+ */
+
+}
+
+#endif
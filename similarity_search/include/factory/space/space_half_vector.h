@@ -0,0 +1,46 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#ifndef FACTORY_SPACE_HALF_VECTOR_H
+#define FACTORY_SPACE_HALF_VECTOR_H
+
+#include <space/space_half_vector.h>
+
+namespace similarity {
+
+/*
+ * Creating functions.
+ */
+
+template <HalfFloatType type>
+inline Space<float>* CreateL2Half(const AnyParams& /* ignoring params */) {
+  return new SpaceL2Half<type>();
+}
+
+template <HalfFloatType type>
+inline Space<float>* CreateCosineSimilarityHalf(const AnyParams& /* ignoring params */) {
+  return new SpaceCosineSimilarityHalf<type>();
+}
+
+template <HalfFloatType type>
+inline Space<float>* CreateNegativeScalarProductHalf(const AnyParams& /* ignoring params */) {
+  return new SpaceNegativeScalarProductHalf<type>();
+}
+
+/*
+ * End of creating functions.
+ */
+}
+
+#endif
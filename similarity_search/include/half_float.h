@@ -0,0 +1,157 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#ifndef HALF_FLOAT_H
+#define HALF_FLOAT_H
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+#include "portable_intrinsics.h"
+
+namespace similarity {
+
+/*
+ * 16-bit floating-point formats, which are used to store dense vectors compactly:
+ *
+ * 1) IEEE half precision (fp16): 5 exponent bits and 10 mantissa bits.
+ *    The largest finite number is 65504, larger numbers become infinities.
+ * 2) bfloat16 (bf16): the upper half of a single-precision number, i.e.,
+ *    8 exponent bits (the same range as float) and 7 mantissa bits.
+ *
+ * Numbers are stored as uint16_t. Conversions from float round to the nearest
+ * even number. Conversions to float are exact.
+ */
+enum HalfFloatType {
+  kHalfFloatFP16 = 0,
+  kHalfFloatBF16 = 1
+};
+
+inline uint32_t FloatAsBits(float f) {
+  uint32_t res;
+  memcpy(&res, &f, sizeof res);
+  return res;
+}
+
+inline float BitsAsFloat(uint32_t u) {
+  float res;
+  memcpy(&res, &u, sizeof res);
+  return res;
+}
+
+/*
+ * Software conversions are based on the code of F. Giesen
+ * (https://gist.github.com/rygorous/2156668).
+ */
+inline uint16_t FloatToFP16Software(float f) {
+  const uint32_t f32Infty = 255U << 23;
+  const uint32_t f16Max = (127U + 16) << 23;
+  // Adding this number aligns the mantissa of denormal fp16 numbers
+  const uint32_t denormMagic = ((127U - 15) + (23 - 10) + 1) << 23;
+
+  uint32_t x = FloatAsBits(f);
+  uint32_t sign = x & 0x80000000U;
+  x ^= sign;
+
+  uint16_t res;
+  if (x >= f16Max) {
+    // Infinity or NaN (all NaNs become quiet ones)
+    res = x > f32Infty ? 0x7e00 : 0x7c00;
+  } else if (x < (113U << 23)) {
+    // A denormal number or zero
+    res = static_cast<uint16_t>(FloatAsBits(BitsAsFloat(x) + BitsAsFloat(denormMagic)) - denormMagic);
+  } else {
+    uint32_t mantOdd = (x >> 13) & 1;
+    // Rebiasing the exponent and rounding to the nearest even
+    x += ((15U - 127) << 23) + 0xfff;
+    x += mantOdd;
+    res = static_cast<uint16_t>(x >> 13);
+  }
+  return res | static_cast<uint16_t>(sign >> 16);
+}
+
+inline float FP16ToFloatSoftware(uint16_t h) {
+  const uint32_t shiftedExp = 0x7c00U << 13;
+  uint32_t res = (h & 0x7fffU) << 13;
+  uint32_t exp = shiftedExp & res;
+  res += (127U - 15) << 23;
+
+  if (exp == shiftedExp) {
+    // Infinity or NaN
+    res += (128U - 16) << 23;
+  } else if (exp == 0) {
+    // A denormal number or zero: renormalizing
+    res += 1U << 23;
+    res = FloatAsBits(BitsAsFloat(res) - BitsAsFloat(113U << 23));
+  }
+  return BitsAsFloat(res | ((h & 0x8000U) << 16));
+}
+
+// F16C instructions are used if they are enabled at compile time
+inline uint16_t FloatToFP16(float f) {
+#ifdef __F16C__
+  return static_cast<uint16_t>(_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT));
+#else
+  return FloatToFP16Software(f);
+#endif
+}
+
+inline float FP16ToFloat(uint16_t h) {
+#ifdef __F16C__
+  return _cvtsh_ss(h);
+#else
+  return FP16ToFloatSoftware(h);
+#endif
+}
+
+inline uint16_t FloatToBF16(float f) {
+  uint32_t x = FloatAsBits(f);
+  // NaNs must remain NaNs after truncation
+  if ((x & 0x7fffffffU) > 0x7f800000U) return static_cast<uint16_t>((x >> 16) | 0x40);
+  x += 0x7fffU + ((x >> 16) & 1);
+  return static_cast<uint16_t>(x >> 16);
+}
+
+inline float BF16ToFloat(uint16_t h) {
+  return BitsAsFloat(uint32_t(h) << 16);
+}
+
+template <HalfFloatType type>
+inline uint16_t FloatToHalf(float f) {
+  return type == kHalfFloatFP16 ? FloatToFP16(f) : FloatToBF16(f);
+}
+
+template <HalfFloatType type>
+inline float HalfToFloat(uint16_t h) {
+  return type == kHalfFloatFP16 ? FP16ToFloat(h) : BF16ToFloat(h);
+}
+
+template <HalfFloatType type>
+inline void FloatToHalfArray(const float* pSrc, uint16_t* pDst, size_t qty) {
+  for (size_t i = 0; i < qty; ++i) pDst[i] = FloatToHalf<type>(pSrc[i]);
+}
+
+template <HalfFloatType type>
+inline void HalfToFloatArray(const uint16_t* pSrc, float* pDst, size_t qty) {
+  for (size_t i = 0; i < qty; ++i) pDst[i] = HalfToFloat<type>(pSrc[i]);
+}
+
+inline const char* GetHalfFloatTypeName(HalfFloatType type) {
+  return type == kHalfFloatFP16 ? "fp16" : "bf16";
+}
+
+}  // namespace similarity
+
+#endif
@@ -16,6 +16,8 @@
 #define _INDEX_STRUCTURE_H_
 
 #include <stdio.h>
+#include <istream>
+#include <ostream>
 #include <string>
 #include <vector>
 
@@ -61,6 +63,17 @@ public:
   virtual void LoadIndex(const string& location) {
     throw runtime_error("LoadIndex is not implemented for method: " + StrDesc());
   }
+  /*
+   * Stream versions of SaveIndex and LoadIndex, which make it possible to keep
+   * a serialized index in memory. They are implemented only by methods that
+   * store the whole index in a single file.
+   */
+  virtual void SaveIndexToStream(std::ostream& output) {
+    throw runtime_error("SaveIndexToStream is not implemented for method: " + StrDesc());
+  }
+  virtual void LoadIndexFromStream(std::istream& input) {
+    throw runtime_error("LoadIndexFromStream is not implemented for method: " + StrDesc());
+  }
   virtual ~Index() {}
   /*
    * There are two type of search methods: a range search and a k-Nearest Neighbor search.
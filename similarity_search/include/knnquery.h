@@ -37,6 +37,7 @@ class KNNQuery : public Query<dist_t> {
 
   const KNNQueue<dist_t>* Result() const;
   virtual dist_t Radius() const;
+  virtual dist_t DistanceBound() const;
   unsigned ResultSize() const;
   unsigned GetK() const { return K_; }
   float GetEPS() const { return eps_; }
@@ -0,0 +1,139 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#ifndef KNOWN_SPACE_DIST_H
+#define KNOWN_SPACE_DIST_H
+
+#include <cmath>
+#include <algorithm>
+
+#include "object.h"
+#include "space.h"
+#include "distcomp_fixed_dim.h"
+
+namespace similarity {
+
+/*
+ * Distance functors for popular dense float spaces. Each of them computes
+ * exactly what HiddenDistance of the respective space computes,
+ * but they are not virtual and they don't check data lengths:
+ * a search loop that is instantiated for a specific functor
+ * gets the distance inlined.
+ *
+ * The first argument is a data point and the second one is the query.
+ */
+template <size_t DIM>
+struct L2DistFixedDim {
+  explicit L2DistFixedDim(size_t dim) : dim_(dim) {}
+  float operator()(const float* pObj, const float* pQuery) const {
+    return std::sqrt(L2SqrFixedDim<DIM>(pObj, pQuery, dim_));
+  }
+  size_t dim_;
+};
+
+template <size_t DIM>
+struct CosineDistFixedDim {
+  explicit CosineDistFixedDim(size_t dim) : dim_(dim) {}
+  float operator()(const float* pObj, const float* pQuery) const {
+    return std::max(float(0), 1 - NormScalarProductFixedDim<DIM>(pObj, pQuery, dim_));
+  }
+  size_t dim_;
+};
+
+template <size_t DIM>
+struct AngularDistFixedDim {
+  explicit AngularDistFixedDim(size_t dim) : dim_(dim) {}
+  float operator()(const float* pObj, const float* pQuery) const {
+    return std::acos(NormScalarProductFixedDim<DIM>(pObj, pQuery, dim_));
+  }
+  size_t dim_;
+};
+
+template <size_t DIM>
+struct NegDotProdDistFixedDim {
+  explicit NegDotProdDistFixedDim(size_t dim) : dim_(dim) {}
+  float operator()(const float* pObj, const float* pQuery) const {
+    return -ScalarProductFixedDim<DIM>(pObj, pQuery, dim_);
+  }
+  size_t dim_;
+};
+
+enum KnownDistType {
+  kKnownDistNone = 0,
+  kKnownDistL2,
+  kKnownDistCosine,
+  kKnownDistAngular,
+  kKnownDistNegDotProd
+};
+
+/*
+ * Recognizes a space with a known distance (see the functors above) and
+ * the dimensionality of the data set. This is done once, when the data is loaded.
+ * Afterwards, Visit() calls visitor(functor), where the type of the functor
+ * is specialized for both the distance and the dimensionality.
+ * Dimensionalities 64, 96, 128, 256, 384, 768, and 960 have
+ * compile-time kernels, other dimensionalities use generic SIMD functions.
+ *
+ * Only float spaces are recognized. For other distance types, IsKnown() is always false.
+ */
+template <typename dist_t>
+class KnownSpaceDist {
+ public:
+  KnownSpaceDist() : type_(kKnownDistNone), dim_(0) {}
+
+  // All data points must have the same dimensionality, otherwise, the generic path is used.
+  void Init(const Space<dist_t>& space, const ObjectVector& data);
+
+  KnownDistType GetType() const { return type_; }
+  size_t GetDim() const { return dim_; }
+  bool IsKnown() const { return type_ != kKnownDistNone; }
+  // The query must have the same dimensionality as data points
+  bool IsCompatible(const Object* pQuery) const {
+    return IsKnown() && pQuery->datalength() == dim_ * sizeof(float);
+  }
+
+  // Returns false, if the space isn't known
+  template <class Visitor>
+  bool Visit(Visitor& visitor) const {
+    switch (type_) {
+      case kKnownDistL2:          VisitDim<L2DistFixedDim>(visitor); return true;
+      case kKnownDistCosine:      VisitDim<CosineDistFixedDim>(visitor); return true;
+      case kKnownDistAngular:     VisitDim<AngularDistFixedDim>(visitor); return true;
+      case kKnownDistNegDotProd:  VisitDim<NegDotProdDistFixedDim>(visitor); return true;
+      default: return false;
+    }
+  }
+
+ private:
+  template <template <size_t> class DistFunc, class Visitor>
+  void VisitDim(Visitor& visitor) const {
+    switch (dim_) {
+      case 64:  visitor(DistFunc<64>(dim_)); break;
+      case 96:  visitor(DistFunc<96>(dim_)); break;
+      case 128: visitor(DistFunc<128>(dim_)); break;
+      case 256: visitor(DistFunc<256>(dim_)); break;
+      case 384: visitor(DistFunc<384>(dim_)); break;
+      case 768: visitor(DistFunc<768>(dim_)); break;
+      case 960: visitor(DistFunc<960>(dim_)); break;
+      default:  visitor(DistFunc<0>(dim_));
+    }
+  }
+
+  KnownDistType type_;
+  size_t        dim_;
+};
+
+}  // namespace similarity
+
+#endif
@@ -0,0 +1,228 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#ifndef _LATENCY_HISTOGRAM_H_
+#define _LATENCY_HISTOGRAM_H_
+
+#include <vector>
+#include <atomic>
+#include <limits>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "global.h"
+
+namespace similarity {
+
+/*
+ * A histogram of non-negative integer values (e.g., latencies in microseconds
+ * or numbers of distance computations) with log-linear buckets, similar to
+ * the HDR histogram: Each power-of-two range is split into SUB_BUCKET_QTY
+ * equal-width buckets. Values below 2*SUB_BUCKET_QTY are recorded exactly,
+ * for larger values the relative error of quantile estimates is at most
+ * 1/SUB_BUCKET_QTY (about 3%). The whole 64-bit range is covered
+ * by a fixed number of buckets, so recording never allocates memory.
+ *
+ * This class is not thread-safe, see ConcurrentLogHistogram.
+ */
+class LogHistogram {
+public:
+  static const unsigned SUB_BUCKET_BITS = 5;
+  static const size_t   SUB_BUCKET_QTY = size_t(1) << SUB_BUCKET_BITS;
+  static const size_t   BUCKET_QTY = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_QTY;
+
+  LogHistogram() : counts_(BUCKET_QTY) { Clear(); }
+
+  static size_t BucketId(uint64_t val) {
+    if (val < SUB_BUCKET_QTY) return val;
+    unsigned shift = MostSignificantBit(val) - SUB_BUCKET_BITS;
+    return shift * SUB_BUCKET_QTY + (val >> shift);
+  }
+  // The largest value that falls into a given bucket
+  static uint64_t BucketMaxValue(size_t bucketId) {
+    if (bucketId < 2 * SUB_BUCKET_QTY) return bucketId;
+    unsigned  shift = bucketId / SUB_BUCKET_QTY - 1;
+    uint64_t  sub = bucketId % SUB_BUCKET_QTY + SUB_BUCKET_QTY;
+    return (sub << shift) + ((uint64_t(1) << shift) - 1);
+  }
+
+  void Add(uint64_t val, uint64_t qty = 1) {
+    if (!qty) return;
+    counts_[BucketId(val)] += qty;
+    count_ += qty;
+    sum_ += val * qty;
+    min_ = std::min(min_, val);
+    max_ = std::max(max_, val);
+  }
+
+  void Merge(const LogHistogram& other) {
+    for (size_t i = 0; i < BUCKET_QTY; ++i) counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  void Clear() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = sum_ = max_ = 0;
+    min_ = std::numeric_limits<uint64_t>::max();
+  }
+
+  uint64_t GetCount() const { return count_; }
+  uint64_t GetSum() const { return sum_; }
+  uint64_t GetMin() const { return count_ ? min_ : 0; }
+  uint64_t GetMax() const { return max_; }
+  double   GetMean() const { return count_ ? double(sum_) / count_ : 0; }
+  uint64_t GetBucketCount(size_t bucketId) const { return counts_[bucketId]; }
+
+  /*
+   * Returns the estimate of the q-quantile (0 <= q <= 1), i.e., the largest
+   * value of the bucket where the cumulative count reaches q * GetCount().
+   * Estimates never exceed the maximum recorded value.
+   */
+  uint64_t GetQuantile(double q) const {
+    if (!count_) return 0;
+    q = std::max(0.0, std::min(1.0, q));
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * count_)));
+    uint64_t cumQty = 0;
+    for (size_t i = 0; i < BUCKET_QTY; ++i) {
+      cumQty += counts_[i];
+      if (cumQty >= rank) return std::max(std::min(BucketMaxValue(i), max_), min_);
+    }
+    return max_;
+  }
+
+private:
+  static unsigned MostSignificantBit(uint64_t val) {
+#ifdef _MSC_VER
+    unsigned long pos;
+    _BitScanReverse64(&pos, val);
+    return pos;
+#else
+    return 63 - __builtin_clzll(val);
+#endif
+  }
+
+  friend class ConcurrentLogHistogram;
+
+  std::vector<uint64_t>   counts_;
+  uint64_t                count_;
+  uint64_t                sum_;
+  uint64_t                min_;
+  uint64_t                max_;
+};
+
+/*
+ * A lock-free version of LogHistogram, which can be updated concurrently
+ * by many threads. To avoid contention, each thread writes into its own
+ * shard (threads are mapped to shards by a sequential thread number)
+ * using relaxed atomic operations. Shards are allocated on first use
+ * and merged only when a snapshot is requested.
+ */
+class ConcurrentLogHistogram {
+public:
+  static const size_t MAX_SHARD_QTY = 64;
+
+  ConcurrentLogHistogram() {
+    for (size_t i = 0; i < MAX_SHARD_QTY; ++i) shards_[i].store(nullptr);
+  }
+  ~ConcurrentLogHistogram() {
+    for (size_t i = 0; i < MAX_SHARD_QTY; ++i) delete shards_[i].load();
+  }
+
+  void Add(uint64_t val) {
+    Shard& shard = getShard();
+    shard.counts_[LogHistogram::BucketId(val)].fetch_add(1, std::memory_order_relaxed);
+    shard.count_.fetch_add(1, std::memory_order_relaxed);
+    shard.sum_.fetch_add(val, std::memory_order_relaxed);
+    updateExtremum(shard.min_, val, [](uint64_t a, uint64_t b) { return a < b; });
+    updateExtremum(shard.max_, val, [](uint64_t a, uint64_t b) { return a > b; });
+  }
+
+  /*
+   * Merges all the shards into a regular histogram. The snapshot is not
+   * atomic with respect to concurrent updates, i.e., it may miss updates
+   * that happen while it is being created.
+   */
+  void GetSnapshot(LogHistogram& res) const {
+    res.Clear();
+    for (size_t i = 0; i < MAX_SHARD_QTY; ++i) {
+      const Shard* pShard = shards_[i].load(std::memory_order_acquire);
+      if (pShard == nullptr) continue;
+      for (size_t k = 0; k < LogHistogram::BUCKET_QTY; ++k) {
+        res.counts_[k] += pShard->counts_[k].load(std::memory_order_relaxed);
+      }
+      res.count_ += pShard->count_.load(std::memory_order_relaxed);
+      res.sum_ += pShard->sum_.load(std::memory_order_relaxed);
+      res.min_ = std::min(res.min_, pShard->min_.load(std::memory_order_relaxed));
+      res.max_ = std::max(res.max_, pShard->max_.load(std::memory_order_relaxed));
+    }
+  }
+
+private:
+  struct Shard {
+    Shard() : counts_(LogHistogram::BUCKET_QTY), count_(0), sum_(0),
+              min_(std::numeric_limits<uint64_t>::max()), max_(0) {
+      for (auto& c : counts_) c.store(0, std::memory_order_relaxed);
+    }
+    std::vector<std::atomic<uint64_t>>  counts_;
+    std::atomic<uint64_t>               count_;
+    std::atomic<uint64_t>               sum_;
+    std::atomic<uint64_t>               min_;
+    std::atomic<uint64_t>               max_;
+  };
+
+  static size_t getThreadShardId() {
+    static std::atomic<size_t> threadQty(0);
+    static thread_local size_t threadId = threadQty.fetch_add(1);
+    return threadId % MAX_SHARD_QTY;
+  }
+
+  Shard& getShard() {
+    std::atomic<Shard*>& slot = shards_[getThreadShardId()];
+    Shard* pShard = slot.load(std::memory_order_acquire);
+    if (pShard == nullptr) {
+      Shard* pNewShard = new Shard();
+      if (slot.compare_exchange_strong(pShard, pNewShard, std::memory_order_acq_rel)) {
+        pShard = pNewShard;
+      } else {
+        // Another thread mapped to the same shard was faster
+        delete pNewShard;
+      }
+    }
+    return *pShard;
+  }
+
+  template <class Compare>
+  static void updateExtremum(std::atomic<uint64_t>& extr, uint64_t val, Compare better) {
+    uint64_t curr = extr.load(std::memory_order_relaxed);
+    while (better(val, curr) &&
+           !extr.compare_exchange_weak(curr, val, std::memory_order_relaxed)) {}
+  }
+
+  std::atomic<Shard*>   shards_[MAX_SHARD_QTY];
+
+  // disable copy and assign
+  DISABLE_COPY_AND_ASSIGN(ConcurrentLogHistogram);
+};
+
+}   // namespace similarity
+
+#endif     // _LATENCY_HISTOGRAM_H_
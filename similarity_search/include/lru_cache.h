@@ -0,0 +1,185 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#ifndef _LRU_CACHE_H_
+#define _LRU_CACHE_H_
+
+#include <string>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+
+#include "object.h"
+
+namespace similarity {
+
+using std::string;
+
+/*
+ * A bounded thread-safe LRU cache with optional expiration of entries.
+ * To reduce lock contention, the cache is split into segments, each of
+ * which has its own lock and LRU list. A key is assigned to a segment
+ * using its hash value. Keys are stored in full: Hence, hash collisions
+ * never result in returning a wrong value.
+ */
+template <class ValueType>
+class LRUCache {
+public:
+  /*
+   * maxQty is the maximum number of cached entries (0 disables caching),
+   * ttlMsec is the entry time-to-live (0 means entries never expire).
+   */
+  LRUCache(size_t maxQty, uint64_t ttlMsec, size_t segmentQty = 16) :
+                ttlMsec_(ttlMsec), hitQty_(0), missQty_(0) {
+    if (segmentQty == 0) segmentQty = 1;
+    if (maxQty < segmentQty) segmentQty = std::max<size_t>(maxQty, 1);
+    segmentMaxQty_ = (maxQty + segmentQty - 1) / segmentQty;
+    for (size_t i = 0; i < segmentQty; ++i) {
+      segments_.emplace_back(new Segment());
+    }
+  }
+
+  bool IsEnabled() const { return segmentMaxQty_ > 0; }
+
+  /*
+   * Returns true and copies the cached value, if the key is found
+   * and the respective entry has not expired.
+   */
+  bool Get(const string& key, ValueType& value) {
+    if (!IsEnabled()) return false;
+    Segment& seg = getSegment(key);
+    {
+      std::unique_lock<std::mutex> lock(seg.mtx_);
+      auto it = seg.map_.find(key);
+      if (it != seg.map_.end()) {
+        if (isExpired(it->second->timeStamp_)) {
+          seg.list_.erase(it->second);
+          seg.map_.erase(it);
+        } else {
+          // Move the entry to the head of the LRU list
+          seg.list_.splice(seg.list_.begin(), seg.list_, it->second);
+          value = it->second->value_;
+          ++hitQty_;
+          return true;
+        }
+      }
+    }
+    ++missQty_;
+    return false;
+  }
+
+  void Put(const string& key, const ValueType& value) {
+    if (!IsEnabled()) return;
+    Segment& seg = getSegment(key);
+    std::unique_lock<std::mutex> lock(seg.mtx_);
+    auto it = seg.map_.find(key);
+    if (it != seg.map_.end()) {
+      it->second->value_ = value;
+      it->second->timeStamp_ = Clock::now();
+      seg.list_.splice(seg.list_.begin(), seg.list_, it->second);
+      return;
+    }
+    seg.list_.emplace_front(key, value);
+    seg.map_.emplace(key, seg.list_.begin());
+    if (seg.map_.size() > segmentMaxQty_) {
+      seg.map_.erase(seg.list_.back().key_);
+      seg.list_.pop_back();
+    }
+  }
+
+  void Clear() {
+    for (auto& seg : segments_) {
+      std::unique_lock<std::mutex> lock(seg->mtx_);
+      seg->map_.clear();
+      seg->list_.clear();
+    }
+  }
+
+  size_t Size() const {
+    size_t res = 0;
+    for (auto& seg : segments_) {
+      std::unique_lock<std::mutex> lock(seg->mtx_);
+      res += seg->map_.size();
+    }
+    return res;
+  }
+
+  uint64_t GetHitQty() const { return hitQty_; }
+  uint64_t GetMissQty() const { return missQty_; }
+  double GetHitRate() const {
+    uint64_t hitQty = hitQty_, totalQty = hitQty + missQty_;
+    return totalQty ? double(hitQty) / totalQty : 0;
+  }
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Entry {
+    Entry(const string& key, const ValueType& value) :
+          key_(key), value_(value), timeStamp_(Clock::now()) {}
+    string              key_;
+    ValueType           value_;
+    Clock::time_point   timeStamp_;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  struct Segment {
+    mutable std::mutex                                        mtx_;
+    EntryList                                                 list_;
+    std::unordered_map<string, typename EntryList::iterator>  map_;
+  };
+
+  Segment& getSegment(const string& key) {
+    return *segments_[std::hash<string>()(key) % segments_.size()];
+  }
+
+  bool isExpired(const Clock::time_point& timeStamp) const {
+    return ttlMsec_ > 0 &&
+           std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - timeStamp).count() >= (int64_t)ttlMsec_;
+  }
+
+  std::vector<std::unique_ptr<Segment>>   segments_;
+  size_t                                  segmentMaxQty_;
+  uint64_t                                ttlMsec_;
+  std::atomic<uint64_t>                   hitQty_;
+  std::atomic<uint64_t>                   missQty_;
+
+  // disable copy and assign
+  DISABLE_COPY_AND_ASSIGN(LRUCache);
+};
+
+/*
+ * Creates a cache key from the query object payload and
+ * a string that encodes all other search parameters
+ * (e.g., k, query-time parameters). The parameter string
+ * should not contain zero characters.
+ */
+inline string CreateQueryCacheKey(const Object* pQueryObj, const string& searchParams) {
+  string key(searchParams);
+  key.push_back('\0');
+  key.append(pQueryObj->data(), pQueryObj->datalength());
+  return key;
+}
+
+}   // namespace similarity
+
+#endif     // _LRU_CACHE_H_
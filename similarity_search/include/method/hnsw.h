@@ -54,7 +54,9 @@ namespace similarity {
       kNormCosine = 3,
       kNegativeDotProduct = 4,
       kL1Norm = 5,
-      kLInfNorm = 6
+      kLInfNorm = 6,
+      kBitHamming = 7,
+      kBitJaccard = 8
     };
 
     using std::string;
@@ -457,6 +459,10 @@ namespace similarity {
 
         virtual void LoadIndex(const string &location) override;
 
+        virtual void SaveIndexToStream(std::ostream &output) override;
+
+        virtual void LoadIndexFromStream(std::istream &input) override;
+
         Hnsw(bool PrintProgress, const Space<dist_t> &space, const ObjectVector &data);
         void CreateIndex(const AnyParams &IndexParams) override;
 
@@ -18,6 +18,7 @@
 #include <string>
 
 #include "index.h"
+#include "known_space_dist.h"
 
 #define METH_SEQ_SEARCH                 "brute_force"
 #define METH_SEQ_SEARCH_SYN             "seq_search"
@@ -52,6 +53,8 @@ class SeqSearch : public Index<dist_t> {
   bool                    multiThread_;
   IdTypeUnsign            threadQty_;
   vector<ObjectVector>    vvThreadData;
+  // Recognized at index creation: allows using inlined distance functions
+  KnownSpaceDist<dist_t>  knownDist_;
 
   const ObjectVector& getData() const { return pData_ != NULL ? *pData_ : this->data_; }
   // disable copy and assign
@@ -0,0 +1,100 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#ifndef _SHARDED_INDEX_H_
+#define _SHARDED_INDEX_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "index.h"
+#include "thread_pool.h"
+
+#define METH_SHARDED                 "sharded"
+
+namespace similarity {
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+
+template <typename dist_t>
+class Space;
+
+/*
+ * An in-process scatter-gather index. The data set is split into shardQty
+ * contiguous slices, each slice is indexed by its own instance of the method
+ * shardMethod. Shards are created and loaded in parallel. A query is sent
+ * to all the shards in parallel (using a thread pool shared by all queries)
+ * and shard-specific results are merged.
+ *
+ * Shards keep pointers to the original data objects. Hence, merged results
+ * carry global object IDs.
+ *
+ */
+template <typename dist_t>
+class ShardedIndex : public Index<dist_t> {
+ public:
+  ShardedIndex(bool PrintProgress,
+               const string& SpaceType,
+               Space<dist_t>& space,
+               const ObjectVector& data);
+  virtual ~ShardedIndex();
+
+  void CreateIndex(const AnyParams& IndexParams) override;
+  void SaveIndex(const string& location) override;
+  void LoadIndex(const string& location) override;
+
+  const std::string StrDesc() const override { return METH_SHARDED; }
+
+  void Search(RangeQuery<dist_t>* query, IdType) const override;
+  void Search(KNNQuery<dist_t>* query, IdType) const override;
+
+  void SetQueryTimeParams(const AnyParams& params) override;
+
+  // New data is added to the smallest shard
+  void AddBatch(const ObjectVector& batchData, bool printProgress, bool checkIDs = false) override;
+
+  size_t GetSize() const override;
+
+  bool DuplicateData() const override;
+ private:
+  bool                              PrintProgress_;
+  string                            spaceType_;
+  Space<dist_t>&                    space_;
+
+  string                            shardMethod_;
+  size_t                            shardQty_;
+  size_t                            threadQty_;
+
+  /*
+   * shardData_ is sized once before shards are created and is never
+   * resized afterwards, because shard indices keep references to its elements.
+   */
+  vector<ObjectVector>              shardData_;
+  vector<unique_ptr<Index<dist_t>>> shards_;
+  unique_ptr<ThreadPool>            pool_;
+
+  void SplitData(const vector<size_t>& shardSizes);
+  void CreateShards();
+  static string ShardLocation(const string& location, size_t shardId);
+
+  // disable copy and assign
+  DISABLE_COPY_AND_ASSIGN(ShardedIndex);
+};
+
+}   // namespace similarity
+
+#endif     // _SHARDED_INDEX_H_
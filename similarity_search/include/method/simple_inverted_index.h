@@ -19,8 +19,14 @@
 #include <sstream>
 #include <unordered_map>
 #include <memory>
+#include <vector>
+#include <limits>
+#include <algorithm>
 
 #include "index.h"
+#include "falconn_heap_mod.h"
+#include "mmap_dataset.h"
+#include "posting_codec.h"
 #include "space/space_sparse_scalar_fast.h"
 
 #define METH_SIMPLE_INV_INDEX             "simple_invindx"
@@ -41,6 +47,7 @@ class SimplInvIndex : public Index<dist_t> {
               Space<dist_t>& space, 
               const ObjectVector& data) : Index<dist_t>(data),
                                           printProgress_(printProgress),
+                                          algoType_(kDAAT),
                                           pSpace_(dynamic_cast<SpaceSparseNegativeScalarProductFast*>(&space)) {
     if (pSpace_ == nullptr) {
       PREPARE_RUNTIME_ERR(err) <<
@@ -74,16 +81,47 @@ class SimplInvIndex : public Index<dist_t> {
   // a protected creator that has already a created parameter manager
   void CreateIndex(AnyParamManager& ParamManager);
 
+  /*
+   * Query processing algorithms:
+   * 1) exhaustive document-at-a-time processing;
+   * 2) WAND: Broder et al., Efficient query evaluation using a two-level retrieval process, CIKM 2003;
+   * 3) Block-Max WAND: Ding and Suel, Faster top-k document retrieval using block-max indexes, SIGIR 2011;
+   * 4) MaxScore: Turtle and Flood, Query evaluation: strategies and optimizations, IP&M 1995.
+   * All of them return the same top-k documents (up to ties), but 2-4 skip documents
+   * whose upper bounds show that they cannot enter the top-k.
+   */
+  enum AlgoType { kDAAT, kWAND, kBlockMaxWAND, kMaxScore };
+
+  void SearchDAAT(KNNQuery<dist_t>* query) const;
+  // These functions work with both uncompressed and compressed posting-list cursors
+  template <class Cursor>
+  void SearchExhaustive(KNNQuery<dist_t>* query, std::vector<Cursor>& cursors) const;
+  template <class Cursor>
+  void SearchWAND(KNNQuery<dist_t>* query, std::vector<Cursor>& cursors, bool useBlockMax) const;
+  template <class Cursor>
+  void SearchMaxScore(KNNQuery<dist_t>* query, std::vector<Cursor>& cursors) const;
+
   struct PostEntry {
     IdType   doc_id_; // IdType is signed
     dist_t   val_;
     PostEntry(int32_t doc_id = 0, dist_t val = 0) : doc_id_(doc_id), val_(val) {}
   };
+  // The number of postings in a block, whose maximum and minimum values are memorized
+  static const size_t kBlockSize = 64;
+  struct PostBlock {
+    IdType  last_doc_id_;
+    dist_t  max_val_;
+    dist_t  min_val_;
+  };
   struct PostList {
     // Variables are const, so that they can be initialized only in constructor
     // However, the memory that entries_ point to isn't const and can be modified
     const size_t     qty_;
     PostEntry* const entries_;
+    // Block statistics are computed (by ComputeBlocks) after the entries are filled
+    std::vector<PostBlock> blocks_;
+    dist_t           max_val_ = 0;
+    dist_t           min_val_ = 0;
     PostList(size_t qty) :
         qty_(qty),
         entries_(new PostEntry[qty]) {
@@ -91,8 +129,194 @@ class SimplInvIndex : public Index<dist_t> {
     ~PostList() {
       delete [] entries_;
     }
+    void ComputeBlocks() {
+      blocks_.clear();
+      for (size_t start = 0; start < qty_; start += kBlockSize) {
+        size_t end = std::min(qty_, start + kBlockSize);
+        PostBlock b = { entries_[end - 1].doc_id_, entries_[start].val_, entries_[start].val_ };
+        for (size_t i = start + 1; i < end; ++i) {
+          b.max_val_ = std::max(b.max_val_, entries_[i].val_);
+          b.min_val_ = std::min(b.min_val_, entries_[i].val_);
+        }
+        if (blocks_.empty()) {
+          max_val_ = b.max_val_;
+          min_val_ = b.min_val_;
+        } else {
+          max_val_ = std::max(max_val_, b.max_val_);
+          min_val_ = std::min(min_val_, b.min_val_);
+        }
+        blocks_.push_back(b);
+      }
+    }
+  };
+
+  static const IdType kNoMoreDocs = std::numeric_limits<IdType>::max();
+
+  /*
+   * A posting-list cursor for dynamic pruning. Values can be negative, so
+   * the upper bound of the term contribution uses the minimum value if the query
+   * value is negative. Bounds are never below zero, because a document missing
+   * from the posting list gets a zero contribution.
+   */
+  struct PostListCursor {
+    const PostList*  post_;
+    size_t           post_pos_;
+    dist_t           qval_;
+    // the upper bound of the contribution for the whole posting list
+    dist_t           max_score_;
+
+    PostListCursor(const PostList& pl, dist_t qval) : post_(&pl), post_pos_(0), qval_(qval) {
+      max_score_ = ValBound(pl.max_val_, pl.min_val_);
+    }
+    dist_t ValBound(dist_t maxVal, dist_t minVal) const {
+      return std::max(dist_t(0), qval_ >= 0 ? qval_ * maxVal : qval_ * minVal);
+    }
+    IdType DocId() const {
+      return post_pos_ < post_->qty_ ? post_->entries_[post_pos_].doc_id_ : IdType(kNoMoreDocs);
+    }
+    dist_t Score() const { return qval_ * post_->entries_[post_pos_].val_; }
+    void Next() { ++post_pos_; }
+    // The index of the first block (starting from the current one) that may contain docId
+    size_t FindBlock(IdType docId) const {
+      size_t b = post_pos_ / kBlockSize;
+      while (b < post_->blocks_.size() && post_->blocks_[b].last_doc_id_ < docId) ++b;
+      return b;
+    }
+    // The upper bound of the contribution in the block (zero if the cursor is exhausted)
+    dist_t BlockMaxScore(size_t b) const {
+      return b < post_->blocks_.size() ? ValBound(post_->blocks_[b].max_val_, post_->blocks_[b].min_val_) : 0;
+    }
+    IdType BlockLastDocId(size_t b) const {
+      return b < post_->blocks_.size() ? post_->blocks_[b].last_doc_id_ : IdType(kNoMoreDocs);
+    }
+    // Moves to the first entry whose document id is >= docId (skipping whole blocks)
+    void NextGEQ(IdType docId) {
+      if (DocId() >= docId) return;
+      size_t b = FindBlock(docId);
+      if (b >= post_->blocks_.size()) {
+        post_pos_ = post_->qty_;
+        return;
+      }
+      const PostEntry* pStart = post_->entries_ + std::max(post_pos_, b * kBlockSize);
+      const PostEntry* pEnd = post_->entries_ + std::min(post_->qty_, (b + 1) * kBlockSize);
+      post_pos_ = std::lower_bound(pStart, pEnd, docId,
+                                   [](const PostEntry& e, IdType id) { return e.doc_id_ < id; }) - post_->entries_;
+    }
+  };
+
+  /*
+   * Compressed posting lists (index-time parameter compress=1) are stored in one
+   * contiguous buffer, which has the same format as the index file. Hence, a saved
+   * compressed index is memory-mapped rather than read:
+   *
+   * <version> <block size> <# of posting lists>    (uint32, uint32, uint64)
+   * <posting list descriptors: CompPostListDesc>
+   * <posting lists>
+   *
+   * Every posting list (aligned on 16 bytes) starts with descriptors of its blocks
+   * (CompPostBlock), which are followed by block data. In each block, document ids are
+   * delta-coded using StreamVByte (see posting_codec.h). The values are quantized to
+   * 8-bit integers (using the minimum and maximum block values), so that document scores
+   * used for pruning are approximate. Hence, more candidates are selected (see
+   * the query-time parameter rerankMult) and reranked using exact distances.
+   */
+  struct CompPostListDesc {
+    uint64_t  offset_;
+    uint32_t  word_id_;
+    uint32_t  qty_;
+    uint32_t  block_qty_;
+    float     max_val_;
+    float     min_val_;
+    uint32_t  reserved_;
+  };
+  struct CompPostBlock {
+    uint32_t  last_doc_id_;
+    // the offset from the beginning of the posting list
+    uint32_t  data_offset_;
+    float     max_val_;
+    float     min_val_;
+  };
+  static const unsigned kQuantLevels = 255;
+
+  // The compressed-list counterpart of PostListCursor: one block at a time is decoded
+  struct CompPostListCursor {
+    const char*           pList_;
+    const CompPostBlock*  blocks_;
+    size_t                qty_;
+    size_t                block_qty_;
+    // the decoded block, the position in it, and the number of its entries
+    size_t                block_;
+    size_t                block_pos_;
+    size_t                block_len_;
+    dist_t                qval_;
+    dist_t                max_score_;
+    uint32_t              doc_ids_[kBlockSize];
+    dist_t                vals_[kBlockSize];
+
+    CompPostListCursor(const char* pList, const CompPostListDesc& desc, dist_t qval) :
+        pList_(pList), blocks_(reinterpret_cast<const CompPostBlock*>(pList)),
+        qty_(desc.qty_), block_qty_(desc.block_qty_), qval_(qval) {
+      max_score_ = ValBound(desc.max_val_, desc.min_val_);
+      DecodeBlock(0);
+    }
+    dist_t ValBound(dist_t maxVal, dist_t minVal) const {
+      return std::max(dist_t(0), qval_ >= 0 ? qval_ * maxVal : qval_ * minVal);
+    }
+    void DecodeBlock(size_t b) {
+      const CompPostBlock& blk = blocks_[b];
+      block_ = b;
+      block_pos_ = 0;
+      block_len_ = std::min(size_t(kBlockSize), qty_ - b * kBlockSize);
+      const uint8_t* p = reinterpret_cast<const uint8_t*>(pList_ + blk.data_offset_);
+      // The first id of the list is coded as a difference from -1
+      p += StreamVByteDeltaDecode(p, block_len_, b ? blocks_[b - 1].last_doc_id_ : uint32_t(-1), doc_ids_);
+      const dist_t scale = (blk.max_val_ - blk.min_val_) / kQuantLevels;
+      for (size_t i = 0; i < block_len_; ++i) {
+        vals_[i] = std::min(dist_t(blk.max_val_), blk.min_val_ + p[i] * scale);
+      }
+    }
+    IdType DocId() const {
+      return block_pos_ < block_len_ ? IdType(doc_ids_[block_pos_]) : IdType(kNoMoreDocs);
+    }
+    dist_t Score() const { return qval_ * vals_[block_pos_]; }
+    void Next() {
+      if (++block_pos_ == block_len_ && block_ + 1 < block_qty_) DecodeBlock(block_ + 1);
+    }
+    size_t FindBlock(IdType docId) const {
+      size_t b = block_;
+      while (b < block_qty_ && IdType(blocks_[b].last_doc_id_) < docId) ++b;
+      return b;
+    }
+    dist_t BlockMaxScore(size_t b) const {
+      return b < block_qty_ ? ValBound(blocks_[b].max_val_, blocks_[b].min_val_) : 0;
+    }
+    IdType BlockLastDocId(size_t b) const {
+      return b < block_qty_ ? IdType(blocks_[b].last_doc_id_) : IdType(kNoMoreDocs);
+    }
+    void NextGEQ(IdType docId) {
+      if (DocId() >= docId) return;
+      size_t b = FindBlock(docId);
+      if (b >= block_qty_) {
+        block_pos_ = block_len_;
+        return;
+      }
+      if (b != block_) DecodeBlock(b);
+      block_pos_ = std::lower_bound(doc_ids_ + block_pos_, doc_ids_ + block_len_, uint32_t(docId)) - doc_ids_;
+    }
   };
 
+  // Creates cursors for query terms that are present in the index
+  void CreateCursors(KNNQuery<dist_t>* query, std::vector<PostListCursor>& cursors) const;
+  void CreateCursors(KNNQuery<dist_t>* query, std::vector<CompPostListCursor>& cursors) const;
+  void AddTopKToResult(KNNQuery<dist_t>* query, FalconnHeapMod1<dist_t, IdType>& resQueue) const;
+  /*
+   * Scores computed using compressed posting lists are approximate: search algorithms
+   * keep rerankMult_ times more candidates, which are reranked using exact distances.
+   */
+  size_t CandidateQty(const KNNQuery<dist_t>* query) const {
+    return compressed_ ? query->GetK() * rerankMult_ : query->GetK();
+  }
+
   /**
    * A structure that keeps information about current state of search within one posting list.
    */
@@ -111,8 +335,23 @@ class SimplInvIndex : public Index<dist_t> {
   };
 
   bool                                                     printProgress_;
+  AlgoType                                                 algoType_;
   SpaceSparseNegativeScalarProductFast*                    pSpace_;
   std::unordered_map<uint32_t, std::unique_ptr<PostList>>  index_;
+
+  // Converts index_ into compressed posting lists
+  void CreateCompressedIndex();
+  // Checks the buffer with compressed posting lists and creates the dictionary
+  void InitCompressedIndex(const char* pData, size_t dataSize);
+
+  bool                                                     compressed_ = false;
+  size_t                                                   rerankMult_ = 4;
+  // Compressed posting lists are either in compBuffer_ or in the memory-mapped file
+  std::vector<char>                                        compBuffer_;
+  std::unique_ptr<MmapFile>                                compFile_;
+  const char*                                              compData_ = nullptr;
+  size_t                                                   compSize_ = 0;
+  std::unordered_map<uint32_t, const CompPostListDesc*>    compIndex_;
   // disable copy and assign
   DISABLE_COPY_AND_ASSIGN(SimplInvIndex);
 };
@@ -52,6 +52,8 @@ class VPTree : public Index<dist_t> {
 
   void SaveIndex(const string& location) override;
   void LoadIndex(const string& location) override;
+  void SaveIndexToStream(std::ostream& output) override;
+  void LoadIndexFromStream(std::istream& input) override;
 
   void Search(RangeQuery<dist_t>* query, IdType) const override;
   void Search(KNNQuery<dist_t>* query, IdType) const override;
@@ -123,8 +125,8 @@ class VPTree : public Index<dist_t> {
 
   vector<string>  QueryTimeParams_;
 
-  VPNode* LoadNodeData(std::ifstream& input, bool ChunkBucket, const vector<IdType>& IdMapper) const;
-  void    SaveNodeData(std::ofstream& output, const VPNode* node) const;
+  VPNode* LoadNodeData(std::istream& input, bool ChunkBucket, const vector<IdType>& IdMapper) const;
+  void    SaveNodeData(std::ostream& output, const VPNode* node) const;
 
   // disable copy and assign
   DISABLE_COPY_AND_ASSIGN(VPTree);
@@ -0,0 +1,91 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#ifndef _MMAP_DATASET_H_
+#define _MMAP_DATASET_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "idtype.h"
+#include "object.h"
+#include "object_arena.h"
+#include "space.h"
+
+namespace similarity {
+
+using std::string;
+using std::vector;
+using std::shared_ptr;
+
+/*
+ * A read-only memory-mapped file. On platforms without mmap,
+ * the file is read into memory.
+ */
+class MmapFile {
+public:
+  explicit MmapFile(const string& fileName);
+  ~MmapFile();
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+private:
+  const char*             data_;
+  size_t                  size_;
+  std::unique_ptr<char[]> buffer_; // used only when mmap is not available
+
+  DISABLE_COPY_AND_ASSIGN(MmapFile);
+};
+
+/*
+ * Binary datasets, which are memory-mapped instead of being read through a stream.
+ * The format is determined by the file extension:
+ *
+ * .fvecs, .ivecs, .bvecs  every vector is preceded by its (int32) dimensionality,
+ *                         elements are float, int32, and uint8, respectively (TEXMEX format);
+ * .fbin, .u8bin           the number of vectors and the dimensionality (both uint32) followed
+ *                         by a row-major matrix of float (uint8) elements;
+ * .objs                   NMSLIB object records created by WriteObjRecordsFile.
+ *
+ * Vectors of the first two groups lack object headers (id, label, and length): Hence, they are
+ * converted to objects by the space (in parallel), e.g., bvecs can be loaded into both the SIFT
+ * space and any dense float space. Each vector is copied once (into the object data).
+ * Only .objs files are used in place (zero-copy): objects point into the mapped file,
+ * nothing is copied or parsed. To load a dataset in place, save it with WriteObjRecordsFile.
+ */
+bool IsMmapDatasetFile(const string& fileName);
+
+/*
+ * Appends up to maxQty objects (zero means all) from the file to the dataset using
+ * up to threadQty threads (zero means the number of cores). Ids are positions in the file
+ * (.objs records keep their stored ids), external ids are empty. Objects are created
+ * in the arena, which also keeps the mapped file alive (if objects point into the file).
+ */
+template <typename dist_t>
+void ReadMmapDataset(const Space<dist_t>& space,
+                     const string& fileName,
+                     ObjectArena& arena,
+                     ObjectVector& dataset,
+                     vector<string>& vExternIds,
+                     const IdTypeUnsign maxQty = MAX_DATASET_QTY,
+                     size_t threadQty = 0);
+
+// Saves objects in the .objs format: they can be used in place after the file is mapped
+void WriteObjRecordsFile(const ObjectVector& dataset, const string& fileName);
+
+}  // namespace similarity
+
+#endif  // _MMAP_DATASET_H_
@@ -95,6 +95,8 @@ class Object {
   }
 
   inline IdType    id()         const { return *(reinterpret_cast<IdType*>(buffer_)); }
+  // Used by readers that create objects before their final positions (ids) are known
+  inline void SetId(IdType id) { memcpy(buffer_, &id, ID_SIZE); }
   inline LabelType label()      const { return *(reinterpret_cast<LabelType*>(buffer_ + ID_SIZE)); }
   inline size_t datalength()    const { return *(reinterpret_cast<size_t*>(buffer_ + LABEL_SIZE + ID_SIZE));}
   inline const char* data() const { return buffer_ + ID_SIZE + LABEL_SIZE+ DATALENGTH_SIZE; }
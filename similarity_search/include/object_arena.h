@@ -0,0 +1,268 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#ifndef _OBJECT_ARENA_H_
+#define _OBJECT_ARENA_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "global.h"
+#include "idtype.h"
+#include "object.h"
+#include "logging.h"
+#include "thread_pool.h"
+
+namespace similarity {
+
+/*
+ * The storage for bulk-loaded objects of arbitrary (and different) sizes.
+ *
+ * 1) Objects created by NewObject (or Copy) are constructed in place one after another
+ *    in large slabs. Each Object is immediately followed by its header and data, and the data is
+ *    PAYLOAD_ALIGN-byte aligned, which suits SIMD loads. Objects created
+ *    by the same Region in the id order are also stored in the id order.
+ *    Different threads can fill the same arena concurrently, each thread uses its own Region.
+ * 2) Objects can also be views of records stored in an external memory block,
+ *    e.g., in a memory-mapped file or a Python buffer (see AttachRecords).
+ *    The arena keeps the owner of the block alive.
+ *
+ * All the memory is released at once when the arena is destroyed: destructors of
+ * objects are not called, but objects in the arena don't own any memory either.
+ * Objects obtained from the arena must NOT be deleted by the caller.
+ */
+class ObjectArena {
+public:
+  static const size_t PAYLOAD_ALIGN = 32;
+  static const size_t MIN_SLAB_SIZE = 4 * 1024 * 1024;
+
+  /*
+   * External records are an object header followed by data and by zero padding up to
+   * RecordSize(dataLength) bytes: all headers are RECORD_ALIGN-byte aligned.
+   */
+  static const size_t HEADER_SIZE = ID_SIZE + LABEL_SIZE + DATALENGTH_SIZE;
+  static const size_t RECORD_ALIGN = 8;
+
+  static size_t RecordSize(size_t dataLength) {
+    return (HEADER_SIZE + dataLength + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN;
+  }
+
+  /*
+   * A part of a slab, where one thread creates objects without locking, so that several
+   * threads can fill the same arena at once. The space that isn't used up is given back
+   * to the arena when the region is destroyed.
+   */
+  class Region {
+  public:
+    explicit Region(ObjectArena& arena) : arena_(arena), cur_(nullptr), end_(nullptr) {
+      arena_.takeRegion(cur_, end_);
+    }
+    ~Region() {
+      arena_.returnRegion(cur_, end_);
+    }
+
+    // Creates an object, whose data is copied from the data argument unless it is nullptr
+    const Object* NewObject(IdType id, LabelType label, size_t dataLength, const void* data) {
+      // The Object is followed by its buffer, which doesn't need to be freed
+      char* p = allocate(sizeof(Object) + HEADER_SIZE + dataLength, sizeof(Object) + HEADER_SIZE);
+      char* buffer = p + sizeof(Object);
+      memcpy(buffer, &id, ID_SIZE);
+      memcpy(buffer + ID_SIZE, &label, LABEL_SIZE);
+      memcpy(buffer + ID_SIZE + LABEL_SIZE, &dataLength, DATALENGTH_SIZE);
+      if (data != nullptr) {
+        memcpy(buffer + HEADER_SIZE, data, dataLength);
+      } else {
+        memset(buffer + HEADER_SIZE, 0, dataLength);
+      }
+      return new (p) Object(buffer);
+    }
+
+    const Object* Copy(const Object* pObj) {
+      return NewObject(pObj->id(), pObj->label(), pObj->datalength(), pObj->data());
+    }
+
+    // Creates a view of an object record stored elsewhere
+    const Object* NewView(const char* record) {
+      return new (allocate(sizeof(Object), 0)) Object(const_cast<char*>(record));
+    }
+
+  private:
+    // Returns a block of the given size such that the address block + alignOffset is PAYLOAD_ALIGN-byte aligned
+    char* allocate(size_t size, size_t alignOffset) {
+      char* p = alignedStart(cur_, alignOffset);
+      if (cur_ != nullptr && p + size <= end_) {
+        cur_ = p + size;
+        return p;
+      }
+      char* slabCur;
+      char* slabEnd;
+      arena_.newSlab(size + alignOffset, slabCur, slabEnd);
+      p = alignedStart(slabCur, alignOffset);
+      // A large object may get a slab of its own, then, the current region is still used
+      if (slabEnd - (p + size) >= end_ - cur_) {
+        cur_ = p + size;
+        end_ = slabEnd;
+      }
+      return p;
+    }
+    static char* alignedStart(char* p, size_t alignOffset) {
+      uintptr_t addr = reinterpret_cast<uintptr_t>(p) + alignOffset;
+      return reinterpret_cast<char*>((addr + PAYLOAD_ALIGN - 1) / PAYLOAD_ALIGN * PAYLOAD_ALIGN - alignOffset);
+    }
+
+    ObjectArena&      arena_;
+    char*             cur_;
+    char*             end_;
+
+    DISABLE_COPY_AND_ASSIGN(Region);
+  };
+
+  explicit ObjectArena(size_t slabSize = MIN_SLAB_SIZE) : slabSize_(slabSize) {}
+
+  /*
+   * Creates an object, whose data is copied from the data argument unless it is nullptr.
+   * Bulk loads should rather use a Region, which doesn't lock the arena for each object.
+   */
+  const Object* NewObject(IdType id, LabelType label, size_t dataLength, const void* data) {
+    Region region(*this);
+    return region.NewObject(id, label, dataLength, data);
+  }
+
+  const Object* Copy(const Object* pObj) {
+    return NewObject(pObj->id(), pObj->label(), pObj->datalength(), pObj->data());
+  }
+
+  /*
+   * Appends to the dataset views of up to maxQty records stored one after another
+   * in the memory block [p, p + size). The block must stay unchanged while
+   * the arena exists: the arena keeps a reference to its owner.
+   * Returns the number of appended objects.
+   */
+  size_t AttachRecords(std::shared_ptr<const void> owner, const char* p, size_t size, size_t maxQty,
+                       ObjectVector& dataset) {
+    CHECK_MSG(reinterpret_cast<uintptr_t>(p) % RECORD_ALIGN == 0, "Bug: object records aren't aligned");
+    const char* end = p + size;
+    size_t start = dataset.size();
+    try {
+      Region region(*this);
+      while (p < end && dataset.size() - start < maxQty) {
+        size_t dataLength;
+        CHECK_MSG(size_t(end - p) >= HEADER_SIZE, "Object records are truncated");
+        memcpy(&dataLength, p + ID_SIZE + LABEL_SIZE, DATALENGTH_SIZE);
+        CHECK_MSG(size_t(end - p) - HEADER_SIZE >= dataLength, "Object records are truncated");
+        dataset.push_back(region.NewView(p));
+        p += std::min<size_t>(RecordSize(dataLength), end - p);
+      }
+    } catch (...) {
+      dataset.resize(start);
+      throw;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    owners_.push_back(std::move(owner));
+    return dataset.size() - start;
+  }
+
+  // Checks if the object was created by this arena
+  bool Owns(const void* pObj) const {
+    const char* p = static_cast<const char*>(pObj);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = slabRanges_.upper_bound(p);
+    if (it == slabRanges_.begin()) return false;
+    --it;
+    return p < it->second;
+  }
+
+  // The total size of all slabs
+  size_t MemoryUsed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t res = 0;
+    for (const auto& range : slabRanges_) res += range.second - range.first;
+    return res;
+  }
+
+private:
+  void newSlab(size_t minSize, char*& cur, char*& end) {
+    size_t slabSize = std::max(slabSize_, minSize + PAYLOAD_ALIGN);
+    std::unique_ptr<char[]> slab(new char[slabSize]);
+    cur = slab.get();
+    end = cur + slabSize;
+    std::lock_guard<std::mutex> lock(mutex_);
+    slabRanges_[cur] = end;
+    slabs_.push_back(std::move(slab));
+  }
+
+  // Unused parts of slabs are kept for the next scopes, so that slabs are filled up
+  void takeRegion(char*& cur, char*& end) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (freeRegions_.empty()) return;
+    cur = freeRegions_.back().first;
+    end = freeRegions_.back().second;
+    freeRegions_.pop_back();
+  }
+  void returnRegion(char* cur, char* end) {
+    if (cur == end) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    freeRegions_.emplace_back(cur, end);
+  }
+
+  size_t                                    slabSize_;
+  mutable std::mutex                        mutex_;
+  std::vector<std::unique_ptr<char[]>>      slabs_;
+  std::map<const char*, const char*>        slabRanges_;
+  std::vector<std::pair<char*, char*>>      freeRegions_;
+  std::vector<std::shared_ptr<const void>>  owners_;
+
+  // disable copy and assign
+  DISABLE_COPY_AND_ASSIGN(ObjectArena);
+};
+
+/*
+ * Sets dataset[start + i] = createObj(i) for i in [0, qty), where start is the original
+ * size of the dataset, using up to threadQty threads (zero means the number of cores).
+ * createObj returns objects allocated on the heap. If the arena isn't nullptr, they are copied
+ * into the arena and deleted: threads copy blocks of consecutive objects, which are stored
+ * one after another. If any call fails, the dataset is restored and the exception is rethrown.
+ */
+template <class CreateFunc>
+void CreateObjectsParallel(ObjectArena* pArena, size_t qty, size_t threadQty,
+                           ObjectVector& dataset, CreateFunc createObj) {
+  const size_t blockSize = 1024;
+  size_t start = dataset.size();
+  dataset.resize(start + qty, nullptr);
+  try {
+    ParallelFor(0, (qty + blockSize - 1) / blockSize, threadQty, [&](size_t block, size_t threadId) {
+      std::unique_ptr<ObjectArena::Region> region(pArena != nullptr ? new ObjectArena::Region(*pArena) : nullptr);
+      for (size_t i = block * blockSize; i < std::min(qty, (block + 1) * blockSize); ++i) {
+        std::unique_ptr<const Object> obj(createObj(i));
+        dataset[start + i] = region ? region->Copy(obj.get()) : obj.release();
+      }
+    });
+  } catch (...) {
+    if (pArena == nullptr) {
+      for (size_t i = start; i < dataset.size(); ++i) delete dataset[i];
+    }
+    dataset.resize(start);
+    throw;
+  }
+}
+
+}   // namespace similarity
+
+#endif     // _OBJECT_ARENA_H_
@@ -28,7 +28,7 @@ const std::string DIST_TYPE_PARAM_OPT            = "distType";
 const std::string DIST_TYPE_PARAM_MSG            = "distance value type: int, float, double";
 
 const std::string DATA_FILE_PARAM_OPT            = "dataFile,i";
-const std::string DATA_FILE_PARAM_MSG            = "input data file";
+const std::string DATA_FILE_PARAM_MSG            = "input data file (.fvecs/.ivecs/.bvecs/.fbin/.u8bin/.objs files are memory-mapped, only .objs files are used without copying)";
 
 const std::string MAX_NUM_DATA_PARAM_OPT         = "maxNumData,D";
 const std::string MAX_NUM_DATA_PARAM_MSG         = "if non-zero, only the first maxNumData elements are used";
@@ -118,6 +118,52 @@ const std::string ADDR_PARAM_MSG                 = "TCP/IP server address";
 const std::string THREAD_PARAM_OPT               = "threadQty";
 const std::string THREAD_PARAM_MSG               = "A number of server threads";
 
+const std::string SHARD_QTY_PARAM_OPT            = "shardQty";
+const std::string SHARD_QTY_PARAM_MSG            = "If > 1, the data is split into this number of shards, which are indexed using the specified method and searched in parallel";
+const unsigned SHARD_QTY_PARAM_DEFAULT           = 1;
+
+const std::string CACHE_SIZE_PARAM_OPT           = "cacheSize";
+const std::string CACHE_SIZE_PARAM_MSG           = "The maximum number of cached query results (0 disables the cache)";
+const size_t CACHE_SIZE_PARAM_DEFAULT            = 0;
+
+const std::string CACHE_TTL_PARAM_OPT            = "cacheTTL";
+const std::string CACHE_TTL_PARAM_MSG            = "Time-to-live (in seconds) of cached query results (0 means no expiration)";
+const unsigned CACHE_TTL_PARAM_DEFAULT           = 0;
+
+const std::string TIMEOUT_PARAM_OPT              = "timeout";
+const std::string TIMEOUT_PARAM_MSG              = "A per-request search timeout in milliseconds (0 means no timeout). Methods supporting deadlines (hnsw, sw-graph, vptree, seq_search) return the best results found so far";
+const unsigned TIMEOUT_PARAM_DEFAULT             = 0;
+
+const std::string STATS_FILE_PARAM_OPT           = "statsFile";
+const std::string STATS_FILE_PARAM_MSG           = "A file where the server periodically writes its statistics (in the Prometheus text format)";
+const std::string STATS_FILE_PARAM_DEFAULT       = "";
+
+const std::string STATS_INTERVAL_PARAM_OPT       = "statsInterval";
+const std::string STATS_INTERVAL_PARAM_MSG       = "An interval (in seconds) between updates of the statistics file";
+const unsigned STATS_INTERVAL_PARAM_DEFAULT      = 10;
+
+// Load generator parameters
+
+const std::string CONN_QTY_PARAM_OPT             = "connQty";
+const std::string CONN_QTY_PARAM_MSG             = "A number of concurrent connections to the server";
+const unsigned CONN_QTY_PARAM_DEFAULT            = 1;
+
+const std::string TARGET_QPS_PARAM_OPT           = "qps";
+const std::string TARGET_QPS_PARAM_MSG           = "A target number of queries per second (open loop). If zero, each connection sends the next query as soon as it receives a reply (closed loop)";
+const double TARGET_QPS_PARAM_DEFAULT            = 0;
+
+const std::string REQUEST_QTY_PARAM_OPT          = "requestQty";
+const std::string REQUEST_QTY_PARAM_MSG          = "A total number of requests (queries are reused in a round-robin fashion). If zero, each query is sent once";
+const size_t REQUEST_QTY_PARAM_DEFAULT           = 0;
+
+const std::string WARM_UP_QTY_PARAM_OPT          = "warmUpQty";
+const std::string WARM_UP_QTY_PARAM_MSG          = "A number of (closed-loop) requests sent before measurements start";
+const size_t WARM_UP_QTY_PARAM_DEFAULT           = 0;
+
+const std::string GOLD_FILE_PARAM_OPT            = "goldFile,g";
+const std::string GOLD_FILE_PARAM_MSG            = "A gold standard file: one line of space-separated ids of true nearest neighbors per query. If it doesn't exist, but the data file is specified, it is computed by the brute-force search and saved";
+const std::string GOLD_FILE_PARAM_DEFAULT        = "";
+
 const std::string RET_EXT_ID_PARAM_OPT           = "retExternId,e";
 const std::string RET_EXT_ID_PARAM_MSG           = "Return external IDs?";
 
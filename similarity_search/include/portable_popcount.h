@@ -19,5 +19,6 @@
 #include <intrin.h>
 
 #define  __builtin_popcount(t) __popcnt(t)
+#define  __builtin_popcountll(t) __popcnt64(t)
 
 #endif
@@ -0,0 +1,61 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#ifndef _POSTING_CODEC_H_
+#define _POSTING_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace similarity {
+
+/*
+ * Delta coding of sorted integers combined with the StreamVByte format:
+ *
+ * Lemire, D., Kurz, N., & Rupp, C. (2018). Stream VByte: Faster byte-oriented integer compression.
+ * Information Processing Letters, 130, 1-6.
+ *
+ * Each integer occupies 1-4 bytes. Byte lengths are kept separately in control bytes
+ * (two bits per integer), which come before the data bytes. Hence, four integers
+ * at a time can be decoded using one shuffle instruction (SSE4 is required, otherwise,
+ * a scalar decoder is used).
+ */
+
+// The maximum number of bytes necessary to encode qty integers
+inline size_t StreamVByteMaxEncodedSize(size_t qty) {
+  return (qty + 3) / 4 + 4 * qty;
+}
+
+/*
+ * The SIMD decoder may read (but not use) up to this number of bytes past
+ * the encoded data: buffers with encoded data must be padded accordingly.
+ */
+const size_t STREAM_VBYTE_PADDING = 16;
+
+/*
+ * Encodes qty increasing integers as differences, the first integer is
+ * encoded as the difference from prev. Returns the number of written bytes.
+ */
+size_t StreamVByteDeltaEncode(const uint32_t* pIn, size_t qty, uint32_t prev, uint8_t* pOut);
+
+// The number of bytes used by qty encoded integers: only control bytes are read
+size_t StreamVByteEncodedSize(const uint8_t* pIn, size_t qty);
+
+// Decodes qty integers, returns the number of consumed bytes
+size_t StreamVByteDeltaDecode(const uint8_t* pIn, size_t qty, uint32_t prev, uint32_t* pOut);
+size_t StreamVByteDeltaDecodeScalar(const uint8_t* pIn, size_t qty, uint32_t prev, uint32_t* pOut);
+
+}  // namespace similarity
+
+#endif  // _POSTING_CODEC_H_
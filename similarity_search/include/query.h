@@ -15,6 +15,8 @@
 #ifndef _QUERY_H_
 #define _QUERY_H_
 
+#include <chrono>
+
 #include "object.h"
 
 namespace similarity {
@@ -25,6 +27,8 @@ class Space;
 template <typename dist_t>
 class Query {
  public:
+  typedef std::chrono::steady_clock DeadlineClock;
+
   Query(const Space<dist_t>& space, const Object* query_object);
   virtual ~Query();
 
@@ -32,23 +36,81 @@ class Query {
   uint64_t DistanceComputations() const;
   void AddDistanceComputations(uint64_t DistComp) { distance_computations_ += DistComp; }
 
+  /*
+   * An optional search deadline. Methods that support deadlines call
+   * IsDeadlineExpired() in their main loops. When the deadline expires,
+   * they stop and keep the best results found so far, and the query
+   * is marked as truncated. Other methods ignore the deadline.
+   */
+  void SetDeadline(const DeadlineClock::time_point& deadline) {
+    deadline_ = deadline;
+    has_deadline_ = true;
+  }
+  void SetTimeout(uint64_t timeoutMicroSec) {
+    SetDeadline(DeadlineClock::now() + std::chrono::microseconds(timeoutMicroSec));
+  }
+  bool HasDeadline() const { return has_deadline_; }
+  const DeadlineClock::time_point& GetDeadline() const { return deadline_; }
+  // Sub-queries (e.g., queries sent to individual shards or threads) share the deadline of the parent query
+  void InheritDeadline(const Query& parent) {
+    if (parent.HasDeadline()) SetDeadline(parent.GetDeadline());
+  }
+
+  /*
+   * This check is cheap: the clock is read only once
+   * in DEADLINE_CHECK_PERIOD calls.
+   */
+  bool IsDeadlineExpired() const {
+    if (!has_deadline_) return false;
+    if (truncated_) return true;
+    if ((++deadline_check_qty_ & (DEADLINE_CHECK_PERIOD - 1)) != 0) return false;
+    truncated_ = DeadlineClock::now() >= deadline_;
+    return truncated_;
+  }
+  bool IsTruncated() const { return truncated_; }
+  void SetTruncated() { truncated_ = true; }
+
   void ResetStats();
   virtual dist_t Distance(const Object* object1, const Object* object2) const;
   // Distance can be asymmetric!
   virtual dist_t DistanceObjLeft(const Object* object) const;
   virtual dist_t DistanceObjRight(const Object* object) const;
+  /*
+   * The same as DistanceObjLeft, but a distance larger than maxDist
+   * may be computed only approximately: see Space::HiddenDistanceBounded
+   */
+  dist_t DistanceObjLeftBounded(const Object* object, dist_t maxDist) const;
+  // Computes distances from n objects to the query at once: out[i] = DistanceObjLeft(objs[i])
+  void DistanceObjLeftBatch(const Object* const* objs, size_t n, dist_t* out) const;
+  /*
+   * Computes distances to n objects in batches of DIST_BATCH_QTY objects
+   * and adds objects to the result. Returns the number of added objects.
+   */
+  size_t CheckAndAddToResultBatch(const Object* const* objs, size_t n);
+
+  static const size_t DIST_BATCH_QTY = 64;
 
   virtual void Reset() = 0;
   virtual dist_t Radius() const = 0;
+  // Objects farther than this distance from the query can't get into the result
+  virtual dist_t DistanceBound() const { return Radius(); }
   virtual unsigned ResultSize() const = 0;
   virtual bool CheckAndAddToResult(const dist_t distance, const Object* object) = 0;
   virtual void Print() const = 0;
 
  protected:
+  // Must be a power of two
+  static const unsigned DEADLINE_CHECK_PERIOD = 16;
+
   const Space<dist_t>& space_;
   const Object* query_object_;
   mutable uint64_t distance_computations_;
 
+  bool                          has_deadline_;
+  DeadlineClock::time_point     deadline_;
+  mutable bool                  truncated_;
+  mutable unsigned              deadline_check_qty_;
+
   // disable copy and assign
   DISABLE_COPY_AND_ASSIGN(Query);
 };
@@ -0,0 +1,325 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "portable_intrinsics.h"
+
+namespace similarity {
+
+/*
+ * Polynomial approximations of log, exp, and pow for single-precision numbers
+ * with SIMD versions that process four (SSE2) or eight (AVX2) numbers at once.
+ * Scalar versions are meant for loop tails: if SSE2 is available, they use one SIMD lane,
+ * so that results don't depend on how the data is split between SIMD and scalar code.
+ * This also keeps the two-constant range reduction of exp intact with -ffast-math,
+ * which would otherwise merge the constants in scalar code.
+ *
+ * log: x = 2^e * m, where sqrt(1/2) <= m <= sqrt(2),
+ *      log(m) = 2 atanh(s) = 2 (s + s^3/3 + s^5/5 + ...), where s = (m - 1)/(m + 1), |s| <= 0.1716
+ * exp: x = n * log(2) + r, where |r| <= log(2)/2,
+ *      exp(r) is computed using the Taylor series, 2^n is obtained by setting the exponent bits.
+ * pow(x, p) = exp(p * log(x))
+ *
+ * Accuracy (relative error):
+ *   kSIMDMathAccurate: ~1e-7 for both log and exp, i.e., nearly the float precision;
+ *   kSIMDMathFast:     ~4e-6 for log and ~3e-6 for exp, but fewer operations.
+ * The relative error of pow is roughly the absolute error of p * log(x), which can
+ * be much larger than 1e-7 for large |p * log(x)| even in the accurate mode.
+ *
+ * Arguments of log and pow must be positive. For x < FLT_MIN, log returns log(FLT_MIN).
+ * exp returns zero for arguments below -87.3, and its arguments are clamped to 88.3 from above.
+ */
+enum SIMDMathAccuracy { kSIMDMathFast = 0, kSIMDMathAccurate = 1 };
+
+#define SIMD_MATH_SQRT2         1.41421356237f
+#define SIMD_MATH_LOG2E         1.44269504089f
+// log(2) = SIMD_MATH_LN2_HI + SIMD_MATH_LN2_LO, the first number has only few significant bits
+#define SIMD_MATH_LN2_HI        0.693359375f
+#define SIMD_MATH_LN2_LO        -2.12194440e-4f
+#define SIMD_MATH_EXP_MIN_ARG   -87.3f
+#define SIMD_MATH_EXP_MAX_ARG   88.3f
+
+template <SIMDMathAccuracy acc>
+inline float LogAtanhSeries(float s) {
+  float z = s * s;
+  if (acc == kSIMDMathAccurate) {
+    return s * (2.0f + z * (2.0f/3 + z * (2.0f/5 + z * (2.0f/7 + z * (2.0f/9)))));
+  }
+  return s * (2.0f + z * (2.0f/3 + z * (2.0f/5)));
+}
+
+template <SIMDMathAccuracy acc>
+inline float ExpTaylorSeries(float r) {
+  if (acc == kSIMDMathAccurate) {
+    return 1.0f + r * (1.0f + r * (1.0f/2 + r * (1.0f/6 + r * (1.0f/24 + r * (1.0f/120 +
+                  r * (1.0f/720 + r * (1.0f/5040)))))));
+  }
+  return 1.0f + r * (1.0f + r * (1.0f/2 + r * (1.0f/6 + r * (1.0f/24 + r * (1.0f/120)))));
+}
+
+/*
+ * SIMDMathOps<Tag> wraps the operations on vectors of the type V (__m128 for SIMDMathSSE2
+ * and __m256 for SIMDMathAVX2), so that the same code works for different vector widths.
+ * Vector types aren't used as template arguments, because their alignment attributes
+ * would be ignored (GCC's -Wignored-attributes). SIMDMathOpsOf(V()) maps the vector type to its tag.
+ */
+struct SIMDMathSSE2 {};
+struct SIMDMathAVX2 {};
+
+template <class Tag> struct SIMDMathOps;
+
+#ifdef PORTABLE_SSE2
+inline SIMDMathSSE2 SIMDMathOpsOf(__m128) { return SIMDMathSSE2(); }
+
+template <> struct SIMDMathOps<SIMDMathSSE2> {
+  typedef __m128  V;
+  typedef __m128i VI;
+  static const size_t kQty = 4;
+
+  static __m128 Set1(float v)                 { return _mm_set1_ps(v); }
+  static __m128 Zero()                        { return _mm_setzero_ps(); }
+  static __m128 Load(const float* p)          { return _mm_loadu_ps(p); }
+  static void   Store(float* p, __m128 v)     { _mm_storeu_ps(p, v); }
+  static __m128 Add(__m128 a, __m128 b)       { return _mm_add_ps(a, b); }
+  static __m128 Sub(__m128 a, __m128 b)       { return _mm_sub_ps(a, b); }
+  static __m128 Mul(__m128 a, __m128 b)       { return _mm_mul_ps(a, b); }
+  static __m128 Div(__m128 a, __m128 b)       { return _mm_div_ps(a, b); }
+  static __m128 Sqrt(__m128 a)                { return _mm_sqrt_ps(a); }
+  static __m128 Max(__m128 a, __m128 b)       { return _mm_max_ps(a, b); }
+  static __m128 Min(__m128 a, __m128 b)       { return _mm_min_ps(a, b); }
+  static __m128 And(__m128 a, __m128 b)       { return _mm_and_ps(a, b); }
+  static __m128 AndNot(__m128 a, __m128 b)    { return _mm_andnot_ps(a, b); }
+  static __m128 CmpGt(__m128 a, __m128 b)     { return _mm_cmpgt_ps(a, b); }
+  static __m128 CmpLt(__m128 a, __m128 b)     { return _mm_cmplt_ps(a, b); }
+  // Rounding to the nearest integer (the default rounding mode)
+  static VI     Round(__m128 a)               { return _mm_cvtps_epi32(a); }
+  static __m128 ToFloat(VI a)                 { return _mm_cvtepi32_ps(a); }
+  static VI     AsInt(__m128 a)               { return _mm_castps_si128(a); }
+  static __m128 AsFloat(VI a)                 { return _mm_castsi128_ps(a); }
+  static VI     AddInt(VI a, int b)           { return _mm_add_epi32(a, _mm_set1_epi32(b)); }
+  static VI     AndInt(VI a, int b)           { return _mm_and_si128(a, _mm_set1_epi32(b)); }
+  static VI     OrInt(VI a, int b)            { return _mm_or_si128(a, _mm_set1_epi32(b)); }
+  static VI     ShiftRight23(VI a)            { return _mm_srli_epi32(a, 23); }
+  static VI     ShiftLeft23(VI a)             { return _mm_slli_epi32(a, 23); }
+  static float  Sum(__m128 v) {
+    float PORTABLE_ALIGN16 TmpRes[4];
+    _mm_store_ps(TmpRes, v);
+    return TmpRes[0] + TmpRes[1] + TmpRes[2] + TmpRes[3];
+  }
+};
+#endif
+
+#ifdef PORTABLE_AVX2
+inline SIMDMathAVX2 SIMDMathOpsOf(__m256) { return SIMDMathAVX2(); }
+
+template <> struct SIMDMathOps<SIMDMathAVX2> {
+  typedef __m256  V;
+  typedef __m256i VI;
+  static const size_t kQty = 8;
+
+  static __m256 Set1(float v)                 { return _mm256_set1_ps(v); }
+  static __m256 Zero()                        { return _mm256_setzero_ps(); }
+  static __m256 Load(const float* p)          { return _mm256_loadu_ps(p); }
+  static void   Store(float* p, __m256 v)     { _mm256_storeu_ps(p, v); }
+  static __m256 Add(__m256 a, __m256 b)       { return _mm256_add_ps(a, b); }
+  static __m256 Sub(__m256 a, __m256 b)       { return _mm256_sub_ps(a, b); }
+  static __m256 Mul(__m256 a, __m256 b)       { return _mm256_mul_ps(a, b); }
+  static __m256 Div(__m256 a, __m256 b)       { return _mm256_div_ps(a, b); }
+  static __m256 Sqrt(__m256 a)                { return _mm256_sqrt_ps(a); }
+  static __m256 Max(__m256 a, __m256 b)       { return _mm256_max_ps(a, b); }
+  static __m256 Min(__m256 a, __m256 b)       { return _mm256_min_ps(a, b); }
+  static __m256 And(__m256 a, __m256 b)       { return _mm256_and_ps(a, b); }
+  static __m256 AndNot(__m256 a, __m256 b)    { return _mm256_andnot_ps(a, b); }
+  static __m256 CmpGt(__m256 a, __m256 b)     { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+  static __m256 CmpLt(__m256 a, __m256 b)     { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static VI     Round(__m256 a)               { return _mm256_cvtps_epi32(a); }
+  static __m256 ToFloat(VI a)                 { return _mm256_cvtepi32_ps(a); }
+  static VI     AsInt(__m256 a)               { return _mm256_castps_si256(a); }
+  static __m256 AsFloat(VI a)                 { return _mm256_castsi256_ps(a); }
+  static VI     AddInt(VI a, int b)           { return _mm256_add_epi32(a, _mm256_set1_epi32(b)); }
+  static VI     AndInt(VI a, int b)           { return _mm256_and_si256(a, _mm256_set1_epi32(b)); }
+  static VI     OrInt(VI a, int b)            { return _mm256_or_si256(a, _mm256_set1_epi32(b)); }
+  static VI     ShiftRight23(VI a)            { return _mm256_srli_epi32(a, 23); }
+  static VI     ShiftLeft23(VI a)             { return _mm256_slli_epi32(a, 23); }
+  static float  Sum(__m256 v) {
+    return SIMDMathOps<SIMDMathSSE2>::Sum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+  }
+};
+#endif
+
+#ifdef PORTABLE_SSE2
+
+// The widest vectors supported by SIMDMathOps
+#ifdef PORTABLE_AVX2
+typedef SIMDMathAVX2 SIMDMathWidest;
+#else
+typedef SIMDMathSSE2 SIMDMathWidest;
+#endif
+typedef SIMDMathOps<SIMDMathWidest>::V SIMDMathVect;
+
+template <SIMDMathAccuracy acc = kSIMDMathAccurate, class V>
+inline V LogSIMD(V x) {
+  typedef SIMDMathOps<decltype(SIMDMathOpsOf(x))> Ops;
+  typedef typename Ops::VI                          VI;
+  const V one = Ops::Set1(1.0f);
+  x = Ops::Max(x, Ops::Set1(std::numeric_limits<float>::min()));
+
+  VI  bits = Ops::AsInt(x);
+  V   fe = Ops::ToFloat(Ops::AddInt(Ops::ShiftRight23(bits), -127));
+  V   m = Ops::AsFloat(Ops::OrInt(Ops::AndInt(bits, 0x007fffff), 0x3f800000));
+  // Mantissas larger than sqrt(2) are halved, exponents are incremented
+  V   large = Ops::CmpGt(m, Ops::Set1(SIMD_MATH_SQRT2));
+  m  = Ops::Sub(m, Ops::And(large, Ops::Mul(m, Ops::Set1(0.5f))));
+  fe = Ops::Add(fe, Ops::And(large, one));
+
+  V   s = Ops::Div(Ops::Sub(m, one), Ops::Add(m, one));
+  V   z = Ops::Mul(s, s);
+  V   poly;
+  if (acc == kSIMDMathAccurate) {
+    poly = Ops::Add(Ops::Set1(2.0f/7), Ops::Mul(z, Ops::Set1(2.0f/9)));
+    poly = Ops::Add(Ops::Set1(2.0f/5), Ops::Mul(z, poly));
+  } else {
+    poly = Ops::Set1(2.0f/5);
+  }
+  poly = Ops::Add(Ops::Set1(2.0f/3), Ops::Mul(z, poly));
+  poly = Ops::Mul(s, Ops::Add(Ops::Set1(2.0f), Ops::Mul(z, poly)));
+
+  return Ops::Add(Ops::Mul(fe, Ops::Set1(SIMD_MATH_LN2_HI)),
+                  Ops::Add(poly, Ops::Mul(fe, Ops::Set1(SIMD_MATH_LN2_LO))));
+}
+
+template <SIMDMathAccuracy acc = kSIMDMathAccurate, class V>
+inline V ExpSIMD(V x) {
+  typedef SIMDMathOps<decltype(SIMDMathOpsOf(x))> Ops;
+  typedef typename Ops::VI                          VI;
+  V   tooSmall = Ops::CmpLt(x, Ops::Set1(SIMD_MATH_EXP_MIN_ARG));
+  x = Ops::Min(x, Ops::Set1(SIMD_MATH_EXP_MAX_ARG));
+
+  VI  n  = Ops::Round(Ops::Mul(x, Ops::Set1(SIMD_MATH_LOG2E)));
+  V   fn = Ops::ToFloat(n);
+  V   r  = Ops::Sub(Ops::Sub(x, Ops::Mul(fn, Ops::Set1(SIMD_MATH_LN2_HI))),
+                    Ops::Mul(fn, Ops::Set1(SIMD_MATH_LN2_LO)));
+  V   poly;
+  if (acc == kSIMDMathAccurate) {
+    poly = Ops::Add(Ops::Set1(1.0f/720), Ops::Mul(r, Ops::Set1(1.0f/5040)));
+    poly = Ops::Add(Ops::Set1(1.0f/120), Ops::Mul(r, poly));
+  } else {
+    poly = Ops::Set1(1.0f/120);
+  }
+  poly = Ops::Add(Ops::Set1(1.0f/24), Ops::Mul(r, poly));
+  poly = Ops::Add(Ops::Set1(1.0f/6),  Ops::Mul(r, poly));
+  poly = Ops::Add(Ops::Set1(1.0f/2),  Ops::Mul(r, poly));
+  poly = Ops::Add(Ops::Set1(1.0f),    Ops::Mul(r, poly));
+  poly = Ops::Add(Ops::Set1(1.0f),    Ops::Mul(r, poly));
+
+  V   scale = Ops::AsFloat(Ops::ShiftLeft23(Ops::AddInt(n, 127)));
+
+  return Ops::AndNot(tooSmall, Ops::Mul(poly, scale));
+}
+
+template <SIMDMathAccuracy acc = kSIMDMathAccurate, class V>
+inline V PowSIMD(V x, V p) {
+  return ExpSIMD<acc>(SIMDMathOps<decltype(SIMDMathOpsOf(x))>::Mul(p, LogSIMD<acc>(x)));
+}
+
+#endif
+
+template <SIMDMathAccuracy acc = kSIMDMathAccurate>
+inline float LogPoly(float x) {
+#ifdef PORTABLE_SSE2
+  return _mm_cvtss_f32(LogSIMD<acc, __m128>(_mm_set_ss(x)));
+#else
+  if (!(x >= std::numeric_limits<float>::min())) x = std::numeric_limits<float>::min();
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  int e = int(bits >> 23) - 127;
+  bits = (bits & 0x007fffffu) | 0x3f800000u;
+  float m;
+  memcpy(&m, &bits, sizeof(m));
+  if (m > SIMD_MATH_SQRT2) {
+    m *= 0.5f;
+    ++e;
+  }
+  float fe = float(e);
+  return fe * SIMD_MATH_LN2_HI + (LogAtanhSeries<acc>((m - 1) / (m + 1)) + fe * SIMD_MATH_LN2_LO);
+#endif
+}
+
+template <SIMDMathAccuracy acc = kSIMDMathAccurate>
+inline float ExpPoly(float x) {
+#ifdef PORTABLE_SSE2
+  return _mm_cvtss_f32(ExpSIMD<acc, __m128>(_mm_set_ss(x)));
+#else
+  if (x < SIMD_MATH_EXP_MIN_ARG) return 0;
+  if (x > SIMD_MATH_EXP_MAX_ARG) x = SIMD_MATH_EXP_MAX_ARG;
+  float fn = std::nearbyint(x * SIMD_MATH_LOG2E);
+  float r = x - fn * SIMD_MATH_LN2_HI - fn * SIMD_MATH_LN2_LO;
+  uint32_t bits = uint32_t(int(fn) + 127) << 23;
+  float scale;
+  memcpy(&scale, &bits, sizeof(scale));
+  return ExpTaylorSeries<acc>(r) * scale;
+#endif
+}
+
+template <SIMDMathAccuracy acc = kSIMDMathAccurate>
+inline float PowPoly(float x, float p) {
+  return ExpPoly<acc>(p * LogPoly<acc>(x));
+}
+
+/*
+ * Element-wise logarithms and exponents of arrays (pIn and pOut may coincide).
+ * The generic versions call std functions, the float versions use approximations above.
+ */
+template <class T>
+inline void LogVector(const T* pIn, T* pOut, size_t qty) {
+  for (size_t i = 0; i < qty; ++i) pOut[i] = std::log(pIn[i]);
+}
+
+template <class T>
+inline void ExpVector(const T* pIn, T* pOut, size_t qty) {
+  for (size_t i = 0; i < qty; ++i) pOut[i] = std::exp(pIn[i]);
+}
+
+inline void LogVector(const float* pIn, float* pOut, size_t qty) {
+  size_t i = 0;
+#ifdef PORTABLE_SSE2
+  typedef SIMDMathOps<SIMDMathWidest> Ops;
+  for (; i + Ops::kQty <= qty; i += Ops::kQty) {
+    Ops::Store(pOut + i, LogSIMD(Ops::Load(pIn + i)));
+  }
+#endif
+  for (; i < qty; ++i) pOut[i] = LogPoly(pIn[i]);
+}
+
+inline void ExpVector(const float* pIn, float* pOut, size_t qty) {
+  size_t i = 0;
+#ifdef PORTABLE_SSE2
+  typedef SIMDMathOps<SIMDMathWidest> Ops;
+  for (; i + Ops::kQty <= qty; i += Ops::kQty) {
+    Ops::Store(pOut + i, ExpSIMD(Ops::Load(pIn + i)));
+  }
+#endif
+  for (; i < qty; ++i) pOut[i] = ExpPoly(pIn[i]);
+}
+
+}  // namespace similarity
+
+#endif
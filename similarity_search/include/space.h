@@ -30,6 +30,7 @@
 #include "utils.h"
 #include "logging.h"
 #include "permutation_type.h"
+#include "portable_prefetch.h"
 
 #define LABEL_PREFIX "label:"
 
@@ -69,6 +70,8 @@ class RangeQuery;
 template <typename dist_t>
 class Experiments;
 
+class ObjectArena;
+
 struct DataFileInputState {
   virtual void Close() {};
   virtual ~DataFileInputState(){};
@@ -198,6 +201,19 @@ class Space {
    * based on the content of the input file.
    */
   virtual void UpdateParamsFromFile(DataFileInputState& inpState) {}
+  /*
+   * Spaces, whose ReadNextObjStr reads exactly one (possibly empty) line from a text
+   * file opened by OpenReadFileHeader, can return true. Then, large files are split
+   * into line-aligned chunks, which ReadDataset parses in parallel: each chunk is read
+   * using a separate input state, which is merged into the main one with MergeInputState.
+   */
+  virtual bool ReadsOneObjectPerLine() const { return false; }
+  /*
+   * Checks that an input state of a chunk is consistent with the main input state
+   * and updates the main state. By default, it merges the dimensionality of vectors
+   * stored in DataFileInputStateVec.
+   */
+  virtual void MergeInputState(DataFileInputState& mainState, const DataFileInputState& chunkState) const;
   /** End of standard functions to read/write/create objects as well as update state parameters */ 
 
   /*
@@ -206,10 +222,24 @@ class Space {
    */
   virtual bool ApproxEqual(const Object& obj1, const Object& obj2) const = 0;
 
+  // Chunks of files smaller than this value are not worth parsing in parallel
+  static const size_t PARALLEL_READ_MIN_CHUNK_SIZE = 16 * 1024 * 1024;
+
+  /*
+   * Reads the dataset (if MaxNumObjects is zero or MAX_DATASET_QTY, the whole file is read).
+   * When the file is large and the space ReadsOneObjectPerLine, chunks of the file
+   * (at least minChunkSize bytes each) are parsed using up to threadQty threads
+   * (zero means the number of cores).
+   * Objects get the same ids (0, 1, ...) as if the file was read sequentially.
+   * If the arena isn't nullptr, objects are created in the arena (and must not be deleted).
+   */
   unique_ptr<DataFileInputState>  ReadDataset(ObjectVector& dataset,
                    vector<string>& vExternIds,
                    const string& inputFile,
-                   const IdTypeUnsign MaxNumObjects = MAX_DATASET_QTY) const;
+                   const IdTypeUnsign MaxNumObjects = MAX_DATASET_QTY,
+                   size_t threadQty = 0,
+                   ObjectArena* arena = nullptr,
+                   size_t minChunkSize = PARALLEL_READ_MIN_CHUNK_SIZE) const;
   void WriteDataset(const ObjectVector& dataset,
                    const vector<string>& vExternIds,
                    const string& outputFile,
@@ -230,6 +260,13 @@ class Space {
                                         const std::string& outputFile,
                                         const IdTypeUnsign MaxNumObjects = MAX_DATASET_QTY) const;
 
+  /*
+   * Spaces that changed the layout of object data return a non-zero version. Then, the default
+   * WriteObjectVectorBinData saves it in the file header, and the default ReadObjectVectorFromBinData
+   * rejects files with a different (or without a) version instead of misreading them.
+   */
+  virtual uint32_t GetBinDataFormatVersion() const { return 0; }
+
   /*
    * For some real-valued or integer-valued *DENSE* vector spaces this function
    * returns the number of vector elements. For all other spaces, it returns
@@ -269,9 +306,53 @@ class Space {
    * IndexTimeDistance access can be disable/enabled only by function friends 
    */
   virtual dist_t HiddenDistance(const Object* obj1, const Object* obj2) const = 0;
+  /*
+   * A one-to-many version of HiddenDistance: out[i] = HiddenDistance(objs[i], query).
+   * Note that objects are left arguments, as in Query::DistanceObjLeft.
+   * The default implementation is a loop, but spaces can override the function
+   * to avoid a virtual call per pair and to process several objects at once.
+   */
+  virtual void DistanceBatch(const Object* query, const Object* const* objs, size_t n, dist_t* out) const {
+    DistanceBatchLoop(query, objs, n, out,
+                      [this](const Object* pObj, const Object* pQuery) { return HiddenDistance(pObj, pQuery); });
+  }
+  /*
+   * Versions of HiddenDistance and DistanceBatch that may stop computing a distance
+   * once it is known to exceed maxDist. The exact distance is returned only if it
+   * doesn't exceed maxDist, otherwise, the result is just some value larger than maxDist.
+   * By default, the bound is ignored and all distances are exact.
+   */
+  virtual dist_t HiddenDistanceBounded(const Object* obj1, const Object* obj2, dist_t maxDist) const {
+    return HiddenDistance(obj1, obj2);
+  }
+  virtual void DistanceBatchBounded(const Object* query, const Object* const* objs, size_t n,
+                                    dist_t maxDist, dist_t* out) const {
+    DistanceBatch(query, objs, n, out);
+  }
+ protected:
+  /*
+   * A helper for DistanceBatch overrides: it calls a (non-virtual) distance function
+   * and prefetches the data of the next object.
+   */
+  template <typename DistFunc>
+  static void DistanceBatchLoop(const Object* query, const Object* const* objs, size_t n, dist_t* out,
+                                const DistFunc& distFunc) {
+    for (size_t i = 0; i < n; ++i) {
+      if (i + 1 < n) PREFETCH(objs[i + 1]->data(), _MM_HINT_T0);
+      out[i] = distFunc(objs[i], query);
+    }
+  }
  private:
   bool mutable bIndexPhase = true;
   
+  void ReadDatasetChunks(ObjectVector& dataset,
+                         vector<string>& vExternIds,
+                         const string& inputFile,
+                         DataFileInputState& inpState,
+                         std::streamoff dataStart, std::streamoff dataEnd,
+                         size_t chunkQty,
+                         ObjectArena* arena) const;
+
   DISABLE_COPY_AND_ASSIGN(Space);
 };
 
@@ -18,6 +18,7 @@
 #include <string>
 #include <map>
 #include <stdexcept>
+#include <algorithm>
 
 #include <string.h>
 #include "global.h"
@@ -51,6 +52,27 @@ class SpaceBitJaccard : public SpaceBitVector<dist_t,dist_uint_t> {
     return BitJaccard<dist_t,dist_uint_t>(x, y, length);
   }
 
+  virtual void DistanceBatch(const Object* query, const Object* const* objs, size_t n, dist_t* out) const override {
+    CHECK(query->datalength() > 0);
+    const dist_uint_t* y = reinterpret_cast<const dist_uint_t*>(query->data());
+    const size_t length = query->datalength() / sizeof(dist_uint_t) - 1;
+
+    const size_t BATCH_QTY = 64;
+    const dist_uint_t* vects[BATCH_QTY];
+    unsigned           andQty[BATCH_QTY];
+    unsigned           orQty[BATCH_QTY];
+
+    for (size_t start = 0; start < n; start += BATCH_QTY) {
+      size_t qty = std::min(BATCH_QTY, n - start);
+      for (size_t i = 0; i < qty; ++i) {
+        CHECK(objs[start + i]->datalength() == query->datalength());
+        vects[i] = reinterpret_cast<const dist_uint_t*>(objs[start + i]->data());
+      }
+      BitAndOrCountBatch(y, vects, qty, length, andQty, orQty);
+      for (size_t i = 0; i < qty; ++i) out[start + i] = 1 - (dist_t(andQty[i]) / dist_t(orQty[i]));
+    }
+  }
+
   DISABLE_COPY_AND_ASSIGN(SpaceBitJaccard);
 };
 
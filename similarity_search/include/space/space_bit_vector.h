@@ -107,6 +107,7 @@ class SpaceBitVector : public Space<dist_t> {
     pInpState->line_num_++;
     return true;
   }
+  virtual bool ReadsOneObjectPerLine() const override { return true; }
   /** End of standard functions to read/write/create objects */
 
   /*
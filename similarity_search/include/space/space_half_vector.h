@@ -0,0 +1,119 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#ifndef _SPACE_HALF_VECTOR_H_
+#define _SPACE_HALF_VECTOR_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "global.h"
+#include "object.h"
+#include "utils.h"
+#include "space.h"
+#include "space_vector.h"
+#include "distcomp.h"
+#include "half_float.h"
+
+#define SPACE_L2_FP16                   "l2_fp16"
+#define SPACE_L2_BF16                   "l2_bf16"
+#define SPACE_COSINE_SIMILARITY_FP16    "cosinesimil_fp16"
+#define SPACE_COSINE_SIMILARITY_BF16    "cosinesimil_bf16"
+#define SPACE_NEGATIVE_SCALAR_FP16      "negdotprod_fp16"
+#define SPACE_NEGATIVE_SCALAR_BF16      "negdotprod_bf16"
+
+namespace similarity {
+
+/*
+ * Dense vectors whose elements are stored as 16-bit floating-point numbers
+ * (fp16 or bf16, see half_float.h): twice as compact as float vectors.
+ * Externally, these spaces behave as float vector spaces: objects are created
+ * from float vectors, which are rounded to the nearest 16-bit numbers, and
+ * CreateDenseVectFromObj returns floats. Hence, text files, binary float vector
+ * files, and float arrays can be used as input.
+ */
+template <HalfFloatType type>
+class VectorSpaceHalf : public VectorSpace<float> {
+ public:
+  explicit VectorSpaceHalf() {}
+  virtual ~VectorSpaceHalf() {}
+
+  virtual string CreateStrFromObj(const Object* pObj, const string& externId /* ignored */) const override;
+  virtual bool ApproxEqual(const Object& obj1, const Object& obj2) const override;
+
+  virtual Object* CreateObjFromVect(IdType id, LabelType label, const std::vector<float>& InpVect) const override {
+    return CreateObjFromArray(id, label, InpVect.data(), InpVect.size());
+  }
+  virtual Object* CreateObjFromArray(IdType id, LabelType label, const float* pVect, size_t elemQty) const override;
+  // Creates an object from 16-bit numbers of the same type (no rounding is needed)
+  Object* CreateObjFromHalfArray(IdType id, LabelType label, const uint16_t* pVect, size_t elemQty) const {
+    return new Object(id, label, elemQty * sizeof(uint16_t), pVect);
+  }
+
+  virtual size_t GetElemQty(const Object* object) const override {
+    return object->datalength() / sizeof(uint16_t);
+  }
+  virtual void CreateDenseVectFromObj(const Object* obj, float* pVect, size_t nElem) const override;
+
+  static const uint16_t* HalfData(const Object* obj) {
+    return reinterpret_cast<const uint16_t*>(obj->data());
+  }
+
+ protected:
+  DISABLE_COPY_AND_ASSIGN(VectorSpaceHalf);
+};
+
+template <HalfFloatType type>
+class SpaceL2Half : public VectorSpaceHalf<type> {
+ public:
+  SpaceL2Half() {}
+  virtual std::string StrDesc() const override {
+    return type == kHalfFloatFP16 ? SPACE_L2_FP16 : SPACE_L2_BF16;
+  }
+ protected:
+  virtual float HiddenDistance(const Object* obj1, const Object* obj2) const override;
+  virtual void DistanceBatch(const Object* query, const Object* const* objs, size_t n, float* out) const override;
+  DISABLE_COPY_AND_ASSIGN(SpaceL2Half);
+};
+
+template <HalfFloatType type>
+class SpaceCosineSimilarityHalf : public VectorSpaceHalf<type> {
+ public:
+  SpaceCosineSimilarityHalf() {}
+  virtual std::string StrDesc() const override {
+    return type == kHalfFloatFP16 ? SPACE_COSINE_SIMILARITY_FP16 : SPACE_COSINE_SIMILARITY_BF16;
+  }
+ protected:
+  virtual float HiddenDistance(const Object* obj1, const Object* obj2) const override;
+  virtual void DistanceBatch(const Object* query, const Object* const* objs, size_t n, float* out) const override;
+  DISABLE_COPY_AND_ASSIGN(SpaceCosineSimilarityHalf);
+};
+
+template <HalfFloatType type>
+class SpaceNegativeScalarProductHalf : public VectorSpaceHalf<type> {
+ public:
+  SpaceNegativeScalarProductHalf() {}
+  virtual std::string StrDesc() const override {
+    return type == kHalfFloatFP16 ? SPACE_NEGATIVE_SCALAR_FP16 : SPACE_NEGATIVE_SCALAR_BF16;
+  }
+ protected:
+  virtual float HiddenDistance(const Object* obj1, const Object* obj2) const override;
+  virtual void DistanceBatch(const Object* query, const Object* const* objs, size_t n, float* out) const override;
+  DISABLE_COPY_AND_ASSIGN(SpaceNegativeScalarProductHalf);
+};
+
+}  // namespace similarity
+
+#endif
@@ -55,9 +55,12 @@ class SpaceL2SqrSift : public Space<DistTypeSIFT> {
    * as its label. Return false, on EOF.
    */
   virtual bool ReadNextObjStr(DataFileInputState &, string& strObj, LabelType& label, string& externId) const override;
+  virtual bool ReadsOneObjectPerLine() const override { return true; }
   /** End of standard functions to read/write/create objects */ 
 
   virtual Object* CreateObjFromUint8Vect(IdType id, LabelType label, const std::vector<uint8_t>& InpVect) const;
+  // Creates an object from an array of SIFT_DIM elements (thread-safe)
+  virtual Object* CreateObjFromUint8Array(IdType id, LabelType label, const uint8_t* pVect, size_t elemQty) const;
   virtual size_t GetElemQty(const Object* object) const override { return SIFT_DIM; }
 
   virtual string StrDesc() const override { return SPACE_L2SQR_SIFT; }
@@ -21,7 +21,10 @@
 #include <algorithm>
 
 #include <string.h>
+#include <climits>
+#include <cmath>
 #include "distcomp.h"
+#include "distcomp_edist.h"
 #include "space/space_string.h"
 
 namespace similarity {
@@ -43,7 +46,32 @@ class SpaceLevenshtein : public StringSpace<int> {
     const size_t len1 = obj1->datalength() / sizeof(char);
     const size_t len2 = obj2->datalength() / sizeof(char);
 
-    return levenshtein(x, len1, y, len2);
+    return levenshteinBitParallel(x, len1, y, len2);
+  }
+  virtual int HiddenDistanceBounded(const Object* obj1, const Object* obj2, int maxDist) const {
+    CHECK(obj1->datalength() > 0);
+    CHECK(obj2->datalength() > 0);
+    const char* x = reinterpret_cast<const char*>(obj1->data());
+    const char* y = reinterpret_cast<const char*>(obj2->data());
+    const size_t len1 = obj1->datalength() / sizeof(char);
+    const size_t len2 = obj2->datalength() / sizeof(char);
+
+    return levenshteinBitParallelBounded(x, len1, y, len2, maxDist);
+  }
+  // The query is preprocessed only once for the whole batch
+  virtual void DistanceBatch(const Object* query, const Object* const* objs, size_t n, int* out) const {
+    DistanceBatchBounded(query, objs, n, INT_MAX, out);
+  }
+  virtual void DistanceBatchBounded(const Object* query, const Object* const* objs, size_t n,
+                                    int maxDist, int* out) const {
+    CHECK(query->datalength() > 0);
+    LevenshteinBitParallel pattern(reinterpret_cast<const char*>(query->data()), query->datalength() / sizeof(char));
+    DistanceBatchLoop(query, objs, n, out,
+                      [&pattern, maxDist](const Object* pObj, const Object*) {
+                        CHECK(pObj->datalength() > 0);
+                        return pattern.DistanceBounded(reinterpret_cast<const char*>(pObj->data()),
+                                                       pObj->datalength() / sizeof(char), maxDist);
+                      });
   }
   DISABLE_COPY_AND_ASSIGN(SpaceLevenshtein);
 };
@@ -64,7 +92,46 @@ class SpaceLevenshteinNormalized : public StringSpace<float> {
 
     if (0 == len1 && 0 == len2) return 0;
     CHECK(len1 || len2);
-    return float(levenshtein(x, len1, y, len2))/std::max(len1, len2);
+    return float(levenshteinBitParallel(x, len1, y, len2))/std::max(len1, len2);
+  }
+  virtual float HiddenDistanceBounded(const Object* obj1, const Object* obj2, float maxDist) const {
+    CHECK(obj1->datalength() > 0);
+    CHECK(obj2->datalength() > 0);
+    const char* x = reinterpret_cast<const char*>(obj1->data());
+    const char* y = reinterpret_cast<const char*>(obj2->data());
+    const size_t len1 = obj1->datalength() / sizeof(char);
+    const size_t len2 = obj2->datalength() / sizeof(char);
+    const size_t maxLen = std::max(len1, len2);
+
+    return float(levenshteinBitParallelBounded(x, len1, y, len2, UnnormalizedBound(maxDist, maxLen)))/maxLen;
+  }
+  // The query is preprocessed only once for the whole batch
+  virtual void DistanceBatch(const Object* query, const Object* const* objs, size_t n, float* out) const {
+    DistanceBatchBounded(query, objs, n, 1, out);
+  }
+  virtual void DistanceBatchBounded(const Object* query, const Object* const* objs, size_t n,
+                                    float maxDist, float* out) const {
+    CHECK(query->datalength() > 0);
+    const size_t queryLen = query->datalength() / sizeof(char);
+    LevenshteinBitParallel pattern(reinterpret_cast<const char*>(query->data()), queryLen);
+    DistanceBatchLoop(query, objs, n, out,
+                      [&pattern, queryLen, maxDist](const Object* pObj, const Object*) {
+                        CHECK(pObj->datalength() > 0);
+                        const size_t len = pObj->datalength() / sizeof(char);
+                        const size_t maxLen = std::max(len, queryLen);
+                        return float(pattern.DistanceBounded(reinterpret_cast<const char*>(pObj->data()), len,
+                                                             UnnormalizedBound(maxDist, maxLen)))/maxLen;
+                      });
+  }
+  /*
+   * If the unnormalized distance exceeds the returned bound, the normalized one exceeds
+   * maxDist by at least 1/maxLen. The margin of one edit protects against rounding errors.
+   * Normalized distances never exceed one, so there is no bound in this case.
+   */
+  static int UnnormalizedBound(float maxDist, size_t maxLen) {
+    if (maxDist >= 1) return INT_MAX;
+    if (maxDist < 0) return -1;
+    return int(std::floor(maxDist * maxLen)) + 1;
   }
   DISABLE_COPY_AND_ASSIGN(SpaceLevenshteinNormalized);
 };
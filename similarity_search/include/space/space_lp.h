@@ -84,6 +84,7 @@ class SpaceLp : public VectorSpaceSimpleStorage<dist_t> {
   virtual std::string StrDesc() const;
  protected:
   virtual dist_t HiddenDistance(const Object* obj1, const Object* obj2) const;
+  virtual void DistanceBatch(const Object* query, const Object* const* objs, size_t n, dist_t* out) const override;
  private:
   SpaceLpDist<dist_t> distObj_;
   DISABLE_COPY_AND_ASSIGN(SpaceLp);
@@ -44,6 +44,7 @@ public:
   }
 protected:
   virtual dist_t HiddenDistance(const Object* obj1, const Object* obj2) const;
+  virtual void DistanceBatch(const Object* query, const Object* const* objs, size_t n, dist_t* out) const override;
   DISABLE_COPY_AND_ASSIGN(SpaceCosineSimilarity);
 };
 
@@ -65,6 +66,7 @@ public:
 
 protected:
   virtual dist_t HiddenDistance(const Object* obj1, const Object* obj2) const;
+  virtual void DistanceBatch(const Object* query, const Object* const* objs, size_t n, dist_t* out) const override;
   DISABLE_COPY_AND_ASSIGN(SpaceAngularDistance);
 };
 
@@ -86,6 +88,7 @@ public:
 
 protected:
   virtual dist_t HiddenDistance(const Object* obj1, const Object* obj2) const;
+  virtual void DistanceBatch(const Object* query, const Object* const* objs, size_t n, dist_t* out) const override;
   DISABLE_COPY_AND_ASSIGN(SpaceNegativeScalarProduct);
 };
 
@@ -19,6 +19,7 @@
 #include <object.h>
 
 #include <memory>
+#include <limits>
 
 #include <space/space_sparse_bin_common.h>
 #include <space/space_sparse_vector_inter.h>
@@ -59,6 +60,13 @@ private:
   void UpdateParamsFromFile(DataFileInputState& inpStateBase) override {
     DataFileInputStateSparseDenseFusion& inpState = dynamic_cast<DataFileInputStateSparseDenseFusion&>(inpStateBase);
     vCompDesc_ = inpState.vCompDesc_;
+    vQueryActiveComp_.clear();
+    vIndexActiveComp_.clear();
+    // Components with non-positive weights are never evaluated
+    for (uint32_t i = 0; i < vCompDesc_.size(); ++i) {
+      if (vCompDesc_[i].queryWeight_ > numeric_limits<float>::min()) vQueryActiveComp_.push_back(i);
+      if (vCompDesc_[i].indexWeight_ > numeric_limits<float>::min()) vIndexActiveComp_.push_back(i);
+    }
   }
 
   // Read a string representation of the next object in a file
@@ -92,10 +100,37 @@ protected:
   DISABLE_COPY_AND_ASSIGN(SpaceSparseDenseFusion);
 
   virtual float HiddenDistance(const Object *obj1, const Object *obj2) const override;
+  virtual float HiddenDistanceBounded(const Object* obj1, const Object* obj2, float maxDist) const override;
+  // Components of the query are located only once
+  virtual void DistanceBatch(const Object* query, const Object* const* objs, size_t n, float* out) const override;
+  virtual void DistanceBatchBounded(const Object* query, const Object* const* objs, size_t n,
+                                    float maxDist, float* out) const override;
 
-  float compDistance(const Object *obj1, const Object *obj2, bool isIndex) const;
+  /*
+   * Objects start with a table of components, which has the offset, the size,
+   * and the Euclidean norm of every component. Hence, any component is accessed
+   * directly. Component data are aligned on 16-byte boundaries.
+   */
+  struct CompHeader {
+    uint32_t  offset_;
+    uint32_t  len_;
+    float     norm_;
+  };
+  static const size_t kCompAlign = 16;
+
+  const CompHeader* getCompHeaders(const Object* obj) const;
+
+  /*
+   * If bounded is true, the norms are used to stop computing the distance once
+   * it is known to exceed maxDist (see Space::HiddenDistanceBounded).
+   */
+  float compDistance(const Object* obj1, const CompHeader* pHead2, const char* pBeg2,
+                     bool isQueryTime, bool bounded, float maxDist) const;
 
   vector<CompDesc>  vCompDesc_;
+  // Indices of components with positive weights
+  vector<uint32_t>  vQueryActiveComp_;
+  vector<uint32_t>  vIndexActiveComp_;
 
   string            weightFileName_;
   vector<float>     vHeaderIndexWeights_;
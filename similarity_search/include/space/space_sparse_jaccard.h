@@ -77,6 +77,7 @@ class SpaceSparseJaccard : public Space<dist_t> {
    * as its label. Return false, on EOF.
    */
   virtual bool ReadNextObjStr(DataFileInputState &, string& strObj, LabelType& label, string& externId) const;
+  virtual bool ReadsOneObjectPerLine() const override { return true; }
 
   /*
    * Used only for testing/debugging: compares objects approximately. Floating point numbers
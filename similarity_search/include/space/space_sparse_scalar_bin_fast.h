@@ -45,6 +45,8 @@ public:
   }
   unique_ptr<DataFileInputState> OpenReadFileHeader(const string& inpFileName) const override;
   virtual bool ReadNextObjStr(DataFileInputState &, string& strObj, LabelType& label, string& externId) const override;
+  // binary files cannot be split into lines
+  virtual bool ReadsOneObjectPerLine() const override { return false; }
   virtual unique_ptr<Object> CreateObjFromStr(IdType id, LabelType label, const string& s,
                                               DataFileInputState* pInpState) const override;
 
@@ -59,6 +61,8 @@ public:
   }
   unique_ptr<DataFileInputState> OpenReadFileHeader(const string& inpFileName) const override;
   virtual bool ReadNextObjStr(DataFileInputState &, string& strObj, LabelType& label, string& externId) const override;
+  // binary files cannot be split into lines
+  virtual bool ReadsOneObjectPerLine() const override { return false; }
   virtual unique_ptr<Object> CreateObjFromStr(IdType id, LabelType label, const string& s,
                                               DataFileInputState* pInpState) const override;
 
@@ -69,6 +69,7 @@ public:
    * as its label. Return false, on EOF.
    */
   virtual bool ReadNextObjStr(DataFileInputState &, string& strObj, LabelType& label, string& externId) const;
+  virtual bool ReadsOneObjectPerLine() const override { return true; }
   /** End of standard functions to read/write/create objects */
 
   /*
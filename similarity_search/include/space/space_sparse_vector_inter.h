@@ -90,6 +90,9 @@ class SpaceSparseVectorInter : public SpaceSparseVector<dist_t> {
 
   virtual size_t GetElemQty(const Object* object) const;
 
+  // Version 2 is the layout with 32-bit ids (see PackSparseElements), which replaced 16-bit ids in blocks
+  virtual uint32_t GetBinDataFormatVersion() const { return 2; }
+
   size_t ComputeOverlap(const Object* pObj1, const Object* pObj2) const;
   size_t ComputeOverlap(const Object* pObj1, const Object* pObj2, const Object* pObj3) const;
 
@@ -102,71 +105,40 @@ class SpaceSparseVectorInter : public SpaceSparseVector<dist_t> {
   virtual dist_t HiddenDistance(const Object* obj1, const Object* obj2) const = 0;
 };
 
-/* 
- *
- * Modifying ids, so we don't have ids for which id % 65536 == 0
- *
- * The SIMD intersection algorithm won't be able to handle such ids, 
- * because a faster version of _mm_cmpistrm requires that all ids 
- * are non-zero.
- *
- */
-inline  size_t removeBlockZeros(size_t id) {
-  // This way we don't have ids for which id % 65536 == 0
-  return (id / 65535) * 65536 + (id % 65535) + 1;
-};
-
-/* 
- * A conversion that reverts removeBlockZeros
- * It works only for the numbers where id % 65536 != 0,
- * which makes sense as removeBlockZeros can't produce a multiple of 65536.
- *
- *
- * One may doubt if this reverse conversion actually works (we 
- * do have a unit test to verify this). However, it's not 
- * hard to see why the conversion is correct using basic
- * modulo and integer division arithmetic (see below).
+/*
+ * The packed format of a sparse vector is:
  *
- * Note 1:
- * One way to represent id produced by removeBlockZeros(origId):
- * id = (origId / 65535) * 65536 + term_smaller_than_65536
- * Therefore: origId / 65536 is equal to  id / 65536
- * This deletion clearly "removes" the term smaller than 65536.
- * 
- * Note 2:
- * Another way to represent id obtained as removeBlockZeros(origId):
- * id = a_multiple_of_65536 + (origId % 65535) + 1
- * Note that the sum of second and the third terms is smaller than 65536.
- * Therefore id % 65536 = (origId % 65535) + 1
+ * i)   The number of elements (size_t).
+ * ii)  The sum of squared element values (dist_t).
+ * iii) (sum of squared element values)^(-0.5) (float).
+ * iv)  Sorted 32-bit element ids.
+ * v)   Element values (dist_t) in the same order as ids.
  *
- * Combining Note 1 & 2, we obtain that:
- * addBlockZeros(id) = (origId / 65535) + origId % 65535 = origId
- * 
- * Q.E.D.
+ * Ids and values are kept in separate arrays so that intersection
+ * kernels can load many 32-bit ids at once (see distcomp_sparse_scalar_fast.cc).
  */
-inline size_t addBlockZeros(size_t id) {
-  return (id / 65536) * 65535 + (id % 65536) - 1;
+template <typename dist_t>
+inline size_t GetSparsePackedSize(size_t elemQty) {
+  return sizeof(size_t) + sizeof(dist_t) + sizeof(float) +
+         elemQty * (sizeof(uint32_t) + sizeof(dist_t));
 }
 
 template <typename dist_t>
-inline  void ParseSparseElementHeader(const char*     pBuff, 
-                                      size_t&         rBlockQty,
-                                      dist_t&         rSqSum,
-                                      float&          rNormCoeff,
-                                      const size_t*&  rpBlockQtys,
-                                      const size_t*&  rpBlockOffs, 
-                                      const char*&    rpBlockBegin) {
+inline  void ParseSparseElementHeader(const char*       pBuff,
+                                      size_t&           rElemQty,
+                                      dist_t&           rSqSum,
+                                      float&            rNormCoeff,
+                                      const uint32_t*&  rpIds,
+                                      const dist_t*&    rpVals) {
   const size_t*   pQty = reinterpret_cast<const size_t*>(pBuff);
-  rBlockQty = *pQty;
+  rElemQty = *pQty;
   const dist_t*   pSqSum = reinterpret_cast<const dist_t*>(pQty + 1);
   rSqSum = *pSqSum;
   const float* pNormCoeff = reinterpret_cast<const float*>(pSqSum + 1);
   rNormCoeff = *pNormCoeff;
-  rpBlockQtys = reinterpret_cast<const size_t*>(pNormCoeff + 1);
-  rpBlockOffs = rpBlockQtys + rBlockQty;
-
-  rpBlockBegin = reinterpret_cast<const char*>(rpBlockOffs + rBlockQty);
-}  
+  rpIds = reinterpret_cast<const uint32_t*>(pNormCoeff + 1);
+  rpVals = reinterpret_cast<const dist_t*>(rpIds + rElemQty);
+}
 
 template <typename dist_t>
 inline  void UnpackSparseElements(const char* pBuff, size_t dataLen,
@@ -176,95 +148,37 @@ inline  void UnpackSparseElements(const char* pBuff, size_t dataLen,
 
   OutVect.clear(); // just in case
 
-  size_t            blockQty = 0;
+  size_t            elemQty = 0;
   dist_t            SqSum = 0;
   float             normCoeff = 0;
-  const size_t*     pBlockQty = NULL;
-  const size_t*     pBlockOff = NULL;
-
-  const char* pBlockBegin = NULL;
+  const uint32_t*   pIds = NULL;
+  const dist_t*     pVals = NULL;
 
-  ParseSparseElementHeader(pBuff, blockQty,
+  ParseSparseElementHeader(pBuff, elemQty,
                            SqSum, normCoeff,
-                           pBlockQty, 
-                           pBlockOff, 
-                           pBlockBegin);
+                           pIds, pVals);
 
-  size_t elemSize = 2 + sizeof(dist_t);
+  CHECK(GetSparsePackedSize<dist_t>(elemQty) == dataLen);
 
-  for (size_t i = 0; i < blockQty; ++i) {
-    size_t qty    = pBlockQty[i];
-    size_t offset = pBlockOff[i];
-
-    const uint16_t* pBlockIds = reinterpret_cast<const uint16_t*>(pBlockBegin);
-    const dist_t* pValBegin = reinterpret_cast<const dist_t*>(pBlockIds + qty);
-
-    for (size_t k = 0; k < qty; ++k) {
-      OutVect.push_back(ElemType(addBlockZeros(pBlockIds[k] + offset), pValBegin[k]));
-    }
-
-    pBlockBegin += elemSize * qty;
+  OutVect.reserve(elemQty);
+  for (size_t k = 0; k < elemQty; ++k) {
+    OutVect.push_back(ElemType(pIds[k], pVals[k]));
   }
-
-  CHECK(pBlockBegin - pBuff == (ptrdiff_t)dataLen);
 }
 
 template <typename dist_t>
 inline  void PackSparseElements(const vector<SparseVectElem<dist_t>>& InpVect, 
                                 char*& prBuff, size_t& dataSize) {
-  typedef SparseVectElem<dist_t> ElemType;
-
-  vector<vector<ElemType>>    blocks;
-  vector<size_t>              blockOffsets;
-
-  uint32_t  prevBlockId = numeric_limits<uint32_t>::max();
-
-  vector<ElemType> currBlock;
-
-  size_t totQty = 0;
   dist_t sqSum = 0;
 
   for (size_t i = 0; i < InpVect.size(); ++i) {
-	  uint32_t id = static_cast<uint32_t> // Blocks are never too large
-						(removeBlockZeros(InpVect[i].id_));
-
-	
-    uint32_t blockId = static_cast<uint32_t> // Blocks are never too large
-						(id / 65536);
-
-    id &= 65535; // in-block id will contain only the last two bytes
-
-    if (blockId != prevBlockId && !currBlock.empty()) {
-      blocks.push_back(currBlock);
-      blockOffsets.push_back(prevBlockId * 65536);
-      currBlock.clear();
-    }
-
-    prevBlockId = blockId;
-    currBlock.push_back(ElemType(id, InpVect[i].val_));
+    // The intersection code relies on sorted unique ids
+    CHECK_MSG(i == 0 || InpVect[i - 1].id_ < InpVect[i].id_,
+              "Sparse element ids should be sorted and unique");
     sqSum += InpVect[i].val_ * InpVect[i].val_;
-    ++totQty;
   }
-  blocks.push_back(currBlock);
-  blockOffsets.push_back(prevBlockId * 65536);
-
-  CHECK(InpVect.size() == totQty);
-
-  /* 
-   * How much memory do we need?
-   *
-   * i)   A header will store the number of blocks. 
-   * ii)  For each block we keep the # of elements
-   * iii) The sum of squared element values.
-   * iv)  Each element has a 2-byte id and a sizeof(dist_t) value
-   *
-   */
-  size_t elemSize = 2 + sizeof(dist_t);
-  dataSize = sizeof(size_t) + // number of blocks
-              sizeof(dist_t) + // sum of squared elements
-              sizeof(float) + // (sum of squared elements)^(-0.5)
-              2 * sizeof(size_t) * (blocks.size()) + // block qtys & offsets
-              elemSize * InpVect.size();  
+
+  dataSize = GetSparsePackedSize<dist_t>(InpVect.size());
 
   prBuff = new char[dataSize]; 
 
@@ -273,37 +187,24 @@ inline  void PackSparseElements(const vector<SparseVectElem<dist_t>>& InpVect,
   /*
    * Store meta information.
    */
-  *pQty = blocks.size(); 
+  *pQty = InpVect.size();
 
   dist_t*   pSqSum = reinterpret_cast<dist_t*>(pQty + 1);
   *pSqSum = sqSum;
   float*    pNormCoeff = reinterpret_cast<float*>(pSqSum + 1);
   *pNormCoeff = 1.0f/sqrt(static_cast<float>(sqSum));
-  size_t*   pBlockQtyOff = reinterpret_cast<size_t*>(pNormCoeff + 1);
-
-  for (size_t i = 0; i < blocks.size(); ++i) {
-    *pBlockQtyOff++ = blocks[i].size(); // qty
-  }
-  for (size_t i = 0; i < blocks.size(); ++i) {
-    *pBlockQtyOff++ = blockOffsets[i]; // offset
-  }
   /*
-   * Store block data.
+   * Store ids and values.
    */
-  uint16_t* pBlockIds = reinterpret_cast<uint16_t*>(pBlockQtyOff);
-
-  for (size_t i = 0; i < blocks.size(); ++i) {
-    dist_t* pBlockVals = reinterpret_cast<dist_t*>(pBlockIds + blocks[i].size());
+  uint32_t* pIds = reinterpret_cast<uint32_t*>(pNormCoeff + 1);
+  dist_t*   pVals = reinterpret_cast<dist_t*>(pIds + InpVect.size());
 
-    for (size_t k = 0; k < blocks[i].size(); ++k) {
-      *pBlockIds++ = blocks[i][k].id_;
-      *pBlockVals++ = blocks[i][k].val_;
-    }
-
-    pBlockIds = reinterpret_cast<uint16_t*>(pBlockVals);
+  for (size_t i = 0; i < InpVect.size(); ++i) {
+    pIds[i] = static_cast<uint32_t>(InpVect[i].id_);
+    pVals[i] = InpVect[i].val_;
   }
 
-  CHECK(reinterpret_cast<char*>(pBlockIds) - prBuff == (ptrdiff_t)dataSize); 
+  CHECK(reinterpret_cast<char*>(pVals + InpVect.size()) - prBuff == (ptrdiff_t)dataSize);
 }
 
 }  // namespace similarity
@@ -20,6 +20,8 @@
 
 #include <string>
 #include <stdexcept>
+#include <vector>
+#include <algorithm>
 
 #include <string.h>
 #include "global.h"
@@ -36,11 +38,21 @@
 
 namespace similarity {
 
+/*
+ * Batched versions of similarity functions: they transform squared Euclidean
+ * distances between centroids into similarities in place (using SIMD).
+ */
+void SqfdMinusSimBatch(float* pVals, size_t qty);
+void SqfdHeuristicSimBatch(float* pVals, size_t qty, float alpha);
+void SqfdGaussianSimBatch(float* pVals, size_t qty, float alpha);
+
 template <typename dist_t>
 class SqfdFunction {
  public:
   virtual ~SqfdFunction() {}
   virtual dist_t f(const dist_t* p1, const dist_t* p2, const int sz) const = 0;
+  // Computes f for qty centroid pairs given squared distances between centroids (in place)
+  virtual void SimFromSqrDistBatch(dist_t* pVals, size_t qty) const = 0;
   virtual std::string StrDesc() const = 0;
   virtual SqfdFunction<dist_t>* Clone() const = 0;
 };
@@ -51,6 +63,9 @@ class SqfdMinusFunction : public SqfdFunction<dist_t> {
   dist_t f(const dist_t* p1, const dist_t* p2, const int sz) const {
     return -L2NormSIMD(p1, p2, sz);
   }
+  void SimFromSqrDistBatch(dist_t* pVals, size_t qty) const {
+    SqfdMinusSimBatch(pVals, qty);
+  }
   std::string StrDesc() const {
     return "minus function";
   }
@@ -66,6 +81,9 @@ class SqfdHeuristicFunction : public SqfdFunction<dist_t> {
   dist_t f(const dist_t* p1, const dist_t* p2, const int sz) const {
     return 1.0 / (alpha_ + L2NormSIMD(p1, p2, sz));
   }
+  void SimFromSqrDistBatch(dist_t* pVals, size_t qty) const {
+    SqfdHeuristicSimBatch(pVals, qty, alpha_);
+  }
   std::string StrDesc() const {
     std::stringstream stream;
     stream << "heuristic function alpha=" << alpha_;
@@ -86,6 +104,9 @@ class SqfdGaussianFunction : public SqfdFunction<dist_t> {
     const dist_t d = L2NormSIMD(p1, p2, sz);
     return exp(-alpha_ * d * d);
   }
+  void SimFromSqrDistBatch(dist_t* pVals, size_t qty) const {
+    SqfdGaussianSimBatch(pVals, qty, alpha_);
+  }
   std::string StrDesc() const {
     std::stringstream stream;
     stream << "gaussian function alpha=" << alpha_;
@@ -156,7 +177,38 @@ class SpaceSqfd : public Space<dist_t> {
   dist_t HiddenDistance(
       const Object* obj1,
       const Object* obj2) const;
+  // The query centroids are transposed only once
+  virtual void DistanceBatch(const Object* query, const Object* const* objs, size_t n, dist_t* out) const override;
  private:
+  /*
+   * The SQFD is sqrt(w1^T A11 w1 + w2^T A22 w2 - 2 w1^T A12 w2), where wi are centroid weights
+   * and A are matrices of centroid similarities. The first two (self-similarity) terms are computed
+   * once, when an object is created, and are stored after centroids. Centroids of one object
+   * are transposed, so that similarities to all of them are computed using SIMD.
+   */
+  struct TransposedCentroids {
+    uint32_t        num_clusters_ = 0;
+    uint32_t        feature_dimension_ = 0;
+    // The number of centroids padded to a multiple of kPadQty
+    uint32_t        stride_ = 0;
+    // feature_dimension_ rows of stride_ elements
+    vector<dist_t>  centroids_;
+    vector<dist_t>  weights_;
+    double          self_sum_ = 0;
+  };
+  static const uint32_t kPadQty = 8;
+
+  // Objects created by this space keep self-similarity terms, but others are supported as well
+  void TransposeCentroids(const Object* obj, TransposedCentroids& res, bool computeSelfSum = true) const;
+  // Computes w1^T A12 w2 for the transposed first object (pBuf must have tc.stride_ elements)
+  double CrossSum(const TransposedCentroids& tc, const Object* obj, dist_t* pBuf) const;
+  double SelfSum(const Object* obj) const;
+
+  dist_t DistanceFromSums(double selfSum1, double selfSum2, double crossSum) const {
+    // Due to rounding errors, the sum can be a small-magnitude negative number
+    return static_cast<dist_t>(sqrt(std::max(0.0, selfSum1 + selfSum2 - 2 * crossSum)));
+  }
+
   SqfdFunction<dist_t>* func_;
 };
 
@@ -55,6 +55,7 @@ class StringSpace : public Space<dist_t> {
                                                               const string& outputFile) const ;
   // Read a string representation of the next object in a file
   virtual bool ReadNextObjStr(DataFileInputState &, string& strObj, LabelType& label, string& externId) const;
+  virtual bool ReadsOneObjectPerLine() const override { return true; }
   // Write a string representation of the next object to a file
   virtual void WriteNextObj(const Object& obj, const string& externId, DataFileOutputState &) const;
   /** End of standard functions to read/write/create objects */ 
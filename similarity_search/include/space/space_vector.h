@@ -53,6 +53,7 @@ class VectorSpace : public Space<dist_t> {
      * as its label. Return false, on EOF.
      */
     virtual bool ReadNextObjStr(DataFileInputState &, string& strObj, LabelType& label, string& externId) const;
+    virtual bool ReadsOneObjectPerLine() const override { return true; }
   /** End of standard functions to read/write/create objects */ 
 
   /*
@@ -62,6 +63,16 @@ class VectorSpace : public Space<dist_t> {
   virtual bool ApproxEqual(const Object& obj1, const Object& obj2) const;
 
   virtual Object* CreateObjFromVect(IdType id, LabelType label, const std::vector<dist_t>& InpVect) const;
+  /*
+   * Creates an object from an array of elemQty elements. The default implementation
+   * copies the array to a temporary vector and calls CreateObjFromVect: this works
+   * for spaces that transform vectors (e.g., precompute logarithms). Spaces, which
+   * store vectors as is, override it to copy the array directly into the object.
+   * This function is thread-safe (it can be used for parallel loading).
+   */
+  virtual Object* CreateObjFromArray(IdType id, LabelType label, const dist_t* pVect, size_t elemQty) const {
+    return CreateObjFromVect(id, label, std::vector<dist_t>(pVect, pVect + elemQty));
+  }
   virtual size_t GetElemQty(const Object* object) const = 0;
   virtual void CreateDenseVectFromObj(const Object* obj, dist_t* pVect,
                                  size_t nElem) const = 0;
@@ -73,6 +84,31 @@ protected:
 
   virtual dist_t HiddenDistance(const Object* obj1, const Object* obj2) const = 0;
 
+  /*
+   * A helper for DistanceBatch overrides of spaces that store vectors as is:
+   * it calls a one-to-many function batchFunc(pQuery, pVects, qty, elemQty, pOut)
+   * (e.g., L2SqrSIMDBatch) for chunks of objects.
+   */
+  template <typename BatchFunc>
+  static void DenseDistanceBatch(const Object* query, const Object* const* objs, size_t n, dist_t* out,
+                                 const BatchFunc& batchFunc) {
+    const size_t CHUNK_QTY = 64;
+    const dist_t* pVects[CHUNK_QTY];
+    CHECK(query->datalength() > 0);
+    const dist_t* pQuery = reinterpret_cast<const dist_t*>(query->data());
+    const size_t elemQty = query->datalength() / sizeof(dist_t);
+
+    for (size_t start = 0; start < n; start += CHUNK_QTY) {
+      size_t qty = std::min(n - start, CHUNK_QTY);
+      for (size_t i = 0; i < qty; ++i) {
+        const Object* pObj = objs[start + i];
+        CHECK(pObj->datalength() == query->datalength());
+        pVects[i] = reinterpret_cast<const dist_t*>(pObj->data());
+      }
+      batchFunc(pQuery, pVects, qty, elemQty, out + start);
+    }
+  }
+
   void CreateVectFromObjSimpleStorage(const char *pFuncName,
                                  const Object* obj, dist_t* pDstVect,
                                  size_t nElem) const {
@@ -102,6 +138,9 @@ class VectorSpaceSimpleStorage : public VectorSpace<dist_t> {
     VectorSpace<dist_t>::
                 CreateVectFromObjSimpleStorage(__func__, obj, pDstVect, nElem);
   }
+  virtual Object* CreateObjFromArray(IdType id, LabelType label, const dist_t* pVect, size_t elemQty) const {
+    return new Object(id, label, elemQty * sizeof(dist_t), pVect);
+  }
 private:
   DISABLE_COPY_AND_ASSIGN(VectorSpaceSimpleStorage);
 };
@@ -45,6 +45,8 @@ class WordEmbedSpace : public VectorSpaceSimpleStorage<dist_t> {
   explicit WordEmbedSpace(EmbedDistSpace distType) : distType_(distType) {}
   virtual ~WordEmbedSpace() {}
 
+  EmbedDistSpace GetDistType() const { return distType_; }
+
   /** Standard functions to read/write/create objects */ 
     // Create a string representation of an object.
     virtual string CreateStrFromObj(const Object* pObj, const string& externId) const;
@@ -12,10 +12,19 @@
  * Apache License Version 2.0 http://www.apache.org/licenses/.
  *
  */
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <algorithm>
 #include <atomic>
 #include <thread>
 #include <queue>
 #include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <memory>
+#include <vector>
 
 namespace similarity {
 
@@ -113,4 +122,121 @@ namespace similarity {
 
 
   }
+
+  /*
+   * A persistent pool of worker threads. Unlike ParallelFor, which starts
+   * and joins threads on every call, the pool keeps its workers alive,
+   * so that it can be used on the critical path of a single query, e.g.,
+   * to fan a query out to several index shards.
+   */
+  class ThreadPool {
+  public:
+    explicit ThreadPool(size_t threadQty) : stop_(false) {
+      if (threadQty == 0) {
+        threadQty = std::thread::hardware_concurrency();
+      }
+      for (size_t i = 0; i < threadQty; ++i) {
+        workers_.push_back(std::thread([this] { workerLoop(); }));
+      }
+    }
+
+    ~ThreadPool() {
+      {
+        std::unique_lock<std::mutex> lock(mtx_);
+        stop_ = true;
+      }
+      cond_.notify_all();
+      for (auto & worker : workers_) {
+        worker.join();
+      }
+    }
+
+    size_t GetThreadQty() const { return workers_.size(); }
+
+    // Enqueues a job, which will be executed by one of the workers (asynchronously).
+    // The job must not throw: use ParallelRun, if exceptions need to be propagated.
+    void Submit(std::function<void()> job) {
+      {
+        std::unique_lock<std::mutex> lock(mtx_);
+        jobs_.push(std::move(job));
+      }
+      cond_.notify_one();
+    }
+
+    /*
+     * Calls fn(id) for ids from 0 (inclusive) to qty (EXCLUSIVE) and blocks until
+     * all the calls finish. The calling thread processes ids too: Hence,
+     * ParallelRun can be safely called from inside a pool job without a deadlock
+     * (in the worst case all the work is done by the caller).
+     * The first exception thrown by fn is re-thrown in the calling thread.
+     */
+    template <class Function>
+    void ParallelRun(size_t qty, Function fn) {
+      if (qty == 0) return;
+
+      auto batch = std::make_shared<BatchState>(qty);
+      auto runBatch = [batch, fn]() {
+        while (true) {
+          size_t id = batch->next_.fetch_add(1);
+          if (id >= batch->qty_) break;
+          try {
+            fn(id);
+          } catch (...) {
+            std::unique_lock<std::mutex> lock(batch->mtx_);
+            if (!batch->exception_) batch->exception_ = std::current_exception();
+          }
+          if (batch->done_.fetch_add(1) + 1 == batch->qty_) {
+            std::unique_lock<std::mutex> lock(batch->mtx_);
+            batch->cond_.notify_all();
+          }
+        }
+      };
+
+      size_t helperQty = std::min(qty - 1, workers_.size());
+      for (size_t i = 0; i < helperQty; ++i) {
+        Submit(runBatch);
+      }
+      runBatch();
+
+      std::unique_lock<std::mutex> lock(batch->mtx_);
+      batch->cond_.wait(lock, [&batch] { return batch->done_.load() == batch->qty_; });
+      if (batch->exception_) {
+        std::rethrow_exception(batch->exception_);
+      }
+    }
+
+  private:
+    struct BatchState {
+      explicit BatchState(size_t qty) : qty_(qty), next_(0), done_(0) {}
+
+      const size_t              qty_;
+      std::atomic<size_t>       next_;
+      std::atomic<size_t>       done_;
+      std::mutex                mtx_;
+      std::condition_variable   cond_;
+      std::exception_ptr        exception_;
+    };
+
+    void workerLoop() {
+      while (true) {
+        std::function<void()> job;
+        {
+          std::unique_lock<std::mutex> lock(mtx_);
+          cond_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+          if (stop_ && jobs_.empty()) return;
+          job = std::move(jobs_.front());
+          jobs_.pop();
+        }
+        job();
+      }
+    }
+
+    std::vector<std::thread>            workers_;
+    std::queue<std::function<void()>>   jobs_;
+    std::mutex                          mtx_;
+    std::condition_variable             cond_;
+    bool                                stop_;
+  };
 };
+
+#endif
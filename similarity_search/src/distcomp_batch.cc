@@ -0,0 +1,185 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include "portable_intrinsics.h"
+#include "distcomp.h"
+#include "utils.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace similarity {
+
+using namespace std;
+
+/*
+ * One-to-many versions of dense-vector distances. Vectors are processed in groups
+ * of four: each block of the query is loaded only once and it is combined with
+ * the blocks of all four vectors, which also gives the CPU four independent
+ * dependency chains. Per-vector sums are accumulated in the same order
+ * as in the respective one-to-one SIMD functions.
+ *
+ * A kernel defines ACC_QTY accumulators per vector and the following functions:
+ *   Accum:        updates accumulators using a block of the query and a block of the vector
+ *   AccumScalar:  the same for a single element (used for tails)
+ *   Finish:       computes the distance from the (horizontally) summed accumulators
+ */
+
+#ifdef PORTABLE_SSE2
+
+template <class Kernel, size_t GroupQty>
+static inline void ProcessGroupSIMD(const Kernel& kernel, const float* pQuery, const float* const* pVects,
+                                    size_t qty, float* pOut) {
+  const size_t ACC_QTY = Kernel::ACC_QTY;
+  const size_t qty4 = qty / 4 * 4;
+
+  __m128 acc[GroupQty][ACC_QTY];
+  for (size_t g = 0; g < GroupQty; ++g)
+    for (size_t k = 0; k < ACC_QTY; ++k) acc[g][k] = _mm_setzero_ps();
+
+  for (size_t i = 0; i < qty4; i += 4) {
+    __m128 q = _mm_loadu_ps(pQuery + i);
+    for (size_t g = 0; g < GroupQty; ++g) {
+      kernel.Accum(q, _mm_loadu_ps(pVects[g] + i), acc[g]);
+    }
+  }
+
+  float PORTABLE_ALIGN16 TmpRes[4];
+  for (size_t g = 0; g < GroupQty; ++g) {
+    typename Kernel::SumType sums[ACC_QTY];
+    for (size_t k = 0; k < ACC_QTY; ++k) {
+      _mm_store_ps(TmpRes, acc[g][k]);
+      sums[k] = TmpRes[0] + TmpRes[1] + TmpRes[2] + TmpRes[3];
+    }
+    for (size_t i = qty4; i < qty; ++i) {
+      kernel.AccumScalar(pQuery[i], pVects[g][i], sums);
+    }
+    pOut[g] = kernel.Finish(sums);
+  }
+}
+
+template <class Kernel>
+static void DistanceBatchSIMD(const Kernel& kernel, const float* pQuery, const float* const* pVects,
+                              size_t n, size_t qty, float* pOut) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    ProcessGroupSIMD<Kernel, 4>(kernel, pQuery, pVects + i, qty, pOut + i);
+  }
+  for (; i < n; ++i) {
+    ProcessGroupSIMD<Kernel, 1>(kernel, pQuery, pVects + i, qty, pOut + i);
+  }
+}
+
+struct L2SqrBatchKernel {
+  typedef float SumType;
+  static const size_t ACC_QTY = 1;
+  void Accum(__m128 q, __m128 v, __m128* acc) const {
+    __m128 diff = _mm_sub_ps(v, q);
+    acc[0] = _mm_add_ps(acc[0], _mm_mul_ps(diff, diff));
+  }
+  void AccumScalar(float q, float v, SumType* sums) const {
+    float diff = v - q;
+    sums[0] += diff * diff;
+  }
+  float Finish(const SumType* sums) const { return sums[0]; }
+};
+
+struct L1BatchKernel {
+  // As in L1NormSIMD, the tail is summed in double precision
+  typedef double SumType;
+  static const size_t ACC_QTY = 1;
+  L1BatchKernel() : mask_sign(_mm_castsi128_ps(_mm_set1_epi32(0x7fffffffu))) {}
+  void Accum(__m128 q, __m128 v, __m128* acc) const {
+    acc[0] = _mm_add_ps(acc[0], _mm_and_ps(_mm_sub_ps(v, q), mask_sign));
+  }
+  void AccumScalar(float q, float v, SumType* sums) const {
+    sums[0] += fabs(v - q);
+  }
+  float Finish(const SumType* sums) const { return sums[0]; }
+
+  __m128 mask_sign;
+};
+
+struct ScalarProductBatchKernel {
+  typedef float SumType;
+  static const size_t ACC_QTY = 1;
+  void Accum(__m128 q, __m128 v, __m128* acc) const {
+    acc[0] = _mm_add_ps(acc[0], _mm_mul_ps(v, q));
+  }
+  void AccumScalar(float q, float v, SumType* sums) const {
+    sums[0] += v * q;
+  }
+  float Finish(const SumType* sums) const { return sums[0]; }
+};
+
+// The squared norm of the query is computed only once
+struct NormScalarProductBatchKernel {
+  typedef float SumType;
+  static const size_t ACC_QTY = 2;
+  explicit NormScalarProductBatchKernel(float queryNorm) : queryNorm_(queryNorm) {}
+  void Accum(__m128 q, __m128 v, __m128* acc) const {
+    acc[0] = _mm_add_ps(acc[0], _mm_mul_ps(v, q));
+    acc[1] = _mm_add_ps(acc[1], _mm_mul_ps(v, v));
+  }
+  void AccumScalar(float q, float v, SumType* sums) const {
+    sums[0] += v * q;
+    sums[1] += v * v;
+  }
+  float Finish(const SumType* sums) const {
+    const float eps = numeric_limits<float>::min() * 2;
+    // Zero-norm vectors are handled as in NormScalarProductSIMD
+    if (sums[1] < eps || queryNorm_ < eps) return 0;
+    return max(float(-1), min(float(1), sums[0] / sqrt(sums[1]) / sqrt(queryNorm_)));
+  }
+
+  float queryNorm_;
+};
+
+#endif
+
+void L2SqrSIMDBatch(const float* pQuery, const float* const* pVects, size_t n, size_t qty, float* pOut) {
+#ifndef PORTABLE_SSE2
+  for (size_t i = 0; i < n; ++i) pOut[i] = L2SqrSIMD(pVects[i], pQuery, qty);
+#else
+  DistanceBatchSIMD(L2SqrBatchKernel(), pQuery, pVects, n, qty, pOut);
+#endif
+}
+
+void L1NormSIMDBatch(const float* pQuery, const float* const* pVects, size_t n, size_t qty, float* pOut) {
+#ifndef PORTABLE_SSE2
+  for (size_t i = 0; i < n; ++i) pOut[i] = L1NormSIMD(pVects[i], pQuery, qty);
+#else
+  DistanceBatchSIMD(L1BatchKernel(), pQuery, pVects, n, qty, pOut);
+#endif
+}
+
+void ScalarProductSIMDBatch(const float* pQuery, const float* const* pVects, size_t n, size_t qty, float* pOut) {
+#ifndef PORTABLE_SSE2
+  for (size_t i = 0; i < n; ++i) pOut[i] = ScalarProductSIMD(pVects[i], pQuery, qty);
+#else
+  DistanceBatchSIMD(ScalarProductBatchKernel(), pQuery, pVects, n, qty, pOut);
+#endif
+}
+
+void NormScalarProductSIMDBatch(const float* pQuery, const float* const* pVects, size_t n, size_t qty, float* pOut) {
+#ifndef PORTABLE_SSE2
+  for (size_t i = 0; i < n; ++i) pOut[i] = NormScalarProductSIMD(pVects[i], pQuery, qty);
+#else
+  float queryNorm = ScalarProductSIMD(pQuery, pQuery, qty);
+  DistanceBatchSIMD(NormScalarProductBatchKernel(queryNorm), pQuery, pVects, n, qty, pOut);
+#endif
+}
+
+}  // namespace similarity
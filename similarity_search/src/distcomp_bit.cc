@@ -0,0 +1,432 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <cstring>
+#include <cstdint>
+
+#include "portable_intrinsics.h"
+#include "portable_prefetch.h"
+#include "distcomp.h"
+#include "logging.h"
+
+namespace similarity {
+
+using namespace std;
+
+/*
+ * Popcount kernels for bit vectors stored as 32-bit words:
+ *
+ * 1) Scalar: processes 64-bit words.
+ * 2) AVX2: the Harley-Seal carry-save adder over blocks of 16 256-bit vectors,
+ *    vectors are counted using the nibble lookup of W. Mula.
+ *    See: W. Mula, N. Kurz, D. Lemire, "Faster population counts using AVX2 instructions", 2016.
+ * 3) AVX-512 with the VPOPCNTDQ extension: a native 64-bit popcount,
+ *    tails are processed using masked loads.
+ *
+ * With GCC and Clang on x86, all the variants are compiled and the best
+ * one is chosen at run time (using the CPU id). Other compilers
+ * use only variants enabled at compile time.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BIT_POPCOUNT_RUNTIME_DISPATCH
+#define BIT_POPCOUNT_AVX2
+#define BIT_POPCOUNT_AVX512
+#define TARGET_AVX2     __attribute__((target("avx2")))
+#define TARGET_AVX512   __attribute__((target("avx512f,avx512vpopcntdq")))
+#else
+#if defined(__AVX2__)
+#define BIT_POPCOUNT_AVX2
+#endif
+#if defined(__AVX512VPOPCNTDQ__)
+#define BIT_POPCOUNT_AVX512
+#endif
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+enum BitOp { kBitXor, kBitAnd, kBitOr };
+
+typedef uint64_t (*BitCountFunc)(const uint32_t* a, const uint32_t* b, size_t qty);
+// Computes both counts in one pass, so that every word is loaded only once
+typedef void (*BitAndOrCountFunc)(const uint32_t* a, const uint32_t* b, size_t qty,
+                                  uint64_t& andQty, uint64_t& orQty);
+
+template <BitOp op, typename T>
+inline T ApplyBitOp(T a, T b) {
+  return op == kBitXor ? (a ^ b) : (op == kBitAnd ? (a & b) : (a | b));
+}
+
+template <BitOp op>
+uint64_t BitCountScalar(const uint32_t* a, const uint32_t* b, size_t qty) {
+  uint64_t res = 0;
+  size_t i = 0;
+  for (; i + 2 <= qty; i += 2) {
+    uint64_t x, y;
+    memcpy(&x, a + i, sizeof x);
+    memcpy(&y, b + i, sizeof y);
+    res += __builtin_popcountll(ApplyBitOp<op>(x, y));
+  }
+  if (i < qty) res += __builtin_popcount(ApplyBitOp<op>(a[i], b[i]));
+  return res;
+}
+
+void BitAndOrCountScalar(const uint32_t* a, const uint32_t* b, size_t qty, uint64_t& andQty, uint64_t& orQty) {
+  uint64_t resAnd = 0, resOr = 0;
+  size_t i = 0;
+  for (; i + 2 <= qty; i += 2) {
+    uint64_t x, y;
+    memcpy(&x, a + i, sizeof x);
+    memcpy(&y, b + i, sizeof y);
+    resAnd += __builtin_popcountll(x & y);
+    resOr += __builtin_popcountll(x | y);
+  }
+  if (i < qty) {
+    resAnd += __builtin_popcount(a[i] & b[i]);
+    resOr += __builtin_popcount(a[i] | b[i]);
+  }
+  andQty = resAnd;
+  orQty = resOr;
+}
+
+#ifdef BIT_POPCOUNT_AVX2
+template <BitOp op>
+TARGET_AVX2 inline __m256i LoadBitOpAVX2(const uint32_t* a, const uint32_t* b) {
+  __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+  __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+  return op == kBitXor ? _mm256_xor_si256(va, vb) :
+         (op == kBitAnd ? _mm256_and_si256(va, vb) : _mm256_or_si256(va, vb));
+}
+
+// Returns four 64-bit counters
+TARGET_AVX2 inline __m256i PopcountAVX2(__m256i v) {
+  const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                          0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i lowMask = _mm256_set1_epi8(0x0f);
+  __m256i lo = _mm256_and_si256(v, lowMask);
+  __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask);
+  __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+  return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+// Carry-save adder: h holds carries and l holds sums
+TARGET_AVX2 inline void CSA_AVX2(__m256i& h, __m256i& l, __m256i a, __m256i b, __m256i c) {
+  __m256i u = _mm256_xor_si256(a, b);
+  h = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+  l = _mm256_xor_si256(u, c);
+}
+
+template <BitOp op>
+TARGET_AVX2 uint64_t BitCountAVX2(const uint32_t* a, const uint32_t* b, size_t qty) {
+  const size_t vecQty = qty / 8;
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i total = zero;
+  __m256i ones = zero, twos = zero, fours = zero, eights = zero, sixteens;
+  __m256i twosA, twosB, foursA, foursB, eightsA, eightsB;
+
+  size_t i = 0;
+  for (; i + 16 <= vecQty; i += 16) {
+    const uint32_t* pa = a + i * 8;
+    const uint32_t* pb = b + i * 8;
+    CSA_AVX2(twosA, ones, ones, LoadBitOpAVX2<op>(pa, pb), LoadBitOpAVX2<op>(pa + 8, pb + 8));
+    CSA_AVX2(twosB, ones, ones, LoadBitOpAVX2<op>(pa + 16, pb + 16), LoadBitOpAVX2<op>(pa + 24, pb + 24));
+    CSA_AVX2(foursA, twos, twos, twosA, twosB);
+    CSA_AVX2(twosA, ones, ones, LoadBitOpAVX2<op>(pa + 32, pb + 32), LoadBitOpAVX2<op>(pa + 40, pb + 40));
+    CSA_AVX2(twosB, ones, ones, LoadBitOpAVX2<op>(pa + 48, pb + 48), LoadBitOpAVX2<op>(pa + 56, pb + 56));
+    CSA_AVX2(foursB, twos, twos, twosA, twosB);
+    CSA_AVX2(eightsA, fours, fours, foursA, foursB);
+    CSA_AVX2(twosA, ones, ones, LoadBitOpAVX2<op>(pa + 64, pb + 64), LoadBitOpAVX2<op>(pa + 72, pb + 72));
+    CSA_AVX2(twosB, ones, ones, LoadBitOpAVX2<op>(pa + 80, pb + 80), LoadBitOpAVX2<op>(pa + 88, pb + 88));
+    CSA_AVX2(foursA, twos, twos, twosA, twosB);
+    CSA_AVX2(twosA, ones, ones, LoadBitOpAVX2<op>(pa + 96, pb + 96), LoadBitOpAVX2<op>(pa + 104, pb + 104));
+    CSA_AVX2(twosB, ones, ones, LoadBitOpAVX2<op>(pa + 112, pb + 112), LoadBitOpAVX2<op>(pa + 120, pb + 120));
+    CSA_AVX2(foursB, twos, twos, twosA, twosB);
+    CSA_AVX2(eightsB, fours, fours, foursA, foursB);
+    CSA_AVX2(sixteens, eights, eights, eightsA, eightsB);
+
+    total = _mm256_add_epi64(total, PopcountAVX2(sixteens));
+  }
+
+  total = _mm256_slli_epi64(total, 4);
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(PopcountAVX2(eights), 3));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(PopcountAVX2(fours), 2));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(PopcountAVX2(twos), 1));
+  total = _mm256_add_epi64(total, PopcountAVX2(ones));
+
+  for (; i < vecQty; ++i) {
+    total = _mm256_add_epi64(total, PopcountAVX2(LoadBitOpAVX2<op>(a + i * 8, b + i * 8)));
+  }
+
+  uint64_t PORTABLE_ALIGN32 TmpRes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(TmpRes), total);
+  uint64_t res = TmpRes[0] + TmpRes[1] + TmpRes[2] + TmpRes[3];
+
+  for (size_t k = vecQty * 8; k < qty; ++k) {
+    res += __builtin_popcount(ApplyBitOp<op>(a[k], b[k]));
+  }
+  return res;
+}
+
+/*
+ * Both counts are accumulated in one loop. The Harley-Seal adder isn't used here:
+ * two adder trees need more registers than AVX2 has, and Jaccard codes are
+ * rarely long enough to fill 16-vector blocks.
+ */
+TARGET_AVX2 void BitAndOrCountAVX2(const uint32_t* a, const uint32_t* b, size_t qty,
+                                   uint64_t& andQty, uint64_t& orQty) {
+  const size_t vecQty = qty / 8;
+  __m256i totalAnd = _mm256_setzero_si256();
+  __m256i totalOr = _mm256_setzero_si256();
+  for (size_t i = 0; i < vecQty; ++i) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i * 8));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i * 8));
+    totalAnd = _mm256_add_epi64(totalAnd, PopcountAVX2(_mm256_and_si256(va, vb)));
+    totalOr = _mm256_add_epi64(totalOr, PopcountAVX2(_mm256_or_si256(va, vb)));
+  }
+
+  uint64_t PORTABLE_ALIGN32 TmpAnd[4];
+  uint64_t PORTABLE_ALIGN32 TmpOr[4];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(TmpAnd), totalAnd);
+  _mm256_store_si256(reinterpret_cast<__m256i*>(TmpOr), totalOr);
+  uint64_t resAnd = TmpAnd[0] + TmpAnd[1] + TmpAnd[2] + TmpAnd[3];
+  uint64_t resOr = TmpOr[0] + TmpOr[1] + TmpOr[2] + TmpOr[3];
+
+  for (size_t k = vecQty * 8; k < qty; ++k) {
+    resAnd += __builtin_popcount(a[k] & b[k]);
+    resOr += __builtin_popcount(a[k] | b[k]);
+  }
+  andQty = resAnd;
+  orQty = resOr;
+}
+#endif
+
+#ifdef BIT_POPCOUNT_AVX512
+template <BitOp op>
+TARGET_AVX512 inline __m512i ApplyBitOpAVX512(__m512i va, __m512i vb) {
+  return op == kBitXor ? _mm512_xor_si512(va, vb) :
+         (op == kBitAnd ? _mm512_and_si512(va, vb) : _mm512_or_si512(va, vb));
+}
+
+/*
+ * _mm512_reduce_add_epi64 extracts halves with the undefined pass-through register,
+ * which GCC 12 reports as uninitialized in target-attributed functions: zero-masked
+ * extracts are used instead.
+ */
+TARGET_AVX512 inline uint64_t HorizontalSumAVX512(__m512i v) {
+  __m256i sum4 = _mm256_add_epi64(_mm512_maskz_extracti64x4_epi64(0xf, v, 0),
+                                  _mm512_maskz_extracti64x4_epi64(0xf, v, 1));
+  __m128i sum2 = _mm_add_epi64(_mm256_castsi256_si128(sum4), _mm256_extracti128_si256(sum4, 1));
+  return static_cast<uint64_t>(_mm_cvtsi128_si64(sum2)) + static_cast<uint64_t>(_mm_extract_epi64(sum2, 1));
+}
+
+template <BitOp op>
+TARGET_AVX512 uint64_t BitCountAVX512(const uint32_t* a, const uint32_t* b, size_t qty) {
+  __m512i acc = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + 16 <= qty; i += 16) {
+    __m512i v = ApplyBitOpAVX512<op>(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+    acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+  }
+  if (i < qty) {
+    // Masked-out words are zeros, which don't change the count for any of the operations
+    __mmask16 mask = static_cast<__mmask16>((1u << (qty - i)) - 1);
+    __m512i v = ApplyBitOpAVX512<op>(_mm512_maskz_loadu_epi32(mask, a + i), _mm512_maskz_loadu_epi32(mask, b + i));
+    acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+  }
+  return HorizontalSumAVX512(acc);
+}
+
+TARGET_AVX512 void BitAndOrCountAVX512(const uint32_t* a, const uint32_t* b, size_t qty,
+                                       uint64_t& andQty, uint64_t& orQty) {
+  __m512i accAnd = _mm512_setzero_si512();
+  __m512i accOr = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + 16 <= qty; i += 16) {
+    __m512i va = _mm512_loadu_si512(a + i), vb = _mm512_loadu_si512(b + i);
+    accAnd = _mm512_add_epi64(accAnd, _mm512_popcnt_epi64(_mm512_and_si512(va, vb)));
+    accOr = _mm512_add_epi64(accOr, _mm512_popcnt_epi64(_mm512_or_si512(va, vb)));
+  }
+  if (i < qty) {
+    __mmask16 mask = static_cast<__mmask16>((1u << (qty - i)) - 1);
+    __m512i va = _mm512_maskz_loadu_epi32(mask, a + i), vb = _mm512_maskz_loadu_epi32(mask, b + i);
+    accAnd = _mm512_add_epi64(accAnd, _mm512_popcnt_epi64(_mm512_and_si512(va, vb)));
+    accOr = _mm512_add_epi64(accOr, _mm512_popcnt_epi64(_mm512_or_si512(va, vb)));
+  }
+  andQty = HorizontalSumAVX512(accAnd);
+  orQty = HorizontalSumAVX512(accOr);
+}
+
+/*
+ * For codes of up to 1024 bits, the query is loaded into registers only once.
+ */
+TARGET_AVX512 void BitHammingBatchAVX512(const uint32_t* pQuery, const uint32_t* const* pVects,
+                                         size_t n, size_t qty, unsigned* pOut) {
+  if (qty > 32) {
+    for (size_t i = 0; i < n; ++i) {
+      if (i + 1 < n) PREFETCH(reinterpret_cast<const char*>(pVects[i + 1]), _MM_HINT_T0);
+      pOut[i] = static_cast<unsigned>(BitCountAVX512<kBitXor>(pQuery, pVects[i], qty));
+    }
+    return;
+  }
+  const uint32_t  mask = qty >= 32 ? 0xffffffffu : ((1u << qty) - 1);
+  const __mmask16 mask0 = static_cast<__mmask16>(mask & 0xffff);
+  const __mmask16 mask1 = static_cast<__mmask16>(mask >> 16);
+  const __m512i   q0 = _mm512_maskz_loadu_epi32(mask0, pQuery);
+  const __m512i   q1 = _mm512_maskz_loadu_epi32(mask1, pQuery + 16);
+
+  for (size_t i = 0; i < n; ++i) {
+    if (i + 1 < n) PREFETCH(reinterpret_cast<const char*>(pVects[i + 1]), _MM_HINT_T0);
+    __m512i cnt = _mm512_popcnt_epi64(_mm512_xor_si512(q0, _mm512_maskz_loadu_epi32(mask0, pVects[i])));
+    if (mask1) {
+      cnt = _mm512_add_epi64(cnt, _mm512_popcnt_epi64(
+                                    _mm512_xor_si512(q1, _mm512_maskz_loadu_epi32(mask1, pVects[i] + 16))));
+    }
+    pOut[i] = static_cast<unsigned>(HorizontalSumAVX512(cnt));
+  }
+}
+#endif
+
+bool IsBitPopcountImplSupported(BitPopcountImpl impl) {
+  switch (impl) {
+    case kBitPopcountScalar: return true;
+#ifdef BIT_POPCOUNT_AVX2
+    case kBitPopcountAVX2:
+#ifdef BIT_POPCOUNT_RUNTIME_DISPATCH
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#else
+      return true;
+#endif
+#endif
+#ifdef BIT_POPCOUNT_AVX512
+    case kBitPopcountAVX512:
+#ifdef BIT_POPCOUNT_RUNTIME_DISPATCH
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+#else
+      return true;
+#endif
+#endif
+    default: return false;
+  }
+}
+
+static BitPopcountImpl SelectBitPopcountImpl() {
+  BitPopcountImpl impl = kBitPopcountScalar;
+  if (IsBitPopcountImplSupported(kBitPopcountAVX512)) impl = kBitPopcountAVX512;
+  else if (IsBitPopcountImplSupported(kBitPopcountAVX2)) impl = kBitPopcountAVX2;
+  LOG(LIB_INFO) << "Bit-vector popcount implementation: " << GetBitPopcountImplName(impl);
+  return impl;
+}
+
+BitPopcountImpl GetBitPopcountImpl() {
+  static const BitPopcountImpl impl = SelectBitPopcountImpl();
+  return impl;
+}
+
+const char* GetBitPopcountImplName(BitPopcountImpl impl) {
+  switch (impl) {
+    case kBitPopcountScalar: return "scalar";
+    case kBitPopcountAVX2:   return "AVX2 Harley-Seal";
+    case kBitPopcountAVX512: return "AVX512-VPOPCNTDQ";
+  }
+  return "unknown";
+}
+
+template <BitOp op>
+static BitCountFunc GetBitCountFunc(BitPopcountImpl impl) {
+  CHECK_MSG(IsBitPopcountImplSupported(impl),
+            string("Popcount implementation isn't supported: ") + GetBitPopcountImplName(impl));
+  switch (impl) {
+#ifdef BIT_POPCOUNT_AVX2
+    case kBitPopcountAVX2:   return BitCountAVX2<op>;
+#endif
+#ifdef BIT_POPCOUNT_AVX512
+    case kBitPopcountAVX512: return BitCountAVX512<op>;
+#endif
+    default:                 return BitCountScalar<op>;
+  }
+}
+
+static BitAndOrCountFunc GetBitAndOrCountFunc(BitPopcountImpl impl) {
+  CHECK_MSG(IsBitPopcountImplSupported(impl),
+            string("Popcount implementation isn't supported: ") + GetBitPopcountImplName(impl));
+  switch (impl) {
+#ifdef BIT_POPCOUNT_AVX2
+    case kBitPopcountAVX2:   return BitAndOrCountAVX2;
+#endif
+#ifdef BIT_POPCOUNT_AVX512
+    case kBitPopcountAVX512: return BitAndOrCountAVX512;
+#endif
+    default:                 return BitAndOrCountScalar;
+  }
+}
+
+unsigned BitHamming(BitPopcountImpl impl, const uint32_t* a, const uint32_t* b, size_t qty) {
+  return static_cast<unsigned>(GetBitCountFunc<kBitXor>(impl)(a, b, qty));
+}
+
+void BitAndOrCount(BitPopcountImpl impl, const uint32_t* a, const uint32_t* b, size_t qty,
+                   unsigned& andQty, unsigned& orQty) {
+  uint64_t resAnd, resOr;
+  GetBitAndOrCountFunc(impl)(a, b, qty, resAnd, resOr);
+  andQty = static_cast<unsigned>(resAnd);
+  orQty = static_cast<unsigned>(resOr);
+}
+
+unsigned BitHamming(const uint32_t* a, const uint32_t* b, size_t qty) {
+  static const BitCountFunc func = GetBitCountFunc<kBitXor>(GetBitPopcountImpl());
+  return static_cast<unsigned>(func(a, b, qty));
+}
+
+void BitAndOrCount(const uint32_t* a, const uint32_t* b, size_t qty, unsigned& andQty, unsigned& orQty) {
+  static const BitAndOrCountFunc func = GetBitAndOrCountFunc(GetBitPopcountImpl());
+  uint64_t resAnd, resOr;
+  func(a, b, qty, resAnd, resOr);
+  andQty = static_cast<unsigned>(resAnd);
+  orQty = static_cast<unsigned>(resOr);
+}
+
+void BitHammingBatch(BitPopcountImpl impl, const uint32_t* pQuery, const uint32_t* const* pVects,
+                     size_t n, size_t qty, unsigned* pOut) {
+#ifdef BIT_POPCOUNT_AVX512
+  if (impl == kBitPopcountAVX512) {
+    CHECK_MSG(IsBitPopcountImplSupported(impl), "AVX512-VPOPCNTDQ isn't supported");
+    BitHammingBatchAVX512(pQuery, pVects, n, qty, pOut);
+    return;
+  }
+#endif
+  const BitCountFunc func = GetBitCountFunc<kBitXor>(impl);
+  for (size_t i = 0; i < n; ++i) {
+    if (i + 1 < n) PREFETCH(reinterpret_cast<const char*>(pVects[i + 1]), _MM_HINT_T0);
+    pOut[i] = static_cast<unsigned>(func(pQuery, pVects[i], qty));
+  }
+}
+
+void BitHammingBatch(const uint32_t* pQuery, const uint32_t* const* pVects, size_t n, size_t qty, unsigned* pOut) {
+  BitHammingBatch(GetBitPopcountImpl(), pQuery, pVects, n, qty, pOut);
+}
+
+void BitAndOrCountBatch(const uint32_t* pQuery, const uint32_t* const* pVects, size_t n, size_t qty,
+                        unsigned* pAndQty, unsigned* pOrQty) {
+  static const BitAndOrCountFunc func = GetBitAndOrCountFunc(GetBitPopcountImpl());
+  for (size_t i = 0; i < n; ++i) {
+    if (i + 1 < n) PREFETCH(reinterpret_cast<const char*>(pVects[i + 1]), _MM_HINT_T0);
+    uint64_t resAnd, resOr;
+    func(pVects[i], pQuery, qty, resAnd, resOr);
+    pAndQty[i] = static_cast<unsigned>(resAnd);
+    pOrQty[i] = static_cast<unsigned>(resOr);
+  }
+}
+
+}  // namespace similarity
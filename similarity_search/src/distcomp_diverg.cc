@@ -21,6 +21,7 @@
 #include "logging.h"
 #include "utils.h"
 #include "pow.h"
+#include "simd_math.h"
 
 namespace similarity {
 
@@ -39,13 +40,59 @@ template <typename T> T alphaBetaDivergenceSlow(const T *x, const T *y,
 
 template  float alphaBetaDivergenceSlow(const float* x, const float* y, const int length, float alpha, float beta);
 
-template <typename T> T alphaBetaDivergenceFast(const T *x, const T *y, const int length, float alpha, float beta) {
-  T res = 0;
-  PowerProxyObject<T> powalphaPlus1(alpha + 1), powBeta(beta);
+/*
+ * Computes sum_i x[i]^p1 * y[i]^p2, as well as the same sum
+ * with arguments swapped, if the second output pointer is not NULL.
+ */
+template <typename T> static void PowProdSum(const T *x, const T *y, const int length, T p1, T p2,
+                                             T* pSum, T* pSumSwapped) {
+  PowerProxyObject<T> pow1(p1), pow2(p2);
+  T sum = 0, sumSwapped = 0;
 
   for (int i = 0; i < length; ++i) {
-    res += powalphaPlus1.pow(x[i])*powBeta.pow(y[i]);
+    sum += pow1.pow(x[i])*pow2.pow(y[i]);
+    if (pSumSwapped) sumSwapped += pow1.pow(y[i])*pow2.pow(x[i]);
   } 
+  *pSum = sum;
+  if (pSumSwapped) *pSumSwapped = sumSwapped;
+}
+
+// x^p1 * y^p2 = exp(p1 * log(x) + p2 * log(y)): two logarithms and one exponent
+static void PowProdSum(const float *x, const float *y, const int length, float p1, float p2,
+                float* pSum, float* pSumSwapped) {
+  float sum = 0, sumSwapped = 0;
+  int i = 0;
+#ifdef PORTABLE_SSE2
+  typedef SIMDMathOps<SIMDMathWidest> Ops;
+  typedef Ops::V                      V;
+  const int qty = Ops::kQty;
+  V   vp1 = Ops::Set1(p1), vp2 = Ops::Set1(p2);
+  V   vSum = Ops::Zero(), vSumSwapped = Ops::Zero();
+
+  for (; i + qty <= length; i += qty) {
+    V logX = LogSIMD(Ops::Load(x + i));
+    V logY = LogSIMD(Ops::Load(y + i));
+    vSum = Ops::Add(vSum, ExpSIMD(Ops::Add(Ops::Mul(vp1, logX), Ops::Mul(vp2, logY))));
+    if (pSumSwapped) {
+      vSumSwapped = Ops::Add(vSumSwapped, ExpSIMD(Ops::Add(Ops::Mul(vp1, logY), Ops::Mul(vp2, logX))));
+    }
+  }
+
+  sum = Ops::Sum(vSum);
+  sumSwapped = Ops::Sum(vSumSwapped);
+#endif
+  for (; i < length; ++i) {
+    float logX = LogPoly(x[i]), logY = LogPoly(y[i]);
+    sum += ExpPoly(p1 * logX + p2 * logY);
+    if (pSumSwapped) sumSwapped += ExpPoly(p1 * logY + p2 * logX);
+  }
+  *pSum = sum;
+  if (pSumSwapped) *pSumSwapped = sumSwapped;
+}
+
+template <typename T> T alphaBetaDivergenceFast(const T *x, const T *y, const int length, float alpha, float beta) {
+  T res = 0;
+  PowProdSum(x, y, length, T(alpha + 1), T(beta), &res, static_cast<T*>(NULL));
   return res;
 }
 
@@ -66,14 +113,9 @@ template <typename T> T alphaBetaDivergenceSlowProxy(const T *x, const T *y,
 template  float alphaBetaDivergenceSlowProxy(const float* x, const float* y, const int length, float alpha, float beta);
 
 template <typename T> T alphaBetaDivergenceFastProxy(const T *x, const T *y, const int length, float alpha, float beta) {
-  PowerProxyObject<T> powalphaPlus1(alpha + 1), powBeta(beta);
-  T res = 0;
-
-  for (int i = 0; i < length; ++i) {
-    res += powalphaPlus1.pow(x[i])* powBeta.pow(y[i]) + 
-           powalphaPlus1.pow(y[i])* powBeta.pow(x[i]) * 0.5;
-  } 
-  return res;
+  T sum = 0, sumSwapped = 0;
+  PowProdSum(x, y, length, T(alpha + 1), T(beta), &sum, &sumSwapped);
+  return (sum + sumSwapped) * T(0.5);
 }
 
 template  float alphaBetaDivergenceFastProxy(const float* x, const float* y, const int length, float alpha, float beta);
@@ -94,14 +136,43 @@ template <typename T> T renyiDivergenceSlow(const T *x, const T *y,
 
 template  float renyiDivergenceSlow(const float* x, const float* y, const int length, float alpha);
 
-template <typename T> T renyiDivergenceFast(const T *x, const T *y, const int length, float alpha) {
-  float t = alpha-1; 
+// Computes sum_i x[i] * (x[i]/y[i])^t
+template <typename T> static T RenyiSum(const T *x, const T *y, const int length, T t) {
   PowerProxyObject<T> powAlphaMinusOne(t);
   T sum = 0;
-  T eps = -1e-6;
   for (int i = 0; i < length; ++i) {
     sum += x[i]*powAlphaMinusOne.pow(x[i]/y[i]);
   } 
+  return sum;
+}
+
+static float RenyiSum(const float *x, const float *y, const int length, float t) {
+  float sum = 0;
+  int i = 0;
+#ifdef PORTABLE_SSE2
+  typedef SIMDMathOps<SIMDMathWidest> Ops;
+  typedef Ops::V                      V;
+  const int qty = Ops::kQty;
+  V   vt = Ops::Set1(t);
+  V   vSum = Ops::Zero();
+
+  for (; i + qty <= length; i += qty) {
+    V vx = Ops::Load(x + i);
+    vSum = Ops::Add(vSum, Ops::Mul(vx, PowSIMD(Ops::Div(vx, Ops::Load(y + i)), vt)));
+  }
+
+  sum = Ops::Sum(vSum);
+#endif
+  for (; i < length; ++i) {
+    sum += x[i] * PowPoly(x[i]/y[i], t);
+  }
+  return sum;
+}
+
+template <typename T> T renyiDivergenceFast(const T *x, const T *y, const int length, float alpha) {
+  float t = alpha-1; 
+  T sum = RenyiSum(x, y, length, T(t));
+  T eps = -1e-6;
   float res = 1/t * log(sum);
   CHECK_MSG(res >= eps, "Expected a non-negative result, but got " + ConvertToString(res) + " for alpha="  + ConvertToString(alpha));
   // Might be slightly negative due to rounding errors
@@ -17,6 +17,8 @@
 #include <stdexcept>
 
 #include "distcomp.h"
+#include "distcomp_edist.h"
+#include "portable_popcount.h"
 #include "string.h"
 #include "utils.h"
 
@@ -76,4 +78,180 @@ template <class T> int levenshtein(const T* p1, size_t len1, const T* p2, size_t
 template int levenshtein<char>(const char* p1, size_t len1, const char* p2, size_t len2);
 template int levenshtein<char32_t>(const char32_t* p1, size_t len1, const char32_t* p2, size_t len2);
 
+/*
+ * Computes the next column of one 64-bit block of the DP matrix.
+ * Pv/Mv are vertical +1/-1 differences, Eq is the match mask of the text character,
+ * hin is the horizontal difference entering the block from above.
+ * Returns the horizontal difference at the row selected by outMask.
+ */
+static inline int LevenAdvanceBlock(uint64_t& Pv, uint64_t& Mv, uint64_t Eq, int hin, uint64_t outMask) {
+  uint64_t Xv = Eq | Mv;
+  if (hin < 0) Eq |= 1;
+  uint64_t Xh = (((Eq & Pv) + Pv) ^ Pv) | Eq;
+  uint64_t Ph = Mv | ~(Xh | Pv);
+  uint64_t Mh = Pv & Xh;
+
+  int hout = (Ph & outMask) ? 1 : ((Mh & outMask) ? -1 : 0);
+
+  Ph <<= 1;
+  Mh <<= 1;
+  if (hin < 0) Mh |= 1;
+  else if (hin > 0) Ph |= 1;
+
+  Pv = Mh | ~(Xv | Ph);
+  Mv = Ph & Xv;
+
+  return hout;
+}
+
+// The sum of vertical differences in the rows selected by the mask
+static inline int LevenVertDiffSum(uint64_t Pv, uint64_t Mv, uint64_t mask) {
+  return int(__builtin_popcountll(Pv & mask)) - int(__builtin_popcountll(Mv & mask));
+}
+
+/*
+ * peq contains blockQty match-mask words for every text character.
+ * The length of the pattern m is > 0, Pv, Mv, and score have blockQty elements.
+ */
+template <bool bounded>
+static int LevenBitParallelIntern(const uint64_t* peq, size_t blockQty, size_t m,
+                                  const unsigned char* text, size_t n, int maxDist,
+                                  uint64_t* Pv, uint64_t* Mv, int* score) {
+  const uint64_t lastRowMask = uint64_t(1) << ((m - 1) % 64);
+  const uint64_t highBitMask = uint64_t(1) << 63;
+
+  if (blockQty == 1) {
+    uint64_t Pv0 = ~uint64_t(0), Mv0 = 0;
+    int      res = int(m);
+
+    for (size_t j = 0; j < n; ++j) {
+      res += LevenAdvanceBlock(Pv0, Mv0, peq[text[j]], 1, lastRowMask);
+      if (bounded) {
+        // The row of the cell on the diagonal that ends in the bottom-right corner
+        ptrdiff_t d = ptrdiff_t(m + j + 1) - ptrdiff_t(n);
+        if (d > 0) {
+          uint64_t mask = d >= 64 ? ~uint64_t(0) : (uint64_t(1) << d) - 1;
+          int lowerBound = int(j + 1) + LevenVertDiffSum(Pv0, Mv0, mask);
+          if (lowerBound > maxDist) return lowerBound;
+        }
+      }
+    }
+
+    return res;
+  }
+
+  for (size_t b = 0; b < blockQty; ++b) {
+    Pv[b] = ~uint64_t(0);
+    Mv[b] = 0;
+    score[b] = int(min(64 * (b + 1), m));
+  }
+
+  for (size_t j = 0; j < n; ++j) {
+    const uint64_t* eq = peq + text[j] * blockQty;
+    // The first row of the DP matrix increases by one in each column
+    int h = 1;
+    for (size_t b = 0; b < blockQty; ++b) {
+      h = LevenAdvanceBlock(Pv[b], Mv[b], eq[b], h, b + 1 == blockQty ? lastRowMask : highBitMask);
+      score[b] += h;
+    }
+    if (bounded) {
+      ptrdiff_t d = ptrdiff_t(m + j + 1) - ptrdiff_t(n);
+      if (d > 0) {
+        size_t   b = size_t(d - 1) / 64;
+        size_t   bit = size_t(d - 1) % 64;
+        uint64_t mask = bit == 63 ? ~uint64_t(0) : (uint64_t(2) << bit) - 1;
+        int      lowerBound = (b ? score[b - 1] : int(j + 1)) + LevenVertDiffSum(Pv[b], Mv[b], mask);
+        if (lowerBound > maxDist) return lowerBound;
+      }
+    }
+  }
+
+  return score[blockQty - 1];
+}
+
+template <bool bounded>
+static int LevenBitParallelWithPeq(const uint64_t* peq, size_t blockQty, size_t m,
+                                   const unsigned char* text, size_t n, int maxDist) {
+  if (!m) return int(n);
+
+  if (bounded) {
+    size_t lenDiff = m > n ? m - n : n - m;
+    if (maxDist < 0 || lenDiff > size_t(maxDist)) return int(lenDiff);
+  }
+
+  if (blockQty <= LEVEN_BIT_PARALLEL_STACK_BLOCK_QTY) {
+    uint64_t Pv[LEVEN_BIT_PARALLEL_STACK_BLOCK_QTY], Mv[LEVEN_BIT_PARALLEL_STACK_BLOCK_QTY];
+    int      score[LEVEN_BIT_PARALLEL_STACK_BLOCK_QTY];
+    return LevenBitParallelIntern<bounded>(peq, blockQty, m, text, n, maxDist, Pv, Mv, score);
+  }
+
+  vector<uint64_t> Pv(blockQty), Mv(blockQty);
+  vector<int>      score(blockQty);
+  return LevenBitParallelIntern<bounded>(peq, blockQty, m, text, n, maxDist, &Pv[0], &Mv[0], &score[0]);
+}
+
+template <bool bounded>
+static int LevenBitParallel(const char* p1, size_t len1, const char* p2, size_t len2, int maxDist) {
+  // The shorter string is the pattern: this minimizes the number of blocks
+  if (len1 > len2) {
+    swap(p1, p2);
+    swap(len1, len2);
+  }
+  if (!len1) return int(len2);
+
+  const unsigned char* pattern = reinterpret_cast<const unsigned char*>(p1);
+  const unsigned char* text = reinterpret_cast<const unsigned char*>(p2);
+  const size_t         blockQty = (len1 + 63) / 64;
+
+  uint64_t         aStackBuf[256 * LEVEN_BIT_PARALLEL_STACK_BLOCK_QTY];
+  vector<uint64_t> memBuf;
+  uint64_t*        peq = aStackBuf;
+
+  if (blockQty > LEVEN_BIT_PARALLEL_STACK_BLOCK_QTY) {
+    memBuf.resize(256 * blockQty);
+    peq = &memBuf[0];
+  } else {
+    /*
+     * Only masks of characters that occur in the text are read.
+     * Zeroing only these (and pattern characters) is cheaper than
+     * clearing the whole table for short strings.
+     */
+    for (size_t i = 0; i < len2; ++i) {
+      for (size_t b = 0; b < blockQty; ++b) peq[text[i] * blockQty + b] = 0;
+    }
+    for (size_t i = 0; i < len1; ++i) {
+      for (size_t b = 0; b < blockQty; ++b) peq[pattern[i] * blockQty + b] = 0;
+    }
+  }
+  for (size_t i = 0; i < len1; ++i) {
+    peq[pattern[i] * blockQty + i / 64] |= uint64_t(1) << (i % 64);
+  }
+
+  return LevenBitParallelWithPeq<bounded>(peq, blockQty, len1, text, len2, maxDist);
+}
+
+int levenshteinBitParallel(const char* p1, size_t len1, const char* p2, size_t len2) {
+  return LevenBitParallel<false>(p1, len1, p2, len2, 0);
+}
+
+int levenshteinBitParallelBounded(const char* p1, size_t len1, const char* p2, size_t len2, int maxDist) {
+  return LevenBitParallel<true>(p1, len1, p2, len2, maxDist);
+}
+
+LevenshteinBitParallel::LevenshteinBitParallel(const char* pattern, size_t len)
+    : len_(len), blockQty_((len + 63) / 64), peq_(256 * blockQty_) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(pattern);
+  for (size_t i = 0; i < len; ++i) {
+    peq_[p[i] * blockQty_ + i / 64] |= uint64_t(1) << (i % 64);
+  }
+}
+
+int LevenshteinBitParallel::DistanceBounded(const char* text, size_t len, int maxDist) const {
+  const unsigned char* t = reinterpret_cast<const unsigned char*>(text);
+  if (maxDist == INT32_MAX) {
+    return LevenBitParallelWithPeq<false>(peq_.data(), blockQty_, len_, t, len, maxDist);
+  }
+  return LevenBitParallelWithPeq<true>(peq_.data(), blockQty_, len_, t, len, maxDist);
+}
+
 }
@@ -0,0 +1,385 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <string>
+
+#include "portable_intrinsics.h"
+#include "distcomp.h"
+#include "half_float.h"
+#include "logging.h"
+
+namespace similarity {
+
+using namespace std;
+
+/*
+ * Kernels for vectors of fp16 and bf16 numbers:
+ *
+ * 1) Scalar: elements are converted one by one.
+ * 2) AVX2: fp16 numbers are converted by F16C instructions, bf16 numbers
+ *    are zero-extended and shifted, products are accumulated using FMA.
+ * 3) AVX-512: the same as AVX2, but 16 numbers at a time,
+ *    tails are processed using masked loads.
+ * 4) AVX-512 with the BF16 extension: scalar products of bf16 vectors
+ *    are computed by VDPBF16PS (32 pairs per instruction) without any conversion.
+ *    Denormal bf16 numbers are treated as zeros. The L2 distance and all
+ *    fp16 distances are computed as in (3).
+ *
+ * As in distcomp_bit.cc, with GCC and Clang on x86, all the variants are compiled
+ * and the best one is chosen at run time. Other compilers use only
+ * variants enabled at compile time.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define HALF_FLOAT_RUNTIME_DISPATCH
+#define HALF_FLOAT_AVX2
+#define HALF_FLOAT_AVX512
+#define TARGET_HALF_AVX2        __attribute__((target("avx2,fma,f16c")))
+#define TARGET_HALF_AVX512      __attribute__((target("avx512f,avx512bw,avx512vl")))
+// Older compilers don't know the BF16 extension
+#if (defined(__clang__) && __clang_major__ >= 9) || (!defined(__clang__) && __GNUC__ >= 10)
+#define HALF_FLOAT_AVX512_BF16
+#define TARGET_HALF_AVX512_BF16 __attribute__((target("avx512f,avx512bw,avx512vl,avx512bf16")))
+#endif
+#else
+#if defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)
+#define HALF_FLOAT_AVX2
+#endif
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VL__)
+#define HALF_FLOAT_AVX512
+#endif
+#if defined(HALF_FLOAT_AVX512) && defined(__AVX512BF16__)
+#define HALF_FLOAT_AVX512_BF16
+#endif
+#define TARGET_HALF_AVX2
+#define TARGET_HALF_AVX512
+#define TARGET_HALF_AVX512_BF16
+#endif
+
+/*
+ * A kernel computes one sum (squared differences or products) or, for the normalized
+ * scalar product, three sums: the product and two squared norms.
+ */
+enum HalfSumOp { kHalfSumL2Sqr, kHalfSumDot, kHalfSumNormDot };
+
+typedef void (*HalfSumFunc)(const uint16_t* a, const uint16_t* b, size_t qty, float* pRes);
+
+template <HalfFloatType type, HalfSumOp op>
+void HalfSumScalar(const uint16_t* a, const uint16_t* b, size_t qty, float* pRes) {
+  float sum = 0, sumSquare1 = 0, sumSquare2 = 0;
+  for (size_t i = 0; i < qty; ++i) {
+    float x = HalfToFloat<type>(a[i]);
+    float y = HalfToFloat<type>(b[i]);
+    if (op == kHalfSumL2Sqr) {
+      float diff = x - y;
+      sum += diff * diff;
+    } else {
+      sum += x * y;
+      if (op == kHalfSumNormDot) {
+        sumSquare1 += x * x;
+        sumSquare2 += y * y;
+      }
+    }
+  }
+  pRes[0] = sum;
+  if (op == kHalfSumNormDot) {
+    pRes[1] = sumSquare1;
+    pRes[2] = sumSquare2;
+  }
+}
+
+#ifdef HALF_FLOAT_AVX2
+template <HalfFloatType type>
+TARGET_HALF_AVX2 inline __m256 LoadHalfAVX2(const uint16_t* p) {
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  if (type == kHalfFloatFP16) return _mm256_cvtph_ps(v);
+  return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(v), 16));
+}
+
+TARGET_HALF_AVX2 inline float HorizontalSumAVX2(__m256 v) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+  return _mm_cvtss_f32(sum);
+}
+
+template <HalfFloatType type, HalfSumOp op>
+TARGET_HALF_AVX2 void HalfSumAVX2(const uint16_t* a, const uint16_t* b, size_t qty, float* pRes) {
+  __m256 sum = _mm256_setzero_ps(), sumSquare1 = sum, sumSquare2 = sum;
+  size_t i = 0;
+  for (; i + 8 <= qty; i += 8) {
+    __m256 x = LoadHalfAVX2<type>(a + i);
+    __m256 y = LoadHalfAVX2<type>(b + i);
+    if (op == kHalfSumL2Sqr) {
+      __m256 diff = _mm256_sub_ps(x, y);
+      sum = _mm256_fmadd_ps(diff, diff, sum);
+    } else {
+      sum = _mm256_fmadd_ps(x, y, sum);
+      if (op == kHalfSumNormDot) {
+        sumSquare1 = _mm256_fmadd_ps(x, x, sumSquare1);
+        sumSquare2 = _mm256_fmadd_ps(y, y, sumSquare2);
+      }
+    }
+  }
+  float tail[3];
+  HalfSumScalar<type, op>(a + i, b + i, qty - i, tail);
+  pRes[0] = HorizontalSumAVX2(sum) + tail[0];
+  if (op == kHalfSumNormDot) {
+    pRes[1] = HorizontalSumAVX2(sumSquare1) + tail[1];
+    pRes[2] = HorizontalSumAVX2(sumSquare2) + tail[2];
+  }
+}
+#endif
+
+#ifdef HALF_FLOAT_AVX512
+/*
+ * AVX-512 kernels use only zero-masking (maskz) forms of intrinsics, which don't merge into
+ * an undefined register: with target attributes, GCC 12 reports such registers as uninitialized.
+ */
+TARGET_HALF_AVX512 inline float HorizontalSumAVX512(__m512 v) {
+  // Even _mm512_castps512_ps256 is an unmasked extract in GCC 12
+  __m256 lo = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xff, _mm512_castps_pd(v), 0));
+  __m256 hi = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xff, _mm512_castps_pd(v), 1));
+  __m256 sum8 = _mm256_add_ps(lo, hi);
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+  return _mm_cvtss_f32(sum);
+}
+
+// Masked-out elements are zeros
+template <HalfFloatType type>
+TARGET_HALF_AVX512 inline __m512 LoadHalfAVX512(const uint16_t* p, __mmask16 mask) {
+  __m256i v = _mm256_maskz_loadu_epi16(mask, p);
+  if (type == kHalfFloatFP16) return _mm512_maskz_cvtph_ps(mask, v);
+  return _mm512_castsi512_ps(_mm512_maskz_slli_epi32(mask, _mm512_maskz_cvtepu16_epi32(mask, v), 16));
+}
+
+template <HalfFloatType type, HalfSumOp op>
+TARGET_HALF_AVX512 inline void HalfSumStepAVX512(const uint16_t* a, const uint16_t* b, __mmask16 mask,
+                                                 __m512& sum, __m512& sumSquare1, __m512& sumSquare2) {
+  __m512 x = LoadHalfAVX512<type>(a, mask);
+  __m512 y = LoadHalfAVX512<type>(b, mask);
+  if (op == kHalfSumL2Sqr) {
+    __m512 diff = _mm512_sub_ps(x, y);
+    sum = _mm512_fmadd_ps(diff, diff, sum);
+  } else {
+    sum = _mm512_fmadd_ps(x, y, sum);
+    if (op == kHalfSumNormDot) {
+      sumSquare1 = _mm512_fmadd_ps(x, x, sumSquare1);
+      sumSquare2 = _mm512_fmadd_ps(y, y, sumSquare2);
+    }
+  }
+}
+
+template <HalfFloatType type, HalfSumOp op>
+TARGET_HALF_AVX512 void HalfSumAVX512(const uint16_t* a, const uint16_t* b, size_t qty, float* pRes) {
+  __m512 sum = _mm512_setzero_ps(), sumSquare1 = sum, sumSquare2 = sum;
+  size_t i = 0;
+  for (; i + 16 <= qty; i += 16) {
+    HalfSumStepAVX512<type, op>(a + i, b + i, 0xffff, sum, sumSquare1, sumSquare2);
+  }
+  if (i < qty) {
+    HalfSumStepAVX512<type, op>(a + i, b + i, __mmask16((1U << (qty - i)) - 1), sum, sumSquare1, sumSquare2);
+  }
+  pRes[0] = HorizontalSumAVX512(sum);
+  if (op == kHalfSumNormDot) {
+    pRes[1] = HorizontalSumAVX512(sumSquare1);
+    pRes[2] = HorizontalSumAVX512(sumSquare2);
+  }
+}
+#endif
+
+#ifdef HALF_FLOAT_AVX512_BF16
+template <HalfSumOp op>
+TARGET_HALF_AVX512_BF16 inline void BF16DotStepAVX512(__m512i x, __m512i y,
+                                                      __m512& sum, __m512& sumSquare1, __m512& sumSquare2) {
+  sum = _mm512_dpbf16_ps(sum, (__m512bh)x, (__m512bh)y);
+  if (op == kHalfSumNormDot) {
+    sumSquare1 = _mm512_dpbf16_ps(sumSquare1, (__m512bh)x, (__m512bh)x);
+    sumSquare2 = _mm512_dpbf16_ps(sumSquare2, (__m512bh)y, (__m512bh)y);
+  }
+}
+
+// Only scalar products (kHalfSumDot and kHalfSumNormDot) of bf16 vectors
+template <HalfSumOp op>
+TARGET_HALF_AVX512_BF16 void BF16DotAVX512(const uint16_t* a, const uint16_t* b, size_t qty, float* pRes) {
+  __m512 sum = _mm512_setzero_ps(), sumSquare1 = sum, sumSquare2 = sum;
+  size_t i = 0;
+  for (; i + 32 <= qty; i += 32) {
+    BF16DotStepAVX512<op>(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i), sum, sumSquare1, sumSquare2);
+  }
+  if (i < qty) {
+    __mmask32 mask = __mmask32((1U << (qty - i)) - 1);
+    BF16DotStepAVX512<op>(_mm512_maskz_loadu_epi16(mask, a + i), _mm512_maskz_loadu_epi16(mask, b + i),
+                          sum, sumSquare1, sumSquare2);
+  }
+  pRes[0] = HorizontalSumAVX512(sum);
+  if (op == kHalfSumNormDot) {
+    pRes[1] = HorizontalSumAVX512(sumSquare1);
+    pRes[2] = HorizontalSumAVX512(sumSquare2);
+  }
+}
+#endif
+
+bool IsHalfFloatImplSupported(HalfFloatImpl impl) {
+  switch (impl) {
+    case kHalfFloatScalar: return true;
+#ifdef HALF_FLOAT_AVX2
+    case kHalfFloatAVX2:
+#ifdef HALF_FLOAT_RUNTIME_DISPATCH
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+#else
+      return true;
+#endif
+#endif
+#ifdef HALF_FLOAT_AVX512
+    case kHalfFloatAVX512:
+#ifdef HALF_FLOAT_RUNTIME_DISPATCH
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+             __builtin_cpu_supports("avx512vl");
+#else
+      return true;
+#endif
+#endif
+#ifdef HALF_FLOAT_AVX512_BF16
+    case kHalfFloatAVX512BF16:
+#ifdef HALF_FLOAT_RUNTIME_DISPATCH
+      __builtin_cpu_init();
+      return IsHalfFloatImplSupported(kHalfFloatAVX512) && __builtin_cpu_supports("avx512bf16");
+#else
+      return true;
+#endif
+#endif
+    default: return false;
+  }
+}
+
+static HalfFloatImpl SelectHalfFloatImpl() {
+  HalfFloatImpl impl = kHalfFloatScalar;
+  if (IsHalfFloatImplSupported(kHalfFloatAVX512BF16)) impl = kHalfFloatAVX512BF16;
+  else if (IsHalfFloatImplSupported(kHalfFloatAVX512)) impl = kHalfFloatAVX512;
+  else if (IsHalfFloatImplSupported(kHalfFloatAVX2)) impl = kHalfFloatAVX2;
+  LOG(LIB_INFO) << "fp16/bf16 vector implementation: " << GetHalfFloatImplName(impl);
+  return impl;
+}
+
+HalfFloatImpl GetHalfFloatImpl() {
+  static const HalfFloatImpl impl = SelectHalfFloatImpl();
+  return impl;
+}
+
+const char* GetHalfFloatImplName(HalfFloatImpl impl) {
+  switch (impl) {
+    case kHalfFloatScalar:     return "scalar";
+    case kHalfFloatAVX2:       return "AVX2+F16C";
+    case kHalfFloatAVX512:     return "AVX512";
+    case kHalfFloatAVX512BF16: return "AVX512-BF16";
+  }
+  return "unknown";
+}
+
+template <HalfFloatType type, HalfSumOp op>
+static HalfSumFunc GetHalfSumFunc(HalfFloatImpl impl) {
+  CHECK_MSG(IsHalfFloatImplSupported(impl),
+            string("fp16/bf16 implementation isn't supported: ") + GetHalfFloatImplName(impl));
+#ifdef HALF_FLOAT_AVX512_BF16
+  if (impl == kHalfFloatAVX512BF16 && type == kHalfFloatBF16 && op != kHalfSumL2Sqr) return BF16DotAVX512<op>;
+#endif
+#ifdef HALF_FLOAT_AVX512
+  if (impl == kHalfFloatAVX512 || impl == kHalfFloatAVX512BF16) return HalfSumAVX512<type, op>;
+#endif
+#ifdef HALF_FLOAT_AVX2
+  if (impl == kHalfFloatAVX2) return HalfSumAVX2<type, op>;
+#endif
+  return HalfSumScalar<type, op>;
+}
+
+static float NormScalarProductFromSums(const float* pSums) {
+  const float eps = numeric_limits<float>::min() * 2;
+
+  if (pSums[1] < eps || pSums[2] < eps) return 0;
+
+  return max(float(-1), min(float(1), pSums[0] / sqrt(pSums[1]) / sqrt(pSums[2])));
+}
+
+template <HalfFloatType type>
+float L2SqrHalf(HalfFloatImpl impl, const uint16_t* pVect1, const uint16_t* pVect2, size_t qty) {
+  float res;
+  GetHalfSumFunc<type, kHalfSumL2Sqr>(impl)(pVect1, pVect2, qty, &res);
+  return res;
+}
+
+template <HalfFloatType type>
+float ScalarProductHalf(HalfFloatImpl impl, const uint16_t* pVect1, const uint16_t* pVect2, size_t qty) {
+  float res;
+  GetHalfSumFunc<type, kHalfSumDot>(impl)(pVect1, pVect2, qty, &res);
+  return res;
+}
+
+template <HalfFloatType type>
+float NormScalarProductHalf(HalfFloatImpl impl, const uint16_t* pVect1, const uint16_t* pVect2, size_t qty) {
+  float sums[3];
+  GetHalfSumFunc<type, kHalfSumNormDot>(impl)(pVect1, pVect2, qty, sums);
+  return NormScalarProductFromSums(sums);
+}
+
+template <HalfFloatType type>
+float L2SqrHalf(const uint16_t* pVect1, const uint16_t* pVect2, size_t qty) {
+  static const HalfSumFunc func = GetHalfSumFunc<type, kHalfSumL2Sqr>(GetHalfFloatImpl());
+  float res;
+  func(pVect1, pVect2, qty, &res);
+  return res;
+}
+
+template <HalfFloatType type>
+float ScalarProductHalf(const uint16_t* pVect1, const uint16_t* pVect2, size_t qty) {
+  static const HalfSumFunc func = GetHalfSumFunc<type, kHalfSumDot>(GetHalfFloatImpl());
+  float res;
+  func(pVect1, pVect2, qty, &res);
+  return res;
+}
+
+template <HalfFloatType type>
+float NormScalarProductHalf(const uint16_t* pVect1, const uint16_t* pVect2, size_t qty) {
+  static const HalfSumFunc func = GetHalfSumFunc<type, kHalfSumNormDot>(GetHalfFloatImpl());
+  float sums[3];
+  func(pVect1, pVect2, qty, sums);
+  return NormScalarProductFromSums(sums);
+}
+
+template float L2SqrHalf<kHalfFloatFP16>(const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+template float L2SqrHalf<kHalfFloatBF16>(const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+template float ScalarProductHalf<kHalfFloatFP16>(const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+template float ScalarProductHalf<kHalfFloatBF16>(const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+template float NormScalarProductHalf<kHalfFloatFP16>(const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+template float NormScalarProductHalf<kHalfFloatBF16>(const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+
+template float L2SqrHalf<kHalfFloatFP16>(HalfFloatImpl impl, const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+template float L2SqrHalf<kHalfFloatBF16>(HalfFloatImpl impl, const uint16_t* pVect1, const uint16_t* pVect2, size_t qty);
+template float ScalarProductHalf<kHalfFloatFP16>(HalfFloatImpl impl, const uint16_t* pVect1, const uint16_t* pVect2,
+                                                 size_t qty);
+template float ScalarProductHalf<kHalfFloatBF16>(HalfFloatImpl impl, const uint16_t* pVect1, const uint16_t* pVect2,
+                                                 size_t qty);
+template float NormScalarProductHalf<kHalfFloatFP16>(HalfFloatImpl impl, const uint16_t* pVect1, const uint16_t* pVect2,
+                                                     size_t qty);
+template float NormScalarProductHalf<kHalfFloatBF16>(HalfFloatImpl impl, const uint16_t* pVect1, const uint16_t* pVect2,
+                                                     size_t qty);
+
+}  // namespace similarity
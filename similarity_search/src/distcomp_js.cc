@@ -17,6 +17,7 @@
 #include "utils.h"
 
 #include "portable_intrinsics.h"
+#include "simd_math.h"
 
 #include <cstdlib>
 #include <cstdint>
@@ -88,6 +89,60 @@ T JSPrecomp(const T* pVect1, const T* pVect2, size_t qty) {
 
 template float JSPrecomp<float>(const float* pVect1, const float* pVect2, size_t qty);
 
+template <>
+float JSPrecompSIMD(const float* pVect1, const float* pVect2, size_t qty)
+{
+#ifndef PORTABLE_SSE2
+#pragma message WARN("JSPrecompSIMD<float>: SSE2 is not available, defaulting to pure C++ implementation!")
+    return JSPrecomp(pVect1, pVect2, qty);
+#else
+    typedef SIMDMathOps<SIMDMathWidest> Ops;
+    typedef Ops::V                      V;
+
+    size_t qtyV  = qty/Ops::kQty;
+
+    const float* pEnd2 = pVect1 + Ops::kQty  * qtyV;
+    const float* pEnd3 = pVect1 + qty;
+
+    const float* pVectLog1 = pVect1 + qty;
+    const float* pVectLog2 = pVect2 + qty;
+
+    V   v1, v2, m;
+    V   sum1  = Ops::Zero();
+    V   sum2  = Ops::Zero();
+    V   half  = Ops::Set1(0.5f);
+
+    while (pVect1 < pEnd2) {
+        v1      = Ops::Load(pVect1);     pVect1 += Ops::kQty;
+        v2      = Ops::Load(pVect2);     pVect2 += Ops::kQty;
+        sum1    = Ops::Add(sum1, Ops::Add(Ops::Mul(v1, Ops::Load(pVectLog1)),
+                                          Ops::Mul(v2, Ops::Load(pVectLog2))));
+        pVectLog1 += Ops::kQty; pVectLog2 += Ops::kQty;
+        /*
+         * If m is zero, LogSIMD returns log of the smallest normalized number,
+         * which is multiplied by zero: no need to check for zeros explicitly.
+         */
+        m       = Ops::Mul(half, Ops::Add(v1, v2));
+        sum2    = Ops::Add(sum2, Ops::Mul(m, LogSIMD(m)));
+    }
+
+    float res1 = Ops::Sum(sum1);
+    float res2 = Ops::Sum(sum2);
+
+    while (pVect1 < pEnd3) {
+        float m = 0.5f*(*pVect1 + *pVect2);
+        res1 += (*pVect1) * (*pVectLog1) + (*pVect2)*(*pVectLog2);
+        res2 += m * LogPoly(m);
+        pVect1++; pVect2++; pVectLog1++; pVectLog2++;
+    }
+
+    // Due to computation/rounding errors, we may get a small-magnitude negative number
+    return std::max(0.5f*res1 - res2, 0.0f);
+#endif
+}
+
+template float JSPrecompSIMD<float>(const float* pVect1, const float* pVect2, size_t qty);
+
 const unsigned LogQty = 65536;
 
 template <class T>
@@ -333,7 +333,7 @@ void ExperimentConfig<dist_t>::SelectTestSet(int SetNum) {
 template <typename dist_t>
 void ExperimentConfig<dist_t>::CopyExternal(const ObjectVector& src, ObjectVector& dst, size_t maxQty) {
   for (size_t i = 0; i < src.size() && i < maxQty; ++i) {
-    dst.push_back(src[i]->Clone());
+    dst.push_back(objArena_.Copy(src[i]));
   }
 }
 
@@ -350,14 +350,17 @@ void ExperimentConfig<dist_t>::ReadDataset() {
         "The set of query objects in non-empty, did you read the data set already?");
 
   if (pExternalData_) CopyExternal(*pExternalData_, origData_, maxNumData_);
-  else {
-    unique_ptr<DataFileInputState> inpState(space_.ReadDataset(origData_, tmp, datafile_, maxNumData_));
+  else if (IsMmapDatasetFile(datafile_)) {
+    ReadMmapDataset(space_, datafile_, objArena_, origData_, tmp, maxNumData_);
+  } else {
+    unique_ptr<DataFileInputState> inpState(space_.ReadDataset(origData_, tmp, datafile_, maxNumData_,
+                                                               0, &objArena_));
     space_.UpdateParamsFromFile(*inpState);
   }
 
   /*
    * Note!!! 
-   * The destructor of this class will delete pointers stored in OrigData & OrigQuery.
+   * This class frees objects whose pointers are stored in OrigData & OrigQuery (they are kept in the arena).
    * Applications should not delete objects whose pointers are stored in arrays:
    * 1) dataobjects 
    * 2) queryobjects.
@@ -366,8 +369,10 @@ void ExperimentConfig<dist_t>::ReadDataset() {
     dataobjects_ = origData_;
     if (pExternalQuery_) 
       CopyExternal(*pExternalQuery_, queryobjects_, maxNumQuery_);
+    else if (IsMmapDatasetFile(queryfile_))
+      ReadMmapDataset(space_, queryfile_, objArena_, queryobjects_, tmp, maxNumQueryToRun_);
     else 
-      space_.ReadDataset(queryobjects_, tmp, queryfile_, maxNumQueryToRun_);
+      space_.ReadDataset(queryobjects_, tmp, queryfile_, maxNumQueryToRun_, 0, &objArena_);
 
     origQuery_ = queryobjects_;
   } else {
@@ -0,0 +1,70 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include "known_space_dist.h"
+#include "space/space_lp.h"
+#include "space/space_scalar.h"
+#include "space/space_word_embed.h"
+
+namespace similarity {
+
+template <typename dist_t>
+void KnownSpaceDist<dist_t>::Init(const Space<dist_t>&, const ObjectVector&) {
+  type_ = kKnownDistNone;
+  dim_ = 0;
+}
+
+template <>
+void KnownSpaceDist<float>::Init(const Space<float>& space, const ObjectVector& data) {
+  type_ = kKnownDistNone;
+  dim_ = 0;
+
+  KnownDistType type = kKnownDistNone;
+
+  const SpaceLp<float>* pSpaceLp = dynamic_cast<const SpaceLp<float>*>(&space);
+  const WordEmbedSpace<float>* pSpaceEmbed = dynamic_cast<const WordEmbedSpace<float>*>(&space);
+
+  if (pSpaceLp != nullptr) {
+    if (pSpaceLp->getP() == 2) type = kKnownDistL2;
+  } else if (pSpaceEmbed != nullptr) {
+    type = pSpaceEmbed->GetDistType() == kEmbedDistL2 ? kKnownDistL2 : kKnownDistCosine;
+  } else if (dynamic_cast<const SpaceCosineSimilarity<float>*>(&space) != nullptr) {
+    type = kKnownDistCosine;
+  } else if (dynamic_cast<const SpaceAngularDistance<float>*>(&space) != nullptr) {
+    type = kKnownDistAngular;
+  } else if (dynamic_cast<const SpaceNegativeScalarProduct<float>*>(&space) != nullptr) {
+    type = kKnownDistNegDotProd;
+  }
+
+  if (type == kKnownDistNone || data.empty()) return;
+
+  /*
+   * HiddenDistance checks data lengths in every call,
+   * here we do it only once for the whole data set.
+   */
+  const size_t dataLen = data[0]->datalength();
+  if (dataLen == 0 || dataLen % sizeof(float) != 0) return;
+  for (const Object* pObj : data) {
+    if (pObj->datalength() != dataLen) return;
+  }
+
+  type_ = type;
+  dim_ = dataLen / sizeof(float);
+}
+
+template class KnownSpaceDist<float>;
+template class KnownSpaceDist<int>;
+template class KnownSpaceDist<short int>;
+
+}  // namespace similarity
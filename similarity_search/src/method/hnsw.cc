@@ -37,6 +37,8 @@
 #include "space.h"
 #include "space/space_lp.h"
 #include "space/space_scalar.h"
+#include "space/space_bit_hamming.h"
+#include "space/space_bit_jaccard.h"
 #include "thread_pool.h"
 #include "utils.h"
 
@@ -88,6 +90,19 @@ namespace similarity {
         return LInfNormSIMD(pVect1, pVect2, qty);
     }
 
+    /*
+     * Bit vectors keep the original number of bits in the last word,
+     * which doesn't take part in distance computation.
+     */
+    float BitHammingWrapper(const float *pVect1, const float *pVect2, size_t &qty, float *) {
+        return BitHamming(reinterpret_cast<const uint32_t *>(pVect1), reinterpret_cast<const uint32_t *>(pVect2), qty - 1);
+    }
+
+    float BitJaccardWrapper(const float *pVect1, const float *pVect2, size_t &qty, float *) {
+        return BitJaccard<float, uint32_t>(reinterpret_cast<const uint32_t *>(pVect1),
+                                           reinterpret_cast<const uint32_t *>(pVect2), qty - 1);
+    }
+
     EfficientDistFunc getDistFunc(DistFuncType funcType) {
         switch (funcType) {
             case kL2Sqr16Ext : return L2Sqr16Ext;
@@ -96,6 +111,8 @@ namespace similarity {
             case kNegativeDotProduct : return NegativeDotProduct;
             case kL1Norm : return L1NormWrapper;
             case kLInfNorm : return LInfNormWrapper;
+            case kBitHamming : return BitHammingWrapper;
+            case kBitJaccard : return BitJaccardWrapper;
         }
 
         return nullptr;
@@ -398,6 +415,14 @@ namespace similarity {
             vectorlength_ = ((dataSectionSize - 16) >> 2);
             LOG(LIB_INFO) << "Vector length=" << vectorlength_;
             dist_func_type_ = kNegativeDotProduct;
+        } else if (dynamic_cast<const SpaceBitHamming<dist_t, uint32_t>*>(&space_) != nullptr ||
+                   dynamic_cast<const SpaceBitJaccard<dist_t, uint32_t>*>(&space_) != nullptr) {
+            LOG(LIB_INFO) << "\nThe space is " << space_.StrDesc();
+            vectorlength_ = ((dataSectionSize - 16) >> 2);
+            LOG(LIB_INFO) << "Vector length (in 32-bit words)=" << vectorlength_
+                          << " popcount implementation: " << GetBitPopcountImplName(GetBitPopcountImpl());
+            dist_func_type_ = dynamic_cast<const SpaceBitHamming<dist_t, uint32_t>*>(&space_) != nullptr ?
+                              kBitHamming : kBitJaccard;
         }
 
         fstdistfunc_ = getDistFunc(dist_func_type_);
@@ -753,6 +778,14 @@ namespace similarity {
         CHECK_MSG(output, "Cannot open file '" + location + "' for writing");
         output.exceptions(ios::badbit | ios::failbit);
 
+        SaveIndexToStream(output);
+
+        output.close();
+    }
+
+    template <typename dist_t>
+    void
+    Hnsw<dist_t>::SaveIndexToStream(std::ostream &output) {
         unsigned int optimIndexFlag = data_level0_memory_ != nullptr;
 
         writeBinaryPOD(output, optimIndexFlag);
@@ -767,8 +800,6 @@ namespace similarity {
         } else {
             SaveOptimizedIndex(output);
         }
-
-        output.close();
     }
 
     template <typename dist_t>
@@ -1000,6 +1031,14 @@ namespace similarity {
 
         input.exceptions(ios::badbit | ios::failbit);
 
+        LoadIndexFromStream(input);
+
+        input.close();
+    }
+
+    template <typename dist_t>
+    void
+    Hnsw<dist_t>::LoadIndexFromStream(std::istream &input) {
 #if USE_TEXT_REGULAR_INDEX
         LoadRegularIndexText(input);
 #else
@@ -1013,7 +1052,6 @@ namespace similarity {
             LoadOptimizedIndex(input);
         }
 #endif
-        input.close();
 
         LOG(LIB_INFO) << "Finished loading index";
         visitedlistpool = new VisitedListPool(1, totalElementsStored_);
@@ -1086,6 +1124,10 @@ namespace similarity {
         provider = enterpoint_;
 
         const Object *currObj = provider->getData();
+        // unvisited neighbors, whose distances to the query are computed at once
+        vector<const Object *> candObjs;
+        vector<HnswNode *> candNodes;
+        vector<dist_t> candDists;
 
         dist_t d = query->DistanceObjLeft(currObj);
         dist_t curdist = d;
@@ -1096,15 +1138,22 @@ namespace similarity {
                 changed = false;
 
                 const vector<HnswNode *> &neighbor = curNode->getAllFriends(i);
+                candObjs.clear();
+                candNodes.clear();
                 for (auto iter = neighbor.begin(); iter != neighbor.end(); ++iter) {
                     PREFETCH((char *)(*iter)->getData(), _MM_HINT_T0);
+                    candObjs.push_back((*iter)->getData());
+                    candNodes.push_back(*iter);
                 }
-                for (auto iter = neighbor.begin(); iter != neighbor.end(); ++iter) {
-                    currObj = (*iter)->getData();
-                    d = query->DistanceObjLeft(currObj);
+                // distances to all the neighbors are computed at once
+                size_t candQty = candObjs.size();
+                candDists.resize(candQty);
+                query->DistanceObjLeftBatch(candObjs.data(), candQty, candDists.data());
+                for (size_t k = 0; k < candQty; ++k) {
+                    d = candDists[k];
                     if (d < curdist) {
                         curdist = d;
-                        curNode = *iter;
+                        curNode = candNodes[k];
                         changed = true;
                     }
                 }
@@ -1128,6 +1177,9 @@ namespace similarity {
         ////////////////////////////////////////////////////////////////////////////////
 
         while (!candidateQueue.empty()) {
+            // The result set always contains the best objects found so far
+            if (query->IsDeadlineExpired())
+                break;
             auto iter = candidateQueue.top(); // This one was already compared to the query
             const HnswNodeDistFarther<dist_t> &currEv = iter;
             // Check condition to end the search
@@ -1147,22 +1199,30 @@ namespace similarity {
                 PREFETCH((char *)(*iter)->getData(), _MM_HINT_T0);
                 PREFETCH((char *)(massVisited + (*iter)->getId()), _MM_HINT_T0);
             }
-            // calculate distance to each neighbor
+            candObjs.clear();
+            candNodes.clear();
             for (auto iter = neighbor.begin(); iter != neighbor.end(); ++iter) {
                 curId = (*iter)->getId();
 
                 if (!(massVisited[curId] == currentV)) {
                     massVisited[curId] = currentV;
-                    currObj = (*iter)->getData();
-                    d = query->DistanceObjLeft(currObj);
-                    if (closestDistQueue1.top().getDistance() > d || closestDistQueue1.size() < ef_) {
-                        {
-                            query->CheckAndAddToResult(d, currObj);
-                            candidateQueue.emplace(d, *iter);
-                            closestDistQueue1.emplace(d, *iter);
-                            if (closestDistQueue1.size() > ef_) {
-                                closestDistQueue1.pop();
-                            }
+                    candObjs.push_back((*iter)->getData());
+                    candNodes.push_back(*iter);
+                }
+            }
+            // calculate distances to all unvisited neighbors at once
+            size_t candQty = candObjs.size();
+            candDists.resize(candQty);
+            query->DistanceObjLeftBatch(candObjs.data(), candQty, candDists.data());
+            for (size_t k = 0; k < candQty; ++k) {
+                d = candDists[k];
+                if (closestDistQueue1.top().getDistance() > d || closestDistQueue1.size() < ef_) {
+                    {
+                        query->CheckAndAddToResult(d, candObjs[k]);
+                        candidateQueue.emplace(d, candNodes[k]);
+                        closestDistQueue1.emplace(d, candNodes[k]);
+                        if (closestDistQueue1.size() > ef_) {
+                            closestDistQueue1.pop();
                         }
                     }
                 }
@@ -1184,6 +1244,10 @@ namespace similarity {
         provider = enterpoint_;
 
         const Object *currObj = provider->getData();
+        // unvisited neighbors, whose distances to the query are computed at once
+        vector<const Object *> candObjs;
+        vector<HnswNode *> candNodes;
+        vector<dist_t> candDists;
 
         dist_t d = query->DistanceObjLeft(currObj);
         dist_t curdist = d;
@@ -1194,15 +1258,22 @@ namespace similarity {
                 changed = false;
 
                 const vector<HnswNode *> &neighbor = curNode->getAllFriends(i);
+                candObjs.clear();
+                candNodes.clear();
                 for (auto iter = neighbor.begin(); iter != neighbor.end(); ++iter) {
                     PREFETCH((char *)(*iter)->getData(), _MM_HINT_T0);
+                    candObjs.push_back((*iter)->getData());
+                    candNodes.push_back(*iter);
                 }
-                for (auto iter = neighbor.begin(); iter != neighbor.end(); ++iter) {
-                    currObj = (*iter)->getData();
-                    d = query->DistanceObjLeft(currObj);
+                // distances to all the neighbors are computed at once
+                size_t candQty = candObjs.size();
+                candDists.resize(candQty);
+                query->DistanceObjLeftBatch(candObjs.data(), candQty, candDists.data());
+                for (size_t k = 0; k < candQty; ++k) {
+                    d = candDists[k];
                     if (d < curdist) {
                         curdist = d;
-                        curNode = *iter;
+                        curNode = candNodes[k];
                         changed = true;
                     }
                 }
@@ -1227,6 +1298,9 @@ namespace similarity {
         ////////////////////////////////////////////////////////////////////////////////
 
         while (currElem < min(sortedArr.size(), ef_)) {
+            // On expiration, the best candidates found so far are returned
+            if (query->IsDeadlineExpired())
+                break;
             auto &e = queueData[currElem];
             CHECK(!e.used);
             e.used = true;
@@ -1246,21 +1320,29 @@ namespace similarity {
                 CHECK(curId >= 0 && curId < this->data_.size());
                 PREFETCH((char *)(massVisited + curId), _MM_HINT_T0);
             }
-            // calculate distance to each neighbor
+            candObjs.clear();
+            candNodes.clear();
             for (auto iter = neighbor.begin(); iter != neighbor.end(); ++iter) {
                 curId = (*iter)->getId();
 
                 if (!(massVisited[curId] == currentV)) {
                     massVisited[curId] = currentV;
-                    currObj = (*iter)->getData();
-                    d = query->DistanceObjLeft(currObj);
-
-                    if (d < topKey || sortedArr.size() < ef_) {
-                        CHECK_MSG(itemBuff.size() > itemQty,
-                                  "Perhaps a bug: buffer size is not enough " + 
-                                  ConvertToString(itemQty) + " >= " + ConvertToString(itemBuff.size()));
-                        itemBuff[itemQty++] = QueueItem(d, *iter);
-                    }
+                    candObjs.push_back((*iter)->getData());
+                    candNodes.push_back(*iter);
+                }
+            }
+            // calculate distances to all unvisited neighbors at once
+            size_t candQty = candObjs.size();
+            candDists.resize(candQty);
+            query->DistanceObjLeftBatch(candObjs.data(), candQty, candDists.data());
+            for (size_t k = 0; k < candQty; ++k) {
+                d = candDists[k];
+
+                if (d < topKey || sortedArr.size() < ef_) {
+                    CHECK_MSG(itemBuff.size() > itemQty,
+                              "Perhaps a bug: buffer size is not enough " + 
+                              ConvertToString(itemQty) + " >= " + ConvertToString(itemBuff.size()));
+                    itemBuff[itemQty++] = QueueItem(d, candNodes[k]);
                 }
             }
 
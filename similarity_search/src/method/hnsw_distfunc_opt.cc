@@ -104,6 +104,9 @@ namespace similarity {
         massVisited[curNodeNum] = currentV;
 
         while (!candidateQueuei.empty()) {
+            // The result set always contains the best objects found so far
+            if (query->IsDeadlineExpired())
+                break;
             EvaluatedMSWNodeInt<dist_t> currEv = candidateQueuei.top(); // This one was already compared to the query
 
             dist_t lowerBound = closestDistQueuei.top().getDistance();
@@ -209,6 +212,9 @@ namespace similarity {
         massVisited[curNodeNum] = currentV;
 
         while (currElem < min(sortedArr.size(), ef_)) {
+            // On expiration, the best candidates found so far are returned
+            if (query->IsDeadlineExpired())
+                break;
             auto &e = queueData[currElem];
             CHECK(!e.used);
             e.used = true;
@@ -602,17 +602,19 @@ void PivotNeighbInvertedIndex<dist_t>::GenSearch(QueryType* query, size_t K) con
       IncrementalQuickSelect<IntInt> quick_select(candidates);
 
       size_t scan_qty = min(db_scan, candidates.size());
+      size_t cand_tmp_qty = 0;
 
       for (size_t i = 0; i < scan_qty; ++i) {
         auto z = quick_select.GetNext();
         if (static_cast<size_t>(-z.first) >= min_times_) {
           const size_t idx = z.second;
           quick_select.Next();
-          if (!skip_checking_) query->CheckAndAddToResult(data_start[idx]);
+          tmp_cand[cand_tmp_qty++]=data_start[idx];
         } else {
           break;
         }
       }
+      if (!skip_checking_) query->CheckAndAddToResultBatch(&tmp_cand[0], cand_tmp_qty);
     } else {
       if (inv_proc_alg_ == kMap) {
         std::unordered_map<uint32_t, uint32_t> map_counter;
@@ -621,12 +623,14 @@ void PivotNeighbInvertedIndex<dist_t>::GenSearch(QueryType* query, size_t K) con
             map_counter[p]++;
           }
         }
+        size_t cand_tmp_qty = 0;
         for (auto& it : map_counter) {
           if (it.second >= min_times_) {
             const size_t idx = it.first;
-            if (!skip_checking_) query->CheckAndAddToResult(data_start[idx]);
+            tmp_cand[cand_tmp_qty++]=data_start[idx];
           }
         }
+        if (!skip_checking_) query->CheckAndAddToResultBatch(&tmp_cand[0], cand_tmp_qty);
       } else if (inv_proc_alg_ == kScan) {
         if (chunkId) {
           memset(&counter[0], 0, sizeof(counter[0])*counter.size());
@@ -642,16 +646,7 @@ void PivotNeighbInvertedIndex<dist_t>::GenSearch(QueryType* query, size_t K) con
             tmp_cand[cand_tmp_qty++]=data_start[i];
           }
         }
-        if (!skip_checking_) {
-          for (size_t i = 0; i < cand_tmp_qty; ++i) {
-            query->CheckAndAddToResult(tmp_cand[i]);
-            if (i + 3 < cand_tmp_qty) {
-              PREFETCH(tmp_cand[i+1]->buffer(), _MM_HINT_T0);
-              PREFETCH(tmp_cand[i+2]->buffer(), _MM_HINT_T0);
-              PREFETCH(tmp_cand[i+3]->buffer(), _MM_HINT_T0);
-            }
-          }
-        }
+        if (!skip_checking_) query->CheckAndAddToResultBatch(&tmp_cand[0], cand_tmp_qty);
       } else if (inv_proc_alg_ == kWAND) {
         vector<unique_ptr<PostListQueryState>>      queryStates(num_prefix_search_);
 
@@ -700,16 +695,7 @@ void PivotNeighbInvertedIndex<dist_t>::GenSearch(QueryType* query, size_t K) con
           }
         }
 
-        if (!skip_checking_) {
-          for (size_t i = 0; i < cand_tmp_qty; ++i) {
-            query->CheckAndAddToResult(tmp_cand[i]);
-            if (i + 3 < cand_tmp_qty) {
-              PREFETCH(tmp_cand[i+1]->buffer(), _MM_HINT_T0);
-              PREFETCH(tmp_cand[i+2]->buffer(), _MM_HINT_T0);
-              PREFETCH(tmp_cand[i+3]->buffer(), _MM_HINT_T0);
-            }
-          }
-        }
+        if (!skip_checking_) query->CheckAndAddToResultBatch(&tmp_cand[0], cand_tmp_qty);
       } else if (inv_proc_alg_ == kPriorQueue) {
         vector<unique_ptr<PostListQueryState>>      queryStates(num_prefix_search_);
 
@@ -747,16 +733,7 @@ void PivotNeighbInvertedIndex<dist_t>::GenSearch(QueryType* query, size_t K) con
           accum = 0;
         }
 
-        if (!skip_checking_) {
-          for (size_t i = 0; i < cand_tmp_qty; ++i) {
-            query->CheckAndAddToResult(tmp_cand[i]);
-            if (i + 3 < cand_tmp_qty) {
-              PREFETCH(tmp_cand[i+1]->buffer(), _MM_HINT_T0);
-              PREFETCH(tmp_cand[i+2]->buffer(), _MM_HINT_T0);
-              PREFETCH(tmp_cand[i+3]->buffer(), _MM_HINT_T0);
-            }
-          }
-        }
+        if (!skip_checking_) query->CheckAndAddToResultBatch(&tmp_cand[0], cand_tmp_qty);
 
       } else if (inv_proc_alg_ == kMerge) {
         VectIdCount   tmpRes[2];
@@ -766,11 +743,13 @@ void PivotNeighbInvertedIndex<dist_t>::GenSearch(QueryType* query, size_t K) con
           prevRes = 1 - prevRes;
         }
 
+        size_t cand_tmp_qty = 0;
         for (const auto& it: tmpRes[1-prevRes]) {
           if (it.qty >= min_times_) {
-            if (!skip_checking_) query->CheckAndAddToResult(data_start[it.id]);
+            tmp_cand[cand_tmp_qty++]=data_start[it.id];
           }
         }
+        if (!skip_checking_) query->CheckAndAddToResultBatch(&tmp_cand[0], cand_tmp_qty);
       } else {
         PREPARE_RUNTIME_ERR(err) << "Bug, unknown inv_proc_alg_: " << inv_proc_alg_;
         THROW_RUNTIME_ERR(err);
@@ -12,9 +12,12 @@
  * Apache License Version 2.0 http://www.apache.org/licenses/.
  *
  */
+#include <algorithm>
 #include <thread>
 
 #include "space.h"
+#include "known_space_dist.h"
+#include "portable_prefetch.h"
 #include "rangequery.h"
 #include "knnquery.h"
 #include "knnqueue.h"
@@ -22,20 +25,62 @@
 
 namespace similarity {
 
+/*
+ * The scan loop instantiated for a specific distance functor (see known_space_dist.h):
+ * the distance is inlined and there are no virtual calls.
+ */
+template <typename dist_t, typename QueryType>
+struct KnownDistScan {
+  KnownDistScan(QueryType& query, const ObjectVector& data) : query_(query), data_(data) {}
+
+  template <class DistFunc>
+  void operator()(const DistFunc& distFunc) {
+    const float* pQuery = reinterpret_cast<const float*>(query_.QueryObject()->data());
+    for (size_t start = 0; start < data_.size(); start += QueryType::DIST_BATCH_QTY) {
+      if (query_.IsDeadlineExpired()) break;
+      size_t end = std::min(data_.size(), start + QueryType::DIST_BATCH_QTY);
+      for (size_t i = start; i < end; ++i) {
+        if (i + 1 < end) PREFETCH(data_[i + 1]->data(), _MM_HINT_T0);
+        const Object* pObj = data_[i];
+        query_.CheckAndAddToResult(distFunc(reinterpret_cast<const float*>(pObj->data()), pQuery), pObj);
+      }
+      query_.AddDistanceComputations(end - start);
+    }
+  }
+
+  QueryType&          query_;
+  const ObjectVector& data_;
+};
+
+template <typename dist_t, typename QueryType>
+void ScanSeqSearch(const KnownSpaceDist<dist_t>& knownDist, QueryType& query, const ObjectVector& data) {
+  if (knownDist.IsCompatible(query.QueryObject())) {
+    KnownDistScan<dist_t, QueryType> scan(query, data);
+    if (knownDist.Visit(scan)) return;
+  }
+  for (size_t start = 0; start < data.size(); start += QueryType::DIST_BATCH_QTY) {
+    if (query.IsDeadlineExpired()) break;
+    query.CheckAndAddToResultBatch(&data[start], std::min(data.size() - start, QueryType::DIST_BATCH_QTY));
+  }
+}
+
 template <typename dist_t, typename QueryType>
 struct SearchThreadParamSeqSearch {
-  const Space<dist_t>&      space_;
-  const ObjectVector&       data_;
-  IdTypeUnsign              threadId_;
-  QueryType&                query_;
+  const Space<dist_t>&          space_;
+  const KnownSpaceDist<dist_t>& knownDist_;
+  const ObjectVector&           data_;
+  IdTypeUnsign                  threadId_;
+  QueryType&                    query_;
 
   SearchThreadParamSeqSearch(
       const Space<dist_t>&             space,
+      const KnownSpaceDist<dist_t>&    knownDist,
       const ObjectVector&              data,
       IdTypeUnsign                     threadId,
       QueryType&                       query
   ) :
       space_(space),
+      knownDist_(knownDist),
       data_(data),
       threadId_(threadId),
       query_(query) {}
@@ -44,9 +89,7 @@ struct SearchThreadParamSeqSearch {
 template <typename dist_t, typename QueryType>
 struct SearchThreadSeqSearch {
   void operator()(SearchThreadParamSeqSearch<dist_t, QueryType> &prm) {
-    for (const Object* o: prm.data_) {
-      prm.query_.CheckAndAddToResult(o);
-    }
+    ScanSeqSearch(prm.knownDist_, prm.query_, prm.data_);
   }
 };
 
@@ -96,6 +139,9 @@ void SeqSearch<dist_t>::CreateIndex(const AnyParams& IndexParams) {
   if (bCopyMem) {
     CreateCacheOptimizedBucket(this->data_, cacheOptimizedBucket_, pData_);
   }
+
+  knownDist_.Init(space_, getData());
+  LOG(LIB_INFO) << "specialized distance code = " << knownDist_.IsKnown();
 }
 
 template <typename dist_t>
@@ -110,9 +156,7 @@ void SeqSearch<dist_t>::Search(RangeQuery<dist_t>* query, IdType) const {
   const ObjectVector& data = getData();
 
   if (!multiThread_) {
-    for (size_t i = 0; i < data.size(); ++i) {
-      query->CheckAndAddToResult(data[i]);
-    }
+    ScanSeqSearch(knownDist_, *query, data);
   } else {
     vector<unique_ptr<RangeQuery<dist_t>>>                    vQueries(threadQty_);
     vector<thread>                                            vThreads(threadQty_);
@@ -120,7 +164,8 @@ void SeqSearch<dist_t>::Search(RangeQuery<dist_t>* query, IdType) const {
 
     for (size_t i = 0; i < threadQty_; ++i) {
       vQueries[i].reset(new RangeQuery<dist_t>(space_, query->QueryObject(), query->Radius()));
-      vThreadParams[i].reset(new SearchThreadParamSeqSearch<dist_t,RangeQuery<dist_t>>(space_, vvThreadData[i], i, *vQueries[i]));
+      vQueries[i]->InheritDeadline(*query);
+      vThreadParams[i].reset(new SearchThreadParamSeqSearch<dist_t,RangeQuery<dist_t>>(space_, knownDist_, vvThreadData[i], i, *vQueries[i]));
     }
     for (size_t i = 0; i < threadQty_; ++i) {
       vThreads[i] = thread(SearchThreadSeqSearch<dist_t,RangeQuery<dist_t>>(), ref(*vThreadParams[i]));
@@ -133,6 +178,7 @@ void SeqSearch<dist_t>::Search(RangeQuery<dist_t>* query, IdType) const {
       const ObjectVector& res          = *threadQuery.Result();
       const std::vector<dist_t>& dists = *threadQuery.ResultDists();
       query->AddDistanceComputations(threadQuery.DistanceComputations());
+      if (threadQuery.IsTruncated()) query->SetTruncated();
       for (size_t k = 0; k < res.size(); ++k) {
         query->CheckAndAddToResult(dists[k], res[k]);
       }
@@ -145,9 +191,7 @@ void SeqSearch<dist_t>::Search(KNNQuery<dist_t>* query, IdType) const {
   const ObjectVector& data = getData();
 
   if (!multiThread_) {
-    for (size_t i = 0; i < data.size(); ++i) {
-      query->CheckAndAddToResult(data[i]);
-    }
+    ScanSeqSearch(knownDist_, *query, data);
   } else {
     vector<unique_ptr<KNNQuery<dist_t>>> vQueries(threadQty_);
     vector<thread>                       vThreads(threadQty_);
@@ -155,7 +199,8 @@ void SeqSearch<dist_t>::Search(KNNQuery<dist_t>* query, IdType) const {
 
     for (size_t i = 0; i < threadQty_; ++i) {
       vQueries[i].reset(new KNNQuery<dist_t>(space_, query->QueryObject(), query->GetK(), query->GetEPS()));
-      vThreadParams[i].reset(new SearchThreadParamSeqSearch<dist_t,KNNQuery<dist_t>>(space_, vvThreadData[i], i, *vQueries[i]));
+      vQueries[i]->InheritDeadline(*query);
+      vThreadParams[i].reset(new SearchThreadParamSeqSearch<dist_t,KNNQuery<dist_t>>(space_, knownDist_, vvThreadData[i], i, *vQueries[i]));
     }
     for (size_t i = 0; i < threadQty_; ++i) {
       vThreads[i] = thread(SearchThreadSeqSearch<dist_t,KNNQuery<dist_t>>(), ref(*vThreadParams[i]));
@@ -167,6 +212,7 @@ void SeqSearch<dist_t>::Search(KNNQuery<dist_t>* query, IdType) const {
       KNNQuery<dist_t>& threadQuery = vThreadParams[i]->query_;
       unique_ptr<KNNQueue<dist_t>> ResQ(threadQuery.Result()->Clone());
       query->AddDistanceComputations(threadQuery.DistanceComputations());
+      if (threadQuery.IsTruncated()) query->SetTruncated();
       while(!ResQ->Empty()) {
         const Object *pObj = reinterpret_cast<const Object *>(ResQ->TopObject());
         query->CheckAndAddToResult(ResQ->TopDistance(), pObj);
@@ -0,0 +1,266 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <thread>
+#include <fstream>
+#include <algorithm>
+
+#include "space.h"
+#include "rangequery.h"
+#include "knnquery.h"
+#include "knnqueue.h"
+#include "methodfactory.h"
+#include "utils.h"
+#include "method/sharded_index.h"
+
+#define SHARD_FILE_SUFF ".shard"
+
+namespace similarity {
+
+template <typename dist_t>
+ShardedIndex<dist_t>::ShardedIndex(bool PrintProgress,
+                                   const string& SpaceType,
+                                   Space<dist_t>& space,
+                                   const ObjectVector& data) :
+                        Index<dist_t>(data),
+                        PrintProgress_(PrintProgress),
+                        spaceType_(SpaceType),
+                        space_(space),
+                        shardQty_(0), threadQty_(0) {}
+
+template <typename dist_t>
+ShardedIndex<dist_t>::~ShardedIndex() {
+  // Stop the workers before shards go away
+  pool_.reset();
+}
+
+template <typename dist_t>
+string ShardedIndex<dist_t>::ShardLocation(const string& location, size_t shardId) {
+  return location + SHARD_FILE_SUFF + ConvertToString(shardId);
+}
+
+template <typename dist_t>
+void ShardedIndex<dist_t>::SplitData(const vector<size_t>& shardSizes) {
+  CHECK(shardSizes.size() == shardQty_);
+  shardData_.clear();
+  shardData_.resize(shardQty_);
+
+  size_t start = 0;
+  for (size_t i = 0; i < shardQty_; ++i) {
+    CHECK_MSG(start + shardSizes[i] <= this->data_.size(),
+              "Shard sizes do not match the data set size: " + ConvertToString(this->data_.size()));
+    shardData_[i].assign(this->data_.begin() + start, this->data_.begin() + start + shardSizes[i]);
+    start += shardSizes[i];
+  }
+  CHECK_MSG(start == this->data_.size(),
+            DATA_MUTATION_ERROR_MSG + " (the total size of shards " + ConvertToString(start) +
+            " != data_.size() = " + ConvertToString(this->data_.size()) + ")");
+}
+
+template <typename dist_t>
+void ShardedIndex<dist_t>::CreateShards() {
+  shards_.clear();
+  for (size_t i = 0; i < shardQty_; ++i) {
+    shards_.emplace_back(MethodFactoryRegistry<dist_t>::Instance().
+                              CreateMethod(false /* no progress for individual shards */,
+                                           shardMethod_,
+                                           spaceType_,
+                                           space_,
+                                           shardData_[i]));
+  }
+  pool_.reset(new ThreadPool(threadQty_));
+}
+
+template <typename dist_t>
+void ShardedIndex<dist_t>::CreateIndex(const AnyParams& IndexParams) {
+  AnyParamManager pmgr(IndexParams);
+
+  pmgr.GetParamRequired("shardMethod", shardMethod_);
+  pmgr.GetParamOptional("shardQty", shardQty_, thread::hardware_concurrency());
+  pmgr.GetParamOptional("threadQty", threadQty_, shardQty_);
+  // All the remaining parameters are passed to shards
+  AnyParams shardParams = pmgr.ExtractParametersExcept({"shardMethod", "shardQty", "threadQty"});
+  pmgr.CheckUnused();
+
+  CHECK_MSG(shardMethod_ != METH_SHARDED, "Shards cannot be sharded indices themselves");
+  if (shardQty_ == 0) shardQty_ = 1;
+  if (threadQty_ == 0) threadQty_ = shardQty_;
+
+  LOG(LIB_INFO) << "shardMethod   = " << shardMethod_;
+  LOG(LIB_INFO) << "shardQty      = " << shardQty_;
+  LOG(LIB_INFO) << "threadQty     = " << threadQty_;
+
+  size_t D = (this->data_.size() + shardQty_ - 1) / shardQty_;
+  vector<size_t> shardSizes(shardQty_);
+  for (size_t i = 0; i < shardQty_; ++i) {
+    size_t start = std::min(i * D, this->data_.size());
+    shardSizes[i] = std::min(start + D, this->data_.size()) - start;
+  }
+
+  SplitData(shardSizes);
+  CreateShards();
+
+  pool_->ParallelRun(shardQty_, [&](size_t shardId) {
+    shards_[shardId]->CreateIndex(shardParams);
+    if (PrintProgress_) {
+      LOG(LIB_INFO) << "Shard " << shardId << " is created, # of data points: " << shardData_[shardId].size();
+    }
+  });
+}
+
+template <typename dist_t>
+void ShardedIndex<dist_t>::SaveIndex(const string& location) {
+  ofstream outFile(location);
+  CHECK_MSG(outFile, "Cannot open file '" + location + "' for writing");
+  outFile.exceptions(std::ios::badbit);
+  size_t lineNum = 0;
+
+  WriteField(outFile, METHOD_DESC, StrDesc()); lineNum++;
+  WriteField(outFile, "shardMethod", shardMethod_); lineNum++;
+  WriteField(outFile, "shardQty", shardQty_); lineNum++;
+  WriteField(outFile, "threadQty", threadQty_); lineNum++;
+  for (size_t i = 0; i < shardQty_; ++i) {
+    WriteField(outFile, "shardSize", shardData_[i].size()); lineNum++;
+  }
+  WriteField(outFile, LINE_QTY, lineNum + 1 /* including this line */);
+  outFile.close();
+
+  pool_->ParallelRun(shardQty_, [&](size_t shardId) {
+    shards_[shardId]->SaveIndex(ShardLocation(location, shardId));
+  });
+}
+
+template <typename dist_t>
+void ShardedIndex<dist_t>::LoadIndex(const string& location) {
+  ifstream inFile(location);
+  CHECK_MSG(inFile, "Cannot open file '" + location + "' for reading");
+  inFile.exceptions(std::ios::badbit);
+
+  size_t lineNum = 1;
+  string methDesc;
+  ReadField(inFile, METHOD_DESC, methDesc); lineNum++;
+  CHECK_MSG(methDesc == StrDesc(),
+            "Looks like you try to use an index created by a different method: " + methDesc);
+  ReadField(inFile, "shardMethod", shardMethod_); lineNum++;
+  ReadField(inFile, "shardQty", shardQty_); lineNum++;
+  ReadField(inFile, "threadQty", threadQty_); lineNum++;
+  vector<size_t> shardSizes(shardQty_);
+  for (size_t i = 0; i < shardQty_; ++i) {
+    ReadField(inFile, "shardSize", shardSizes[i]); lineNum++;
+  }
+  size_t ExpLineNum;
+  ReadField(inFile, LINE_QTY, ExpLineNum);
+  CHECK_MSG(lineNum == ExpLineNum,
+            DATA_MUTATION_ERROR_MSG + " (expected number of lines " + ConvertToString(ExpLineNum) +
+            " read so far doesn't match the number of read lines: " + ConvertToString(lineNum) + ")");
+  inFile.close();
+
+  SplitData(shardSizes);
+  CreateShards();
+
+  pool_->ParallelRun(shardQty_, [&](size_t shardId) {
+    shards_[shardId]->LoadIndex(ShardLocation(location, shardId));
+  });
+}
+
+template <typename dist_t>
+void ShardedIndex<dist_t>::SetQueryTimeParams(const AnyParams& params) {
+  // Parameters are interpreted by shards
+  for (auto& shard : shards_) {
+    shard->SetQueryTimeParams(params);
+  }
+}
+
+template <typename dist_t>
+void ShardedIndex<dist_t>::AddBatch(const ObjectVector& batchData, bool printProgress, bool checkIDs) {
+  CHECK_MSG(!shards_.empty(), "Call CreateIndex or LoadIndex before adding data!");
+  size_t minShardId = 0;
+  for (size_t i = 1; i < shardQty_; ++i) {
+    if (shards_[i]->GetSize() < shards_[minShardId]->GetSize()) minShardId = i;
+  }
+  shards_[minShardId]->AddBatch(batchData, printProgress, checkIDs);
+  shardData_[minShardId].insert(shardData_[minShardId].end(), batchData.begin(), batchData.end());
+}
+
+template <typename dist_t>
+size_t ShardedIndex<dist_t>::GetSize() const {
+  size_t res = 0;
+  for (const auto& shard : shards_) res += shard->GetSize();
+  return res;
+}
+
+template <typename dist_t>
+bool ShardedIndex<dist_t>::DuplicateData() const {
+  return !shards_.empty() && shards_[0]->DuplicateData();
+}
+
+template <typename dist_t>
+void ShardedIndex<dist_t>::Search(RangeQuery<dist_t>* query, IdType) const {
+  vector<unique_ptr<Object>>                queryObjs(shardQty_);
+  vector<unique_ptr<RangeQuery<dist_t>>>    vQueries(shardQty_);
+
+  /*
+   * Each shard gets a private copy of the query object,
+   * because some methods (e.g., HNSW for the cosine similarity) modify it.
+   */
+  for (size_t i = 0; i < shardQty_; ++i) {
+    queryObjs[i].reset(query->QueryObject()->Clone());
+    vQueries[i].reset(new RangeQuery<dist_t>(space_, queryObjs[i].get(), query->Radius()));
+    vQueries[i]->InheritDeadline(*query);
+  }
+  pool_->ParallelRun(shardQty_, [&](size_t shardId) {
+    shards_[shardId]->Search(vQueries[shardId].get(), -1);
+  });
+  for (size_t i = 0; i < shardQty_; ++i) {
+    RangeQuery<dist_t>& shardQuery    = *vQueries[i];
+    const ObjectVector& res           = *shardQuery.Result();
+    const std::vector<dist_t>& dists  = *shardQuery.ResultDists();
+    query->AddDistanceComputations(shardQuery.DistanceComputations());
+    if (shardQuery.IsTruncated()) query->SetTruncated();
+    for (size_t k = 0; k < res.size(); ++k) {
+      query->CheckAndAddToResult(dists[k], res[k]);
+    }
+  }
+}
+
+template <typename dist_t>
+void ShardedIndex<dist_t>::Search(KNNQuery<dist_t>* query, IdType) const {
+  vector<unique_ptr<Object>>                queryObjs(shardQty_);
+  vector<unique_ptr<KNNQuery<dist_t>>>      vQueries(shardQty_);
+
+  // See the comment in the range search function
+  for (size_t i = 0; i < shardQty_; ++i) {
+    queryObjs[i].reset(query->QueryObject()->Clone());
+    vQueries[i].reset(new KNNQuery<dist_t>(space_, queryObjs[i].get(), query->GetK(), query->GetEPS()));
+    vQueries[i]->InheritDeadline(*query);
+  }
+  pool_->ParallelRun(shardQty_, [&](size_t shardId) {
+    shards_[shardId]->Search(vQueries[shardId].get(), -1);
+  });
+  for (size_t i = 0; i < shardQty_; ++i) {
+    KNNQuery<dist_t>& shardQuery = *vQueries[i];
+    unique_ptr<KNNQueue<dist_t>> ResQ(shardQuery.Result()->Clone());
+    query->AddDistanceComputations(shardQuery.DistanceComputations());
+    if (shardQuery.IsTruncated()) query->SetTruncated();
+    while(!ResQ->Empty()) {
+      query->CheckAndAddToResult(ResQ->TopDistance(), ResQ->TopObject());
+      ResQ->Pop();
+    }
+  }
+}
+
+template class ShardedIndex<float>;
+template class ShardedIndex<int>;
+
+}
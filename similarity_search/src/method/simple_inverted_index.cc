@@ -26,11 +26,260 @@
 namespace similarity {
 
 const uint32_t VERSION_NUMBER = 1;
+// The version of files with compressed posting lists
+const uint32_t COMPRESSED_VERSION_NUMBER = 2;
+// Alignment of compressed posting lists
+const size_t COMP_POST_LIST_ALIGN = 16;
 
 using namespace std;
 
+// Keeps the top-K documents: the queue stores negated scores, so its top is the worst document
+template <typename dist_t>
+static void AddToTopK(FalconnHeapMod1<dist_t, IdType>& resQueue, size_t K, dist_t score, IdType docId) {
+  dist_t negScore = -score;
+  if (size_t(resQueue.size()) < K)
+    resQueue.push(negScore, docId);
+  else if (resQueue.top_key() > negScore)
+    resQueue.replace_top(negScore, docId);
+}
+
+// A document needs to have a larger score to enter the top-K
+template <typename dist_t>
+static dist_t TopKThreshold(FalconnHeapMod1<dist_t, IdType>& resQueue, size_t K) {
+  return size_t(resQueue.size()) < K ? -numeric_limits<dist_t>::max() : -resQueue.top_key();
+}
+
 template <typename dist_t>
 void SimplInvIndex<dist_t>::Search(KNNQuery<dist_t>* query, IdType) const {
+  if (compressed_) {
+    vector<CompPostListCursor> cursors;
+    CreateCursors(query, cursors);
+    switch (algoType_) {
+      case kWAND:         SearchWAND(query, cursors, false); break;
+      case kBlockMaxWAND: SearchWAND(query, cursors, true); break;
+      case kMaxScore:     SearchMaxScore(query, cursors); break;
+      default:            SearchExhaustive(query, cursors);
+    }
+  } else if (algoType_ == kDAAT) {
+    SearchDAAT(query);
+  } else {
+    vector<PostListCursor> cursors;
+    CreateCursors(query, cursors);
+    switch (algoType_) {
+      case kWAND:         SearchWAND(query, cursors, false); break;
+      case kBlockMaxWAND: SearchWAND(query, cursors, true); break;
+      default:            SearchMaxScore(query, cursors);
+    }
+  }
+}
+
+template <typename dist_t>
+void SimplInvIndex<dist_t>::CreateCursors(KNNQuery<dist_t>* query, vector<PostListCursor>& cursors) const {
+  vector<SparseVectElem<dist_t>>    query_vect;
+  const Object* o = query->QueryObject();
+  UnpackSparseElements(o->data(), o->datalength(), query_vect);
+
+  cursors.clear();
+  for (auto eQuery : query_vect) {
+    auto it = index_.find(eQuery.id_);
+    if (it != index_.end()) { // There may be out-of-vocabulary words
+#ifdef SANITY_CHECKS
+      CHECK(it->second.get() != nullptr);
+#endif
+      CHECK(it->second->qty_ > 0);
+      cursors.push_back(PostListCursor(*it->second, eQuery.val_));
+    }
+  }
+}
+
+template <typename dist_t>
+void SimplInvIndex<dist_t>::CreateCursors(KNNQuery<dist_t>* query, vector<CompPostListCursor>& cursors) const {
+  vector<SparseVectElem<dist_t>>    query_vect;
+  const Object* o = query->QueryObject();
+  UnpackSparseElements(o->data(), o->datalength(), query_vect);
+
+  cursors.clear();
+  cursors.reserve(query_vect.size());
+  for (auto eQuery : query_vect) {
+    auto it = compIndex_.find(eQuery.id_);
+    if (it != compIndex_.end()) { // There may be out-of-vocabulary words
+      const CompPostListDesc& desc = *it->second;
+      cursors.push_back(CompPostListCursor(compData_ + desc.offset_, desc, eQuery.val_));
+    }
+  }
+}
+
+template <typename dist_t>
+void SimplInvIndex<dist_t>::AddTopKToResult(KNNQuery<dist_t>* query, FalconnHeapMod1<dist_t, IdType>& resQueue) const {
+  while (!resQueue.empty()) {
+#ifdef SANITY_CHECKS
+    CHECK(resQueue.top_data() >= 0);
+#endif
+    // This recomputes the distance, but it normally has a negligibly small effect on the run-time
+    query->CheckAndAddToResult(this->data_[resQueue.top_data()]);
+    resQueue.pop();
+  }
+}
+
+template <typename dist_t>
+template <class Cursor>
+void SimplInvIndex<dist_t>::SearchExhaustive(KNNQuery<dist_t>* query, vector<Cursor>& cursors) const {
+  const size_t K = CandidateQty(query);
+  FalconnHeapMod1<dist_t, IdType> resQueue;
+
+  while (true) {
+    IdType docId = kNoMoreDocs;
+    for (const auto& c : cursors) docId = min(docId, c.DocId());
+    if (docId == kNoMoreDocs) break;
+
+    dist_t score = 0;
+    for (auto& c : cursors) {
+      if (c.DocId() == docId) {
+        score += c.Score();
+        c.Next();
+      }
+    }
+    AddToTopK(resQueue, K, score, docId);
+  }
+
+  AddTopKToResult(query, resQueue);
+}
+
+template <typename dist_t>
+template <class Cursor>
+void SimplInvIndex<dist_t>::SearchWAND(KNNQuery<dist_t>* query, vector<Cursor>& cursors, bool useBlockMax) const {
+  if (cursors.empty()) return;
+
+  const size_t K = CandidateQty(query);
+  FalconnHeapMod1<dist_t, IdType> resQueue;
+
+  // Cursors sorted by the current document id (exhausted cursors are at the end)
+  vector<Cursor*> order;
+  for (auto& c : cursors) order.push_back(&c);
+  auto byDocId = [](const Cursor* c1, const Cursor* c2) { return c1->DocId() < c2->DocId(); };
+  sort(order.begin(), order.end(), byDocId);
+
+  while (true) {
+    dist_t threshold = TopKThreshold(resQueue, K);
+    /*
+     * The pivot is the first cursor such that the sum of upper bounds of this and
+     * preceding cursors exceeds the threshold. Documents preceding the pivot
+     * document can be found only in preceding lists, so they can be skipped.
+     */
+    dist_t boundSum = 0;
+    size_t pivot = order.size();
+    for (size_t i = 0; i < order.size() && order[i]->DocId() != kNoMoreDocs; ++i) {
+      boundSum += order[i]->max_score_;
+      if (boundSum > threshold) {
+        pivot = i;
+        break;
+      }
+    }
+    if (pivot == order.size()) break;
+
+    const IdType pivotDocId = order[pivot]->DocId();
+    while (pivot + 1 < order.size() && order[pivot + 1]->DocId() == pivotDocId) ++pivot;
+
+    if (useBlockMax) {
+      // A finer bound using maximum values of blocks that may contain the pivot document
+      dist_t blockBoundSum = 0;
+      for (size_t i = 0; i <= pivot; ++i) {
+        blockBoundSum += order[i]->BlockMaxScore(order[i]->FindBlock(pivotDocId));
+      }
+      if (blockBoundSum <= threshold) {
+        /*
+         * The same bound holds for all documents up to the end of the shortest block,
+         * unless the document is in one of the following lists.
+         */
+        IdType nextDocId = pivot + 1 < order.size() ? order[pivot + 1]->DocId() : kNoMoreDocs;
+        for (size_t i = 0; i <= pivot; ++i) {
+          IdType lastDocId = order[i]->BlockLastDocId(order[i]->FindBlock(pivotDocId));
+          if (lastDocId != kNoMoreDocs) nextDocId = min(nextDocId, lastDocId + 1);
+        }
+        for (size_t i = 0; i <= pivot; ++i) order[i]->NextGEQ(nextDocId);
+        sort(order.begin(), order.end(), byDocId);
+        continue;
+      }
+    }
+
+    if (order[0]->DocId() == pivotDocId) {
+      // All the cursors up to the pivot point to the pivot document
+      dist_t score = 0;
+      for (size_t i = 0; i <= pivot; ++i) {
+        score += order[i]->Score();
+        order[i]->Next();
+      }
+      AddToTopK(resQueue, K, score, pivotDocId);
+    } else {
+      for (size_t i = 0; i < pivot && order[i]->DocId() < pivotDocId; ++i) order[i]->NextGEQ(pivotDocId);
+    }
+    sort(order.begin(), order.end(), byDocId);
+  }
+
+  AddTopKToResult(query, resQueue);
+}
+
+template <typename dist_t>
+template <class Cursor>
+void SimplInvIndex<dist_t>::SearchMaxScore(KNNQuery<dist_t>* query, vector<Cursor>& cursors) const {
+  if (cursors.empty()) return;
+
+  const size_t K = CandidateQty(query);
+  FalconnHeapMod1<dist_t, IdType> resQueue;
+
+  // Cursors sorted by upper bounds: pointers are sorted, because cursors can be large
+  vector<Cursor*> order;
+  for (auto& c : cursors) order.push_back(&c);
+  sort(order.begin(), order.end(),
+       [](const Cursor* c1, const Cursor* c2) { return c1->max_score_ < c2->max_score_; });
+  // boundSums[i] is the sum of upper bounds for lists 0..i
+  vector<dist_t> boundSums(order.size());
+  dist_t boundSum = 0;
+  for (size_t i = 0; i < order.size(); ++i) boundSums[i] = boundSum += order[i]->max_score_;
+
+  /*
+   * Lists before firstEssential are non-essential: a document, which appears
+   * only in these lists, cannot enter the top-K. Hence, candidates are produced
+   * only by essential lists, and non-essential lists are only searched.
+   */
+  size_t firstEssential = 0;
+  dist_t threshold = TopKThreshold(resQueue, K);
+
+  while (firstEssential < order.size()) {
+    IdType docId = kNoMoreDocs;
+    for (size_t i = firstEssential; i < order.size(); ++i) docId = min(docId, order[i]->DocId());
+    if (docId == kNoMoreDocs) break;
+
+    dist_t score = 0;
+    for (size_t i = firstEssential; i < order.size(); ++i) {
+      if (order[i]->DocId() == docId) {
+        score += order[i]->Score();
+        order[i]->Next();
+      }
+    }
+
+    bool pruned = false;
+    for (size_t i = firstEssential; i-- > 0;) {
+      if (score + boundSums[i] <= threshold) {
+        pruned = true;
+        break;
+      }
+      order[i]->NextGEQ(docId);
+      if (order[i]->DocId() == docId) score += order[i]->Score();
+    }
+
+    if (!pruned) {
+      AddToTopK(resQueue, K, score, docId);
+      threshold = TopKThreshold(resQueue, K);
+      while (firstEssential < order.size() && boundSums[firstEssential] <= threshold) ++firstEssential;
+    }
+  }
+
+  AddTopKToResult(query, resQueue);
+}
+
+template <typename dist_t>
+void SimplInvIndex<dist_t>::SearchDAAT(KNNQuery<dist_t>* query) const {
   // the query vector, its size is the number of query terms (non-zero dimensions of the query vector)
   vector<SparseVectElem<dist_t>>    query_vect;
   const Object* o = query->QueryObject();
@@ -147,6 +396,13 @@ void SimplInvIndex<dist_t>::SaveIndex(const string& location) {
   CHECK_MSG(output, "Cannot open file '" + location + "' for writing");
   output.exceptions(ios::badbit | ios::failbit);
 
+  if (compressed_) {
+    // The buffer already has the file format
+    output.write(compData_, compSize_);
+    output.close();
+    return;
+  }
+
   // Save version number
   const uint32_t version = VERSION_NUMBER;
   writeBinaryPOD(output, version);
@@ -177,6 +433,20 @@ void SimplInvIndex<dist_t>::LoadIndex(const string& location) {
 
   uint32_t version;
   readBinaryPOD(input, version);
+
+  index_.clear();
+  compIndex_.clear();
+  compBuffer_.clear();
+  compFile_.reset();
+  compressed_ = false;
+
+  if (version == COMPRESSED_VERSION_NUMBER) {
+    input.close();
+    compFile_.reset(new MmapFile(location));
+    InitCompressedIndex(compFile_->data(), compFile_->size());
+    compressed_ = true;
+    return;
+  }
   if (version != VERSION_NUMBER) {
     PREPARE_RUNTIME_ERR(err) << "File version number (" << version << ") differs from "
                              << "expected version (" << VERSION_NUMBER << ")";
@@ -200,6 +470,8 @@ void SimplInvIndex<dist_t>::LoadIndex(const string& location) {
       readBinaryPOD(input, e.doc_id_);
       readBinaryPOD(input, e.val_);
     }
+    // Block statistics aren't stored
+    pl->ComputeBlocks();
     index_.insert(make_pair(wordId, unique_ptr<PostList>(pl.release())));
   }
 }
@@ -212,7 +484,9 @@ void SimplInvIndex<dist_t>::CreateIndex(const AnyParams& IndexParams) {
 
 template <typename dist_t>
 void SimplInvIndex<dist_t>::CreateIndex(AnyParamManager& ParamManager) {
+  ParamManager.GetParamOptional("compress", compressed_, false);
   ParamManager.CheckUnused();
+  LOG(LIB_INFO) << "compress = " << compressed_;
   // Always call ResetQueryTimeParams() to set query-time parameters to their default values
   this->ResetQueryTimeParams();
 
@@ -287,6 +561,131 @@ void SimplInvIndex<dist_t>::CreateIndex(AnyParamManager& ParamManager) {
     CHECK(qty == post_pos[wordId]);
   }
 #endif
+  for (auto& e : index_) e.second->ComputeBlocks();
+
+  if (compressed_) {
+    LOG(LIB_INFO) << "Compressing posting lists";
+    CreateCompressedIndex();
+    index_.clear();
+  }
+}
+
+template <typename dist_t>
+void SimplInvIndex<dist_t>::CreateCompressedIndex() {
+  vector<uint32_t> wordIds;
+  for (const auto& e : index_) wordIds.push_back(e.first);
+  sort(wordIds.begin(), wordIds.end());
+
+  const size_t headerSize = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+  vector<char> buf(headerSize + wordIds.size() * sizeof(CompPostListDesc));
+  vector<CompPostListDesc> descs;
+  vector<uint32_t> docIds(kBlockSize);
+
+  for (uint32_t wordId : wordIds) {
+    const PostList& pl = *index_.find(wordId)->second;
+    buf.resize((buf.size() + COMP_POST_LIST_ALIGN - 1) / COMP_POST_LIST_ALIGN * COMP_POST_LIST_ALIGN);
+    const size_t listStart = buf.size();
+    const size_t blockQty = pl.blocks_.size();
+    vector<CompPostBlock> blocks(blockQty);
+    buf.resize(listStart + blockQty * sizeof(CompPostBlock));
+
+    for (size_t b = 0; b < blockQty; ++b) {
+      const PostBlock& pb = pl.blocks_[b];
+      const size_t start = b * kBlockSize, qty = min(pl.qty_, start + kBlockSize) - start;
+      CHECK_MSG(buf.size() - listStart <= numeric_limits<uint32_t>::max(),
+                "The posting list of the word " + ConvertToString(wordId) + " is too long");
+      blocks[b].last_doc_id_ = pb.last_doc_id_;
+      blocks[b].data_offset_ = buf.size() - listStart;
+      blocks[b].max_val_ = pb.max_val_;
+      blocks[b].min_val_ = pb.min_val_;
+
+      for (size_t i = 0; i < qty; ++i) docIds[i] = pl.entries_[start + i].doc_id_;
+      const size_t dataStart = buf.size();
+      buf.resize(dataStart + StreamVByteMaxEncodedSize(qty) + qty);
+      uint8_t* pData = reinterpret_cast<uint8_t*>(&buf[dataStart]);
+      size_t idLen = StreamVByteDeltaEncode(&docIds[0], qty, b ? pl.blocks_[b - 1].last_doc_id_ : uint32_t(-1), pData);
+
+      const dist_t range = pb.max_val_ - pb.min_val_;
+      for (size_t i = 0; i < qty; ++i) {
+        dist_t q = range > 0 ? round((pl.entries_[start + i].val_ - pb.min_val_) / range * kQuantLevels) : 0;
+        pData[idLen + i] = static_cast<uint8_t>(max(dist_t(0), min(dist_t(kQuantLevels), q)));
+      }
+      buf.resize(dataStart + idLen + qty);
+    }
+    memcpy(&buf[listStart], &blocks[0], blockQty * sizeof(CompPostBlock));
+
+    CompPostListDesc desc;
+    desc.offset_ = listStart;
+    desc.word_id_ = wordId;
+    desc.qty_ = pl.qty_;
+    desc.block_qty_ = blockQty;
+    desc.max_val_ = pl.max_val_;
+    desc.min_val_ = pl.min_val_;
+    desc.reserved_ = 0;
+    descs.push_back(desc);
+  }
+  // The decoder may read past the end of the data
+  buf.resize(buf.size() + STREAM_VBYTE_PADDING);
+
+  char* pHeader = &buf[0];
+  writeBinaryPOD(pHeader, COMPRESSED_VERSION_NUMBER);
+  writeBinaryPOD(pHeader + sizeof(uint32_t), uint32_t(kBlockSize));
+  writeBinaryPOD(pHeader + 2 * sizeof(uint32_t), uint64_t(descs.size()));
+  if (!descs.empty()) memcpy(pHeader + headerSize, &descs[0], descs.size() * sizeof(CompPostListDesc));
+
+  compBuffer_.swap(buf);
+  InitCompressedIndex(&compBuffer_[0], compBuffer_.size());
+
+  size_t uncompSize = 0;
+  for (const auto& e : index_) uncompSize += e.second->qty_ * sizeof(PostEntry);
+  LOG(LIB_INFO) << "Uncompressed posting lists: " << uncompSize << " bytes, compressed: " << compSize_ << " bytes";
+}
+
+template <typename dist_t>
+void SimplInvIndex<dist_t>::InitCompressedIndex(const char* pData, size_t dataSize) {
+  const size_t headerSize = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+  CHECK_MSG(dataSize >= headerSize, "The compressed index is truncated");
+  uint32_t version = 0, blockSize = 0;
+  uint64_t listQty = 0;
+  readBinaryPOD(pData, version);
+  readBinaryPOD(pData + sizeof(uint32_t), blockSize);
+  readBinaryPOD(pData + 2 * sizeof(uint32_t), listQty);
+  CHECK_MSG(version == COMPRESSED_VERSION_NUMBER,
+            "Unexpected version of the compressed index: " + ConvertToString(version));
+  CHECK_MSG(blockSize == kBlockSize,
+            "Block size of the compressed index (" + ConvertToString(blockSize) + ") " +
+            "differs from expected (" + ConvertToString(size_t(kBlockSize)) + ")");
+  // The division guards against an overflow
+  CHECK_MSG(listQty <= (dataSize - headerSize) / sizeof(CompPostListDesc), "The compressed index is truncated");
+
+  compData_ = pData;
+  compSize_ = dataSize;
+  compIndex_.clear();
+  const CompPostListDesc* pDesc = reinterpret_cast<const CompPostListDesc*>(pData + headerSize);
+  for (size_t i = 0; i < listQty; ++i) {
+    const CompPostListDesc& desc = pDesc[i];
+    CHECK_MSG(desc.qty_ > 0 && desc.block_qty_ == (desc.qty_ + kBlockSize - 1) / kBlockSize &&
+              desc.offset_ % COMP_POST_LIST_ALIGN == 0 && desc.offset_ <= dataSize &&
+              desc.block_qty_ * sizeof(CompPostBlock) <= dataSize - desc.offset_,
+              "Invalid descriptor of the posting list # " + ConvertToString(i));
+    /*
+     * Block data (ids and quantized values) followed by the padding, which the SIMD decoder
+     * may read, must be within the buffer: lengths of ids are read from control bytes.
+     */
+    const char* pList = pData + desc.offset_;
+    const CompPostBlock* pBlocks = reinterpret_cast<const CompPostBlock*>(pList);
+    for (size_t b = 0; b < desc.block_qty_; ++b) {
+      const size_t qty = min(size_t(kBlockSize), size_t(desc.qty_) - b * kBlockSize);
+      const size_t avail = dataSize - desc.offset_;
+      const size_t start = pBlocks[b].data_offset_;
+      CHECK_MSG(start <= avail && (qty + 3) / 4 <= avail - start,
+                "Invalid block # " + ConvertToString(b) + " of the posting list # " + ConvertToString(i));
+      const size_t blockSize = StreamVByteEncodedSize(reinterpret_cast<const uint8_t*>(pList + start), qty) + qty;
+      CHECK_MSG(blockSize + STREAM_VBYTE_PADDING <= avail - start,
+                "Invalid block # " + ConvertToString(b) + " of the posting list # " + ConvertToString(i));
+    }
+    compIndex_.insert(make_pair(desc.word_id_, &desc));
+  }
 }
 
 template <typename dist_t>
@@ -299,10 +698,25 @@ void
 SimplInvIndex<dist_t>::SetQueryTimeParams(const AnyParams& QueryTimeParams) {
   // Check if a user specified extra parameters, which can be also misspelled variants of existing ones
   AnyParamManager pmgr(QueryTimeParams);
-  int dummy;
+  string tmps;
   // Note that GetParamOptional() should always have a default value
-  pmgr.GetParamOptional("dummyParam", dummy, -1);
-  LOG(LIB_INFO) << "Set dummy = " << dummy;
+  pmgr.GetParamOptional("algoType", tmps, "daat");
+  ToLower(tmps);
+  if (tmps == "daat")
+    algoType_ = kDAAT;
+  else if (tmps == "wand")
+    algoType_ = kWAND;
+  else if (tmps == "bmw")
+    algoType_ = kBlockMaxWAND;
+  else if (tmps == "maxscore")
+    algoType_ = kMaxScore;
+  else {
+    throw runtime_error("algoType should be one of the following: daat, wand, bmw, maxscore");
+  }
+  LOG(LIB_INFO) << "Set algoType = " << tmps;
+  pmgr.GetParamOptional("rerankMult", rerankMult_, 4);
+  CHECK_MSG(rerankMult_ > 0, "rerankMult should be positive");
+  LOG(LIB_INFO) << "Set rerankMult = " << rerankMult_;
   pmgr.CheckUnused();
 }
 
@@ -647,10 +647,16 @@ void SmallWorldRand<dist_t>::SearchV1Merge(KNNQuery<dist_t>* query) const {
 
   vector<QueueItem>& queueData = sortedArr.get_data();
   vector<QueueItem>  itemBuff(8*NN_);
+  // unvisited neighbors, whose distances to the query are computed at once
+  vector<const Object*> candObjs;
+  vector<MSWNode*>      candNodes;
+  vector<dist_t>        candDists;
 
   // efSearch_ is always <= # of elements in the queueData.size() (the size of the BUFFER), but it can be
   // larger than sortedArr.size(), which returns the number of actual elements in the buffer
   while(currElem < min(sortedArr.size(),efSearch_)){
+    // On expiration, the best candidates found so far are returned
+    if (query->IsDeadlineExpired()) break;
     auto& e = queueData[currElem];
     CHECK(!e.used);
     e.used = true;
@@ -670,18 +676,25 @@ void SmallWorldRand<dist_t>::SearchV1Merge(KNNQuery<dist_t>* query) const {
     size_t itemQty = 0;
 
     dist_t topKey = sortedArr.top_key();
-    //calculate distance to each neighbor
+    candObjs.clear();
+    candNodes.clear();
     for (MSWNode* neighbor : currNode->getAllFriends()) {
       nodeId = neighbor->getId();
       CHECK_MSG(nodeId < NextNodeId_, "Bug: nodeId (" + ConvertToString(nodeId) +  ") > NextNodeId_ (" +ConvertToString(NextNodeId_));
 
       if (!visitedBitset[nodeId]) {
-        currObj = neighbor->getData();
-        d = query->DistanceObjLeft(currObj);
         visitedBitset[nodeId] = true;
-        if (sortedArr.size() < efSearch_ || d < topKey) {
-          itemBuff[itemQty++]=QueueItem(d, neighbor);
-        }
+        candObjs.push_back(neighbor->getData());
+        candNodes.push_back(neighbor);
+      }
+    }
+    //calculate distances to all unvisited neighbors at once
+    candDists.resize(candObjs.size());
+    query->DistanceObjLeftBatch(candObjs.data(), candObjs.size(), candDists.data());
+    for (size_t k = 0; k < candObjs.size(); ++k) {
+      d = candDists[k];
+      if (sortedArr.size() < efSearch_ || d < topKey) {
+        itemBuff[itemQty++]=QueueItem(d, candNodes[k]);
       }
     }
 
@@ -753,6 +766,8 @@ void SmallWorldRand<dist_t>::SearchOld(KNNQuery<dist_t>* query) const {
   visitedBitset[nodeId] = true;
 
   while(!candidateQueue.empty()){
+    // The result set always contains the best objects found so far
+    if (query->IsDeadlineExpired()) break;
 
     auto iter = candidateQueue.top(); // This one was already compared to the query
     const EvaluatedMSWNodeReverse<dist_t>& currEv = iter;
@@ -132,6 +132,12 @@ void VPTree<dist_t, SearchOracle>::SaveIndex(const std::string& location) {
   CHECK_MSG(output, "Cannot open file '" + location + "' for writing");
   output.exceptions(ios::badbit | ios::failbit);
 
+  SaveIndexToStream(output);
+  output.close();
+}
+
+template <typename dist_t, typename SearchOracle>
+void VPTree<dist_t, SearchOracle>::SaveIndexToStream(std::ostream& output) {
   // Save version number
   const uint32_t version = VERSION_NUMBER;
   writeBinaryPOD(output, version);
@@ -149,7 +155,6 @@ void VPTree<dist_t, SearchOracle>::SaveIndex(const std::string& location) {
   if (root_) {
     SaveNodeData(output, root_.get());
   }
-  output.close();
 }
 
 template <typename dist_t, typename SearchOracle>
@@ -159,6 +164,11 @@ void VPTree<dist_t, SearchOracle>::LoadIndex(const std::string& location) {
   CHECK_MSG(input, "Cannot open file '" + location + "' for reading");
   input.exceptions(ios::badbit | ios::failbit);
 
+  LoadIndexFromStream(input);
+}
+
+template <typename dist_t, typename SearchOracle>
+void VPTree<dist_t, SearchOracle>::LoadIndexFromStream(std::istream& input) {
   uint32_t version;
   readBinaryPOD(input, version);
   if (version != VERSION_NUMBER) {
@@ -190,7 +200,7 @@ void VPTree<dist_t, SearchOracle>::LoadIndex(const std::string& location) {
 template <typename dist_t, typename SearchOracle>
 void
 VPTree<dist_t, SearchOracle>::SaveNodeData(
-  std::ofstream& output,
+  std::ostream& output,
   const typename VPTree<dist_t, SearchOracle>::VPNode* node) const {
 
   // Nodes are written to output in pre-order. 
@@ -233,7 +243,7 @@ VPTree<dist_t, SearchOracle>::SaveNodeData(
 
 template <typename dist_t, typename SearchOracle>
 typename VPTree<dist_t, SearchOracle>::VPNode*
-VPTree<dist_t, SearchOracle>::LoadNodeData(std::ifstream& input, bool ChunkBucket, const vector<IdType>& IdMapper) const {
+VPTree<dist_t, SearchOracle>::LoadNodeData(std::istream& input, bool ChunkBucket, const vector<IdType>& IdMapper) const {
   IdType pivotId = 0;
   // read one element, the pivot
   readBinaryPOD(input, pivotId);
@@ -419,6 +429,7 @@ template <typename QueryType>
 void VPTree<dist_t, SearchOracle>::VPNode::GenericSearch(QueryType* query,
                                                          int& MaxLeavesToVisit) const {
   if (MaxLeavesToVisit <= 0) return; // early termination
+  if (query->IsDeadlineExpired()) return; // best-so-far results are kept
   if (bucket_) {
     --MaxLeavesToVisit;
 
@@ -426,11 +437,7 @@ void VPTree<dist_t, SearchOracle>::VPNode::GenericSearch(QueryType* query,
       PREFETCH(CacheOptimizedBucket_, _MM_HINT_T0);
     }
 
-    for (unsigned i = 0; i < bucket_->size(); ++i) {
-      const Object* Obj = (*bucket_)[i];
-      dist_t distQC = query->DistanceObjLeft(Obj);
-      query->CheckAndAddToResult(distQC, Obj);
-    }
+    query->CheckAndAddToResultBatch(bucket_->data(), bucket_->size());
     return;
   }
 
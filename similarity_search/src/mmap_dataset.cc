@@ -0,0 +1,280 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mmap_dataset.h"
+#include "utils.h"
+#include "space/space_vector.h"
+#include "space/space_l2sqr_sift.h"
+
+namespace similarity {
+
+using std::unique_ptr;
+
+const uint64_t OBJ_RECORDS_MAGIC = 0x31534a424f534d4eULL; // "NMSOBJS1"
+
+enum MmapDatasetFormat {
+  MMAP_FORMAT_UNKNOWN,
+  MMAP_FORMAT_FVECS,
+  MMAP_FORMAT_IVECS,
+  MMAP_FORMAT_BVECS,
+  MMAP_FORMAT_FBIN,
+  MMAP_FORMAT_U8BIN,
+  MMAP_FORMAT_OBJS
+};
+
+static MmapDatasetFormat GetMmapDatasetFormat(const string& fileName) {
+  string name = fileName;
+  ToLower(name);
+  const std::pair<const char*, MmapDatasetFormat> formats[] = {
+    {".fvecs", MMAP_FORMAT_FVECS}, {".ivecs", MMAP_FORMAT_IVECS}, {".bvecs", MMAP_FORMAT_BVECS},
+    {".fbin", MMAP_FORMAT_FBIN}, {".u8bin", MMAP_FORMAT_U8BIN}, {".objs", MMAP_FORMAT_OBJS}
+  };
+  for (const auto& format : formats) {
+    size_t len = strlen(format.first);
+    if (name.size() > len && name.compare(name.size() - len, len, format.first) == 0) {
+      return format.second;
+    }
+  }
+  return MMAP_FORMAT_UNKNOWN;
+}
+
+bool IsMmapDatasetFile(const string& fileName) {
+  return GetMmapDatasetFormat(fileName) != MMAP_FORMAT_UNKNOWN;
+}
+
+#ifdef _MSC_VER
+MmapFile::MmapFile(const string& fileName) : data_(nullptr), size_(0) {
+  std::ifstream input(fileName, std::ios::binary | std::ios::ate);
+  CHECK_MSG(input, "Cannot open file: " + fileName + " for reading");
+  input.exceptions(std::ios::badbit | std::ios::failbit);
+  size_ = input.tellg();
+  input.seekg(0);
+  buffer_.reset(new char[size_ + 1]);
+  input.read(buffer_.get(), size_);
+  data_ = buffer_.get();
+}
+
+MmapFile::~MmapFile() {}
+#else
+MmapFile::MmapFile(const string& fileName) : data_(nullptr), size_(0) {
+  int fd = open(fileName.c_str(), O_RDONLY);
+  CHECK_MSG(fd >= 0, "Cannot open file: " + fileName + " for reading");
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw runtime_error("Cannot obtain the size of the file: " + fileName);
+  }
+  size_ = st.st_size;
+  if (size_) {
+    void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    CHECK_MSG(p != MAP_FAILED, "Cannot memory-map the file: " + fileName);
+    data_ = static_cast<const char*>(p);
+  } else {
+    close(fd);
+  }
+}
+
+MmapFile::~MmapFile() {
+  if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+}
+#endif
+
+/*
+ * Converts raw vectors to objects, which are then copied into the arena. Raw vectors
+ * lack object headers, so they cannot be used in place. uint8 vectors can be used directly
+ * by the SIFT space, otherwise elements are converted to the distance type of a dense vector space.
+ */
+template <typename dist_t, typename elem_t>
+class RawVectorConverter {
+public:
+  RawVectorConverter(const Space<dist_t>& space, const string& fileName) :
+      pVectSpace_(dynamic_cast<const VectorSpace<dist_t>*>(&space)),
+      pSimpleSpace_(dynamic_cast<const VectorSpaceSimpleStorage<dist_t>*>(&space)),
+      pSiftSpace_(std::is_same<elem_t, uint8_t>::value ? dynamic_cast<const SpaceL2SqrSift*>(&space) : nullptr) {
+    CHECK_MSG(pVectSpace_ != nullptr || pSiftSpace_ != nullptr,
+              "The space " + space.StrDesc() + " cannot read dense vectors from the file " + fileName);
+  }
+
+  Object* operator()(IdType id, const elem_t* pVect, size_t dim) const {
+    if (pSiftSpace_ != nullptr) {
+      return pSiftSpace_->CreateObjFromUint8Array(id, EMPTY_LABEL, reinterpret_cast<const uint8_t*>(pVect), dim);
+    }
+    return createVectObj(id, pVect, dim, std::is_same<elem_t, dist_t>());
+  }
+
+private:
+  Object* createVectObj(IdType id, const elem_t* pVect, size_t dim, std::true_type) const {
+    return pVectSpace_->CreateObjFromArray(id, EMPTY_LABEL, pVect, dim);
+  }
+  Object* createVectObj(IdType id, const elem_t* pVect, size_t dim, std::false_type) const {
+    if (pSimpleSpace_ != nullptr) {
+      unique_ptr<Object> obj(new Object(id, EMPTY_LABEL, dim * sizeof(dist_t), nullptr));
+      std::copy(pVect, pVect + dim, reinterpret_cast<dist_t*>(obj->data()));
+      return obj.release();
+    }
+    // The space needs a vector of the distance type: the buffer is reused by the thread
+    static thread_local vector<dist_t> vect;
+    vect.assign(pVect, pVect + dim);
+    return pVectSpace_->CreateObjFromArray(id, EMPTY_LABEL, vect.data(), dim);
+  }
+
+  const VectorSpace<dist_t>*                pVectSpace_;
+  const VectorSpaceSimpleStorage<dist_t>*   pSimpleSpace_;
+  const SpaceL2SqrSift*                     pSiftSpace_;
+};
+
+/*
+ * Reads qty vectors of the dimensionality dim, which are recSize bytes apart. If the records
+ * start with their dimensionalities (.*vecs formats), the dimensionality of each vector is checked.
+ */
+template <typename dist_t, typename elem_t>
+static void ReadRawVectors(const Space<dist_t>& space, const string& fileName,
+                           const char* pStart, size_t qty, size_t dim, size_t recSize, bool hasDims,
+                           ObjectArena& arena, ObjectVector& dataset, size_t threadQty) {
+  RawVectorConverter<dist_t, elem_t> converter(space, fileName);
+  CreateObjectsParallel(&arena, qty, threadQty, dataset, [&](size_t i) {
+    const char* pRec = pStart + i * recSize;
+    if (hasDims) {
+      int32_t recDim;
+      memcpy(&recDim, pRec, sizeof(recDim));
+      if (recDim < 0 || size_t(recDim) != dim) {
+        PREPARE_RUNTIME_ERR(err) << "The dimensionality of the vector # " << i << " (" << recDim << ")"
+                                 << " doesn't match the dimensionality of previous vectors (" << dim << ")"
+                                 << " in the file: " << fileName;
+        THROW_RUNTIME_ERR(err);
+      }
+      pRec += sizeof(recDim);
+    }
+    return converter(i, reinterpret_cast<const elem_t*>(pRec), dim);
+  });
+}
+
+template <typename dist_t, typename elem_t>
+static void ReadVecsFile(const Space<dist_t>& space, const string& fileName, const MmapFile& file,
+                         ObjectArena& arena, ObjectVector& dataset, size_t maxQty, size_t threadQty) {
+  if (file.size() == 0) return;
+  CHECK_MSG(file.size() >= sizeof(int32_t), "The file is truncated: " + fileName);
+  int32_t dim;
+  memcpy(&dim, file.data(), sizeof(dim));
+  CHECK_MSG(dim > 0, "Invalid dimensionality " + ConvertToString(dim) + " in the file: " + fileName);
+  size_t recSize = sizeof(int32_t) + dim * sizeof(elem_t);
+  CHECK_MSG(file.size() % recSize == 0,
+            "The size of the file " + fileName + " isn't a multiple of the vector record size " +
+            ConvertToString(recSize) + ": either the file is truncated or vectors have different dimensionalities");
+  size_t qty = std::min(file.size() / recSize, maxQty);
+  ReadRawVectors<dist_t, elem_t>(space, fileName, file.data(), qty, dim, recSize, true, arena, dataset, threadQty);
+}
+
+template <typename dist_t, typename elem_t>
+static void ReadBinFile(const Space<dist_t>& space, const string& fileName, const MmapFile& file,
+                        ObjectArena& arena, ObjectVector& dataset, size_t maxQty, size_t threadQty) {
+  uint32_t qty, dim;
+  const size_t headerSize = sizeof(qty) + sizeof(dim);
+  CHECK_MSG(file.size() >= headerSize, "The file is truncated: " + fileName);
+  memcpy(&qty, file.data(), sizeof(qty));
+  memcpy(&dim, file.data() + sizeof(qty), sizeof(dim));
+  size_t recSize = dim * sizeof(elem_t);
+  CHECK_MSG(file.size() == headerSize + qty * recSize,
+            "The size of the file " + fileName + " doesn't match the number of vectors (" + ConvertToString(qty) +
+            ") and the dimensionality (" + ConvertToString(dim) + ") stored in its header");
+  ReadRawVectors<dist_t, elem_t>(space, fileName, file.data() + headerSize,
+                                 std::min<size_t>(qty, maxQty), dim, recSize, false, arena, dataset, threadQty);
+}
+
+static void ReadObjRecordsFile(const string& fileName, const shared_ptr<MmapFile>& file,
+                               ObjectArena& arena, ObjectVector& dataset, size_t maxQty) {
+  uint64_t magic, qty;
+  const size_t headerSize = sizeof(magic) + sizeof(qty);
+  CHECK_MSG(file->size() >= headerSize, "The file is truncated: " + fileName);
+  memcpy(&magic, file->data(), sizeof(magic));
+  memcpy(&qty, file->data() + sizeof(magic), sizeof(qty));
+  CHECK_MSG(magic == OBJ_RECORDS_MAGIC, "The file " + fileName + " wasn't created by WriteObjRecordsFile");
+
+  qty = std::min<size_t>(qty, maxQty);
+  size_t start = dataset.size();
+  size_t readQty = 0;
+  try {
+    readQty = arena.AttachRecords(file, file->data() + headerSize, file->size() - headerSize, qty, dataset);
+  } catch (const std::exception& e) {
+    throw runtime_error(string(e.what()) + ", file: " + fileName);
+  }
+  if (readQty != qty) {
+    dataset.resize(start);
+    throw runtime_error("The file is truncated: " + fileName);
+  }
+}
+
+template <typename dist_t>
+void ReadMmapDataset(const Space<dist_t>& space,
+                     const string& fileName,
+                     ObjectArena& arena,
+                     ObjectVector& dataset,
+                     vector<string>& vExternIds,
+                     const IdTypeUnsign maxQty,
+                     size_t threadQty) {
+  MmapDatasetFormat format = GetMmapDatasetFormat(fileName);
+  CHECK_MSG(format != MMAP_FORMAT_UNKNOWN, "Unsupported binary dataset format, file: " + fileName);
+  shared_ptr<MmapFile> file(new MmapFile(fileName));
+  size_t qty = maxQty ? maxQty : MAX_DATASET_QTY;
+  size_t start = dataset.size();
+
+  switch (format) {
+    case MMAP_FORMAT_FVECS: ReadVecsFile<dist_t, float>(space, fileName, *file, arena, dataset, qty, threadQty); break;
+    case MMAP_FORMAT_IVECS: ReadVecsFile<dist_t, int32_t>(space, fileName, *file, arena, dataset, qty, threadQty); break;
+    case MMAP_FORMAT_BVECS: ReadVecsFile<dist_t, uint8_t>(space, fileName, *file, arena, dataset, qty, threadQty); break;
+    case MMAP_FORMAT_FBIN: ReadBinFile<dist_t, float>(space, fileName, *file, arena, dataset, qty, threadQty); break;
+    case MMAP_FORMAT_U8BIN: ReadBinFile<dist_t, uint8_t>(space, fileName, *file, arena, dataset, qty, threadQty); break;
+    // Objects point into the mapped file, which is kept by the arena
+    case MMAP_FORMAT_OBJS: ReadObjRecordsFile(fileName, file, arena, dataset, qty); break;
+    default: throw runtime_error("Bug: unexpected format");
+  }
+  vExternIds.resize(vExternIds.size() + dataset.size() - start);
+  LOG(LIB_INFO) << "Read " << (dataset.size() - start) << " objects from the file: " << fileName;
+}
+
+void WriteObjRecordsFile(const ObjectVector& dataset, const string& fileName) {
+  std::ofstream output(fileName, std::ios::binary);
+  CHECK_MSG(output, "Cannot open file '" + fileName + "' for writing");
+  output.exceptions(std::ios::badbit | std::ios::failbit);
+
+  writeBinaryPOD(output, OBJ_RECORDS_MAGIC);
+  writeBinaryPOD(output, uint64_t(dataset.size()));
+  const char padding[ObjectArena::RECORD_ALIGN] = {0};
+  for (const Object* pObj : dataset) {
+    output.write(pObj->buffer(), pObj->bufferlength());
+    output.write(padding, ObjectArena::RecordSize(pObj->datalength()) - pObj->bufferlength());
+  }
+  output.close();
+}
+
+template void ReadMmapDataset<float>(const Space<float>&, const string&, ObjectArena&, ObjectVector&,
+                                     vector<string>&, const IdTypeUnsign, size_t);
+template void ReadMmapDataset<int>(const Space<int>&, const string&, ObjectArena&, ObjectVector&,
+                                   vector<string>&, const IdTypeUnsign, size_t);
+
+}  // namespace similarity
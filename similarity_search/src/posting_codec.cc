@@ -0,0 +1,126 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <cstring>
+
+#include "portable_intrinsics.h"
+#include "posting_codec.h"
+
+namespace similarity {
+
+size_t StreamVByteDeltaEncode(const uint32_t* pIn, size_t qty, uint32_t prev, uint8_t* pOut) {
+  uint8_t* pCtrl = pOut;
+  uint8_t* pData = pOut + (qty + 3) / 4;
+  memset(pCtrl, 0, (qty + 3) / 4);
+
+  for (size_t i = 0; i < qty; ++i) {
+    uint32_t delta = pIn[i] - prev;
+    prev = pIn[i];
+    unsigned len = delta < (1U << 8) ? 1 : delta < (1U << 16) ? 2 : delta < (1U << 24) ? 3 : 4;
+    pCtrl[i / 4] |= (len - 1) << (2 * (i % 4));
+    for (unsigned k = 0; k < len; ++k) {
+      *pData++ = static_cast<uint8_t>(delta >> (8 * k));
+    }
+  }
+  return pData - pOut;
+}
+
+size_t StreamVByteEncodedSize(const uint8_t* pIn, size_t qty) {
+  size_t res = (qty + 3) / 4;
+  for (size_t i = 0; i < qty; ++i) {
+    res += ((pIn[i / 4] >> (2 * (i % 4))) & 3) + 1;
+  }
+  return res;
+}
+
+size_t StreamVByteDeltaDecodeScalar(const uint8_t* pIn, size_t qty, uint32_t prev, uint32_t* pOut) {
+  const uint8_t* pCtrl = pIn;
+  const uint8_t* pData = pIn + (qty + 3) / 4;
+
+  for (size_t i = 0; i < qty; ++i) {
+    unsigned len = ((pCtrl[i / 4] >> (2 * (i % 4))) & 3) + 1;
+    uint32_t delta = 0;
+    for (unsigned k = 0; k < len; ++k) {
+      delta |= uint32_t(*pData++) << (8 * k);
+    }
+    prev += delta;
+    pOut[i] = prev;
+  }
+  return pData - pIn;
+}
+
+#ifdef PORTABLE_SSE4
+/*
+ * For every control byte (four 2-bit lengths), a shuffle mask that moves
+ * data bytes to their 32-bit integers, and the total number of data bytes.
+ */
+struct StreamVByteTables {
+  StreamVByteTables() {
+    for (unsigned c = 0; c < 256; ++c) {
+      unsigned pos = 0;
+      for (unsigned i = 0; i < 4; ++i) {
+        unsigned len = ((c >> (2 * i)) & 3) + 1;
+        for (unsigned k = 0; k < 4; ++k) {
+          shuffle_[c][4 * i + k] = k < len ? static_cast<int8_t>(pos + k) : -1;
+        }
+        pos += len;
+      }
+      len_[c] = pos;
+    }
+  }
+  int8_t  shuffle_[256][16];
+  uint8_t len_[256];
+};
+#endif
+
+size_t StreamVByteDeltaDecode(const uint8_t* pIn, size_t qty, uint32_t prev, uint32_t* pOut) {
+#ifndef PORTABLE_SSE4
+  return StreamVByteDeltaDecodeScalar(pIn, qty, prev, pOut);
+#else
+  static StreamVByteTables tables; // Thread-safe in C++11
+
+  const uint8_t* pCtrl = pIn;
+  const uint8_t* pData = pIn + (qty + 3) / 4;
+  const size_t   qty4 = qty / 4;
+
+  __m128i prevV = _mm_set1_epi32(static_cast<int>(prev));
+  for (size_t i = 0; i < qty4; ++i) {
+    uint8_t c = pCtrl[i];
+    __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pData)),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.shuffle_[c])));
+    pData += tables.len_[c];
+    // Prefix sums of the differences
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+    v = _mm_add_epi32(v, prevV);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 4 * i), v);
+    prevV = _mm_shuffle_epi32(v, 0xFF);
+  }
+  prev = static_cast<uint32_t>(_mm_cvtsi128_si32(prevV));
+
+  // Fewer than four remaining integers
+  for (size_t i = qty4 * 4; i < qty; ++i) {
+    unsigned len = ((pCtrl[i / 4] >> (2 * (i % 4))) & 3) + 1;
+    uint32_t delta = 0;
+    for (unsigned k = 0; k < len; ++k) {
+      delta |= uint32_t(*pData++) << (8 * k);
+    }
+    prev += delta;
+    pOut[i] = prev;
+  }
+  return pData - pIn;
+#endif
+}
+
+}  // namespace similarity
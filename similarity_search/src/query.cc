@@ -26,7 +26,10 @@ template <typename dist_t>
 Query<dist_t>::Query(const Space<dist_t>& space, const Object* query_object)
     : space_(space),
       query_object_(query_object),
-      distance_computations_(0) {
+      distance_computations_(0),
+      has_deadline_(false),
+      truncated_(false),
+      deadline_check_qty_(0) {
 }
 
 template <typename dist_t>
@@ -46,6 +49,8 @@ uint64_t Query<dist_t>::DistanceComputations() const {
 template <typename dist_t>
 void Query<dist_t>::ResetStats() {
   distance_computations_ = 0;
+  truncated_ = false;
+  deadline_check_qty_ = 0;
 }
 
 template <typename dist_t>
@@ -66,6 +71,37 @@ dist_t Query<dist_t>::DistanceObjRight(const Object* object) const {
   return Distance(query_object_, object);
 }
 
+template <typename dist_t>
+dist_t Query<dist_t>::DistanceObjLeftBounded(const Object* object, dist_t maxDist) const {
+  ++distance_computations_;
+  return space_.HiddenDistanceBounded(object, query_object_, maxDist);
+}
+
+template <typename dist_t>
+const size_t Query<dist_t>::DIST_BATCH_QTY;
+
+template <typename dist_t>
+void Query<dist_t>::DistanceObjLeftBatch(const Object* const* objs, size_t n, dist_t* out) const {
+  distance_computations_ += n;
+  space_.DistanceBatch(query_object_, objs, n, out);
+}
+
+template <typename dist_t>
+size_t Query<dist_t>::CheckAndAddToResultBatch(const Object* const* objs, size_t n) {
+  dist_t dists[DIST_BATCH_QTY];
+  size_t res = 0;
+  for (size_t start = 0; start < n; start += DIST_BATCH_QTY) {
+    size_t qty = std::min(n - start, DIST_BATCH_QTY);
+    // The bound can only shrink while objects are added
+    distance_computations_ += qty;
+    space_.DistanceBatchBounded(query_object_, objs + start, qty, DistanceBound(), dists);
+    for (size_t i = 0; i < qty; ++i) {
+      if (CheckAndAddToResult(dists[i], objs[start + i])) ++res;
+    }
+  }
+  return res;
+}
+
 template class Query<float>;
 template class Query<int>;
 template class Query<short int>;
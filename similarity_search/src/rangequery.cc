@@ -78,18 +78,12 @@ bool RangeQuery<dist_t>::CheckAndAddToResult(const dist_t distance,
 template <typename dist_t>
 bool RangeQuery<dist_t>::CheckAndAddToResult(const Object* object) {
   // Distance can be asymmetric, but query is on the left side here
-  return CheckAndAddToResult(this->DistanceObjLeft(object), object);
+  return CheckAndAddToResult(this->DistanceObjLeftBounded(object, radius_), object);
 }
 
 template <typename dist_t>
 size_t RangeQuery<dist_t>::CheckAndAddToResult(const ObjectVector& bucket) {
-  size_t res = 0;
-  for (size_t i = 0; i < bucket.size(); ++i) {
-    if (CheckAndAddToResult(bucket[i])) {
-      ++res;
-    }
-  }
-  return res;
+  return this->CheckAndAddToResultBatch(bucket.data(), bucket.size());
 }
 
 template <typename dist_t>
@@ -12,8 +12,14 @@
  * Apache License Version 2.0 http://www.apache.org/licenses/.
  *
  */
+#include <algorithm>
+#include <fstream>
+#include <thread>
+
 #include <space.h>
 #include <query.h>
+#include <thread_pool.h>
+#include <object_arena.h>
 
 namespace similarity {
 
@@ -24,21 +30,158 @@ template <typename dist_t>
 unique_ptr<DataFileInputState> Space<dist_t>::ReadDataset(ObjectVector& dataset,
                            vector<string>& vExternIds,
                            const string& inputFile,
-                           const IdTypeUnsign MaxNumObjects) const {
+                           const IdTypeUnsign MaxNumObjects,
+                           size_t threadQty,
+                           ObjectArena* arena,
+                           size_t minChunkSize) const {
   CHECK_MSG(MaxNumObjects >=0, "Bug: MaxNumObjects should be >= 0");
   unique_ptr<DataFileInputState> inpState(OpenReadFileHeader(inputFile));
+
+  DataFileInputStateOneFile* pOneFileState = dynamic_cast<DataFileInputStateOneFile*>(inpState.get());
+  bool readAll = !MaxNumObjects || MaxNumObjects == MAX_DATASET_QTY;
+  if (readAll && pOneFileState != nullptr && ReadsOneObjectPerLine()) {
+    ifstream& inpFile = pOneFileState->inp_file_;
+    // everything before the current position is a header
+    streamoff dataStart = inpFile.tellg();
+    inpFile.seekg(0, ios::end);
+    streamoff dataEnd = inpFile.tellg();
+    inpFile.seekg(dataStart);
+
+    if (threadQty == 0) threadQty = std::thread::hardware_concurrency();
+    size_t chunkQty = std::min<size_t>(threadQty, (dataEnd - dataStart) / std::max<size_t>(minChunkSize, 1));
+    if (chunkQty > 1) {
+      ReadDatasetChunks(dataset, vExternIds, inputFile, *inpState, dataStart, dataEnd, chunkQty, arena);
+      inpState->Close();
+      return inpState;
+    }
+  }
+
+  unique_ptr<ObjectArena::Region> region(arena != nullptr ? new ObjectArena::Region(*arena) : nullptr);
   string line;
   LabelType label;
   string externId;
   for (size_t id = 0; id < MaxNumObjects || !MaxNumObjects; ++id) {
     if (!ReadNextObjStr(*inpState, line, label, externId)) break;
-    dataset.push_back(CreateObjFromStr(id, label, line, inpState.get()).release());
+    unique_ptr<Object> obj(CreateObjFromStr(id, label, line, inpState.get()));
+    dataset.push_back(region ? region->Copy(obj.get()) : obj.release());
     vExternIds.push_back(externId);
   }
   inpState->Close();
   return inpState;
 }
 
+/*
+ * Finds the first position (not smaller than pos) where a line starts after a non-empty line.
+ * Readers that skip empty lines cannot cross such a boundary: the preceding non-empty line
+ * is always read by the previous chunk.
+ */
+static streamoff FindChunkStart(ifstream& inpFile, streamoff pos, streamoff end) {
+  inpFile.clear();
+  inpFile.seekg(pos - 2);
+  int prev2 = inpFile.get();
+  int prev1 = inpFile.get();
+  for (; pos < end; ++pos) {
+    if (prev1 == '\n' && prev2 != '\n') return pos;
+    prev2 = prev1;
+    prev1 = inpFile.get();
+    if (prev1 == EOF) break;
+  }
+  return end;
+}
+
+template <typename dist_t>
+void Space<dist_t>::ReadDatasetChunks(ObjectVector& dataset,
+                                      vector<string>& vExternIds,
+                                      const string& inputFile,
+                                      DataFileInputState& inpState,
+                                      streamoff dataStart, streamoff dataEnd,
+                                      size_t chunkQty,
+                                      ObjectArena* arena) const {
+  // Chunk boundaries are computed before parsing, the first line always belongs to the first chunk
+  vector<streamoff> chunkStarts(chunkQty + 1);
+  {
+    ifstream inpFile(inputFile.c_str(), ios::binary);
+    CHECK_MSG(inpFile, "Cannot open file: " + inputFile + " for reading");
+    chunkStarts[0] = dataStart;
+    for (size_t i = 1; i < chunkQty; ++i) {
+      streamoff pos = dataStart + 2 + (dataEnd - dataStart - 2) * i / chunkQty;
+      chunkStarts[i] = FindChunkStart(inpFile, pos, dataEnd);
+    }
+    chunkStarts[chunkQty] = dataEnd;
+  }
+
+  struct Chunk {
+    ObjectVector                    objects;
+    vector<string>                  externIds;
+    unique_ptr<DataFileInputState>  inpState;
+  };
+  vector<Chunk> chunks(chunkQty);
+
+  try {
+    ParallelFor(0, chunkQty, chunkQty, [&](size_t chunkId, size_t threadId) {
+      unique_ptr<ObjectArena::Region> region(arena != nullptr ? new ObjectArena::Region(*arena) : nullptr);
+      Chunk& chunk = chunks[chunkId];
+      chunk.inpState = OpenReadFileHeader(inputFile);
+      ifstream& inpFile = dynamic_cast<DataFileInputStateOneFile&>(*chunk.inpState).inp_file_;
+      inpFile.seekg(chunkStarts[chunkId]);
+
+      string line;
+      LabelType label;
+      string externId;
+      while (inpFile && inpFile.tellg() < chunkStarts[chunkId + 1]) {
+        if (!ReadNextObjStr(*chunk.inpState, line, label, externId)) break;
+        // ids are relative to the chunk start, they are fixed after all chunks are read
+        unique_ptr<Object> obj(CreateObjFromStr(chunk.objects.size(), label, line, chunk.inpState.get()));
+        chunk.objects.push_back(region ? region->Copy(obj.get()) : obj.release());
+        chunk.externIds.push_back(externId);
+      }
+      chunk.inpState->Close();
+    });
+    for (Chunk& chunk : chunks) MergeInputState(inpState, *chunk.inpState);
+  } catch (...) {
+    // Objects created in the arena are freed with the arena
+    if (arena == nullptr) {
+      for (const Chunk& chunk : chunks) {
+        for (const Object* pObj : chunk.objects) delete pObj;
+      }
+    }
+    throw;
+  }
+
+  size_t totalQty = dataset.size();
+  for (const Chunk& chunk : chunks) totalQty += chunk.objects.size();
+  dataset.reserve(totalQty);
+  vExternIds.reserve(vExternIds.size() + totalQty);
+
+  size_t id = 0;
+  for (Chunk& chunk : chunks) {
+    for (size_t i = 0; i < chunk.objects.size(); ++i) {
+      const_cast<Object*>(chunk.objects[i])->SetId(id++);
+      dataset.push_back(chunk.objects[i]);
+      vExternIds.push_back(chunk.externIds[i]);
+    }
+  }
+}
+
+template <typename dist_t>
+void Space<dist_t>::MergeInputState(DataFileInputState& mainState, const DataFileInputState& chunkState) const {
+  DataFileInputStateOneFile* pMainFile = dynamic_cast<DataFileInputStateOneFile*>(&mainState);
+  const DataFileInputStateOneFile* pChunkFile = dynamic_cast<const DataFileInputStateOneFile*>(&chunkState);
+  if (pMainFile != nullptr && pChunkFile != nullptr) {
+    pMainFile->line_num_ += pChunkFile->line_num_;
+  }
+
+  DataFileInputStateVec* pMainVec = dynamic_cast<DataFileInputStateVec*>(&mainState);
+  const DataFileInputStateVec* pChunkVec = dynamic_cast<const DataFileInputStateVec*>(&chunkState);
+  if (pMainVec == nullptr || pChunkVec == nullptr || !pChunkVec->dim_) return;
+  if (pMainVec->dim_ && pMainVec->dim_ != pChunkVec->dim_) {
+    PREPARE_RUNTIME_ERR(err) << "The # of vector elements (" << pChunkVec->dim_ << ")" <<
+                    " doesn't match the # of elements in previous lines. (" << pMainVec->dim_ << " )";
+    THROW_RUNTIME_ERR(err);
+  }
+  pMainVec->dim_ = pChunkVec->dim_;
+}
+
 template <typename dist_t>
 void Space<dist_t>::WriteDataset(const ObjectVector& dataset,
                            const vector<string>& vExternIds,
@@ -56,6 +199,9 @@ void Space<dist_t>::WriteDataset(const ObjectVector& dataset,
   outState->Close();
 }
 
+// Files of spaces with a non-zero data format version start with this value followed by the version
+const size_t BIN_DATA_MAGIC = 0x3154414450534d4eULL; // "NMSPDAT1"
+
 // Doesn't support external IDs, just makes them all empty
 template <typename dist_t>
 unique_ptr<DataFileInputState>
@@ -72,14 +218,29 @@ Space<dist_t>::ReadObjectVectorFromBinData(ObjectVector& data,
   vExternIds.clear();
 
   readBinaryPOD(input, qty);
+  uint32_t version = 0;
+  if (qty == BIN_DATA_MAGIC) {
+    readBinaryPOD(input, version);
+    readBinaryPOD(input, qty);
+  }
+  CHECK_MSG(version == GetBinDataFormatVersion(),
+            "The data file '" + fileName + "' has the format version " + ConvertToString(version) +
+            ", but the space " + StrDesc() + " expects the version " + ConvertToString(GetBinDataFormatVersion()) +
+            ": the data must be re-created from the original input");
 
   for (unsigned i = 0; i < std::min(qty, size_t(maxQty)); ++i) {
     readBinaryPOD(input, objSize);
-    unique_ptr<char []> buf(new char[objSize]);
-    input.read(&buf[0], objSize);
-    // true guarantees that the Object will take ownership of memory
-    // less than ideal, but ok for now
-    data.push_back(new Object(buf.release(), true));
+    IdType id;
+    LabelType label;
+    size_t dataLength;
+    readBinaryPOD(input, id);
+    readBinaryPOD(input, label);
+    readBinaryPOD(input, dataLength);
+    CHECK_MSG(objSize == ID_SIZE + LABEL_SIZE + DATALENGTH_SIZE + dataLength,
+              "Invalid object header in the file: " + fileName);
+    unique_ptr<Object> obj(new Object(id, label, dataLength, nullptr));
+    input.read(obj->data(), dataLength);
+    data.push_back(obj.release());
   }
   
   return unique_ptr<DataFileInputState>(new DataFileInputState());
@@ -95,6 +256,10 @@ void Space<dist_t>::WriteObjectVectorBinData(const ObjectVector& data,
   CHECK_MSG(output, "Cannot open file '" + fileName + "' for writing");
   output.exceptions(std::ios::badbit | std::ios::failbit);
 
+  if (GetBinDataFormatVersion() != 0) {
+    writeBinaryPOD(output, BIN_DATA_MAGIC);
+    writeBinaryPOD(output, GetBinDataFormatVersion());
+  }
   writeBinaryPOD(output, size_t(data.size()));
   for (unsigned i = 0; i < std::min(data.size(), size_t(maxQty)); ++i) {
     const Object* o = data[i];
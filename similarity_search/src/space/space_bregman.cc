@@ -20,6 +20,7 @@
 #include "space/space_bregman.h"
 #include "logging.h"
 #include "distcomp.h"
+#include "simd_math.h"
 #include "experimentconf.h"
 
 namespace similarity {
@@ -63,9 +64,12 @@ dist_t KLDivAbstract<dist_t>::Function(const Object* object) const {
   const dist_t* x = reinterpret_cast<const dist_t*>(object->data());
   const size_t length = GetElemQty(object);
 
+  std::vector<dist_t> logs(length);
+  LogVector(x, &logs[0], length);
+
   dist_t result = 0.0;
   for (size_t i = 0; i < length; ++i) {
-    result += x[i] * log(x[i]);
+    result += x[i] * logs[i];
   }
   return result;
 }
@@ -79,8 +83,9 @@ Object* KLDivAbstract<dist_t>::GradientFunction(const Object* object) const {
   // the caller is responsible for releasing the pointer
   Object* result = Object::CreateNewEmptyObject(object->datalength());
   dist_t* y = reinterpret_cast<dist_t*>(result->data());
+  LogVector(x, y, length);
   for (size_t i = 0; i < length; ++i) {
-    y[i] = log(x[i]) + 1.0;
+    y[i] += 1.0;
   }
   return result;
 }
@@ -95,8 +100,9 @@ Object* KLDivAbstract<dist_t>::InverseGradientFunction(const Object* object) con
   Object* result = Object::CreateNewEmptyObject(object->datalength());
   dist_t* y = reinterpret_cast<dist_t*>(result->data());
   for (size_t i = 0; i < length; ++i) {
-    y[i] = exp(x[i] - 1.0);
+    y[i] = x[i] - 1.0;
   }
+  ExpVector(y, y, length);
   return result;
 }
 
@@ -175,9 +181,12 @@ dist_t ItakuraSaitoFast<dist_t>::Function(const Object* object) const {
   const dist_t* x = reinterpret_cast<const dist_t*>(object->data());
   const size_t length = GetElemQty(object);
 
+  std::vector<dist_t> logs(length);
+  LogVector(x, &logs[0], length);
+
   dist_t result = 0.0;
   for (size_t i = 0; i < length; ++i) {
-    result += - log(x[i]);
+    result += - logs[i];
   }
   return result;
 }
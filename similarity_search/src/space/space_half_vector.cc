@@ -0,0 +1,152 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <iomanip>
+#include <limits>
+#include <memory>
+
+#include "space/space_half_vector.h"
+#include "logging.h"
+#include "my_isnan_isinf.h"
+
+namespace similarity {
+
+using namespace std;
+
+template <HalfFloatType type>
+Object* VectorSpaceHalf<type>::CreateObjFromArray(IdType id, LabelType label, const float* pVect, size_t elemQty) const {
+  unique_ptr<Object> res(new Object(id, label, elemQty * sizeof(uint16_t), NULL));
+  FloatToHalfArray<type>(pVect, reinterpret_cast<uint16_t*>(res->data()), elemQty);
+  return res.release();
+}
+
+template <HalfFloatType type>
+void VectorSpaceHalf<type>::CreateDenseVectFromObj(const Object* obj, float* pVect, size_t nElem) const {
+  const size_t len = GetElemQty(obj);
+  if (nElem > len) {
+    PREPARE_RUNTIME_ERR(err) << __func__ << " The number of requested elements "
+                             << nElem << " is larger than the actual number of elements " << len;
+    THROW_RUNTIME_ERR(err);
+  }
+  HalfToFloatArray<type>(HalfData(obj), pVect, nElem);
+}
+
+template <HalfFloatType type>
+string VectorSpaceHalf<type>::CreateStrFromObj(const Object* pObj, const string& externId /* ignored */) const {
+  stringstream out;
+  const uint16_t* p = HalfData(pObj);
+  const size_t length = GetElemQty(pObj);
+  for (size_t i = 0; i < length; ++i) {
+    if (i) out << " ";
+    // Each 16-bit number is represented by a float exactly
+    out.unsetf(ios_base::floatfield);
+    out << setprecision(numeric_limits<float>::max_digits10) << noshowpoint << HalfToFloat<type>(p[i]);
+  }
+
+  return out.str();
+}
+
+template <HalfFloatType type>
+bool VectorSpaceHalf<type>::ApproxEqual(const Object& obj1, const Object& obj2) const {
+  const size_t len1 = GetElemQty(&obj1);
+  const size_t len2 = GetElemQty(&obj2);
+  if (len1 != len2) {
+    PREPARE_RUNTIME_ERR(err) << "Bug: comparing vectors of different lengths: " << len1 << " and " << len2;
+    THROW_RUNTIME_ERR(err);
+  }
+  const uint16_t* p1 = HalfData(&obj1);
+  const uint16_t* p2 = HalfData(&obj2);
+  for (size_t i = 0; i < len1; ++i) {
+    if (!similarity::ApproxEqual(HalfToFloat<type>(p1[i]), HalfToFloat<type>(p2[i]))) return false;
+  }
+  return true;
+}
+
+template class VectorSpaceHalf<kHalfFloatFP16>;
+template class VectorSpaceHalf<kHalfFloatBF16>;
+
+/*
+ * Non-virtual distance functions: they are called by both HiddenDistance
+ * and (without a virtual call per object) by DistanceBatch.
+ */
+template <HalfFloatType type>
+static float L2DistHalf(const Object* obj1, const Object* obj2) {
+  CHECK(obj1->datalength() > 0);
+  CHECK(obj1->datalength() == obj2->datalength());
+  return sqrt(L2SqrHalf<type>(VectorSpaceHalf<type>::HalfData(obj1), VectorSpaceHalf<type>::HalfData(obj2),
+                              obj1->datalength() / sizeof(uint16_t)));
+}
+
+template <HalfFloatType type>
+static float CosineDistHalf(const Object* obj1, const Object* obj2) {
+  CHECK(obj1->datalength() > 0);
+  CHECK(obj1->datalength() == obj2->datalength());
+  float val = max(float(0), 1 - NormScalarProductHalf<type>(VectorSpaceHalf<type>::HalfData(obj1),
+                                                            VectorSpaceHalf<type>::HalfData(obj2),
+                                                            obj1->datalength() / sizeof(uint16_t)));
+  if (my_isnan(val)) throw runtime_error("Bug: NAN dist! (SpaceCosineSimilarityHalf)");
+  return val;
+}
+
+template <HalfFloatType type>
+static float NegDotProdDistHalf(const Object* obj1, const Object* obj2) {
+  CHECK(obj1->datalength() > 0);
+  CHECK(obj1->datalength() == obj2->datalength());
+  return -ScalarProductHalf<type>(VectorSpaceHalf<type>::HalfData(obj1), VectorSpaceHalf<type>::HalfData(obj2),
+                                  obj1->datalength() / sizeof(uint16_t));
+}
+
+template <HalfFloatType type>
+float SpaceL2Half<type>::HiddenDistance(const Object* obj1, const Object* obj2) const {
+  return L2DistHalf<type>(obj1, obj2);
+}
+
+template <HalfFloatType type>
+void SpaceL2Half<type>::DistanceBatch(const Object* query, const Object* const* objs, size_t n, float* out) const {
+  this->DistanceBatchLoop(query, objs, n, out, L2DistHalf<type>);
+}
+
+template <HalfFloatType type>
+float SpaceCosineSimilarityHalf<type>::HiddenDistance(const Object* obj1, const Object* obj2) const {
+  return CosineDistHalf<type>(obj1, obj2);
+}
+
+template <HalfFloatType type>
+void SpaceCosineSimilarityHalf<type>::DistanceBatch(const Object* query, const Object* const* objs, size_t n,
+                                                    float* out) const {
+  this->DistanceBatchLoop(query, objs, n, out, CosineDistHalf<type>);
+}
+
+template <HalfFloatType type>
+float SpaceNegativeScalarProductHalf<type>::HiddenDistance(const Object* obj1, const Object* obj2) const {
+  return NegDotProdDistHalf<type>(obj1, obj2);
+}
+
+template <HalfFloatType type>
+void SpaceNegativeScalarProductHalf<type>::DistanceBatch(const Object* query, const Object* const* objs, size_t n,
+                                                         float* out) const {
+  this->DistanceBatchLoop(query, objs, n, out, NegDotProdDistHalf<type>);
+}
+
+template class SpaceL2Half<kHalfFloatFP16>;
+template class SpaceL2Half<kHalfFloatBF16>;
+template class SpaceCosineSimilarityHalf<kHalfFloatFP16>;
+template class SpaceCosineSimilarityHalf<kHalfFloatBF16>;
+template class SpaceNegativeScalarProductHalf<kHalfFloatFP16>;
+template class SpaceNegativeScalarProductHalf<kHalfFloatBF16>;
+
+}  // namespace similarity
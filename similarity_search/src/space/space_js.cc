@@ -54,7 +54,7 @@ dist_t SpaceJSBase<dist_t>::JensenShannonFunc(const Object* obj1, const Object*
 
   switch (type_) {
     case kJSSlow:               val = JSStandard(x, y, length); break;
-    case kJSFastPrecomp:        val = JSPrecomp(x, y, length); break;
+    case kJSFastPrecomp:        val = JSPrecompSIMD(x, y, length); break;
     case kJSFastPrecompApprox:  val = JSPrecompSIMDApproxLog(x, y, length); break;
     default: {
                PREPARE_RUNTIME_ERR(err) << "Unknown JS function type code: " << type_;
@@ -135,16 +135,21 @@ void SpaceL2SqrSift::ReadUint8Vec(string line, LabelType& label, vector<uint8_t>
 
 Object* 
 SpaceL2SqrSift::CreateObjFromUint8Vect(IdType id, LabelType label, const vector<uint8_t>& InpVect) const {
-  CHECK_MSG(InpVect.size() == SIFT_DIM, 
-           "Bug or internal error, SIFT vectors dim " + ConvertToString(InpVect.size()) + 
+  return CreateObjFromUint8Array(id, label, InpVect.data(), InpVect.size());
+}
+
+Object* 
+SpaceL2SqrSift::CreateObjFromUint8Array(IdType id, LabelType label, const uint8_t* pVect, size_t elemQty) const {
+  CHECK_MSG(elemQty == SIFT_DIM, 
+           "Bug or internal error, SIFT vectors dim " + ConvertToString(elemQty) + 
            " isn't == " + ConvertToString(SIFT_DIM));
   DistTypeSIFT sum = 0;
   // We precompute and memorize the sum
-  for (DistTypeSIFT e : InpVect) 
-    sum += e * e;
-  unique_ptr<Object> res(new Object(id, label, SIFT_DIM + sizeof(DistTypeSIFT), 
-                                               &InpVect[0]));
+  for (size_t i = 0; i < SIFT_DIM; ++i) 
+    sum += DistTypeSIFT(pVect[i]) * pVect[i];
+  unique_ptr<Object> res(new Object(id, label, SIFT_DIM + sizeof(DistTypeSIFT), NULL));
 
+  memcpy(res->data(), pVect, SIFT_DIM);
   *reinterpret_cast<DistTypeSIFT*>(res->data() + SIFT_DIM) = sum;
   return res.release();
 }
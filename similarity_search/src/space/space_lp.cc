@@ -34,6 +34,18 @@ dist_t SpaceLp<dist_t>::HiddenDistance(const Object* obj1, const Object* obj2) c
   return distObj_(x, y, length);
 }
 
+template <typename dist_t>
+void SpaceLp<dist_t>::DistanceBatch(const Object* query, const Object* const* objs, size_t n, dist_t* out) const {
+  if (distObj_.getCustom() && distObj_.getP() == 2) {
+    this->DenseDistanceBatch(query, objs, n, out, L2SqrSIMDBatch);
+    for (size_t i = 0; i < n; ++i) out[i] = sqrt(out[i]);
+  } else if (distObj_.getCustom() && distObj_.getP() == 1) {
+    this->DenseDistanceBatch(query, objs, n, out, L1NormSIMDBatch);
+  } else {
+    Space<dist_t>::DistanceBatch(query, objs, n, out);
+  }
+}
+
 template <typename dist_t>
 std::string SpaceLp<dist_t>::StrDesc() const {
   std::stringstream stream;
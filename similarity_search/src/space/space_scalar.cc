@@ -38,6 +38,16 @@ dist_t SpaceCosineSimilarity<dist_t>::HiddenDistance(const Object* obj1, const O
   return val;
 }
 
+template <typename dist_t>
+void SpaceCosineSimilarity<dist_t>::DistanceBatch(const Object* query, const Object* const* objs, size_t n,
+                                                  dist_t* out) const {
+  this->DenseDistanceBatch(query, objs, n, out, NormScalarProductSIMDBatch);
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = std::max(dist_t(0), 1 - out[i]);
+    if (my_isnan(out[i])) throw runtime_error("Bug: NAN dist! (SpaceCosineSimilarity)");
+  }
+}
+
 template class SpaceCosineSimilarity<float>;
 
 template <typename dist_t>
@@ -54,6 +64,16 @@ dist_t SpaceAngularDistance<dist_t>::HiddenDistance(const Object* obj1, const Ob
   return val;
 }
 
+template <typename dist_t>
+void SpaceAngularDistance<dist_t>::DistanceBatch(const Object* query, const Object* const* objs, size_t n,
+                                                 dist_t* out) const {
+  this->DenseDistanceBatch(query, objs, n, out, NormScalarProductSIMDBatch);
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = acos(out[i]);
+    if (my_isnan(out[i])) throw runtime_error("Bug: NAN dist! (SpaceAngularDistance)");
+  }
+}
+
 template class SpaceAngularDistance<float>;
 
 template <typename dist_t>
@@ -67,6 +87,13 @@ dist_t SpaceNegativeScalarProduct<dist_t>::HiddenDistance(const Object* obj1, co
   return -ScalarProductSIMD(x, y, length);
 }
 
+template <typename dist_t>
+void SpaceNegativeScalarProduct<dist_t>::DistanceBatch(const Object* query, const Object* const* objs, size_t n,
+                                                       dist_t* out) const {
+  this->DenseDistanceBatch(query, objs, n, out, ScalarProductSIMDBatch);
+  for (size_t i = 0; i < n; ++i) out[i] = -out[i];
+}
+
 template class SpaceNegativeScalarProduct<float>;
 
 }  // namespace similarity
@@ -49,6 +49,13 @@ namespace similarity {
  *
  * <dimension values>
  *
+ * In memory, an object is:
+ *
+ * <# of components>
+ * <offset> <size in bytes> <Euclidean norm>  (one triple per component)
+ * Component data, each one starts at a 16-byte aligned offset:
+ *    packed sparse vectors (see PackSparseElements) or dense float vectors.
+ *
  */
 
 
@@ -192,15 +199,25 @@ SpaceSparseDenseFusion::CreateObjFromStr(IdType id, LabelType label, const strin
     pCompDesc = &vCompDesc_;
   }
 
-  vector<float> vDataBuff; // The buffer stores 4-byte floats and 4-byte unsigned ints
   vector<float> vDense;
   vector<SparseVectElem<float>> vSparse;
 
   unsigned extractStart = 0;
 
-  vector<char> buf;
+  const size_t compQty = pCompDesc->size();
+  CHECK_MSG(compQty <= numeric_limits<uint32_t>::max(), "Too many components: " + ConvertToString(compQty));
+  // The table of components is followed by the component data
+  vector<CompHeader> vHeader(compQty);
+  size_t headerSize = sizeof(uint32_t) + compQty * sizeof(CompHeader);
+  vector<char> buf((headerSize + kCompAlign - 1) / kCompAlign * kCompAlign);
+
+  for (size_t compId = 0; compId < compQty; ++compId) {
+    const auto& e = (*pCompDesc)[compId];
+    size_t oldSize = buf.size();
+    CHECK(oldSize % kCompAlign == 0);
+    CHECK_MSG(oldSize <= numeric_limits<uint32_t>::max(),
+              "The size of the data is huge: " + ConvertToString(oldSize) + " this is likely an bug!");
 
-  for (const auto e : *pCompDesc) {
     if (e.isSparse_) {
       parseSparseBinVect(objStr, vSparse, extractStart); // modifies extractStart
 
@@ -210,116 +227,130 @@ SpaceSparseDenseFusion::CreateObjFromStr(IdType id, LabelType label, const strin
       PackSparseElements(vSparse, pData, dataLen);
       unique_ptr<char[]> data(pData); // data needs to be deleted when out of scope
 
-      size_t oldSize = buf.size();
-      CHECK((oldSize & 3) == 0);
-      size_t padSize = getPad4(dataLen); // To align on 4-byte boundary
-
-      size_t currElemBuffSize = dataLen + 4 + padSize;
-
-      buf.resize(oldSize + currElemBuffSize);
-      CHECK((buf.size() & 3) == 0);
-
       CHECK_MSG(dataLen <= numeric_limits<uint32_t>::max(),
                 "The size of the data is huge: " + ConvertToString(dataLen) + " this is likely an bug!");
 
-      char *pCurrBuffStart = &buf[oldSize];
-      writeBinaryPOD(pCurrBuffStart, (uint32_t) dataLen);
-      memcpy(pCurrBuffStart + 4, pData, dataLen);
-      memset(pCurrBuffStart + dataLen, 0, padSize); // zero padded area
+      float sqSum = 0;
+      for (const auto& el : vSparse) sqSum += el.val_ * el.val_;
 
-    } else {
+      vHeader[compId].offset_ = oldSize;
+      vHeader[compId].len_ = dataLen;
+      vHeader[compId].norm_ = sqrt(sqSum);
 
+      // The padded area is zero-filled by resize
+      buf.resize(oldSize + (dataLen + kCompAlign - 1) / kCompAlign * kCompAlign);
+      memcpy(&buf[oldSize], pData, dataLen);
+    } else {
       parseDenseBinVect(objStr, vDense, extractStart, e.dim_);  // modifies extractStart
-      size_t oldSize = buf.size();
-      CHECK_MSG((oldSize & 3) == 0, "old buffer size: " + ConvertToString(oldSize));
 
       size_t vectSize = e.dim_ * sizeof(float);
-      buf.resize(oldSize + vectSize);
-      CHECK((buf.size() & 3) == 0);
 
-      char *pCurrBuffStart = &buf[oldSize];
-      memcpy(pCurrBuffStart, &vDense[0], vectSize);
+      vHeader[compId].offset_ = oldSize;
+      vHeader[compId].len_ = vectSize;
+      vHeader[compId].norm_ = e.dim_ ? sqrt(ScalarProductSIMD(&vDense[0], &vDense[0], e.dim_)) : 0;
 
+      buf.resize(oldSize + (vectSize + kCompAlign - 1) / kCompAlign * kCompAlign);
+      if (vectSize) memcpy(&buf[oldSize], &vDense[0], vectSize);
     }
   }
 
+  char* pHead = &buf[0];
+  writeBinaryPOD(pHead, (uint32_t) compQty);
+  if (compQty) memcpy(pHead + sizeof(uint32_t), &vHeader[0], compQty * sizeof(CompHeader));
+
   return unique_ptr<Object>(new Object(id, label, buf.size(), &buf[0]));
 }
 
-float SpaceSparseDenseFusion::compDistance(const Object* obj1, const Object* obj2, bool isQueryTime) const {
-  float res = 0;
-
-  unsigned start1 = 0, start2 = 0;
+const SpaceSparseDenseFusion::CompHeader* SpaceSparseDenseFusion::getCompHeaders(const Object* obj) const {
+  const size_t compQty = vCompDesc_.size();
+  uint32_t objCompQty = 0;
+  CHECK_MSG(obj->datalength() >= sizeof(uint32_t) + compQty * sizeof(CompHeader),
+            "datalength()=" + ConvertToString(obj->datalength()) + " is too small for # of components: " +
+            ConvertToString(compQty));
+  readBinaryPOD(obj->data(), objCompQty);
+  CHECK_MSG(objCompQty == compQty,
+            "# of object components: " + ConvertToString(objCompQty) +
+            " doesn't match # of components in the space: " + ConvertToString(compQty));
+  return reinterpret_cast<const CompHeader*>(obj->data() + sizeof(uint32_t));
+}
 
+float SpaceSparseDenseFusion::compDistance(const Object* obj1, const CompHeader* pHead2, const char* pBeg2,
+                                           bool isQueryTime, bool bounded, float maxDist) const {
+  const CompHeader* pHead1 = getCompHeaders(obj1);
   const char* const pBeg1 = obj1->data();
-  const char* const pBeg2 = obj2->data();
+  const vector<uint32_t>& vActiveComp = isQueryTime ? vQueryActiveComp_ : vIndexActiveComp_;
 
-  uint32_t dataLen1, dataLen2 = 0;
+  /*
+   * By Cauchy-Schwarz, the weighted scalar product of the remaining components
+   * cannot exceed the weighted product of their norms. The bound is slightly
+   * loosened to account for rounding errors.
+   */
+  float remainBound = 0;
+  if (bounded) {
+    for (uint32_t compId : vActiveComp) {
+      const CompDesc& e = vCompDesc_[compId];
+      remainBound += (isQueryTime ? e.queryWeight_ : e.indexWeight_) * pHead1[compId].norm_ * pHead2[compId].norm_;
+    }
+    remainBound = remainBound * 1.001f + 1e-5f;
+  }
 
-  for (const auto e : vCompDesc_) {
+  float res = 0;
 
+  for (uint32_t compId : vActiveComp) {
+    const CompDesc& e = vCompDesc_[compId];
+    const CompHeader& h1 = pHead1[compId];
+    const CompHeader& h2 = pHead2[compId];
     float weight = (isQueryTime ? e.queryWeight_ : e.indexWeight_);
-    float val = 0;
 
-    size_t pad1 = 0, pad2 = 0;
+    if (bounded) {
+      if (-(res + remainBound) > maxDist) return -(res + remainBound);
+      remainBound -= weight * h1.norm_ * h2.norm_ * 1.001f;
+    }
 
+    float val;
     if (e.isSparse_) {
-      readBinaryPOD(pBeg1 + start1, dataLen1);
-      start1 += 4;
-      readBinaryPOD(pBeg2 + start2, dataLen2);
-      start2 += 4;
-
-      pad1 = getPad4(dataLen1);
-      pad2 = getPad4(dataLen2);
-
+      val = SparseScalarProductFast(pBeg1 + h1.offset_, h1.len_, pBeg2 + h2.offset_, h2.len_);
     } else {
-      dataLen1 = 4 * e.dim_;
-      dataLen2 = 4 * e.dim_;
-    }
-
-    CHECK_MSG(start1 + dataLen1 + pad1 <= obj1->datalength(),
-              " start1="   + ConvertToString(start1) +
-              " pad1="  + ConvertToString(pad1) +
-              " dataLen1=" + ConvertToString(dataLen1)+
-              " obj1->datalength():" + ConvertToString(obj1->datalength())
-    );
-    CHECK_MSG(start2 + dataLen2 <= obj2->datalength(),
-              " start2=" + ConvertToString(start2) +
-              " pad2=" + ConvertToString(pad2) +
-              " dataLen2=" + ConvertToString(dataLen2) +
-              " obj2->datalength():" + ConvertToString(obj2->datalength())
-    );
-
-    if (weight > numeric_limits<float>::min()) {
-      if (e.isSparse_) {
-        val = SparseScalarProductFast(pBeg1 + start1, dataLen1,
-                                      pBeg2 + start2, dataLen2);
-      } else {
-        val = ScalarProductSIMD(reinterpret_cast<const float*>(pBeg1 + start1),
-                                reinterpret_cast<const float*>(pBeg2 + start2), e.dim_);
-      }
+      val = ScalarProductSIMD(reinterpret_cast<const float*>(pBeg1 + h1.offset_),
+                              reinterpret_cast<const float*>(pBeg2 + h2.offset_), e.dim_);
     }
 
     res += val * weight;
-
-    start1 += dataLen1 + pad1;
-    start2 += dataLen2 + pad2;
   }
 
-  CHECK_MSG(start1 == obj1->datalength(),
-            "start1="+ConvertToString(start1) + " datalength()=" + ConvertToString(obj1->datalength()));
-  CHECK_MSG(start2 == obj2->datalength(),
-            "start1="+ConvertToString(start2) + " datalength()=" + ConvertToString(obj2->datalength()));
-
   return -res;
 }
 
 float SpaceSparseDenseFusion::ProxyDistance(const Object* obj1, const Object* obj2) const {
- return compDistance(obj1, obj2, false /* false for index-time distance */);
+  return compDistance(obj1, getCompHeaders(obj2), obj2->data(),
+                      false /* false for index-time distance */, false, 0);
 }
 
 float SpaceSparseDenseFusion::HiddenDistance(const Object* obj1, const Object* obj2) const {
-  return compDistance(obj1, obj2, true /* true for query-time distance */);
+  return compDistance(obj1, getCompHeaders(obj2), obj2->data(),
+                      true /* true for query-time distance */, false, 0);
+}
+
+float SpaceSparseDenseFusion::HiddenDistanceBounded(const Object* obj1, const Object* obj2, float maxDist) const {
+  return compDistance(obj1, getCompHeaders(obj2), obj2->data(), true, true, maxDist);
+}
+
+void SpaceSparseDenseFusion::DistanceBatch(const Object* query, const Object* const* objs, size_t n,
+                                           float* out) const {
+  const CompHeader* pQueryHead = getCompHeaders(query);
+  DistanceBatchLoop(query, objs, n, out,
+                    [this, pQueryHead](const Object* pObj, const Object* pQuery) {
+                      return compDistance(pObj, pQueryHead, pQuery->data(), true, false, 0);
+                    });
+}
+
+void SpaceSparseDenseFusion::DistanceBatchBounded(const Object* query, const Object* const* objs, size_t n,
+                                                  float maxDist, float* out) const {
+  const CompHeader* pQueryHead = getCompHeaders(query);
+  DistanceBatchLoop(query, objs, n, out,
+                    [this, pQueryHead, maxDist](const Object* pObj, const Object* pQuery) {
+                      return compDistance(pObj, pQueryHead, pQuery->data(), true, true, maxDist);
+                    });
 }
 
 
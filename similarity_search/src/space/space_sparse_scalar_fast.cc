@@ -82,20 +82,16 @@ void SpaceDotProdPivotIndexBase::GenVectElems(const Object& obj, bool bNorm, vec
     UnpackSparseElements(obj.data(), obj.datalength(), pivElems);
   }
   if (bNorm) {
-    size_t            blockQty = 0;
+    size_t            elemQty = 0;
     float             SqSum = 0;
     float             normCoeff = 0;
-    const size_t*     pBlockQty = NULL;
-    const size_t*     pBlockOff = NULL;
+    const uint32_t*   pIds = NULL;
+    const float*      pVals = NULL;
 
-    const char* pBlockBegin = NULL;
-
-    ParseSparseElementHeader(obj.data(), blockQty,
+    ParseSparseElementHeader(obj.data(), elemQty,
                              SqSum, normCoeff,
-                             pBlockQty,
-                             pBlockOff,
-                             pBlockBegin);
-    CHECK(ptrdiff_t(obj.datalength()) >= (pBlockBegin-reinterpret_cast<const char*>(obj.data())));
+                             pIds, pVals);
+    CHECK(obj.datalength() == GetSparsePackedSize<float>(elemQty));
     for (SparseVectElem<float> & e : pivElems) {
       e.val_ *= normCoeff;
     }
@@ -21,21 +21,93 @@
 #include <iomanip>
 #include <limits>
 #include <algorithm>
-#include <Eigen/Dense>
 
 #include "object.h"
 #include "logging.h"
 #include "distcomp.h"
 #include "experimentconf.h"
+#include "simd_math.h"
 #include "space/space_sqfd.h"
 
 namespace similarity {
 
-using Eigen::MatrixXd;
-using Eigen::VectorXd;
-
 using namespace std;
 
+void SqfdMinusSimBatch(float* pVals, size_t qty) {
+  size_t i = 0;
+#ifdef PORTABLE_SSE2
+  typedef SIMDMathOps<SIMDMathWidest> Ops;
+  for (; i + Ops::kQty <= qty; i += Ops::kQty) {
+    Ops::Store(pVals + i, Ops::Sub(Ops::Zero(), Ops::Sqrt(Ops::Load(pVals + i))));
+  }
+#endif
+  for (; i < qty; ++i) pVals[i] = -sqrt(pVals[i]);
+}
+
+void SqfdHeuristicSimBatch(float* pVals, size_t qty, float alpha) {
+  size_t i = 0;
+#ifdef PORTABLE_SSE2
+  typedef SIMDMathOps<SIMDMathWidest> Ops;
+  SIMDMathVect one = Ops::Set1(1.0f), alphaV = Ops::Set1(alpha);
+  for (; i + Ops::kQty <= qty; i += Ops::kQty) {
+    Ops::Store(pVals + i, Ops::Div(one, Ops::Add(alphaV, Ops::Sqrt(Ops::Load(pVals + i)))));
+  }
+#endif
+  for (; i < qty; ++i) pVals[i] = 1.0f / (alpha + sqrt(pVals[i]));
+}
+
+void SqfdGaussianSimBatch(float* pVals, size_t qty, float alpha) {
+  size_t i = 0;
+#ifdef PORTABLE_SSE2
+  typedef SIMDMathOps<SIMDMathWidest> Ops;
+  SIMDMathVect negAlpha = Ops::Set1(-alpha);
+  for (; i + Ops::kQty <= qty; i += Ops::kQty) {
+    Ops::Store(pVals + i, ExpSIMD(Ops::Mul(negAlpha, Ops::Load(pVals + i))));
+  }
+#endif
+  for (; i < qty; ++i) pVals[i] = ExpPoly(-alpha * pVals[i]);
+}
+
+// Squared distances from the centroid pVect to all transposed centroids
+static void SqrDistToTransposed(const float* pCentroids, uint32_t stride, uint32_t featureDim,
+                                const float* pVect, float* pOut) {
+  uint32_t i = 0;
+#ifdef PORTABLE_SSE2
+  typedef SIMDMathOps<SIMDMathWidest> Ops;
+  // stride is a multiple of kPadQty, which is a multiple of the vector size
+  for (; i < stride; i += Ops::kQty) {
+    SIMDMathVect sum = Ops::Zero();
+    for (uint32_t k = 0; k < featureDim; ++k) {
+      SIMDMathVect diff = Ops::Sub(Ops::Load(pCentroids + k * stride + i), Ops::Set1(pVect[k]));
+      sum = Ops::Add(sum, Ops::Mul(diff, diff));
+    }
+    Ops::Store(pOut + i, sum);
+  }
+#endif
+  for (; i < stride; ++i) {
+    float sum = 0;
+    for (uint32_t k = 0; k < featureDim; ++k) {
+      float diff = pCentroids[k * stride + i] - pVect[k];
+      sum += diff * diff;
+    }
+    pOut[i] = sum;
+  }
+}
+
+static void CheckSqfdObjectSize(const Object* obj) {
+  if (obj->datalength() < 8) {
+    PREPARE_RUNTIME_ERR(err) << "Bug: object size " << obj->datalength() << " is smaller than 8 bytes!";
+    THROW_RUNTIME_ERR(err);
+  }
+}
+
+// The size of the data without the self-similarity term
+template <typename dist_t>
+static size_t SqfdCentroidDataLength(const Object* obj) {
+  const uint32_t* h = reinterpret_cast<const uint32_t*>(obj->data());
+  return 2 * sizeof(uint32_t) + size_t(h[0]) * (h[1] + 1) * sizeof(dist_t);
+}
+
 template <typename dist_t>
 SpaceSqfd<dist_t>::SpaceSqfd(SqfdFunction<dist_t>* func)
     : func_(func) {
@@ -229,9 +301,10 @@ unique_ptr<Object> SpaceSqfd<dist_t>::CreateObjFromStr(IdType id, LabelType labe
 
   const uint32_t feature_weight = prevQty;
   const uint32_t num_clusters = obj.size() / prevQty;
-  const int object_size =
+  const int centroid_data_size =
         2 * sizeof(uint32_t) + // num_clusters & feature_dimension
         num_clusters * feature_weight * sizeof(dist_t);
+  const int object_size = centroid_data_size + sizeof(double); // + the self-similarity term
 
   vector<char> buf(object_size);
   uint32_t* h = reinterpret_cast<uint32_t*>(&buf[0]);
@@ -241,6 +314,11 @@ unique_ptr<Object> SpaceSqfd<dist_t>::CreateObjFromStr(IdType id, LabelType labe
   dist_t* pVect = reinterpret_cast<dist_t*>(h+2);
   copy(obj.begin(), obj.end(), pVect);
 
+  // SelfSum computes the term, because the object doesn't have it yet
+  Object tmp(id, label, centroid_data_size, &buf[0]);
+  double selfSum = SelfSum(&tmp);
+  memcpy(&buf[centroid_data_size], &selfSum, sizeof(selfSum));
+
   return unique_ptr<Object>(new Object(id, label, object_size, &buf[0]));
 }
 
@@ -277,6 +355,70 @@ bool SpaceSqfd<dist_t>::ReadNextObjStr(DataFileInputState &inpState, string& str
   return true;
 }
 
+template <typename dist_t>
+void SpaceSqfd<dist_t>::TransposeCentroids(const Object* obj, TransposedCentroids& res, bool computeSelfSum) const {
+  CheckSqfdObjectSize(obj);
+  const uint32_t* h = reinterpret_cast<const uint32_t*>(obj->data());
+  const uint32_t num_clusters = h[0], feature_dimension = h[1];
+  const dist_t* x = reinterpret_cast<const dist_t*>(obj->data() + 2*sizeof(uint32_t));
+
+  res.num_clusters_ = num_clusters;
+  res.feature_dimension_ = feature_dimension;
+  res.stride_ = (num_clusters + kPadQty - 1) / kPadQty * kPadQty;
+  res.centroids_.assign(size_t(res.stride_) * feature_dimension, 0);
+  res.weights_.resize(num_clusters);
+  for (uint32_t i = 0; i < num_clusters; ++i) {
+    const dist_t* p = x + i * (feature_dimension + 1);
+    for (uint32_t k = 0; k < feature_dimension; ++k) {
+      res.centroids_[k * res.stride_ + i] = p[k];
+    }
+    res.weights_[i] = p[feature_dimension];
+  }
+  res.self_sum_ = computeSelfSum ? SelfSum(obj) : 0;
+}
+
+template <typename dist_t>
+double SpaceSqfd<dist_t>::CrossSum(const TransposedCentroids& tc, const Object* obj, dist_t* pBuf) const {
+  CheckSqfdObjectSize(obj);
+  const uint32_t* h = reinterpret_cast<const uint32_t*>(obj->data());
+  const uint32_t num_clusters = h[0], feature_dimension = h[1];
+  const dist_t* y = reinterpret_cast<const dist_t*>(obj->data() + 2*sizeof(uint32_t));
+  if (feature_dimension != tc.feature_dimension_) {
+    PREPARE_RUNTIME_ERR(err) << "Bug: different feature dimensions: " 
+               << tc.feature_dimension_ << " vs " << feature_dimension;
+    THROW_RUNTIME_ERR(err);
+  }
+
+  double sum = 0;
+  for (uint32_t j = 0; j < num_clusters; ++j) {
+    const dist_t* p = y + j * (feature_dimension + 1);
+    SqrDistToTransposed(&tc.centroids_[0], tc.stride_, feature_dimension, p, pBuf);
+    func_->SimFromSqrDistBatch(pBuf, tc.stride_);
+    sum += double(p[feature_dimension]) * ScalarProductSIMD(pBuf, &tc.weights_[0], tc.num_clusters_);
+  }
+  return sum;
+}
+
+template <typename dist_t>
+double SpaceSqfd<dist_t>::SelfSum(const Object* obj) const {
+  CheckSqfdObjectSize(obj);
+  size_t centroidDataLen = SqfdCentroidDataLength<dist_t>(obj);
+  double res;
+  if (obj->datalength() == centroidDataLen + sizeof(res)) {
+    memcpy(&res, obj->data() + centroidDataLen, sizeof(res));
+    return res;
+  }
+  /*
+   * Objects without the cached term (e.g., created not by CreateObjFromStr):
+   * the same computation as in CreateObjFromStr.
+   */
+  TransposedCentroids tc;
+  TransposeCentroids(obj, tc, false);
+  vector<dist_t> buf(tc.stride_);
+  res = CrossSum(tc, obj, &buf[0]);
+  return res;
+}
+
 template <typename dist_t>
 dist_t SpaceSqfd<dist_t>::HiddenDistance(
     const Object* obj1, const Object* obj2) const {
@@ -290,43 +432,31 @@ dist_t SpaceSqfd<dist_t>::HiddenDistance(
   }
   const uint32_t* h1 = reinterpret_cast<const uint32_t*>(obj1->data());
   const uint32_t* h2 = reinterpret_cast<const uint32_t*>(obj2->data());
-  const uint32_t num_clusters1 = h1[0], feature_dimension1 = h1[1];
-  const uint32_t num_clusters2 = h2[0], feature_dimension2 = h2[1];
-  const dist_t* x = reinterpret_cast<const dist_t*>(
-      obj1->data() + 2*sizeof(uint32_t));
-  const dist_t* y = reinterpret_cast<const dist_t*>(
-      obj2->data() + 2*sizeof(uint32_t));
+  const uint32_t feature_dimension1 = h1[1];
+  const uint32_t feature_dimension2 = h2[1];
   if (feature_dimension1 != feature_dimension2) {
     PREPARE_RUNTIME_ERR(err) << "Bug: different feature dimensions: " 
                << feature_dimension1 << " vs " << feature_dimension2;
     THROW_RUNTIME_ERR(err);
   }
-  const uint32_t sz = num_clusters1 + num_clusters2;
-  VectorXd W(sz);
-  size_t pos = feature_dimension1;
-  for (uint32_t i = 0; i < num_clusters1; ++i) {
-    W(i) = x[pos];
-    pos += feature_dimension1 + 1;
-  }
-  pos = feature_dimension2;
-  for (uint32_t i = 0; i < num_clusters2; ++i) {
-    W(num_clusters1 + i) = -y[pos];
-    pos += feature_dimension2 + 1;
-  }
-  MatrixXd A(sz,sz);
-  for (uint32_t i = 0; i < sz; ++i) {
-    for (uint32_t j = i; j < sz; ++j) {
-      const dist_t* p1 = i < num_clusters1
-          ? x + i * (feature_dimension1 + 1)
-          : y + (i - num_clusters1) * (feature_dimension1 + 1);
-      const dist_t* p2 = j < num_clusters1
-          ? x + j * (feature_dimension1 + 1)
-          : y + (j - num_clusters1) * (feature_dimension1 + 1);
-      A(i,j) = A(j,i) = func_->f(p1, p2, feature_dimension1);
-    }
+  // As in DistanceBatch, the right object (query) is transposed.
+  // The buffers are reused by the thread, so that the distance computation doesn't allocate memory.
+  static thread_local TransposedCentroids tc;
+  static thread_local vector<dist_t> buf;
+  TransposeCentroids(obj2, tc);
+  buf.resize(tc.stride_);
+  return DistanceFromSums(SelfSum(obj1), tc.self_sum_, CrossSum(tc, obj1, &buf[0]));
+}
+
+template <typename dist_t>
+void SpaceSqfd<dist_t>::DistanceBatch(const Object* query, const Object* const* objs, size_t n, dist_t* out) const {
+  TransposedCentroids tc;
+  TransposeCentroids(query, tc);
+  vector<dist_t> buf(tc.stride_);
+  for (size_t i = 0; i < n; ++i) {
+    if (i + 1 < n) PREFETCH(objs[i + 1]->data(), _MM_HINT_T0);
+    out[i] = DistanceFromSums(SelfSum(objs[i]), tc.self_sum_, CrossSum(tc, objs[i], &buf[0]));
   }
-  auto res = W.transpose() * A * W;
-  return sqrt(res(0,0));
 }
 
 template <typename dist_t>
@@ -0,0 +1,113 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bunit.h"
+#include "params.h"
+#include "space.h"
+#include "spacefactory.h"
+#include "knnquery.h"
+#include "utils.h"
+
+namespace similarity {
+
+using std::vector;
+using std::string;
+using std::unique_ptr;
+using std::stringstream;
+
+enum BatchTestFormat { kDensePositive, kDenseSigned, kSparse, kBits };
+
+static string GenBatchTestStr(BatchTestFormat fmt, size_t dim) {
+  stringstream str;
+  for (size_t i = 0; i < dim; ++i) {
+    if (i) str << " ";
+    switch (fmt) {
+      case kDensePositive: str << (0.01f + RandomReal<float>()); break;
+      case kDenseSigned:   str << (2 * RandomReal<float>() - 1); break;
+      case kSparse:        str << (i * 3 + RandomInt() % 3) << ":" << (0.1f + RandomReal<float>()); break;
+      case kBits:          str << (RandomInt() % 2); break;
+    }
+  }
+  return str.str();
+}
+
+/*
+ * The batch form must produce what the one-at-a-time loop
+ * computes, with data points as left arguments.
+ */
+template <typename dist_t>
+static void TestBatchForSpace(const string& spaceDesc, BatchTestFormat fmt) {
+  string           spaceType;
+  vector<string>   spaceParams;
+  ParseSpaceArg(spaceDesc, spaceType, spaceParams);
+  unique_ptr<Space<dist_t>> space(
+    SpaceFactoryRegistry<dist_t>::Instance().CreateSpace(spaceType, AnyParams(spaceParams)));
+
+  for (size_t dim : {1, 5, 37, 128}) {
+    for (size_t qty : {7, 70}) {
+      unique_ptr<Object> query(space->CreateObjFromStr(-1, -1, GenBatchTestStr(fmt, dim), nullptr));
+      vector<unique_ptr<Object>> objHolder;
+      ObjectVector               objs;
+      for (size_t i = 0; i < qty; ++i) {
+        objHolder.emplace_back(space->CreateObjFromStr(i, -1, GenBatchTestStr(fmt, dim), nullptr));
+        objs.push_back(objHolder.back().get());
+      }
+      vector<dist_t> out(qty);
+      KNNQuery<dist_t> batchQuery(*space, query.get(), 3);
+      batchQuery.DistanceObjLeftBatch(objs.data(), qty, out.data());
+      KNNQuery<dist_t> oneByOneQuery(*space, query.get(), 3);
+      for (size_t i = 0; i < qty; ++i) {
+        dist_t expected = oneByOneQuery.DistanceObjLeft(objs[i]);
+        EXPECT_EQ_EPS(expected, out[i], dist_t(1e-4 * (1 + std::abs(double(expected)))));
+      }
+      EXPECT_EQ(batchQuery.DistanceComputations(), uint64_t(qty));
+
+      KNNQuery<dist_t> knn(*space, query.get(), 3);
+      EXPECT_EQ(knn.CheckAndAddToResultBatch(objs.data(), qty) >= 3, true);
+      EXPECT_EQ(knn.DistanceComputations(), uint64_t(qty));
+      for (const Object* obj : objs) oneByOneQuery.CheckAndAddToResult(obj);
+      EXPECT_EQ(knn.ResultSize(), oneByOneQuery.ResultSize());
+      EXPECT_EQ_EPS(oneByOneQuery.Radius(), knn.Radius(),
+                    dist_t(1e-4 * (1 + std::abs(double(knn.Radius())))));
+    }
+  }
+}
+
+TEST(TestDistanceBatchDense) {
+  for (const char* spaceDesc : {"l2", "l1", "linf", "lp:p=3", "cosinesimil", "angulardist",
+                                  "negdotprod", "l2_fp16", "l2_bf16", "cosinesimil_fp16", "cosinesimil_bf16",
+                                  "negdotprod_fp16", "negdotprod_bf16"}) {
+    TestBatchForSpace<float>(spaceDesc, kDenseSigned);
+  }
+  for (const char* spaceDesc : {"kldivfast", "kldivfastrq", "kldivgenfast", "kldivgenfastrq",
+                                  "itakurasaitofast", "jsdivfast", "jsmetrfast"}) {
+    TestBatchForSpace<float>(spaceDesc, kDensePositive);
+  }
+}
+
+TEST(TestDistanceBatchSparseAndBits) {
+  for (const char* spaceDesc : {"cosinesimil_sparse_fast", "angulardist_sparse_fast",
+                                  "negdotprod_sparse_fast", "querynorm_negdotprod_sparse_fast"}) {
+    TestBatchForSpace<float>(spaceDesc, kSparse);
+  }
+  TestBatchForSpace<int>("bit_hamming", kBits);
+}
+
+}  // namespace similarity
@@ -38,6 +38,9 @@
 #include "permutation_utils.h"
 #include "ztimer.h"
 #include "pow.h"
+#include "simd_math.h"
+#include "half_float.h"
+#include "my_isnan_isinf.h"
 
 #define RANGE          8.0f
 #define RANGE_SMALL    1e-6f
@@ -141,15 +144,6 @@ TEST(NormScalarProductSIMDForZeroVectors) {
   EXPECT_EQ_EPS(NormScalarProductSIMD(allZeros, allOnes, DIM), 0.f, 1e-5f);
 }
 
-TEST(BlockZeros) {
-  for (size_t id = 0 ; id <= 3*65536; id++) {
-    size_t id1 = removeBlockZeros(id);
-   
-    size_t id2 = addBlockZeros(id1); 
-    EXPECT_EQ(id, id2);
-  }
-}
-
 #ifdef DISABLE_LONG_TESTS
 TEST(DISABLE_SparsePackUnpack) {
 #else
@@ -158,6 +152,225 @@ TEST(SparsePackUnpack) {
   TestSparsePackUnpack<float>();
 }
 
+/*
+ * All popcount implementations supported by the CPU must agree with
+ * a bit-by-bit computation (the lengths cover all tails and
+ * several Harley-Seal blocks of the AVX2 version).
+ */
+TEST(BitPopcountImplAgree) {
+  for (size_t qty : {1, 2, 3, 7, 8, 15, 16, 17, 31, 32, 33, 64, 127, 128, 129, 300, 1000}) {
+    const size_t N = 20;
+    vector<uint32_t> arr(N * qty);
+    for (uint32_t& w : arr) w = (uint32_t(RandomInt()) << 16) ^ uint32_t(RandomInt());
+
+    const uint32_t* pQuery = &arr[0];
+    vector<const uint32_t*> vects;
+    vector<unsigned> expHamming, expAnd, expOr;
+    for (size_t i = 0; i < N; ++i) {
+      const uint32_t* pVect = &arr[i * qty];
+      vects.push_back(pVect);
+      unsigned h = 0, a = 0, o = 0;
+      for (size_t w = 0; w < qty; ++w) {
+        for (unsigned k = 0; k < 32; ++k) {
+          unsigned b1 = (pVect[w] >> k) & 1, b2 = (pQuery[w] >> k) & 1;
+          h += b1 ^ b2;
+          a += b1 & b2;
+          o += b1 | b2;
+        }
+      }
+      expHamming.push_back(h);
+      expAnd.push_back(a);
+      expOr.push_back(o);
+    }
+
+    for (BitPopcountImpl impl : {kBitPopcountScalar, kBitPopcountAVX2, kBitPopcountAVX512}) {
+      if (!IsBitPopcountImplSupported(impl)) continue;
+      vector<unsigned> batchRes(N);
+      BitHammingBatch(impl, pQuery, &vects[0], N, qty, &batchRes[0]);
+      for (size_t i = 0; i < N; ++i) {
+        unsigned andQty = 0, orQty = 0;
+        BitAndOrCount(impl, vects[i], pQuery, qty, andQty, orQty);
+        EXPECT_EQ(expHamming[i], BitHamming(impl, vects[i], pQuery, qty));
+        EXPECT_EQ(expHamming[i], batchRes[i]);
+        EXPECT_EQ(expAnd[i], andQty);
+        EXPECT_EQ(expOr[i], orQty);
+      }
+    }
+
+    // The default (dispatched) versions
+    vector<unsigned> batchRes(N), batchAnd(N), batchOr(N);
+    BitHammingBatch(pQuery, &vects[0], N, qty, &batchRes[0]);
+    BitAndOrCountBatch(pQuery, &vects[0], N, qty, &batchAnd[0], &batchOr[0]);
+    for (size_t i = 0; i < N; ++i) {
+      EXPECT_EQ(expHamming[i], BitHamming(vects[i], pQuery, qty));
+      EXPECT_EQ(expHamming[i], batchRes[i]);
+      EXPECT_EQ(expAnd[i], batchAnd[i]);
+      EXPECT_EQ(expOr[i], batchOr[i]);
+    }
+  }
+}
+
+// All fp16 and bf16 numbers (except NaNs) survive a round trip to floats
+TEST(HalfFloatConversion) {
+  for (uint32_t i = 0; i < 65536; ++i) {
+    uint16_t h = uint16_t(i);
+
+    float f = FP16ToFloatSoftware(h);
+    EXPECT_EQ(my_isnan(f), (h & 0x7fff) > 0x7c00);
+    // Hardware conversions make NaNs quiet
+    EXPECT_EQ(my_isnan(f), my_isnan(FP16ToFloat(h)));
+    if (!my_isnan(f)) {
+      EXPECT_EQ(FloatAsBits(f), FloatAsBits(FP16ToFloat(h)));
+      EXPECT_EQ(h, FloatToFP16Software(f));
+      EXPECT_EQ(h, FloatToFP16(f));
+    }
+
+    float b = BF16ToFloat(h);
+    EXPECT_EQ(my_isnan(b), (h & 0x7fff) > 0x7f80);
+    EXPECT_EQ(my_isnan(b), my_isnan(BF16ToFloat(FloatToBF16(b))));
+    if (!my_isnan(b)) EXPECT_EQ(h, FloatToBF16(b));
+  }
+  // Rounding to the nearest even, overflows, and denormals
+  const float one = 1.0f;
+  EXPECT_EQ(uint16_t(0x3c00), FloatToFP16Software(one + ldexp(one, -11)));
+  EXPECT_EQ(uint16_t(0x3c02), FloatToFP16Software(one + 3 * ldexp(one, -11)));
+  EXPECT_EQ(uint16_t(0x7bff), FloatToFP16Software(65519.0f));
+  EXPECT_EQ(uint16_t(0x7c00), FloatToFP16Software(65520.0f));
+  EXPECT_EQ(uint16_t(0xfc00), FloatToFP16Software(-1e10f));
+  EXPECT_EQ(uint16_t(0x0001), FloatToFP16Software(ldexp(one, -24)));
+  EXPECT_EQ(uint16_t(0x0000), FloatToFP16Software(ldexp(one, -25)));
+  EXPECT_EQ(uint16_t(0x0001), FloatToFP16Software(1.5f * ldexp(one, -25)));
+  EXPECT_EQ(uint16_t(0x3f80), FloatToBF16(one + ldexp(one, -8)));
+  EXPECT_EQ(uint16_t(0x3f82), FloatToBF16(one + 3 * ldexp(one, -8)));
+  EXPECT_EQ(uint16_t(0x7f80), FloatToBF16(numeric_limits<float>::max()));
+  // Software and hardware conversions must agree
+  for (size_t i = 0; i < 100000; ++i) {
+    float f = (RandomInt() % 2 ? 1 : -1) * exp(RandomReal<float>() * 40 - 25);
+    EXPECT_EQ(FloatToFP16Software(f), FloatToFP16(f));
+  }
+}
+
+/*
+ * All implementations of fp16/bf16 distances must agree with
+ * a double-precision computation over converted numbers.
+ */
+template <HalfFloatType type>
+void TestHalfFloatImplAgree() {
+  for (size_t qty : {1, 2, 7, 8, 9, 15, 16, 17, 31, 32, 33, 64, 100, 128, 300, 768, 1000}) {
+    vector<float> v1(qty), v2(qty);
+    vector<uint16_t> h1(qty), h2(qty);
+    GenRandVect(&v1[0], qty, -1.0f, 1.0f);
+    GenRandVect(&v2[0], qty, -1.0f, 1.0f);
+    FloatToHalfArray<type>(&v1[0], &h1[0], qty);
+    FloatToHalfArray<type>(&v2[0], &h2[0], qty);
+
+    double l2 = 0, dot = 0, absDot = 0, norm1 = 0, norm2 = 0;
+    for (size_t i = 0; i < qty; ++i) {
+      double x = HalfToFloat<type>(h1[i]), y = HalfToFloat<type>(h2[i]);
+      l2 += (x - y) * (x - y);
+      dot += x * y;
+      absDot += fabs(x * y);
+      norm1 += x * x;
+      norm2 += y * y;
+    }
+    double normDot = dot / sqrt(norm1) / sqrt(norm2);
+    const double eps = 1e-5;
+
+    for (HalfFloatImpl impl : {kHalfFloatScalar, kHalfFloatAVX2, kHalfFloatAVX512, kHalfFloatAVX512BF16}) {
+      if (!IsHalfFloatImplSupported(impl)) continue;
+      EXPECT_EQ_EPS(l2, double(L2SqrHalf<type>(impl, &h1[0], &h2[0], qty)), eps * l2);
+      EXPECT_EQ_EPS(dot, double(ScalarProductHalf<type>(impl, &h1[0], &h2[0], qty)), eps * absDot);
+      EXPECT_EQ_EPS(normDot, double(NormScalarProductHalf<type>(impl, &h1[0], &h2[0], qty)), eps * (1 + absDot / sqrt(norm1 * norm2)));
+    }
+    EXPECT_EQ_EPS(l2, double(L2SqrHalf<type>(&h1[0], &h2[0], qty)), eps * l2);
+    EXPECT_EQ_EPS(dot, double(ScalarProductHalf<type>(&h1[0], &h2[0], qty)), eps * absDot);
+  }
+}
+
+TEST(HalfFloatImplAgree) {
+  TestHalfFloatImplAgree<kHalfFloatFP16>();
+  TestHalfFloatImplAgree<kHalfFloatBF16>();
+}
+
+// fp16/bf16 spaces compute the same distances as float spaces over rounded vectors
+TEST(HalfVectorSpaceDist) {
+  const pair<const char*, const char*> spaces[] = {
+    {"l2_fp16", "l2"}, {"l2_bf16", "l2"}, {"cosinesimil_fp16", "cosinesimil"},
+    {"cosinesimil_bf16", "cosinesimil"}, {"negdotprod_fp16", "negdotprod"}, {"negdotprod_bf16", "negdotprod"}
+  };
+  for (const auto& spaceNames : spaces) {
+    unique_ptr<Space<float>> halfSpace(SpaceFactoryRegistry<float>::Instance().CreateSpace(spaceNames.first, AnyParams()));
+    unique_ptr<Space<float>> floatSpace(SpaceFactoryRegistry<float>::Instance().CreateSpace(spaceNames.second, AnyParams()));
+    const VectorSpace<float>* pHalfSpace = dynamic_cast<const VectorSpace<float>*>(halfSpace.get());
+    const VectorSpace<float>* pFloatSpace = dynamic_cast<const VectorSpace<float>*>(floatSpace.get());
+
+    for (size_t dim : {3, 16, 100, 768}) {
+      vector<float> v1(dim), v2(dim);
+      GenRandVect(&v1[0], dim, -1.0f, 1.0f);
+      GenRandVect(&v2[0], dim, -1.0f, 1.0f);
+      unique_ptr<Object> h1(pHalfSpace->CreateObjFromVect(0, -1, v1));
+      unique_ptr<Object> h2(pHalfSpace->CreateObjFromVect(1, -1, v2));
+      EXPECT_EQ(h1->datalength(), dim * sizeof(uint16_t));
+      // Rounded vectors
+      pHalfSpace->CreateDenseVectFromObj(h1.get(), &v1[0], dim);
+      pHalfSpace->CreateDenseVectFromObj(h2.get(), &v2[0], dim);
+      unique_ptr<Object> f1(pFloatSpace->CreateObjFromVect(0, -1, v1));
+      unique_ptr<Object> f2(pFloatSpace->CreateObjFromVect(1, -1, v2));
+
+      float expDist = floatSpace->IndexTimeDistance(f1.get(), f2.get());
+      EXPECT_EQ_EPS(expDist, halfSpace->IndexTimeDistance(h1.get(), h2.get()), 1e-4f * (1 + fabs(expDist)));
+    }
+  }
+}
+
+/*
+ * Intersection of 32-bit ids: both the block-wise SIMD merge and
+ * galloping (for lists whose lengths differ a lot) are exercised.
+ */
+TEST(SparseScalarProductFastAgree) {
+  const uint32_t maxIds[] = {50, 70000, 1u << 20, numeric_limits<uint32_t>::max()};
+  const size_t   qtys[] = {0, 1, 3, 17, 64, 500, 5000};
+
+  for (uint32_t maxId : maxIds)
+  for (size_t qty1 : qtys)
+  for (size_t qty2 : qtys) {
+    vector<SparseVectElem<float>> elems[2];
+    size_t qtys12[2] = {qty1, qty2};
+    for (size_t k = 0; k < 2; ++k) {
+      vector<uint32_t> ids;
+      // The id 0 and the maximum id are always possible
+      for (size_t i = 0; i < qtys12[k]; ++i) {
+        uint32_t id = RandomInt() % 4 == 0 ? uint32_t(RandomInt() % 4) * (maxId / 3) :
+                      uint32_t((uint64_t(RandomInt()) * 65599 + RandomInt()) % (uint64_t(maxId) + 1));
+        ids.push_back(id);
+      }
+      sort(ids.begin(), ids.end());
+      ids.erase(unique(ids.begin(), ids.end()), ids.end());
+      for (uint32_t id : ids) elems[k].push_back(SparseVectElem<float>(id, RandomReal<float>() + 0.1f));
+    }
+    if (elems[0].empty() || elems[1].empty()) continue;
+
+    float expected = 0;
+    for (size_t i1 = 0, i2 = 0; i1 < elems[0].size() && i2 < elems[1].size();) {
+      if (elems[0][i1].id_ == elems[1][i2].id_) {
+        expected += elems[0][i1++].val_ * elems[1][i2++].val_;
+      } else if (elems[0][i1].id_ < elems[1][i2].id_) ++i1; else ++i2;
+    }
+
+    char* pBuff1 = NULL;
+    char* pBuff2 = NULL;
+    size_t dataLen1 = 0, dataLen2 = 0;
+    PackSparseElements(elems[0], pBuff1, dataLen1);
+    PackSparseElements(elems[1], pBuff2, dataLen2);
+    unique_ptr<char[]> buff1(pBuff1), buff2(pBuff2);
+
+    float res = SparseScalarProductFast(pBuff1, dataLen1, pBuff2, dataLen2);
+    EXPECT_EQ_EPS(expected, res, 1e-4f * max(1.0f, expected));
+    res = SparseScalarProductFast(pBuff2, dataLen2, pBuff1, dataLen1);
+    EXPECT_EQ_EPS(expected, res, 1e-4f * max(1.0f, expected));
+  }
+}
+
 TEST(TestEfficientPower) {
   double f = 2.0;
 
@@ -187,6 +400,76 @@ TEST(TestEfficientFract) {
   }  
 }
 
+/*
+ * SIMD and scalar versions must agree with each other
+ * and stay within the declared relative error.
+ */
+template <SIMDMathAccuracy acc>
+void TestSIMDMathAgree(double maxRelErr) {
+  vector<float> args, powArgs;
+  for (float x = 1e-30f; x < 1e30f; x *= 1.0137f) args.push_back(x);
+  for (size_t i = 0; i < 10000; ++i) args.push_back(0.5f + RandomReal<float>());
+  while (args.size() % 4) args.push_back(1);
+  for (size_t i = 0; i < args.size(); ++i) powArgs.push_back(4 * RandomReal<float>() - 2);
+
+  double maxLogErr = 0, maxExpErr = 0, maxPowErr = 0;
+
+  for (size_t i = 0; i < args.size(); i += 4) {
+    float PORTABLE_ALIGN16 resLog[4], resExp[4], resPow[4];
+    // Logarithms of arguments cover the range of exp
+    float PORTABLE_ALIGN16 logs[4];
+    for (size_t k = 0; k < 4; ++k) logs[k] = LogPoly<kSIMDMathAccurate>(args[i + k]);
+#ifdef PORTABLE_SSE2
+    _mm_store_ps(resLog, LogSIMD<acc>(_mm_loadu_ps(&args[i])));
+    _mm_store_ps(resExp, ExpSIMD<acc>(_mm_load_ps(logs)));
+    _mm_store_ps(resPow, PowSIMD<acc>(_mm_loadu_ps(&args[i]), _mm_set1_ps(powArgs[i])));
+#endif
+    for (size_t k = 0; k < 4; ++k) {
+      float  v = args[i + k];
+      float  lv = logs[k];
+      double expLog = std::log(double(v));
+      double expExp = std::exp(double(lv));
+      double expPow = std::pow(double(v), double(powArgs[i]));
+      // Absolute error for logs: their values are close to zero for arguments close to one
+      double errLog = std::fabs(LogPoly<acc>(v) - expLog) / std::max(std::fabs(expLog), 1.0);
+      double errExp = std::fabs(ExpPoly<acc>(lv) - expExp) / expExp;
+#ifdef PORTABLE_SSE2
+      EXPECT_EQ_EPS(LogPoly<acc>(v), resLog[k], 1e-6f * std::max(std::fabs(resLog[k]), 1.0f));
+      EXPECT_EQ_EPS(ExpPoly<acc>(lv), resExp[k], 1e-6f * resExp[k]);
+      if (expPow > 1e-30 && expPow < 1e30) {
+        double errPow = std::fabs(resPow[k] - expPow) / expPow;
+        maxPowErr = std::max(maxPowErr, errPow);
+      }
+#endif
+      maxLogErr = std::max(maxLogErr, errLog);
+      maxExpErr = std::max(maxExpErr, errExp);
+    }
+  }
+  // Vector versions use the widest available SIMD type
+  vector<float> vectLog(args.size()), vectExp(args.size());
+  LogVector(&args[0], &vectLog[0], args.size());
+  ExpVector(&vectLog[0], &vectExp[0], args.size());
+  for (size_t i = 0; i < args.size(); ++i) {
+    EXPECT_EQ_EPS(LogPoly(args[i]), vectLog[i], 1e-6f * std::max(std::fabs(vectLog[i]), 1.0f));
+    EXPECT_EQ_EPS(ExpPoly(vectLog[i]), vectExp[i], 1e-6f * vectExp[i]);
+  }
+  LOG(LIB_INFO) << "Accuracy: " << acc << " max. rel. error log: " << maxLogErr
+                << " exp: " << maxExpErr << " pow: " << maxPowErr;
+  EXPECT_EQ(maxLogErr < maxRelErr, true);
+  EXPECT_EQ(maxExpErr < maxRelErr, true);
+  // Errors of log are amplified: pow = exp(p * log(x)), |p * log(x)| <= 2 * 69
+  EXPECT_EQ(maxPowErr < 200 * maxRelErr, true);
+}
+
+TEST(TestSIMDMath) {
+  TestSIMDMathAgree<kSIMDMathAccurate>(5e-7);
+  TestSIMDMathAgree<kSIMDMathFast>(1e-5);
+
+  EXPECT_EQ(ExpPoly(-100.0f), 0.0f);
+  EXPECT_EQ(std::isfinite(ExpPoly(100.0f)), true);
+  EXPECT_EQ_EPS(LogPoly(0.0f), std::log(std::numeric_limits<float>::min()), 1e-4f);
+}
+
 template <class T>
 bool TestScalarProductAgree(size_t N, size_t dim, size_t Rep) {
     vector<T> vect1(dim), vect2(dim);
@@ -716,6 +999,16 @@ bool TestJSAgree(size_t N, size_t dim, size_t Rep, double pZero) {
                 bug = true;
             }
 
+            T val4 = JSPrecompSIMD(pPrecompVect1, pPrecompVect2, dim);
+
+            T AbsDiff4 = fabs(val4 - val0);
+            T RelDiff4 = AbsDiff4/max(max(fabs(val4),fabs(val0)),T(1e-18));
+
+            if (RelDiff4 > 1e-5 && AbsDiff4 > 1e-5) {
+                cerr << "Bug JS (4) " << typeid(T).name() << " !!! Dim = " << dim << " val0 = " << val0 << " val4 = " << val4 << " Diff: " << (val0 - val4) << " RelDiff4: " << RelDiff4 << " AbsDiff4: " << AbsDiff4 << endl;
+                bug = true;
+            }
+
             T val2 = JSPrecompApproxLog(pPrecompVect1, pPrecompVect2, dim);
             T val3 = JSPrecompSIMDApproxLog(pPrecompVect1, pPrecompVect2, dim);
 
@@ -14,9 +14,13 @@
  */
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "space/space_leven.h"
 #include "distcomp_edist.h"
+#include "knnquery.h"
+#include "rangequery.h"
+#include "utils.h"
 #include "bunit.h"
 #include "testdataset.h"
 
@@ -115,4 +119,93 @@ TEST(EditDistanceLong) {
 
 }
 
+static string GenRandStr(size_t len, size_t alphabetQty) {
+  string res;
+  for (size_t i = 0; i < len; ++i) res.push_back(char('a' + RandomInt() % alphabetQty));
+  return res;
+}
+
+/*
+ * Bit-parallel versions must agree with the classic DP, including
+ * multi-block patterns (longer than 64 characters) and non-ASCII characters.
+ */
+TEST(EditDistanceBitParallel) {
+  for (size_t iter = 0; iter < 2000; ++iter) {
+    size_t alphabetQty = 1 + RandomInt() % 26;
+    size_t maxLen = iter % 4 ? 70 : 300;
+    string s1 = GenRandStr(RandomInt() % maxLen, alphabetQty);
+    string s2 = iter % 3 ? GenRandStr(RandomInt() % maxLen, alphabetQty) : s1;
+    // Random edits make close strings, which are the interesting case for the bounded version
+    for (size_t k = RandomInt() % 8; k > 0 && !s2.empty(); --k) s2[RandomInt() % s2.size()] = char(0xF0 + k);
+
+    int expected = levenshtein(s1, s2);
+    EXPECT_EQ(expected, levenshteinBitParallel(s1.c_str(), s1.size(), s2.c_str(), s2.size()));
+    EXPECT_EQ(expected, levenshteinBitParallel(s2.c_str(), s2.size(), s1.c_str(), s1.size()));
+
+    LevenshteinBitParallel pattern(s1.c_str(), s1.size());
+    EXPECT_EQ(expected, pattern.Distance(s2.c_str(), s2.size()));
+
+    for (int maxDist : {-1, 0, 1, expected - 1, expected, expected + 1, int(RandomInt() % 300)}) {
+      int d1 = levenshteinBitParallelBounded(s1.c_str(), s1.size(), s2.c_str(), s2.size(), maxDist);
+      int d2 = pattern.DistanceBounded(s2.c_str(), s2.size(), maxDist);
+      if (expected <= maxDist) {
+        EXPECT_EQ(expected, d1);
+        EXPECT_EQ(expected, d2);
+      } else {
+        EXPECT_EQ(d1 > maxDist && d1 <= expected, true);
+        EXPECT_EQ(d2 > maxDist && d2 <= expected, true);
+      }
+    }
+  }
+}
+
+/*
+ * Queries compute bounded distances: results must be the same
+ * as the ones obtained with exact distances.
+ */
+template <class SpaceType, typename dist_t>
+static void TestEditDistanceQueries(SpaceType& space, const vector<string>& strs, dist_t radius) {
+  ObjectVector data;
+  vector<unique_ptr<Object>> objHolder;
+  for (size_t i = 1; i < strs.size(); ++i) {
+    objHolder.emplace_back(space.CreateObjFromStr(i, -1, strs[i], NULL));
+    data.push_back(objHolder.back().get());
+  }
+  unique_ptr<Object> queryObj(space.CreateObjFromStr(0, -1, strs[0], NULL));
+
+  KNNQuery<dist_t> knnOneByOne(space, queryObj.get(), 5);
+  KNNQuery<dist_t> knnBatch(space, queryObj.get(), 5);
+  KNNQuery<dist_t> knnExact(space, queryObj.get(), 5);
+  RangeQuery<dist_t> rangeOneByOne(space, queryObj.get(), radius);
+  RangeQuery<dist_t> rangeBatch(space, queryObj.get(), radius);
+  for (const Object* pObj : data) {
+    knnOneByOne.CheckAndAddToResult(pObj);
+    rangeOneByOne.CheckAndAddToResult(pObj);
+    knnExact.CheckAndAddToResult(knnExact.DistanceObjLeft(pObj), pObj);
+  }
+  knnBatch.CheckAndAddToResult(data);
+  rangeBatch.CheckAndAddToResult(data);
+
+  EXPECT_EQ(knnExact.Equals(&knnOneByOne), true);
+  EXPECT_EQ(knnExact.Equals(&knnBatch), true);
+  EXPECT_EQ(rangeOneByOne.ResultSize(), rangeBatch.ResultSize());
+  for (size_t i = 0; i < rangeBatch.ResultSize(); ++i) {
+    dist_t dist = (*rangeBatch.ResultDists())[i];
+    EXPECT_EQ(dist <= radius, true);
+    EXPECT_EQ(dist, rangeBatch.DistanceObjLeft((*rangeBatch.Result())[i]));
+  }
+}
+
+TEST(EditDistanceBoundedQueries) {
+  vector<string> strs;
+  for (size_t i = 0; i < 500; ++i) {
+    // Mostly short strings, but some of them need several blocks
+    strs.push_back(GenRandStr(1 + RandomInt() % (i % 10 ? 20 : 150), 4));
+  }
+  SpaceLevenshtein space;
+  TestEditDistanceQueries<SpaceLevenshtein, int>(space, strs, 8);
+  SpaceLevenshteinNormalized spaceNorm;
+  TestEditDistanceQueries<SpaceLevenshteinNormalized, float>(spaceNorm, strs, 0.4f);
+}
+
 }  // namespace similarity
@@ -0,0 +1,115 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bunit.h"
+#include "space.h"
+#include "spacefactory.h"
+#include "methodfactory.h"
+#include "knnquery.h"
+#include "knnqueue.h"
+#include "utils.h"
+
+namespace similarity {
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+using std::set;
+using std::stringstream;
+
+const size_t BIT_TEST_DIM = 256;
+
+// Bit vectors are noisy copies of cluster centers: each bit is flipped with the probability 0.25
+static string GenBitTestStr(const vector<bool>& center) {
+  stringstream str;
+  for (size_t k = 0; k < center.size(); ++k) {
+    if (k) str << " ";
+    str << (center[k] != (RandomInt() % 4 == 0));
+  }
+  return str.str();
+}
+
+/*
+ * HNSW has optimized (popcount-based) distance functions for bit_hamming and bit_jaccard.
+ * With a realistic ef, the recall must be high and result distances must be the same
+ * as those computed by the space.
+ */
+template <typename dist_t>
+static void TestHnswBitSpace(const string& spaceType, float minRecall) {
+  const size_t dataQty = 2000, queryQty = 50, clusterQty = 200;
+  const unsigned K = 10;
+  unique_ptr<Space<dist_t>> space(SpaceFactoryRegistry<dist_t>::Instance().CreateSpace(spaceType, AnyParams()));
+
+  vector<vector<bool>> centers(clusterQty, vector<bool>(BIT_TEST_DIM));
+  for (auto& c : centers) {
+    for (size_t k = 0; k < BIT_TEST_DIM; ++k) c[k] = RandomInt() % 2;
+  }
+
+  ObjectVector data;
+  for (size_t i = 0; i < dataQty; ++i) {
+    data.push_back(space->CreateObjFromStr(i, -1, GenBitTestStr(centers[i % clusterQty]), nullptr).release());
+  }
+
+  unique_ptr<Index<dist_t>> index(MethodFactoryRegistry<dist_t>::Instance().
+                                  CreateMethod(false, "hnsw", spaceType, *space, data));
+  index->CreateIndex(AnyParams({"M=16", "efConstruction=100"}));
+  index->SetQueryTimeParams(AnyParams({"ef=100"}));
+
+  size_t foundQty = 0;
+  for (size_t i = 0; i < queryQty; ++i) {
+    unique_ptr<Object> queryObj(space->CreateObjFromStr(-1, -1, GenBitTestStr(centers[RandomInt() % clusterQty]), nullptr));
+
+    KNNQuery<dist_t> exactQuery(*space, queryObj.get(), K);
+    for (const Object* obj : data) exactQuery.CheckAndAddToResult(obj);
+    set<IdType> exactIds;
+    unique_ptr<KNNQueue<dist_t>> exactRes(exactQuery.Result()->Clone());
+    // Ties at the K-th distance are counted as found
+    dist_t maxExactDist = exactRes->TopDistance();
+    while (!exactRes->Empty()) {
+      exactIds.insert(exactRes->TopObject()->id());
+      exactRes->Pop();
+    }
+
+    KNNQuery<dist_t> query(*space, queryObj.get(), K);
+    index->Search(&query, -1);
+    unique_ptr<KNNQueue<dist_t>> res(query.Result()->Clone());
+    EXPECT_EQ(res->Size(), size_t(K));
+    while (!res->Empty()) {
+      const Object* obj = res->TopObject();
+      EXPECT_EQ_EPS(res->TopDistance(), query.DistanceObjLeft(obj), dist_t(1e-5));
+      foundQty += exactIds.count(obj->id()) || res->TopDistance() <= maxExactDist;
+      res->Pop();
+    }
+  }
+  float recall = float(foundQty) / (K * queryQty);
+  EXPECT_EQ(recall >= minRecall, true);
+
+  for (auto e : data) delete e;
+}
+
+TEST(TestHnswBitHamming) {
+  TestHnswBitSpace<int>("bit_hamming", 0.95f);
+}
+
+TEST(TestHnswBitJaccard) {
+  TestHnswBitSpace<float>("bit_jaccard", 0.95f);
+}
+
+}  // namespace similarity
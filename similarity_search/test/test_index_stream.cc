@@ -0,0 +1,110 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bunit.h"
+#include "genrand_vect.h"
+#include "space.h"
+#include "space/space_vector.h"
+#include "spacefactory.h"
+#include "methodfactory.h"
+#include "knnquery.h"
+#include "knnqueue.h"
+
+namespace similarity {
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+using std::stringstream;
+
+/*
+ * An index saved to a memory stream and loaded back
+ * must return exactly the same results as the original one.
+ */
+static void TestIndexStream(const string& methName, const AnyParams& indexParams) {
+  const size_t dim = 16, dataQty = 1000, queryQty = 20;
+  unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().CreateSpace("l2", AnyParams()));
+  const VectorSpace<float>& vectSpace = dynamic_cast<const VectorSpace<float>&>(*space);
+
+  ObjectVector data;
+  vector<float> vect(dim);
+  for (size_t i = 0; i < dataQty; ++i) {
+    GenRandVect(&vect[0], dim);
+    data.push_back(vectSpace.CreateObjFromVect(i, -1, vect));
+  }
+
+  unique_ptr<Index<float>> index(MethodFactoryRegistry<float>::Instance().
+                                 CreateMethod(false, methName, "l2", *space, data));
+  index->CreateIndex(indexParams);
+
+  stringstream buffer;
+  index->SaveIndexToStream(buffer);
+
+  unique_ptr<Index<float>> loaded(MethodFactoryRegistry<float>::Instance().
+                                  CreateMethod(false, methName, "l2", *space, data));
+  loaded->LoadIndexFromStream(buffer);
+  loaded->ResetQueryTimeParams();
+
+  const unsigned K = 10;
+  for (size_t i = 0; i < queryQty; ++i) {
+    GenRandVect(&vect[0], dim);
+    unique_ptr<Object> queryObj(vectSpace.CreateObjFromVect(-1, -1, vect));
+    KNNQuery<float> origQuery(*space, queryObj.get(), K);
+    KNNQuery<float> loadedQuery(*space, queryObj.get(), K);
+    index->Search(&origQuery, -1);
+    loaded->Search(&loadedQuery, -1);
+
+    unique_ptr<KNNQueue<float>> origRes(origQuery.Result()->Clone());
+    unique_ptr<KNNQueue<float>> loadedRes(loadedQuery.Result()->Clone());
+    EXPECT_EQ(origRes->Size(), loadedRes->Size());
+    while (!origRes->Empty() && !loadedRes->Empty()) {
+      EXPECT_EQ(origRes->TopObject()->id(), loadedRes->TopObject()->id());
+      origRes->Pop();
+      loadedRes->Pop();
+    }
+  }
+
+  for (auto e : data) delete e;
+}
+
+TEST(TestIndexStreamHnsw) {
+  TestIndexStream("hnsw", AnyParams({"M=10", "efConstruction=50"}));
+  TestIndexStream("hnsw", AnyParams({"M=10", "efConstruction=50", "skip_optimized_index=1"}));
+}
+
+TEST(TestIndexStreamVPTree) {
+  TestIndexStream("vptree", AnyParams({"bucketSize=10"}));
+}
+
+TEST(TestIndexStreamNotImplemented) {
+  unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().CreateSpace("l2", AnyParams()));
+  ObjectVector data;
+  unique_ptr<Index<float>> index(MethodFactoryRegistry<float>::Instance().
+                                 CreateMethod(false, "seq_search", "l2", *space, data));
+  stringstream buffer;
+  bool thrown = false;
+  try {
+    index->SaveIndexToStream(buffer);
+  } catch (const std::exception&) {
+    thrown = true;
+  }
+  EXPECT_EQ(thrown, true);
+}
+
+}  // namespace similarity
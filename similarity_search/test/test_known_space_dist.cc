@@ -0,0 +1,119 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bunit.h"
+#include "genrand_vect.h"
+#include "params.h"
+#include "space.h"
+#include "spacefactory.h"
+#include "knnquery.h"
+#include "known_space_dist.h"
+
+namespace similarity {
+
+using std::vector;
+using std::string;
+using std::unique_ptr;
+
+struct KnownDistCollect {
+  KnownDistCollect(const Object* pQuery, const ObjectVector& data) : pQuery_(pQuery), data_(data) {}
+
+  template <class DistFunc>
+  void operator()(const DistFunc& distFunc) {
+    for (const Object* pObj : data_) {
+      dists_.push_back(distFunc(reinterpret_cast<const float*>(pObj->data()),
+                                reinterpret_cast<const float*>(pQuery_->data())));
+    }
+  }
+
+  const Object*       pQuery_;
+  const ObjectVector& data_;
+  vector<float>       dists_;
+};
+
+TEST(TestKnownSpaceDist) {
+  const size_t qty = 20;
+
+  for (const char* spaceDesc : {"l2", "lp:p=2", "cosinesimil", "angulardist", "negdotprod",
+                                  "word_embed:dist=l2", "word_embed:dist=cosine"}) {
+    string           spaceType;
+    vector<string>   spaceParams;
+    ParseSpaceArg(spaceDesc, spaceType, spaceParams);
+    unique_ptr<Space<float>> space(
+      SpaceFactoryRegistry<float>::Instance().CreateSpace(spaceType, AnyParams(spaceParams)));
+
+    // Both dimensionalities with compile-time kernels and generic ones
+    for (size_t dim : {1, 37, 64, 96, 100, 128, 960}) {
+      vector<float> vect(dim);
+      vector<unique_ptr<Object>> objHolder;
+      ObjectVector               data;
+      for (size_t i = 0; i <= qty; ++i) {
+        GenRandVect(&vect[0], dim, -1.0f, 1.0f);
+        objHolder.emplace_back(new Object(i, -1, dim * sizeof(float), &vect[0]));
+        if (i < qty) data.push_back(objHolder.back().get());
+      }
+      const Object* pQuery = objHolder.back().get();
+
+      KnownSpaceDist<float> knownDist;
+      knownDist.Init(*space, data);
+      EXPECT_EQ(knownDist.IsKnown(), true);
+      EXPECT_EQ(knownDist.GetDim(), dim);
+      EXPECT_EQ(knownDist.IsCompatible(pQuery), true);
+
+      KnownDistCollect collect(pQuery, data);
+      EXPECT_EQ(knownDist.Visit(collect), true);
+      EXPECT_EQ(collect.dists_.size(), qty);
+
+      KNNQuery<float> query(*space, pQuery, 1);
+      for (size_t i = 0; i < qty; ++i) {
+        float expected = query.DistanceObjLeft(data[i]);
+        EXPECT_EQ_EPS(expected, collect.dists_[i], 1e-5f * (1 + std::abs(expected)));
+      }
+    }
+  }
+}
+
+TEST(TestKnownSpaceDistUnknown) {
+  const size_t dim = 16;
+  vector<float> vect(dim);
+  vector<unique_ptr<Object>> objHolder;
+  ObjectVector               data;
+  for (size_t i = 0; i < 2; ++i) {
+    GenRandVect(&vect[0], dim - i, 0.1f, 1.0f);
+    objHolder.emplace_back(new Object(i, -1, (dim - i) * sizeof(float), &vect[0]));
+    data.push_back(objHolder.back().get());
+  }
+
+  unique_ptr<Space<float>> spaceL1(SpaceFactoryRegistry<float>::Instance().CreateSpace("l1", AnyParams()));
+  KnownSpaceDist<float> knownDist;
+  knownDist.Init(*spaceL1, data);
+  EXPECT_EQ(knownDist.IsKnown(), false);
+
+  // Different dimensionalities: the generic path must be used
+  unique_ptr<Space<float>> spaceL2(SpaceFactoryRegistry<float>::Instance().CreateSpace("l2", AnyParams()));
+  knownDist.Init(*spaceL2, data);
+  EXPECT_EQ(knownDist.IsKnown(), false);
+
+  data.pop_back();
+  knownDist.Init(*spaceL2, data);
+  EXPECT_EQ(knownDist.IsKnown(), true);
+  EXPECT_EQ(knownDist.IsCompatible(objHolder.back().get()), false);
+}
+
+}  // namespace similarity
@@ -0,0 +1,87 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <cstdint>
+
+#include "bunit.h"
+#include "latency_histogram.h"
+#include "thread_pool.h"
+
+namespace similarity {
+
+TEST(TestLogHistogramBuckets) {
+  // Bucket ids are monotonic and each value falls into a bucket, whose range contains it
+  size_t prevId = 0;
+  for (uint64_t val = 0; val < 100000; val += 1 + val / 100) {
+    size_t bucketId = LogHistogram::BucketId(val);
+    EXPECT_EQ(bucketId >= prevId, true);
+    EXPECT_EQ(LogHistogram::BucketMaxValue(bucketId) >= val, true);
+    if (bucketId > 0) {
+      EXPECT_EQ(LogHistogram::BucketMaxValue(bucketId - 1) < val, true);
+    }
+    prevId = bucketId;
+  }
+  uint64_t maxVal = std::numeric_limits<uint64_t>::max();
+  EXPECT_EQ(LogHistogram::BucketId(maxVal) + 1, size_t(LogHistogram::BUCKET_QTY));
+  EXPECT_EQ(LogHistogram::BucketMaxValue(LogHistogram::BucketId(maxVal)), maxVal);
+}
+
+TEST(TestLogHistogramQuantiles) {
+  LogHistogram hist;
+
+  EXPECT_EQ(hist.GetQuantile(0.5), static_cast<uint64_t>(0));
+  for (uint64_t val = 1; val <= 10000; ++val) hist.Add(val);
+
+  EXPECT_EQ(hist.GetCount(), static_cast<uint64_t>(10000));
+  EXPECT_EQ(hist.GetMin(), static_cast<uint64_t>(1));
+  EXPECT_EQ(hist.GetMax(), static_cast<uint64_t>(10000));
+  EXPECT_EQ(hist.GetSum(), static_cast<uint64_t>(10000 * 10001 / 2));
+  EXPECT_EQ(hist.GetQuantile(0), static_cast<uint64_t>(1));
+  EXPECT_EQ(hist.GetQuantile(1), static_cast<uint64_t>(10000));
+
+  // Small values are recorded exactly, the relative error of the others is within 1/32
+  EXPECT_EQ(hist.GetQuantile(0.005), static_cast<uint64_t>(50));
+  const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+  for (double q : quantiles) {
+    double exact = q * 10000;
+    double estim = hist.GetQuantile(q);
+    EXPECT_EQ(estim >= exact && estim <= exact * (1 + 1.0 / 32), true);
+  }
+
+  LogHistogram hist2;
+  hist2.Add(1000000, 10000);
+  hist.Merge(hist2);
+  EXPECT_EQ(hist.GetCount(), static_cast<uint64_t>(20000));
+  EXPECT_EQ(hist.GetMax(), static_cast<uint64_t>(1000000));
+  EXPECT_EQ(hist.GetQuantile(0.5) <= 10000 * (1 + 1.0 / 32), true);
+  EXPECT_EQ(hist.GetQuantile(0.51) >= 1000000 * (1 - 1.0 / 32), true);
+}
+
+TEST(TestConcurrentLogHistogram) {
+  ConcurrentLogHistogram  hist;
+  ThreadPool              pool(4);
+  const size_t            qty = 100000;
+
+  pool.ParallelRun(qty, [&](size_t i) { hist.Add(i % 1000); });
+
+  LogHistogram snapshot;
+  hist.GetSnapshot(snapshot);
+  EXPECT_EQ(snapshot.GetCount(), static_cast<uint64_t>(qty));
+  EXPECT_EQ(snapshot.GetSum(), static_cast<uint64_t>(qty / 1000 * (999 * 1000 / 2)));
+  EXPECT_EQ(snapshot.GetMin(), static_cast<uint64_t>(0));
+  EXPECT_EQ(snapshot.GetMax(), static_cast<uint64_t>(999));
+  EXPECT_EQ(snapshot.GetBucketCount(LogHistogram::BucketId(5)), static_cast<uint64_t>(qty / 1000));
+}
+
+}  // namespace similarity
@@ -0,0 +1,92 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <thread>
+#include <string>
+#include <vector>
+
+#include "bunit.h"
+#include "lru_cache.h"
+#include "thread_pool.h"
+
+namespace similarity {
+
+using std::string;
+using std::vector;
+
+TEST(TestLRUCacheEviction) {
+  // A single segment makes the eviction order predictable
+  LRUCache<int> cache(2, 0, 1);
+  int val = 0;
+
+  cache.Put("a", 1);
+  cache.Put("b", 2);
+  EXPECT_EQ(cache.Get("a", val), true); // "a" becomes the most recently used
+  EXPECT_EQ(val, 1);
+  cache.Put("c", 3);                    // "b" is evicted
+  EXPECT_EQ(cache.Get("b", val), false);
+  EXPECT_EQ(cache.Get("c", val), true);
+  EXPECT_EQ(val, 3);
+  EXPECT_EQ(cache.Size(), static_cast<size_t>(2));
+
+  EXPECT_EQ(cache.GetHitQty(), static_cast<uint64_t>(2));
+  EXPECT_EQ(cache.GetMissQty(), static_cast<uint64_t>(1));
+
+  cache.Clear();
+  EXPECT_EQ(cache.Size(), static_cast<size_t>(0));
+}
+
+TEST(TestLRUCacheTTL) {
+  LRUCache<int> cache(10, 20 /* msec */);
+  int val = 0;
+
+  cache.Put("a", 1);
+  EXPECT_EQ(cache.Get("a", val), true);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(cache.Get("a", val), false);
+}
+
+TEST(TestLRUCacheDisabled) {
+  LRUCache<int> cache(0, 0);
+  int val = 0;
+
+  EXPECT_EQ(cache.IsEnabled(), false);
+  cache.Put("a", 1);
+  EXPECT_EQ(cache.Get("a", val), false);
+}
+
+TEST(TestLRUCacheConcurrent) {
+  LRUCache<string> cache(100, 0);
+  ParallelFor(0, 10000, 4, [&](size_t id, size_t threadId) {
+    string key = ConvertToString(id % 200);
+    string val;
+    if (cache.Get(key, val)) {
+      if (val != key) throw std::runtime_error("Wrong cached value: " + val + " for key: " + key);
+    } else {
+      cache.Put(key, key);
+    }
+  });
+  EXPECT_EQ(cache.Size() <= 100 + 16 /* a segment may round the limit up */, true);
+  EXPECT_EQ(cache.GetHitQty() + cache.GetMissQty(), static_cast<uint64_t>(10000));
+}
+
+TEST(TestQueryCacheKey) {
+  float v1[] = {1, 2, 3}, v2[] = {1, 2, 4};
+  Object obj1(0, -1, sizeof(v1), v1), obj2(1, -1, sizeof(v2), v2);
+  EXPECT_EQ(CreateQueryCacheKey(&obj1, "k=10") == CreateQueryCacheKey(&obj1, "k=10"), true);
+  EXPECT_EQ(CreateQueryCacheKey(&obj1, "k=10") == CreateQueryCacheKey(&obj2, "k=10"), false);
+  EXPECT_EQ(CreateQueryCacheKey(&obj1, "k=10") == CreateQueryCacheKey(&obj1, "k=20"), false);
+}
+
+}  // namespace similarity
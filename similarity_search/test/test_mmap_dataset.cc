@@ -0,0 +1,182 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "bunit.h"
+#include "mmap_dataset.h"
+#include "space.h"
+#include "spacefactory.h"
+#include "space/space_vector.h"
+
+namespace similarity {
+
+using std::vector;
+using std::unique_ptr;
+
+const size_t MMAP_TEST_QTY = 100;
+const size_t MMAP_TEST_DIM = 128;
+
+template <typename elem_t>
+void WriteTestVecs(const string& fileName, const vector<vector<elem_t>>& data, bool binHeader) {
+  std::ofstream out(fileName, std::ios::binary);
+  if (binHeader) {
+    uint32_t qty = data.size(), dim = data[0].size();
+    writeBinaryPOD(out, qty);
+    writeBinaryPOD(out, dim);
+  }
+  for (const auto& v : data) {
+    if (!binHeader) {
+      int32_t dim = v.size();
+      writeBinaryPOD(out, dim);
+    }
+    out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(elem_t));
+  }
+}
+
+template <typename elem_t>
+vector<vector<elem_t>> GenTestVecs() {
+  vector<vector<elem_t>> res(MMAP_TEST_QTY, vector<elem_t>(MMAP_TEST_DIM));
+  for (size_t i = 0; i < MMAP_TEST_QTY; ++i)
+    for (size_t k = 0; k < MMAP_TEST_DIM; ++k)
+      res[i][k] = elem_t((i * 7 + k * 13) % 251);
+  return res;
+}
+
+template <typename elem_t>
+bool CheckDenseFile(const string& spaceType, const string& fileName, bool binHeader, size_t maxQty) {
+  vector<vector<elem_t>> data = GenTestVecs<elem_t>();
+  WriteTestVecs(fileName, data, binHeader);
+
+  unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().CreateSpace(spaceType, AnyParams()));
+  ObjectArena arena;
+  ObjectVector dataset;
+  vector<string> externIds;
+  ReadMmapDataset(*space, fileName, arena, dataset, externIds, maxQty, 4);
+  bool res = dataset.size() == std::min(maxQty ? maxQty : MAX_DATASET_QTY, MMAP_TEST_QTY) && externIds.size() == dataset.size();
+  const VectorSpace<float>* pVectSpace = dynamic_cast<const VectorSpace<float>*>(space.get());
+  for (size_t i = 0; res && i < dataset.size(); ++i) {
+    vector<float> v(MMAP_TEST_DIM);
+    pVectSpace->CreateDenseVectFromObj(dataset[i], &v[0], MMAP_TEST_DIM);
+    vector<float> expected(data[i].begin(), data[i].end());
+    res = arena.Owns(dataset[i]) && dataset[i]->id() == IdType(i) && expected == v;
+  }
+  remove(fileName.c_str());
+  return res;
+}
+
+TEST(TestMmapDatasetDense) {
+  EXPECT_EQ(CheckDenseFile<float>("l2", "tmp_mmap_test.fvecs", false, MAX_DATASET_QTY), true);
+  EXPECT_EQ(CheckDenseFile<int32_t>("l2", "tmp_mmap_test.ivecs", false, 10), true);
+  EXPECT_EQ(CheckDenseFile<uint8_t>("l1", "tmp_mmap_test.bvecs", false, MAX_DATASET_QTY), true);
+  EXPECT_EQ(CheckDenseFile<float>("linf", "tmp_mmap_test.fbin", true, 0), true);
+  EXPECT_EQ(CheckDenseFile<uint8_t>("l2", "tmp_mmap_test.u8bin", true, 50), true);
+}
+
+TEST(TestMmapDatasetSift) {
+  const string fileName = "tmp_mmap_test.bvecs";
+  vector<vector<uint8_t>> data = GenTestVecs<uint8_t>();
+  WriteTestVecs(fileName, data, false);
+
+  unique_ptr<Space<int>> space(SpaceFactoryRegistry<int>::Instance().CreateSpace("l2sqr_sift", AnyParams()));
+  ObjectArena arena;
+  ObjectVector dataset;
+  vector<string> externIds;
+  ReadMmapDataset(*space, fileName, arena, dataset, externIds);
+  EXPECT_EQ(dataset.size(), MMAP_TEST_QTY);
+  int dist = 0;
+  for (size_t k = 0; k < MMAP_TEST_DIM; ++k) {
+    int d = int(data[1][k]) - int(data[2][k]);
+    dist += d * d;
+  }
+  EXPECT_EQ(space->IndexTimeDistance(dataset[1], dataset[2]), dist);
+  remove(fileName.c_str());
+}
+
+TEST(TestMmapDatasetObjRecords) {
+  const string fileName = "tmp_mmap_test.objs";
+  ObjectVector orig;
+  for (size_t i = 0; i < MMAP_TEST_QTY; ++i) {
+    // Lengths vary to test the record padding
+    string s(i % 13, 'a' + i % 26);
+    orig.push_back(new Object(i * 2, i % 3, s.size(), s.data()));
+  }
+  WriteObjRecordsFile(orig, fileName);
+
+  ObjectVector dataset;
+  vector<string> externIds;
+  unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().CreateSpace("l2", AnyParams()));
+  ObjectArena arena;
+  ReadMmapDataset(*space, fileName, arena, dataset, externIds);
+  EXPECT_EQ(dataset.size(), orig.size());
+  EXPECT_EQ(externIds.size(), orig.size());
+  for (size_t i = 0; i < dataset.size(); ++i) {
+    EXPECT_EQ(dataset[i]->id(), orig[i]->id());
+    EXPECT_EQ(dataset[i]->label(), orig[i]->label());
+    EXPECT_EQ(dataset[i]->datalength(), orig[i]->datalength());
+    EXPECT_EQ(memcmp(dataset[i]->data(), orig[i]->data(), orig[i]->datalength()), 0);
+    EXPECT_EQ(arena.Owns(dataset[i]), true);
+    // Objects point into the mapped file rather than into the arena
+    EXPECT_EQ(arena.Owns(dataset[i]->buffer()), false);
+  }
+  for (const Object* pObj : orig) delete pObj;
+  remove(fileName.c_str());
+}
+
+TEST(TestMmapDatasetErrors) {
+  unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().CreateSpace("l2", AnyParams()));
+  unique_ptr<Space<float>> strSpace(SpaceFactoryRegistry<float>::Instance().CreateSpace("normleven", AnyParams()));
+  vector<vector<float>> data = GenTestVecs<float>();
+  const string fileName = "tmp_mmap_test.fvecs";
+
+  auto readFails = [&](const Space<float>& sp) {
+    ObjectArena arena;
+    ObjectVector dataset;
+    vector<string> externIds;
+    try {
+      ReadMmapDataset(sp, fileName, arena, dataset, externIds);
+    } catch (const std::exception&) {
+      return dataset.empty();
+    }
+    return false;
+  };
+
+  WriteTestVecs(fileName, data, false);
+  // The space isn't a dense vector space
+  EXPECT_EQ(readFails(*strSpace), true);
+
+  // Different dimensionalities
+  data[MMAP_TEST_QTY / 2].resize(MMAP_TEST_DIM / 2);
+  data[MMAP_TEST_QTY / 2 + 1].resize(MMAP_TEST_DIM * 3 / 2);
+  WriteTestVecs(fileName, data, false);
+  EXPECT_EQ(readFails(*space), true);
+
+  // A truncated file
+  data.resize(1);
+  data[0].resize(MMAP_TEST_DIM);
+  WriteTestVecs(fileName, data, false);
+  {
+    std::ofstream out(fileName, std::ios::binary | std::ios::app);
+    out.write("abc", 3);
+  }
+  EXPECT_EQ(readFails(*space), true);
+  remove(fileName.c_str());
+}
+
+}  // namespace similarity
@@ -0,0 +1,166 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "bunit.h"
+#include "object_arena.h"
+#include "space.h"
+#include "spacefactory.h"
+
+namespace similarity {
+
+using std::vector;
+using std::unique_ptr;
+
+TEST(TestObjectArena) {
+  const size_t qty = 1000;
+  // A small slab size to test allocation of multiple slabs and of records larger than a slab
+  ObjectArena arena(1024);
+
+  ObjectVector data, orig;
+  Object stackObj(-1, -1, 3, "abc");
+  {
+    ObjectArena::Region region(arena);
+    for (size_t i = 0; i < qty; ++i) {
+      string s(i % 17 + (i == 500 ? 4096 : 0), 'a' + i % 26);
+      data.push_back(region.NewObject(i, i % 7, s.size(), s.data()));
+    }
+  }
+  for (size_t i = 0; i < qty; ++i) orig.push_back(data[i]->Clone());
+  data.push_back(arena.NewObject(qty, 1, 3, "xyz"));
+  data.push_back(arena.NewObject(qty + 1, 1, 5, nullptr));
+
+  EXPECT_EQ(arena.MemoryUsed() >= qty * ObjectArena::RecordSize(0), true);
+  EXPECT_EQ(arena.Owns(&stackObj), false);
+
+  for (size_t i = 0; i < qty; ++i) {
+    EXPECT_EQ(arena.Owns(data[i]), true);
+    EXPECT_EQ(arena.Owns(data[i]->buffer()), true);
+    EXPECT_EQ(arena.Owns(orig[i]), false);
+    EXPECT_EQ(data[i]->id(), IdType(i));
+    EXPECT_EQ(data[i]->label(), LabelType(i % 7));
+    EXPECT_EQ(data[i]->datalength(), orig[i]->datalength());
+    EXPECT_EQ(memcmp(data[i]->data(), orig[i]->data(), orig[i]->datalength()), 0);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data[i]->data()) % ObjectArena::PAYLOAD_ALIGN, uintptr_t(0));
+    delete orig[i];
+  }
+  EXPECT_EQ(memcmp(data[qty]->data(), "xyz", 3), 0);
+  EXPECT_EQ(memcmp(data[qty + 1]->data(), "\0\0\0\0\0", 5), 0);
+
+  // Copies of objects created by the space are stored one after another in the id order
+  ObjectArena denseArena;
+  unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().CreateSpace("l2", AnyParams()));
+  ObjectVector dense;
+  {
+    ObjectArena::Region region(denseArena);
+    for (size_t i = 0; i < 10; ++i) {
+      string s = ConvertToString(i) + " 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0";
+      dense.push_back(region.Copy(space->CreateObjFromStr(i, EMPTY_LABEL, s, nullptr).get()));
+    }
+  }
+  for (size_t i = 1; i < dense.size(); ++i) {
+    EXPECT_EQ(denseArena.Owns(dense[i]), true);
+    EXPECT_EQ(dense[i]->buffer() - dense[i - 1]->buffer(), dense[1]->buffer() - dense[0]->buffer());
+  }
+  EXPECT_EQ(space->IndexTimeDistance(dense[0], dense[3]), 3.0f);
+  EXPECT_EQ(arena.Owns(dense[0]), false);
+}
+
+TEST(TestObjectArenaParallel) {
+  const size_t qty = 10000, dim = 7;
+  ObjectArena arena(64 * 1024);
+  ObjectVector data(1, nullptr);
+  CreateObjectsParallel(&arena, qty, 4, data, [&](size_t i) {
+    vector<float> vect(dim, float(i));
+    return new Object(i, -1, dim * sizeof(float), &vect[0]);
+  });
+  EXPECT_EQ(data.size(), qty + 1);
+  for (size_t i = 0; i < qty; ++i) {
+    EXPECT_EQ(arena.Owns(data[i + 1]), true);
+    EXPECT_EQ(data[i + 1]->id(), IdType(i));
+    EXPECT_EQ(reinterpret_cast<const float*>(data[i + 1]->data())[dim - 1], float(i));
+  }
+
+  // A failure leaves the dataset unchanged
+  bool thrown = false;
+  try {
+    CreateObjectsParallel(&arena, qty, 4, data, [&](size_t i) {
+      if (i == qty / 2) throw std::runtime_error("test");
+      return new Object(i, -1, 0, nullptr);
+    });
+  } catch (const std::exception&) {
+    thrown = true;
+  }
+  EXPECT_EQ(thrown, true);
+  EXPECT_EQ(data.size(), qty + 1);
+}
+
+TEST(TestObjectArenaRecords) {
+  const size_t qty = 100;
+  // Records of different lengths are written as they would be stored in a file
+  vector<unique_ptr<Object>> origObjs;
+  vector<uint64_t> buffer;
+  for (size_t i = 0; i < qty; ++i) {
+    string s(i % 13, 'a' + i % 26);
+    origObjs.emplace_back(new Object(i * 3, i % 5, s.size(), s.data()));
+    size_t recSize = ObjectArena::RecordSize(s.size());
+    EXPECT_EQ(recSize % ObjectArena::RECORD_ALIGN, size_t(0));
+    size_t offset = buffer.size() * sizeof(uint64_t);
+    buffer.resize(buffer.size() + recSize / sizeof(uint64_t));
+    memcpy(reinterpret_cast<char*>(&buffer[0]) + offset, origObjs.back()->buffer(), origObjs.back()->bufferlength());
+  }
+  std::shared_ptr<vector<uint64_t>> owner(new vector<uint64_t>(buffer));
+  const char* pRecs = reinterpret_cast<const char*>(&(*owner)[0]);
+  size_t size = owner->size() * sizeof(uint64_t);
+
+  ObjectVector data;
+  {
+    ObjectArena arena;
+    EXPECT_EQ(arena.AttachRecords(owner, pRecs, size, MAX_DATASET_QTY, data), qty);
+    EXPECT_EQ(arena.AttachRecords(owner, pRecs, size, 10, data), size_t(10));
+    // The arena keeps the owner of the records
+    EXPECT_EQ(owner.use_count(), long(3));
+    EXPECT_EQ(data.size(), qty + 10);
+    for (size_t i = 0; i < data.size(); ++i) {
+      const Object* pOrig = origObjs[i % qty].get();
+      EXPECT_EQ(arena.Owns(data[i]), true);
+      EXPECT_EQ(data[i]->id(), pOrig->id());
+      EXPECT_EQ(data[i]->label(), pOrig->label());
+      EXPECT_EQ(data[i]->datalength(), pOrig->datalength());
+      EXPECT_EQ(memcmp(data[i]->data(), pOrig->data(), pOrig->datalength()), 0);
+      // views point into the records
+      EXPECT_EQ(data[i]->buffer() >= pRecs && data[i]->buffer() < pRecs + size, true);
+    }
+
+    // Truncated records
+    bool thrown = false;
+    ObjectVector truncData;
+    try {
+      arena.AttachRecords(owner, pRecs, size - ObjectArena::RecordSize(origObjs.back()->datalength()) + 8,
+                          MAX_DATASET_QTY, truncData);
+    } catch (const std::exception&) {
+      thrown = true;
+    }
+    EXPECT_EQ(thrown, true);
+    EXPECT_EQ(truncData.empty(), true);
+  }
+  EXPECT_EQ(owner.use_count(), long(1));
+}
+
+}  // namespace similarity
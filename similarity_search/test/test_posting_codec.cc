@@ -0,0 +1,54 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <cstdint>
+#include <vector>
+
+#include "bunit.h"
+#include "utils.h"
+#include "posting_codec.h"
+
+namespace similarity {
+
+using std::vector;
+
+/*
+ * Differences of all byte lengths (1-4) are mixed, the number of integers
+ * is not necessarily a multiple of four (the SIMD decoder processes four at a time).
+ */
+TEST(TestStreamVByteDelta) {
+  for (size_t qty : {1, 3, 4, 5, 17, 64, 201}) {
+    for (uint32_t prev : {uint32_t(-1), uint32_t(0), uint32_t(1000)}) {
+      vector<uint32_t> vals(qty);
+      uint32_t curr = prev;
+      for (size_t i = 0; i < qty; ++i) {
+        const uint32_t maxGaps[] = {1U << 7, 1U << 15, 1U << 23, 1U << 26};
+        curr += 1 + RandomInt() % maxGaps[RandomInt() % 4];
+        vals[i] = curr;
+      }
+
+      vector<uint8_t> buf(StreamVByteMaxEncodedSize(qty) + STREAM_VBYTE_PADDING);
+      size_t len = StreamVByteDeltaEncode(&vals[0], qty, prev, &buf[0]);
+      EXPECT_EQ(len <= StreamVByteMaxEncodedSize(qty), true);
+
+      vector<uint32_t> decoded(qty), decodedScalar(qty);
+      EXPECT_EQ(StreamVByteDeltaDecode(&buf[0], qty, prev, &decoded[0]), len);
+      EXPECT_EQ(StreamVByteDeltaDecodeScalar(&buf[0], qty, prev, &decodedScalar[0]), len);
+      EXPECT_EQ(decoded == vals, true);
+      EXPECT_EQ(decodedScalar == vals, true);
+    }
+  }
+}
+
+}  // namespace similarity
@@ -0,0 +1,126 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bunit.h"
+#include "genrand_vect.h"
+#include "space.h"
+#include "space/space_vector.h"
+#include "spacefactory.h"
+#include "methodfactory.h"
+#include "knnquery.h"
+#include "rangequery.h"
+
+namespace similarity {
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+
+const size_t DEADLINE_TEST_DIM      = 16;
+const size_t DEADLINE_TEST_DATA_QTY = 2000;
+
+static void CreateDeadlineTestData(const Space<float>& space, ObjectVector& data) {
+  const VectorSpace<float>& vectSpace = dynamic_cast<const VectorSpace<float>&>(space);
+  vector<float> vect(DEADLINE_TEST_DIM);
+  for (size_t i = 0; i < DEADLINE_TEST_DATA_QTY; ++i) {
+    GenRandVect(&vect[0], DEADLINE_TEST_DIM);
+    data.push_back(vectSpace.CreateObjFromVect(i, -1, vect));
+  }
+}
+
+/*
+ * A query with an already expired deadline must stop early,
+ * return a (possibly empty) best-so-far result and be marked as truncated.
+ * A query without a deadline must not be affected.
+ */
+static void TestMethodDeadline(const string& methName, const AnyParams& indexParams,
+                               const AnyParams& queryTimeParams = AnyParams()) {
+  unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().CreateSpace("l2", AnyParams()));
+  ObjectVector data;
+  CreateDeadlineTestData(*space, data);
+
+  unique_ptr<Index<float>> index(MethodFactoryRegistry<float>::Instance().
+                                 CreateMethod(false, methName, "l2", *space, data));
+  index->CreateIndex(indexParams);
+  index->SetQueryTimeParams(queryTimeParams);
+
+  const unsigned K = 10;
+  unique_ptr<Object> queryObj(data[0]->Clone());
+
+  KNNQuery<float> fullQuery(*space, queryObj.get(), K);
+  index->Search(&fullQuery, -1);
+  EXPECT_EQ(fullQuery.IsTruncated(), false);
+  EXPECT_EQ(fullQuery.ResultSize(), K);
+
+  KNNQuery<float> truncQuery(*space, queryObj.get(), K);
+  truncQuery.SetDeadline(Query<float>::DeadlineClock::now());
+  index->Search(&truncQuery, -1);
+  EXPECT_EQ(truncQuery.IsTruncated(), true);
+  EXPECT_EQ(truncQuery.DistanceComputations() < fullQuery.DistanceComputations(), true);
+  EXPECT_EQ(truncQuery.ResultSize() <= K, true);
+
+  // A generous deadline doesn't change results
+  KNNQuery<float> longQuery(*space, queryObj.get(), K);
+  longQuery.SetTimeout(1000000000ULL);
+  index->Search(&longQuery, -1);
+  EXPECT_EQ(longQuery.IsTruncated(), false);
+  EXPECT_EQ(longQuery.DistanceComputations(), fullQuery.DistanceComputations());
+
+  for (auto e : data) delete e;
+}
+
+TEST(TestDeadlineSeqSearch) {
+  TestMethodDeadline("seq_search", AnyParams());
+  TestMethodDeadline("seq_search", AnyParams({"multiThread=1", "threadQty=2"}));
+}
+
+TEST(TestDeadlineVPTree) {
+  TestMethodDeadline("vptree", AnyParams({"bucketSize=10"}));
+}
+
+TEST(TestDeadlineSmallWorld) {
+  TestMethodDeadline("sw-graph", AnyParams({"NN=10", "efConstruction=50"}),
+                     AnyParams({"efSearch=100"}));
+}
+
+TEST(TestDeadlineHnsw) {
+  TestMethodDeadline("hnsw", AnyParams({"M=10", "efConstruction=50", "skip_optimized_index=1"}));
+}
+
+TEST(TestDeadlineRangeQuery) {
+  unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().CreateSpace("l2", AnyParams()));
+  ObjectVector data;
+  CreateDeadlineTestData(*space, data);
+
+  unique_ptr<Index<float>> index(MethodFactoryRegistry<float>::Instance().
+                                 CreateMethod(false, "seq_search", "l2", *space, data));
+  index->CreateIndex(AnyParams());
+
+  RangeQuery<float> query(*space, data[0], 1e6);
+  query.SetDeadline(Query<float>::DeadlineClock::now());
+  index->Search(&query, -1);
+  EXPECT_EQ(query.IsTruncated(), true);
+  EXPECT_EQ(query.ResultSize() < DEADLINE_TEST_DATA_QTY, true);
+
+  query.Reset();
+  EXPECT_EQ(query.IsTruncated(), false);
+
+  for (auto e : data) delete e;
+}
+
+}  // namespace similarity
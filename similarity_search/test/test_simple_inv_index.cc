@@ -0,0 +1,226 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bunit.h"
+#include "space.h"
+#include "spacefactory.h"
+#include "methodfactory.h"
+#include "knnquery.h"
+#include "knnqueue.h"
+#include "utils.h"
+
+namespace similarity {
+
+using std::vector;
+using std::string;
+using std::unique_ptr;
+using std::stringstream;
+
+// Frequent terms have small ids, a few values (document and query ones) are negative
+static string GenInvIndexTestStr(size_t termQty, size_t maxTermId) {
+  std::set<unsigned> ids;
+  while (ids.size() < termQty) {
+    float r = RandomReal<float>();
+    ids.insert(static_cast<unsigned>(r * r * maxTermId));
+  }
+  stringstream str;
+  for (unsigned id : ids) {
+    float val = 0.05f + RandomReal<float>();
+    if (RandomInt() % 10 == 0) val = -val;
+    str << id << ":" << val << " ";
+  }
+  return str.str();
+}
+
+static vector<float> GetSortedDists(KNNQuery<float>& query) {
+  vector<float> res;
+  unique_ptr<KNNQueue<float>> queue(query.Result()->Clone());
+  while (!queue->Empty()) {
+    res.push_back(queue->TopDistance());
+    queue->Pop();
+  }
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
+/*
+ * WAND, Block-Max WAND, and MaxScore skip documents using upper bounds,
+ * but they must return the same top-K distances as the exhaustive search.
+ */
+TEST(TestSimplInvIndexDynamicPruning) {
+  const size_t dataQty = 4000, queryQty = 30, maxTermId = 300;
+  const unsigned K = 10;
+  unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().
+                                 CreateSpace("negdotprod_sparse_fast", AnyParams()));
+  ObjectVector data;
+  for (size_t i = 0; i < dataQty; ++i) {
+    data.push_back(space->CreateObjFromStr(i, -1, GenInvIndexTestStr(5 + RandomInt() % 30, maxTermId), nullptr).release());
+  }
+
+  unique_ptr<Index<float>> index(MethodFactoryRegistry<float>::Instance().
+                                 CreateMethod(false, "simple_invindx", "negdotprod_sparse_fast", *space, data));
+  index->CreateIndex(AnyParams());
+
+  const string indexFile = "tmp_simple_invindx.bin";
+  index->SaveIndex(indexFile);
+  unique_ptr<Index<float>> loadedIndex(MethodFactoryRegistry<float>::Instance().
+                                       CreateMethod(false, "simple_invindx", "negdotprod_sparse_fast", *space, data));
+  loadedIndex->LoadIndex(indexFile);
+
+  for (size_t iq = 0; iq < queryQty; ++iq) {
+    unique_ptr<Object> queryObj(space->CreateObjFromStr(-1, -1, GenInvIndexTestStr(2 + iq % 15, maxTermId), nullptr));
+
+    KNNQuery<float> exactQuery(*space, queryObj.get(), K);
+    index->SetQueryTimeParams(AnyParams({"algoType=daat"}));
+    index->Search(&exactQuery, -1);
+    vector<float> exactDists = GetSortedDists(exactQuery);
+
+    for (const string& algo : vector<string>{"wand", "bmw", "maxscore"}) {
+      for (Index<float>* pIndex : {index.get(), loadedIndex.get()}) {
+        pIndex->SetQueryTimeParams(AnyParams({"algoType=" + algo}));
+        KNNQuery<float> query(*space, queryObj.get(), K);
+        pIndex->Search(&query, -1);
+        vector<float> dists = GetSortedDists(query);
+        EXPECT_EQ(dists.size(), exactDists.size());
+        for (size_t i = 0; i < std::min(dists.size(), exactDists.size()); ++i) {
+          EXPECT_EQ_EPS(dists[i], exactDists[i], 1e-4f);
+        }
+      }
+    }
+  }
+
+  bool thrown = false;
+  try {
+    index->SetQueryTimeParams(AnyParams({"algoType=unknown"}));
+  } catch (const std::exception&) {
+    thrown = true;
+  }
+  EXPECT_EQ(thrown, true);
+
+  for (auto e : data) delete e;
+  remove(indexFile.c_str());
+}
+
+/*
+ * Compressed posting lists have quantized values, but candidates are reranked
+ * using exact distances, so results must be the same as those of the exact search.
+ * A saved index is memory-mapped and must produce the same results as the index in memory.
+ * Truncated or corrupted index files must be rejected.
+ */
+TEST(TestSimplInvIndexCompressed) {
+  const size_t dataQty = 4000, queryQty = 30, maxTermId = 300;
+  const unsigned K = 10;
+  unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().
+                                 CreateSpace("negdotprod_sparse_fast", AnyParams()));
+  ObjectVector data;
+  for (size_t i = 0; i < dataQty; ++i) {
+    data.push_back(space->CreateObjFromStr(i, -1, GenInvIndexTestStr(5 + RandomInt() % 30, maxTermId), nullptr).release());
+  }
+
+  unique_ptr<Index<float>> index(MethodFactoryRegistry<float>::Instance().
+                                 CreateMethod(false, "simple_invindx", "negdotprod_sparse_fast", *space, data));
+  index->CreateIndex(AnyParams());
+  unique_ptr<Index<float>> compIndex(MethodFactoryRegistry<float>::Instance().
+                                     CreateMethod(false, "simple_invindx", "negdotprod_sparse_fast", *space, data));
+  compIndex->CreateIndex(AnyParams({"compress=1"}));
+
+  const string indexFile = "tmp_simple_invindx_comp.bin";
+  compIndex->SaveIndex(indexFile);
+  unique_ptr<Index<float>> loadedIndex(MethodFactoryRegistry<float>::Instance().
+                                       CreateMethod(false, "simple_invindx", "negdotprod_sparse_fast", *space, data));
+  loadedIndex->LoadIndex(indexFile);
+
+  for (const string& algo : vector<string>{"daat", "wand", "bmw", "maxscore"}) {
+    for (size_t iq = 0; iq < queryQty; ++iq) {
+      unique_ptr<Object> queryObj(space->CreateObjFromStr(-1, -1, GenInvIndexTestStr(2 + iq % 15, maxTermId), nullptr));
+
+      KNNQuery<float> exactQuery(*space, queryObj.get(), K);
+      index->SetQueryTimeParams(AnyParams({"algoType=daat"}));
+      index->Search(&exactQuery, -1);
+      vector<float> exactDists = GetSortedDists(exactQuery);
+
+      compIndex->SetQueryTimeParams(AnyParams({"algoType=" + algo}));
+      KNNQuery<float> query(*space, queryObj.get(), K);
+      compIndex->Search(&query, -1);
+      vector<float> dists = GetSortedDists(query);
+
+      loadedIndex->SetQueryTimeParams(AnyParams({"algoType=" + algo}));
+      KNNQuery<float> loadedQuery(*space, queryObj.get(), K);
+      loadedIndex->Search(&loadedQuery, -1);
+      EXPECT_EQ(GetSortedDists(loadedQuery) == dists, true);
+
+      EXPECT_EQ(dists.size(), exactDists.size());
+      for (size_t i = 0; i < std::min(dists.size(), exactDists.size()); ++i) {
+        EXPECT_EQ_EPS(dists[i], exactDists[i], 1e-4f);
+      }
+    }
+  }
+  // The file is rewritten below, so it must not be mapped
+  loadedIndex.reset();
+
+  string orig;
+  {
+    std::ifstream in(indexFile, std::ios::binary);
+    orig.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  auto loadFails = [&](const string& content) {
+    {
+      std::ofstream out(indexFile, std::ios::binary);
+      out.write(content.data(), content.size());
+    }
+    unique_ptr<Index<float>> badIndex(MethodFactoryRegistry<float>::Instance().
+                                      CreateMethod(false, "simple_invindx", "negdotprod_sparse_fast", *space, data));
+    try {
+      badIndex->LoadIndex(indexFile);
+    } catch (const std::exception&) {
+      return true;
+    }
+    return false;
+  };
+  EXPECT_EQ(loadFails(orig), false);
+  // The padding after the last block is missing
+  EXPECT_EQ(loadFails(orig.substr(0, orig.size() - 1)), true);
+  {
+    // The number of posting lists, whose descriptors' size overflows
+    string bad = orig;
+    uint64_t listQty = uint64_t(1) << 60;
+    memcpy(&bad[8], &listQty, sizeof(listQty));
+    EXPECT_EQ(loadFails(bad), true);
+  }
+  {
+    // The data offset of the first block of the first posting list
+    string bad = orig;
+    uint64_t listOffset;
+    memcpy(&listOffset, &bad[16], sizeof(listOffset));
+    uint32_t dataOffset = uint32_t(orig.size());
+    memcpy(&bad[listOffset + 4], &dataOffset, sizeof(dataOffset));
+    EXPECT_EQ(loadFails(bad), true);
+  }
+
+  for (auto e : data) delete e;
+  remove(indexFile.c_str());
+}
+
+}  // namespace similarity
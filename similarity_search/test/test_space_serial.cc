@@ -22,8 +22,12 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
 
 #include "bunit.h"
+#include "genrand_vect.h"
 #include "space.h"
 #include "spacefactory.h"
 #include "testdataset.h"
@@ -35,6 +39,8 @@
 #include "space/space_sparse_vector.h"
 #include "space/space_scalar.h"
 #include "space/space_word_embed.h"
+#include "space/space_vector.h"
+#include "space/space_l2sqr_sift.h"
 
 #define MAX_NUM_REC 10
 
@@ -220,6 +226,56 @@ TEST(Test_SparseVectorSpaceFast) {
   }
 }
 
+/*
+ * Binary data of fast sparse spaces has a format version: files saved
+ * in a different layout must be rejected rather than misread.
+ */
+TEST(Test_SparseVectorSpaceFastBinDataVersion) {
+  unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().CreateSpace("cosinesimil_sparse", AnyParams()));
+  unique_ptr<Space<float>> spaceFast(SpaceFactoryRegistry<float>::Instance().CreateSpace("cosinesimil_sparse_fast", AnyParams()));
+  const string fileName = "tmp_bin_data_version.bin";
+  ObjectVector data, dataFast;
+  vector<string> externIds(MAX_NUM_REC);
+  for (size_t i = 0; i < MAX_NUM_REC; ++i) {
+    stringstream line;
+    line << i << ":0.5 " << (i + 3) << ":" << (i + 1) << " 100000:2";
+    data.push_back(space->CreateObjFromStr(i, -1, line.str(), nullptr).release());
+    dataFast.push_back(spaceFast->CreateObjFromStr(i, -1, line.str(), nullptr).release());
+  }
+
+  auto readFails = [&](const Space<float>& sp) {
+    ObjectVector res;
+    vector<string> resExternIds;
+    try {
+      sp.ReadObjectVectorFromBinData(res, resExternIds, fileName);
+    } catch (const exception&) {
+      return res.empty();
+    }
+    for (auto e : res) delete e;
+    return false;
+  };
+
+  spaceFast->WriteObjectVectorBinData(dataFast, externIds, fileName);
+  ObjectVector res;
+  vector<string> resExternIds;
+  spaceFast->ReadObjectVectorFromBinData(res, resExternIds, fileName);
+  EXPECT_EQ(res.size(), dataFast.size());
+  for (size_t i = 0; i < std::min(res.size(), dataFast.size()); ++i) {
+    EXPECT_EQ(res[i]->datalength(), dataFast[i]->datalength());
+    EXPECT_EQ(memcmp(res[i]->data(), dataFast[i]->data(), dataFast[i]->datalength()), 0);
+  }
+  EXPECT_EQ(readFails(*space), true);
+
+  // A file without the version, e.g., saved before the format version was introduced
+  space->WriteObjectVectorBinData(data, externIds, fileName);
+  EXPECT_EQ(readFails(*spaceFast), true);
+
+  for (auto e : res) delete e;
+  for (auto e : data) delete e;
+  for (auto e : dataFast) delete e;
+  remove(fileName.c_str());
+}
+
 TEST(Test_StringSpace) {
   for (size_t maxNumRec = 1; maxNumRec < MAX_NUM_REC; ++maxNumRec) {
     for (unsigned binTest = 0; binTest < 2; ++binTest) {
@@ -266,6 +322,129 @@ TEST(Test_BitJaccard) {
   }
 }
 
+TEST(Test_HalfVectorSpace) {
+  vector<string> testVect;
+
+  for (size_t i = 0; i < MAX_NUM_REC; ++i) {
+    vector<float> vect(37);
+    GenRandVect(&vect[0], vect.size(), -1.0f, 1.0f);
+    stringstream ss;
+    for (size_t k = 0; k < vect.size(); ++k) {
+      if (k) ss << " ";
+      ss << vect[k];
+    }
+    testVect.push_back(ss.str());
+  }
+  for (string spaceName : {"l2_fp16", "l2_bf16", "cosinesimil_fp16", "negdotprod_bf16"}) {
+    for (size_t maxNumRec = 1; maxNumRec < MAX_NUM_REC; ++maxNumRec) {
+      for (unsigned binTest = 0; binTest < 2; ++binTest) {
+        EXPECT_EQ(true, fullTest<float>(binTest, testVect, maxNumRec, "tmp_out_file.txt", spaceName, emptyParams, false));
+      }
+    }
+  }
+}
+
+bool sameObjects(const Object* obj1, const Object* obj2) {
+  return obj1->id() == obj2->id() && obj1->label() == obj2->label() &&
+         obj1->datalength() == obj2->datalength() &&
+         !memcmp(obj1->data(), obj2->data(), obj1->datalength());
+}
+
+// Creating objects from arrays and from vectors should produce identical objects
+TEST(Test_CreateObjFromArray) {
+  const size_t dim = 17;
+  vector<float> vect(dim);
+  GenRandVect(&vect[0], dim, 0.1f, 1.0f);
+
+  for (string spaceName : {"l2", "cosinesimil", "negdotprod", "kldivgenfast", "kldivfast", "jsdivfast", "renyidiv_fast",
+                           "l2_fp16", "l2_bf16", "cosinesimil_fp16", "negdotprod_bf16"}) {
+    AnyParams params;
+    if (spaceName == "renyidiv_fast") params = AnyParams({"alpha=0.5"});
+    unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().CreateSpace(spaceName, params));
+    const VectorSpace<float>* vectSpace = dynamic_cast<const VectorSpace<float>*>(space.get());
+    EXPECT_EQ(vectSpace != nullptr, true);
+
+    unique_ptr<Object> objVect(vectSpace->CreateObjFromVect(1, 2, vect));
+    unique_ptr<Object> objArr(vectSpace->CreateObjFromArray(1, 2, &vect[0], dim));
+    EXPECT_EQ(sameObjects(objVect.get(), objArr.get()), true);
+  }
+
+  SpaceL2SqrSift siftSpace;
+  vector<uint8_t> siftVect(SIFT_DIM);
+  for (size_t i = 0; i < siftVect.size(); ++i) siftVect[i] = (i * 7) % 256;
+  unique_ptr<Object> siftObjVect(siftSpace.CreateObjFromUint8Vect(3, -1, siftVect));
+  unique_ptr<Object> siftObjArr(siftSpace.CreateObjFromUint8Array(3, -1, &siftVect[0], siftVect.size()));
+  EXPECT_EQ(sameObjects(siftObjVect.get(), siftObjArr.get()), true);
+}
+
+/*
+ * Reads a file sequentially and in parallel: the minimum chunk size is reduced, so that
+ * a small file is split into several chunks. Both reads must produce the same objects with the same ids.
+ */
+static void TestParallelRead(const string& spaceName, const vector<string>& lines, size_t emptyLineFreq) {
+  unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().CreateSpace(spaceName, AnyParams()));
+  const string fileName = "tmp_parallel_read.txt";
+  const size_t minChunkSize = 256 * 1024;
+  {
+    ofstream out(fileName.c_str());
+    size_t lineQty = 0;
+    for (size_t fileSize = 0; fileSize < 3 * minChunkSize; ++lineQty) {
+      const string& line = lines[lineQty % lines.size()];
+      out << line << "\n";
+      fileSize += line.size() + 1;
+      // runs of empty lines, which sparse vector spaces skip
+      if (emptyLineFreq && lineQty % emptyLineFreq == 0) {
+        out << string(lineQty % 3 + 1, '\n');
+        fileSize += lineQty % 3 + 1;
+      }
+    }
+  }
+
+  ObjectVector seqData, parData;
+  vector<string> seqExternIds, parExternIds;
+  space->ReadDataset(seqData, seqExternIds, fileName, MAX_DATASET_QTY, 1, nullptr, minChunkSize);
+  unique_ptr<DataFileInputState> parState(space->ReadDataset(parData, parExternIds, fileName, MAX_DATASET_QTY, 4,
+                                                             nullptr, minChunkSize));
+
+  EXPECT_EQ(seqData.size(), parData.size());
+  EXPECT_EQ(seqExternIds.size(), parExternIds.size());
+  for (size_t i = 0; i < std::min(seqData.size(), parData.size()); ++i) {
+    EXPECT_EQ(parData[i]->id(), IdType(i));
+    EXPECT_EQ(sameObjects(seqData[i], parData[i]), true);
+  }
+  const DataFileInputStateVec* pVecState = dynamic_cast<const DataFileInputStateVec*>(parState.get());
+  if (pVecState != nullptr) {
+    EXPECT_EQ(size_t(pVecState->dim_), space->GetElemQty(parData[0]));
+  }
+
+  for (auto e : seqData) delete e;
+  for (auto e : parData) delete e;
+  remove(fileName.c_str());
+}
+
+TEST(Test_ParallelReadDense) {
+  vector<string> lines;
+  vector<float> vect(8);
+  for (size_t i = 0; i < 100; ++i) {
+    GenRandVect(&vect[0], vect.size());
+    stringstream line;
+    if (i % 7 == 0) line << LABEL_PREFIX << i << " ";
+    for (size_t k = 0; k < vect.size(); ++k) line << vect[k] << " ";
+    lines.push_back(line.str());
+  }
+  TestParallelRead("l2", lines, 0);
+}
+
+TEST(Test_ParallelReadSparse) {
+  vector<string> lines;
+  for (size_t i = 0; i < 100; ++i) {
+    stringstream line;
+    for (size_t k = 0; k < i % 10 + 1; ++k) line << (k * 13 + i) << ":" << (0.5f + k) << " ";
+    lines.push_back(line.str());
+  }
+  TestParallelRead("cosinesimil_sparse", lines, 50);
+}
+
 #if defined(WITH_EXTRAS)
 TEST(Test_SQFD) {
   const char* sqfdParams[] = {"alpha=1", NULL} ;
@@ -0,0 +1,149 @@
+/**
+ * Non-metric Space Library
+ *
+ * Main developers: Bilegsaikhan Naidan, Leonid Boytsov, Yury Malkov, Ben Frederickson, David Novak
+ *
+ * For the complete list of contributors and further details see:
+ * https://github.com/nmslib/nmslib
+ *
+ * Copyright (c) 2013-2018
+ *
+ * This code is released under the
+ * Apache License Version 2.0 http://www.apache.org/licenses/.
+ *
+ */
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bunit.h"
+#include "space.h"
+#include "spacefactory.h"
+#include "knnquery.h"
+#include "utils.h"
+#include "space/space_sparse_dense_fusion.h"
+
+namespace similarity {
+
+using std::vector;
+using std::string;
+using std::unique_ptr;
+using std::ofstream;
+
+// A sparse vector is stored as a dense one with many zeros
+struct FusionTestEntry {
+  vector<vector<float>> comps_;
+};
+
+static float FusionTestScore(const FusionTestEntry& e1, const FusionTestEntry& e2, const vector<float>& weights) {
+  float res = 0;
+  for (size_t c = 0; c < weights.size(); ++c) {
+    if (weights[c] <= 0) continue;
+    float val = 0;
+    for (size_t k = 0; k < e1.comps_[c].size(); ++k) val += e1.comps_[c][k] * e2.comps_[c][k];
+    res += weights[c] * val;
+  }
+  return -res;
+}
+
+/*
+ * Components are located via the table of components, distances use precomputed norms
+ * to stop early. All forms of the distance must agree with the straightforward computation.
+ */
+TEST(TestSparseDenseFusion) {
+  const string weightFile = "tmp_fusion_weights.txt";
+  const string dataFile = "tmp_fusion_data.bin";
+  // Sparse and dense components, one query weight is zero (the component is ignored)
+  const vector<bool>     isSparse     = {true, false, true, false};
+  const vector<uint32_t> dims         = {200, 37, 50, 3};
+  const vector<float>    queryWeights = {0.5f, 1.0f, 0.0f, 2.0f};
+  const vector<float>    indexWeights = {1.0f, 0.25f, 1.0f, 1.0f};
+  const size_t           qty = 60;
+
+  {
+    ofstream out(weightFile);
+    out << "queryWeights:";
+    for (float w : queryWeights) out << " " << w;
+    out << std::endl << "indexWeights:";
+    for (float w : indexWeights) out << " " << w;
+    out << std::endl;
+  }
+
+  vector<FusionTestEntry> entries(qty);
+  {
+    ofstream out(dataFile, std::ios::binary);
+    writeBinaryPOD(out, uint32_t(qty));
+    writeBinaryPOD(out, uint32_t(dims.size()));
+    for (size_t c = 0; c < dims.size(); ++c) {
+      writeBinaryPOD(out, uint32_t(isSparse[c] ? 1 : 0));
+      writeBinaryPOD(out, dims[c]);
+    }
+    for (size_t i = 0; i < qty; ++i) {
+      string externId = "doc" + ConvertToString(i);
+      writeBinaryPOD(out, uint32_t(externId.size()));
+      out.write(externId.data(), externId.size());
+      for (size_t c = 0; c < dims.size(); ++c) {
+        vector<float> v(dims[c]);
+        if (isSparse[c]) {
+          vector<uint32_t> ids;
+          for (uint32_t k = 0; k < dims[c]; ++k) {
+            if (RandomInt() % 5 == 0) ids.push_back(k);
+          }
+          writeBinaryPOD(out, uint32_t(ids.size()));
+          for (uint32_t k : ids) {
+            v[k] = 0.1f + RandomReal<float>();
+            writeBinaryPOD(out, k);
+            writeBinaryPOD(out, v[k]);
+          }
+        } else {
+          writeBinaryPOD(out, dims[c]);
+          for (float& e : v) {
+            e = 2 * RandomReal<float>() - 1;
+            writeBinaryPOD(out, e);
+          }
+        }
+        entries[i].comps_.push_back(v);
+      }
+    }
+  }
+
+  unique_ptr<Space<float>> space(SpaceFactoryRegistry<float>::Instance().
+                                 CreateSpace(SPACE_SPARSE_DENSE_FUSION, AnyParams({"weightfilename=" + weightFile})));
+  ObjectVector   data;
+  vector<string> externIds;
+  unique_ptr<DataFileInputState> inpState(space->ReadDataset(data, externIds, dataFile));
+  space->UpdateParamsFromFile(*inpState);
+  EXPECT_EQ(data.size(), qty);
+
+  vector<float> out(qty);
+  for (size_t iq = 0; iq < 5; ++iq) {
+    const Object* queryObj = data[iq];
+    KNNQuery<float> query(*space, queryObj, 1);
+    query.DistanceObjLeftBatch(data.data(), qty, out.data());
+
+    for (size_t i = 0; i < qty; ++i) {
+      float expected = FusionTestScore(entries[i], entries[iq], queryWeights);
+      float tol = 1e-4f * (1 + std::abs(expected));
+      EXPECT_EQ_EPS(query.DistanceObjLeft(data[i]), expected, tol);
+      EXPECT_EQ_EPS(out[i], expected, tol);
+      EXPECT_EQ_EPS(space->ProxyDistance(data[i], queryObj),
+                    FusionTestScore(entries[i], entries[iq], indexWeights), tol);
+      // Bounded distances are exact within the bound and exceed the bound otherwise
+      for (float maxDist : {expected - 1.0f, expected, expected + 1.0f}) {
+        float d = query.DistanceObjLeftBounded(data[i], maxDist);
+        if (expected <= maxDist - tol) {
+          EXPECT_EQ_EPS(d, expected, tol);
+        } else if (expected > maxDist + tol) {
+          EXPECT_EQ(d > maxDist, true);
+        }
+      }
+    }
+  }
+
+  for (auto e : data) delete e;
+  remove(weightFile.c_str());
+  remove(dataFile.c_str());
+}
+
+}  // namespace similarity
@@ -15,9 +15,16 @@
 #if defined(WITH_EXTRAS)
 
 #include <string.h>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <sstream>
 #include "space.h"
 #include "bunit.h"
 #include "testdataset.h"
+#include "knnquery.h"
+#include "utils.h"
 #include "space_sqfd.h"
 
 namespace similarity {
@@ -118,6 +125,107 @@ TEST(Sqfd) {
   delete o;
 }
 
+// The straightforward computation: sqrt(w^T A w), where w = (w1, -w2)
+static double SqfdReference(const SqfdFunction<float>& f,
+                            const std::vector<std::vector<float>>& c1, const std::vector<float>& w1,
+                            const std::vector<std::vector<float>>& c2, const std::vector<float>& w2) {
+  std::vector<std::vector<float>> c(c1);
+  c.insert(c.end(), c2.begin(), c2.end());
+  std::vector<double> w(w1.begin(), w1.end());
+  for (float e : w2) w.push_back(-e);
+  double res = 0;
+  for (size_t i = 0; i < c.size(); ++i) {
+    for (size_t j = 0; j < c.size(); ++j) {
+      res += w[i] * w[j] * f.f(&c[i][0], &c[j][0], c[i].size());
+    }
+  }
+  return sqrt(std::max(0.0, res));
+}
+
+static void GenSqfdSignature(size_t num_clusters, size_t feature_dimension,
+                             std::vector<std::vector<float>>& c, std::vector<float>& w) {
+  c.resize(num_clusters);
+  w.resize(num_clusters);
+  for (size_t i = 0; i < num_clusters; ++i) {
+    c[i].resize(feature_dimension);
+    for (float& e : c[i]) e = RandomReal<float>();
+    w[i] = 0.05f + RandomReal<float>();
+  }
+}
+
+static std::string SqfdSignatureToStr(const std::vector<std::vector<float>>& c, const std::vector<float>& w) {
+  std::stringstream str;
+  // The first line is a file name
+  str << FAKE_FILE_NAME << std::endl;
+  str << std::setprecision(std::numeric_limits<float>::max_digits10);
+  for (size_t i = 0; i < c.size(); ++i) {
+    for (float e : c[i]) str << e << " ";
+    str << w[i] << std::endl;
+  }
+  return str.str();
+}
+
+/*
+ * Centroid similarities are computed via SIMD and self-similarity terms are cached.
+ * Distances must match the straightforward computation for all similarity functions,
+ * objects with and without cached terms, and the batch (one-to-many) form.
+ */
+TEST(Sqfd_Precomputed) {
+  std::vector<SqfdFunction<float>*> funcs = {
+    new SqfdMinusFunction<float>(), new SqfdHeuristicFunction<float>(1.0), new SqfdGaussianFunction<float>(0.5)
+  };
+  const size_t feature_dimension = 7;
+  for (SqfdFunction<float>* f : funcs) {
+    std::unique_ptr<SqfdFunction<float>> ref(f->Clone());
+    std::unique_ptr<Space<float>> space(new SpaceSqfd<float>(f));
+
+    std::vector<std::vector<float>> cq;
+    std::vector<float> wq;
+    GenSqfdSignature(13, feature_dimension, cq, wq);
+    std::unique_ptr<Object> q(space->CreateObjFromStr(-1, -1, SqfdSignatureToStr(cq, wq), NULL));
+    std::unique_ptr<Object> qNoCache(CreateSqfdObject(cq, wq));
+    EXPECT_EQ(q->datalength(), qNoCache->datalength() + sizeof(double));
+    // The same object, with and without the cached term
+    EXPECT_EQ(space->IndexTimeDistance(q.get(), q.get()), 0.0f);
+    EXPECT_EQ(space->IndexTimeDistance(qNoCache.get(), q.get()), 0.0f);
+
+    std::vector<std::unique_ptr<Object>> objHolder;
+    ObjectVector objs;
+    std::vector<double> expected;
+    for (size_t num_clusters : {1, 3, 8, 10, 17}) {
+      std::vector<std::vector<float>> co;
+      std::vector<float> wo;
+      GenSqfdSignature(num_clusters, feature_dimension, co, wo);
+      objHolder.emplace_back(space->CreateObjFromStr(objs.size(), -1, SqfdSignatureToStr(co, wo), NULL));
+      objs.push_back(objHolder.back().get());
+      std::unique_ptr<Object> tmp(CreateSqfdObject(co, wo));
+      // No term is cached here, hence, it is computed on the fly
+      float d = space->IndexTimeDistance(tmp.get(), q.get());
+      EXPECT_EQ_EPS(d, space->IndexTimeDistance(objs.back(), q.get()), 1e-5f);
+      expected.push_back(d);
+    }
+
+    KNNQuery<float> query(*space, q.get(), 1);
+    std::vector<float> out(objs.size());
+    query.DistanceObjLeftBatch(objs.data(), objs.size(), out.data());
+    for (size_t i = 0; i < objs.size(); ++i) {
+      EXPECT_EQ_EPS(out[i], query.DistanceObjLeft(objs[i]), 1e-5f);
+      EXPECT_EQ_EPS(double(out[i]), expected[i], 1e-4);
+    }
+    for (size_t i = 0; i < objs.size(); ++i) {
+      std::vector<std::vector<float>> co;
+      std::vector<float> wo;
+      const uint32_t* h = reinterpret_cast<const uint32_t*>(objs[i]->data());
+      const float* p = reinterpret_cast<const float*>(h + 2);
+      for (uint32_t k = 0; k < h[0]; ++k, p += h[1] + 1) {
+        co.push_back(std::vector<float>(p, p + h[1]));
+        wo.push_back(p[h[1]]);
+      }
+      EXPECT_EQ_EPS(double(out[i]), SqfdReference(*ref, co, wo, cq, wq), 1e-3);
+    }
+  }
+}
+
 }  // namespace similarity
 
 #endif
@@ -43,4 +43,44 @@ TEST(TestParallelForException) {
   }
   EXPECT_EQ(has_thrown, true);
 }
+
+TEST(TestThreadPoolParallelRun) {
+  ThreadPool pool(4);
+  EXPECT_EQ(pool.GetThreadQty(), static_cast<size_t>(4));
+  // The pool is reused across batches
+  for (size_t rep = 0; rep < 10; ++rep) {
+    std::vector<double> squares(1000);
+    pool.ParallelRun(squares.size(), [&](size_t id) {
+      squares[id] = id * id;
+    });
+    for (size_t i = 0; i < squares.size(); ++i) {
+      EXPECT_EQ(squares[i], static_cast<double>(i * i));
+    }
+  }
+}
+
+TEST(TestThreadPoolNestedRun) {
+  // nested calls shouldn't deadlock even if the pool is small
+  ThreadPool pool(1);
+  std::atomic<size_t> counter(0);
+  pool.ParallelRun(4, [&](size_t) {
+    pool.ParallelRun(4, [&](size_t) { ++counter; });
+  });
+  EXPECT_EQ(counter.load(), static_cast<size_t>(16));
+}
+
+TEST(TestThreadPoolException) {
+  ThreadPool pool(4);
+  bool has_thrown = false;
+  std::string message = "not gonna do it";
+  try {
+    pool.ParallelRun(1000, [&](size_t id) {
+      if (id == 50) throw std::invalid_argument(message);
+    });
+  } catch (const std::invalid_argument & e) {
+    EXPECT_EQ(message == e.what(), true);
+    has_thrown = true;
+  }
+  EXPECT_EQ(has_thrown, true);
+}
 }  // namespace similarity